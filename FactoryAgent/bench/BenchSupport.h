@@ -0,0 +1,135 @@
+#ifndef BENCH_SUPPORT_H
+#define BENCH_SUPPORT_H
+
+/*
+ * BenchSupport.h
+ * Timing, percentiles, peak memory and scratch files for the benchmark drivers.
+ * Every driver takes --quick, the small run ctest uses to check it still works
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <unistd.h>
+
+namespace BenchSupport {
+
+    class Stopwatch {
+    public:
+        Stopwatch() {
+            Restart();
+        }
+
+        void Restart() {
+            started_ = std::chrono::steady_clock::now();
+        }
+
+        double Seconds() const {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - started_).count();
+        }
+
+        double Millis() const {
+            return Seconds() * 1000.0;
+        }
+
+    private:
+        std::chrono::steady_clock::time_point started_;
+    };
+
+    // values is sorted in place; fraction 0.5 is the median
+    inline double Percentile(std::vector<double>& values, double fraction) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        size_t index = (size_t)(fraction * (double)(values.size() - 1) + 0.5);
+        return values[std::min(index, values.size() - 1)];
+    }
+
+    inline bool HasFlag(int argc, char** argv, const char* flag) {
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], flag) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Value after "--name", or fallback when absent
+    inline long long IntOption(int argc, char** argv, const char* name, long long fallback) {
+        for (int i = 1; i + 1 < argc; i++) {
+            if (strcmp(argv[i], name) == 0) {
+                return atoll(argv[i + 1]);
+            }
+        }
+        return fallback;
+    }
+
+    inline std::string StringOption(int argc, char** argv, const char* name, const std::string& fallback) {
+        for (int i = 1; i + 1 < argc; i++) {
+            if (strcmp(argv[i], name) == 0) {
+                return argv[i + 1];
+            }
+        }
+        return fallback;
+    }
+
+    // VmHWM: the most resident memory the process has had so far
+    inline long long PeakRssKb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmHWM:") == 0) {
+                return atoll(line.c_str() + 6);
+            }
+        }
+        return 0;
+    }
+
+    // Resets VmHWM to the current RSS, so the next peak belongs to the next phase
+    inline void ResetPeakRss() {
+        std::ofstream clear("/proc/self/clear_refs");
+        clear << "5";
+    }
+
+    // A fresh directory under $TMPDIR (or /tmp) for files a run creates
+    inline std::string MakeScratchDir(const char* tag) {
+        const char* base = getenv("TMPDIR");
+        std::string pattern = std::string(base ? base : "/tmp") + "/" + tag + "XXXXXX";
+        std::vector<char> path(pattern.begin(), pattern.end());
+        path.push_back('\0');
+        return mkdtemp(path.data()) ? std::string(path.data()) : std::string();
+    }
+
+    inline void RemoveTree(const std::string& path) {
+        if (!path.empty()) {
+            std::error_code ignored;
+            std::filesystem::remove_all(path, ignored);
+        }
+    }
+
+    // Deterministic, poorly compressible bytes
+    inline std::string MakePayload(size_t size, unsigned seed) {
+        std::string data(size, '\0');
+        unsigned state = seed * 2654435761u + 1;
+        for (size_t i = 0; i < size; i++) {
+            state = state * 1103515245u + 12345u;
+            data[i] = (char)(state >> 16);
+        }
+        return data;
+    }
+
+    inline bool WriteFile(const std::string& path, const std::string& data) {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(data.data(), (std::streamsize)data.size());
+        return (bool)file;
+    }
+}
+
+#endif
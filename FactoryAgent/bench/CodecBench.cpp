@@ -0,0 +1,163 @@
+/*
+ * CodecBench.cpp
+ * The three payloads the agent sends most, built the way the services build
+ * them: a heartbeat (with and without the interval metrics summary), a full
+ * log-tree sync from LogIndex over a generated folder, and a model sync. For
+ * JSON, CBOR and MessagePack it reports the body bytes, what gzip leaves of
+ * them when the client would compress, and the median encode and decode time.
+ * Every decoded body must equal the payload it came from
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/services/LogIndex.h"
+#include "../include/utilities/WireCodec.h"
+#include "../include/utilities/CompressionUtils.h"
+#include "../include/common/Constants.h"
+#include "BenchSupport.h"
+#include <fstream>
+#include <cstdio>
+
+using namespace BenchSupport;
+
+namespace fs = std::filesystem;
+
+namespace {
+    const WireEncoding ENCODINGS[] = { WIRE_ENCODING_JSON, WIRE_ENCODING_CBOR, WIRE_ENCODING_MSGPACK };
+
+    // As HeartbeatService::SendHeartbeat: the metrics summary rides along about once a minute
+    json BuildHeartbeat(HttpClient* client) {
+        json request;
+        request["pcId"] = 12;
+        request["isApplicationRunning"] = true;
+        request["commandsOnChannel"] = true;
+        if (client) {
+            request["metrics"] = client->CollectMetricsSummary();
+        }
+        return request;
+    }
+
+    // A metrics summary needs traffic to summarize: the calls an agent makes in a minute or so
+    bool MakeTraffic(HttpClient& client) {
+        json registration;
+        registration["lineNumber"] = 1;
+        registration["pcNumber"] = 12;
+        json response;
+        bool ok = client.Post(AgentConstants::ENDPOINT_REGISTER, registration, response);
+        for (int i = 0; i < 20 && ok; i++) {
+            ok = client.Post(AgentConstants::ENDPOINT_HEARTBEAT, BuildHeartbeat(NULL), response);
+        }
+        json models;
+        models["pcId"] = 12;
+        models["models"] = json::array();
+        for (int i = 0; i < 5 && ok; i++) {
+            ok = client.Post(AgentConstants::ENDPOINT_SYNC_MODELS, models, response);
+        }
+        return ok;
+    }
+
+    // As LogService::SyncLogsToServer sends a whole tree
+    json BuildLogSync(const std::string& scratch, int days) {
+        fs::path root = fs::path(scratch) / "logs";
+        for (int day = 0; day < days; day++) {
+            for (int camera = 0; camera < 10; camera++) {
+                fs::path folder = root / ("2025-10-" + std::to_string(10 + day)) / ("cam" + std::to_string(camera));
+                fs::create_directories(folder);
+                for (int file = 0; file < 20; file++) {
+                    std::ofstream((folder / ("inspection_" + std::to_string(file) + ".log")).string().c_str())
+                        << std::string((size_t)(file * 37), 'x');
+                }
+            }
+        }
+
+        LogIndex index(scratch + "/index.snapshot");
+        index.Refresh(root.string());
+        json request;
+        request["pcId"] = 12;
+        request["logStructureJson"] = index.SerializeTree();
+        request["version"] = index.GetVersion();
+        return request;
+    }
+
+    // As ModelService::SyncModelsToServer
+    json BuildModelSync(int count) {
+        json models = json::array();
+        for (int i = 0; i < count; i++) {
+            json model;
+            model["ModelName"] = "MODEL_" + std::to_string(1000 + i);
+            model["ModelPath"] = "D:\\LEADER_TEST\\INSPECTION\\MODEL_" + std::to_string(1000 + i);
+            model["IsCurrent"] = i == 7;
+            models.push_back(model);
+        }
+        json request;
+        request["pcId"] = 12;
+        request["models"] = models;
+        return request;
+    }
+
+    bool Report(const char* name, const json& payload, int repeats) {
+        bool matched = true;
+        for (size_t e = 0; e < sizeof(ENCODINGS) / sizeof(ENCODINGS[0]); e++) {
+            WireEncoding encoding = ENCODINGS[e];
+            std::string body;
+            std::vector<double> encodeMicros;
+            std::vector<double> decodeMicros;
+            json decoded;
+            for (int i = 0; i < repeats; i++) {
+                Stopwatch encode;
+                WireCodec::Encode(payload, encoding, body);
+                encodeMicros.push_back(encode.Seconds() * 1e6);
+
+                Stopwatch decode;
+                WireCodec::Decode(body, WireCodec::ContentType(encoding), decoded);
+                decodeMicros.push_back(decode.Seconds() * 1e6);
+            }
+            matched = matched && decoded == payload;
+
+            // HttpClient gzips bodies from COMPRESSION_MIN_BYTES up
+            std::string compressed;
+            size_t wire = body.size();
+            if ((int)body.size() >= AgentConstants::COMPRESSION_MIN_BYTES &&
+                CompressionUtils::GzipCompress(body, compressed) && compressed.size() < body.size()) {
+                wire = compressed.size();
+            }
+            printf("%-18s %-8s %10zu B  %10zu B gzip  encode %9.1f us  decode %9.1f us\n", name,
+                WireCodec::Name(encoding), body.size(), wire, Percentile(encodeMicros, 0.5),
+                Percentile(decodeMicros, 0.5));
+        }
+        return matched;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    int repeats = (int)IntOption(argc, argv, "--repeats", quick ? 5 : 200);
+    int days = (int)IntOption(argc, argv, "--days", quick ? 3 : 30);
+
+    StandInServer server;
+    if (!server.Start(0)) {
+        fprintf(stderr, "stand-in server did not start\n");
+        return 1;
+    }
+    HttpClient client(server.GetBaseUrl());
+    if (!MakeTraffic(client)) {
+        fprintf(stderr, "requests to the stand-in server failed\n");
+        return 1;
+    }
+    server.Stop();
+
+    std::string scratch = MakeScratchDir("codecbench");
+    json logSync = BuildLogSync(scratch, days);
+    RemoveTree(scratch);
+
+    bool matched = Report("heartbeat", BuildHeartbeat(NULL), repeats);
+    matched = Report("heartbeat+metrics", BuildHeartbeat(&client), repeats) && matched;
+    matched = Report("log tree", logSync, repeats) && matched;
+    matched = Report("model sync", BuildModelSync(200), repeats) && matched;
+
+    if (!matched) {
+        fprintf(stderr, "a decoded body differs from its payload\n");
+        return 1;
+    }
+    return 0;
+}
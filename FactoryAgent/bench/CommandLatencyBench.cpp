@@ -0,0 +1,177 @@
+/*
+ * CommandLatencyBench.cpp
+ * Time from a command being queued on StandInServer to its result being
+ * posted back, once with commands delivered by the heartbeat only and once
+ * with the command channel open. Commands are queued at random points in the
+ * heartbeat cycle, as a dashboard user would. Also reports how long
+ * CommandChannel::Stop takes with the channel open
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/services/CommandChannel.h"
+#include "../include/services/HeartbeatService.h"
+#include "../include/common/Constants.h"
+#include "BenchSupport.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <random>
+#include <cstdio>
+
+using namespace BenchSupport;
+
+namespace {
+    // Posts a result for every command it is handed, on its own thread like CommandExecutor
+    class ResultPoster {
+    public:
+        explicit ResultPoster(HttpClient* client) : client_(client), stop_(false) {
+            thread_ = std::thread(&ResultPoster::Run, this);
+        }
+
+        ~ResultPoster() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            queued_.notify_one();
+            thread_.join();
+        }
+
+        void Enqueue(const json& commands) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                batches_.push_back(commands);
+            }
+            queued_.notify_one();
+        }
+
+    private:
+        HttpClient* client_;
+        bool stop_;
+        std::mutex mutex_;
+        std::condition_variable queued_;
+        std::deque<json> batches_;
+        std::thread thread_;
+
+        void Run() {
+            while (true) {
+                json batch;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    queued_.wait(lock, [this]() { return stop_ || !batches_.empty(); });
+                    if (stop_) {
+                        return;
+                    }
+                    batch = batches_.front();
+                    batches_.pop_front();
+                }
+
+                for (size_t i = 0; i < batch.size(); i++) {
+                    json result;
+                    result["commandId"] = batch[i]["commandId"];
+                    result["status"] = "Completed";
+                    result["resultData"] = "{\"content\":\"x\"}";
+                    result["errorMessage"] = "";
+                    json response;
+                    client_->Post(AgentConstants::ENDPOINT_COMMAND_RESULT, result, response);
+                }
+            }
+        }
+
+        ResultPoster(const ResultPoster&);
+        ResultPoster& operator=(const ResultPoster&);
+    };
+
+    bool MeasureLatency(bool useChannel, int commands, int intervalMs) {
+        StandInServer server;
+        server.SetCommandChannelEnabled(useChannel);
+        if (!server.Start(0)) {
+            fprintf(stderr, "stand-in server did not start\n");
+            return false;
+        }
+        HttpClient client(server.GetBaseUrl());
+        ResultPoster poster(&client);
+        CommandChannel channel(&client, [&poster](const json& batch) { poster.Enqueue(batch); });
+        if (useChannel) {
+            channel.Start(1);
+        }
+
+        // The heartbeat loop from AgentCore, at the given interval
+        HeartbeatService heartbeat([&poster](const json& batch) { poster.Enqueue(batch); });
+        std::atomic<bool> stop(false);
+        std::thread beats([&]() {
+            while (!stop) {
+                json batch;
+                if (heartbeat.SendHeartbeat(1, true, &client, channel.IsConnected() ? NULL : &batch) &&
+                    !batch.empty()) {
+                    poster.Enqueue(batch);
+                }
+                for (int waited = 0; waited < intervalMs && !stop; waited += 10) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+        std::mt19937 random(7);
+        std::vector<double> millis;
+        for (int i = 0; i < commands; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(random() % intervalMs));
+            size_t before = server.GetCommandResults().size();
+
+            json command;
+            command["commandId"] = i + 1;
+            command["commandType"] = "GetLogFileContent";
+            command["commandData"] = "{}";
+            Stopwatch watch;
+            server.QueueCommand(command);
+            while (server.GetCommandResults().size() == before) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            millis.push_back(watch.Millis());
+        }
+
+        stop = true;
+        beats.join();
+        channel.Stop();
+        server.Stop();
+
+        printf("%-9s %3d commands  p50 %8.2f ms  p90 %8.2f ms  max %8.2f ms\n", useChannel ? "channel" : "heartbeat",
+            commands, Percentile(millis, 0.50), Percentile(millis, 0.90), Percentile(millis, 1.0));
+        return true;
+    }
+
+    bool MeasureStop() {
+        StandInServer server;
+        if (!server.Start(0)) {
+            return false;
+        }
+        HttpClient client(server.GetBaseUrl());
+        CommandChannel channel(&client, [](const json&) {});
+        channel.Start(1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+        Stopwatch watch;
+        channel.Stop();
+        double stopMs = watch.Millis();
+        server.Stop();
+        printf("CommandChannel::Stop with the channel open took %.1f ms\n", stopMs);
+        return stopMs < 1000.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    int commands = (int)IntOption(argc, argv, "--commands", quick ? 5 : 40);
+    int intervalMs = (int)IntOption(argc, argv, "--interval-ms",
+        quick ? 1000 : AgentConstants::HEARTBEAT_INTERVAL_SECONDS * 1000);
+
+    printf("heartbeat every %d ms\n", intervalMs);
+    if (!MeasureLatency(false, commands, intervalMs) || !MeasureLatency(true, commands, intervalMs)) {
+        return 1;
+    }
+    return MeasureStop() ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+/*
+ * DirectoryScanBench.cpp
+ * Recursive scans of generated line/device/day log trees of 10k, 100k and 1M
+ * files: std::filesystem's iterator with a file_size and last_write_time per
+ * file, as the tree builders used to walk, against DirectoryScanner. Each tree
+ * is scanned once to warm the page cache before it is timed; --files picks one
+ * size instead of all three
+ */
+
+#include "../include/utilities/DirectoryScanner.h"
+#include "BenchSupport.h"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace BenchSupport;
+
+namespace fs = std::filesystem;
+
+namespace {
+    const int LINES = 10;
+    const int FILES_PER_DAY = 20;
+
+    // LINES lines of devices, each device with a folder per day of FILES_PER_DAY logs
+    void GenerateTree(const fs::path& root, int files) {
+        int days = files / FILES_PER_DAY;
+        int devicesPerLine = std::max(1, (int)std::sqrt((double)days / LINES));
+        for (int day = 0; day < days; day++) {
+            int device = day % (LINES * devicesPerLine);
+            fs::path folder = root / ("Line" + std::to_string(device % LINES)) /
+                ("Dev" + std::to_string(device / LINES)) / ("day" + std::to_string(day));
+            fs::create_directories(folder);
+            for (int file = 0; file < FILES_PER_DAY; file++) {
+                std::ofstream((folder / ("cycle" + std::to_string(file) + ".log")).string().c_str()) << file;
+            }
+        }
+    }
+
+    // checksum sums sizes and write times, so the two scans agree only if both match file by file
+    double IteratorScan(const fs::path& root, size_t& files, unsigned long long& checksum) {
+        Stopwatch watch;
+        files = 0;
+        checksum = 0;
+        for (fs::recursive_directory_iterator it(root); it != fs::recursive_directory_iterator(); ++it) {
+            if (it->is_regular_file()) {
+                checksum += fs::file_size(it->path());
+                checksum += (unsigned long long)fs::last_write_time(it->path()).time_since_epoch().count();
+                files++;
+            }
+        }
+        return watch.Millis();
+    }
+
+    double ScannerScan(const fs::path& root, DirectoryScanner& scanner, size_t& files, unsigned long long& checksum) {
+        Stopwatch watch;
+        std::vector<ScanEntry> entries;
+        scanner.Scan(root.string(), true, entries);
+        double millis = watch.Millis();
+        files = 0;
+        checksum = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!entries[i].isDirectory) {
+                checksum += entries[i].size + (unsigned long long)entries[i].writeTime;
+                files++;
+            }
+        }
+        return millis;
+    }
+
+    bool RunSize(const std::string& scratch, int files) {
+        fs::path root = fs::path(scratch) / ("tree" + std::to_string(files));
+        Stopwatch watch;
+        GenerateTree(root, files);
+        printf("%d files generated in %.1f s\n", files, watch.Seconds());
+
+        size_t iteratorFiles = 0;
+        size_t scannerFiles = 0;
+        unsigned long long iteratorChecksum = 0;
+        unsigned long long scannerChecksum = 0;
+        DirectoryScanner scanner;
+        IteratorScan(root, iteratorFiles, iteratorChecksum);
+        double iteratorMs = IteratorScan(root, iteratorFiles, iteratorChecksum);
+        double scannerMs = ScannerScan(root, scanner, scannerFiles, scannerChecksum);
+
+        printf("%8d files  iterator %9.1f ms  scanner %9.1f ms (%d folders, %d threads)  %.1fx\n", files,
+            iteratorMs, scannerMs, scanner.GetStats().folders, scanner.GetStats().threads, iteratorMs / scannerMs);
+        RemoveTree(root.string());
+
+        if (iteratorFiles != scannerFiles || iteratorChecksum != scannerChecksum) {
+            fprintf(stderr, "scanner found %zu files (checksum %llu); iterator %zu files (checksum %llu)\n",
+                scannerFiles, scannerChecksum, iteratorFiles, iteratorChecksum);
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    std::vector<int> sizes;
+    long long only = IntOption(argc, argv, "--files", quick ? 2000 : 0);
+    if (only > 0) {
+        sizes.push_back((int)only);
+    }
+    else {
+        sizes.push_back(10000);
+        sizes.push_back(100000);
+        sizes.push_back(1000000);
+    }
+
+    std::string scratch = MakeScratchDir("scanbench");
+    bool matched = true;
+    for (size_t i = 0; i < sizes.size() && matched; i++) {
+        matched = RunSize(scratch, sizes[i]);
+    }
+    RemoveTree(scratch);
+    return matched ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+/*
+ * DownloadBench.cpp
+ * A large model served by StandInServer over a simulated long link (--rtt-ms
+ * per 256 KB window, so one stream tops out at 256 KB per round trip), fetched
+ * on one stream and as parallel byte-range segments: wall time, throughput and
+ * the speedup. Both copies are checked against the server's SHA-256
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/utilities/Sha256.h"
+#include "BenchSupport.h"
+#include <cstdio>
+
+using namespace BenchSupport;
+
+namespace {
+    const char* const MODEL_URL = "/api/agent/downloadmodel/1";
+
+    // Seconds for one download, or a negative value when it failed
+    double TimeDownload(HttpClient& client, const std::string& outputPath, const std::string& digest) {
+        Stopwatch watch;
+        if (!client.DownloadFile(MODEL_URL, outputPath, digest)) {
+            return -1;
+        }
+        return watch.Seconds();
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    long long megabytes = IntOption(argc, argv, "--mb", quick ? 8 : 256);
+    int roundTripMs = (int)IntOption(argc, argv, "--rtt-ms", quick ? 5 : 20);
+
+    StandInServer server;
+    if (!server.Start(0)) {
+        fprintf(stderr, "stand-in server did not start\n");
+        return 1;
+    }
+    std::string payload = MakePayload((size_t)(megabytes * 1024 * 1024), 11);
+    std::string digest = Sha256::HashString(payload);
+    server.SetModelPayload(payload);
+    payload.clear();
+    server.SetDownloadRoundTrip(roundTripMs);
+
+    std::string scratch = MakeScratchDir("downloadbench");
+    HttpClient client(server.GetBaseUrl());
+
+    client.SetSegmentedDownloadThreshold(0);
+    double single = TimeDownload(client, scratch + "/single.bin", digest);
+
+    // Every size this run uses is over the threshold, so the segmented path is taken even with --mb 1
+    client.SetSegmentedDownloadThreshold(1);
+    double segmented = TimeDownload(client, scratch + "/segmented.bin", digest);
+
+    RemoveTree(scratch);
+    server.Stop();
+
+    if (single < 0 || segmented < 0) {
+        fprintf(stderr, "download failed or did not match the server's digest\n");
+        return 1;
+    }
+    printf("%lld MB, %d ms round trip per 256 KB window\n", megabytes, roundTripMs);
+    printf("single stream  %8.2f s  %8.1f MB/s\n", single, (double)megabytes / single);
+    printf("segmented      %8.2f s  %8.1f MB/s  %.1fx\n", segmented, (double)megabytes / segmented,
+        single / segmented);
+    return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * FleetReconnectBench.cpp
+ * A fleet of simulated agents heartbeats against StandInServer, the server
+ * goes away and comes back, and the requests reaching it afterwards are
+ * counted in 2.5 s buckets. Run once with the fixed schedule the agent used
+ * to have and once with RetryPolicy's jittered backoff, to compare the load
+ * curve a restart produces. Agent time is scaled down (--scale-percent) so a run takes
+ * seconds; all figures are in agent time
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/network/RetryPolicy.h"
+#include "../include/common/Constants.h"
+#include "BenchSupport.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <cstdio>
+
+using namespace BenchSupport;
+
+namespace {
+    // The schedule AgentCore had before RetryPolicy
+    const int OLD_REGISTRATION_RETRIES = 3;
+    const int OLD_RETRY_DELAY_MS = 5000;
+    const int HEARTBEAT_MS = AgentConstants::HEARTBEAT_INTERVAL_SECONDS * 1000;
+
+    const int UP_BEFORE_MS = 40000;
+    const int DOWN_MS = 90000;
+    const int UP_AFTER_MS = 100000;
+    const int BUCKET_MS = 2500;
+
+    struct Attempt {
+        double atMs;
+        bool succeeded;
+    };
+
+    class Fleet {
+    public:
+        Fleet(HttpClient* client, double scale) : client_(client), scale_(scale), stop_(false) {
+        }
+
+        // Agent milliseconds since the run started
+        double Now() const {
+            return clock_.Millis() / scale_;
+        }
+
+        void Sleep(double agentMs) const {
+            if (agentMs > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds((long long)(agentMs * scale_ * 1000.0)));
+            }
+        }
+
+        bool Stopped() const {
+            return stop_;
+        }
+
+        void Stop() {
+            stop_ = true;
+        }
+
+        bool Call(const wchar_t* endpoint) {
+            json request;
+            request["pcId"] = 1;
+            request["lineNumber"] = 1;
+            request["pcNumber"] = 1;
+            request["isApplicationRunning"] = true;
+            json response;
+            bool succeeded = client_->Post(endpoint, request, response);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            Attempt attempt;
+            attempt.atMs = Now();
+            attempt.succeeded = succeeded;
+            attempts_.push_back(attempt);
+            return succeeded;
+        }
+
+        std::vector<Attempt> TakeAttempts() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return attempts_;
+        }
+
+    private:
+        HttpClient* client_;
+        double scale_;
+        Stopwatch clock_;
+        std::atomic<bool> stop_;
+        std::mutex mutex_;
+        std::vector<Attempt> attempts_;
+    };
+
+    void FixedScheduleAgent(Fleet& fleet) {
+        bool registered = false;
+        int retries = 0;
+        int failures = 0;
+        double nextBeat = 0;
+
+        while (!fleet.Stopped()) {
+            if (!registered) {
+                if (retries < OLD_REGISTRATION_RETRIES) {
+                    registered = fleet.Call(AgentConstants::ENDPOINT_REGISTER);
+                    if (!registered) {
+                        retries++;
+                        fleet.Sleep(OLD_RETRY_DELAY_MS);
+                        continue;
+                    }
+                }
+                else {
+                    fleet.Sleep(HEARTBEAT_MS);
+                    retries = 0;
+                    continue;
+                }
+                failures = 0;
+            }
+
+            if (fleet.Now() >= nextBeat) {
+                nextBeat = fleet.Now() + HEARTBEAT_MS;
+                if (fleet.Call(AgentConstants::ENDPOINT_HEARTBEAT)) {
+                    failures = 0;
+                }
+                else if (++failures >= AgentConstants::MAX_CONNECTION_FAILURES) {
+                    registered = false;
+                    retries = 0;
+                }
+            }
+            fleet.Sleep(nextBeat - fleet.Now());
+        }
+    }
+
+    void JitteredAgent(Fleet& fleet) {
+        RetryPolicy reconnect(AgentConstants::RECONNECT_BASE_DELAY_MS, AgentConstants::RECONNECT_MAX_DELAY_MS);
+        RetryPolicy heartbeatRetry(HEARTBEAT_MS, AgentConstants::HEARTBEAT_RETRY_MAX_DELAY_MS);
+        bool registered = false;
+        int failures = 0;
+        double nextBeat = 0;
+
+        while (!fleet.Stopped()) {
+            if (!registered) {
+                registered = fleet.Call(AgentConstants::ENDPOINT_REGISTER);
+                if (!registered) {
+                    fleet.Sleep(reconnect.NextDelayMs());
+                    continue;
+                }
+                reconnect.Reset();
+                heartbeatRetry.Reset();
+                failures = 0;
+                nextBeat = 0;
+            }
+
+            if (fleet.Now() >= nextBeat) {
+                nextBeat = fleet.Now() + HEARTBEAT_MS;
+                if (fleet.Call(AgentConstants::ENDPOINT_HEARTBEAT)) {
+                    failures = 0;
+                    heartbeatRetry.Reset();
+                }
+                else {
+                    nextBeat = fleet.Now() + heartbeatRetry.NextDelayMs();
+                    if (++failures >= AgentConstants::MAX_CONNECTION_FAILURES) {
+                        registered = false;
+                    }
+                }
+            }
+            fleet.Sleep(nextBeat - fleet.Now());
+        }
+    }
+
+    // Returns the busiest bucket after the restart, or -1 when the server could not come back
+    int RunFleet(bool jittered, int agents, double scale) {
+        StandInServer server;
+        if (!server.Start(0)) {
+            return -1;
+        }
+        int port = server.GetPort();
+        HttpClient client(server.GetBaseUrl());
+        Fleet fleet(&client, scale);
+
+        std::vector<std::thread> threads;
+        std::mt19937 random(agents);
+        for (int i = 0; i < agents; i++) {
+            double startAfter = (double)(random() % HEARTBEAT_MS);
+            threads.push_back(std::thread([&fleet, jittered, startAfter]() {
+                fleet.Sleep(startAfter);
+                if (jittered) {
+                    JitteredAgent(fleet);
+                }
+                else {
+                    FixedScheduleAgent(fleet);
+                }
+            }));
+        }
+
+        fleet.Sleep(UP_BEFORE_MS);
+        server.Stop();
+        double downAt = fleet.Now();
+        fleet.Sleep(DOWN_MS);
+        StandInServer restarted;
+        bool back = restarted.Start(port);
+        double upAt = fleet.Now();
+        fleet.Sleep(UP_AFTER_MS);
+        fleet.Stop();
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+        restarted.Stop();
+        if (!back) {
+            return -1;
+        }
+
+        std::vector<int> buckets(UP_AFTER_MS / BUCKET_MS, 0);
+        int attemptsWhileDown = 0;
+        std::vector<Attempt> attempts = fleet.TakeAttempts();
+        for (size_t i = 0; i < attempts.size(); i++) {
+            if (attempts[i].atMs >= downAt && attempts[i].atMs < upAt) {
+                attemptsWhileDown++;
+            }
+            if (attempts[i].atMs >= upAt && attempts[i].succeeded) {
+                size_t bucket = (size_t)((attempts[i].atMs - upAt) / BUCKET_MS);
+                if (bucket < buckets.size()) {
+                    buckets[bucket]++;
+                }
+            }
+        }
+
+        int peak = 0;
+        printf("%-8s requests per %.1f s after restart:", jittered ? "jittered" : "fixed", BUCKET_MS / 1000.0);
+        for (size_t i = 0; i < buckets.size(); i++) {
+            printf(" %d", buckets[i]);
+            peak = std::max(peak, buckets[i]);
+        }
+        printf("\n%-8s peak %d per bucket, %d attempts while the server was down\n",
+            jittered ? "jittered" : "fixed", peak, attemptsWhileDown);
+        return peak;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    int agents = (int)IntOption(argc, argv, "--agents", quick ? 60 : 300);
+    double scale = (double)IntOption(argc, argv, "--scale-percent", quick ? 2 : 10) / 100.0;
+
+    int fixedPeak = RunFleet(false, agents, scale);
+    int jitteredPeak = RunFleet(true, agents, scale);
+    if (fixedPeak < 0 || jitteredPeak < 0) {
+        fprintf(stderr, "stand-in server could not be restarted on its port\n");
+        return 1;
+    }
+    printf("%d agents: peak load after restart %d (fixed) vs %d (jittered)\n", agents, fixedPeak, jitteredPeak);
+    return 0;
+}
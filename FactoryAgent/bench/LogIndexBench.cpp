@@ -0,0 +1,175 @@
+/*
+ * LogIndexBench.cpp
+ * Cost of one log sync cycle on a large log folder: the full rescan the agent
+ * used to do (walk, JSON tree, dump, compare with the last text) against
+ * LogIndex::Refresh when nothing changed, when a live log grew and when a file
+ * was added, and a restart from the snapshot. The folder is generated
+ * in a scratch directory with day/camera/file levels like a real one
+ */
+
+#include "../include/services/LogIndex.h"
+#include "../include/utilities/StringUtils.h"
+#include "BenchSupport.h"
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+using namespace BenchSupport;
+
+namespace fs = std::filesystem;
+
+namespace {
+    const int CAMERAS_PER_DAY = 10;
+    const int FILES_PER_CAMERA = 100;
+
+    // The pre-index cycle: LogService::BuildDirectoryTree as it was before LogIndex
+    json BuildDirectoryTree(const fs::path& currentPath, const fs::path& rootPath) {
+        json children = json::array();
+        if (!fs::exists(currentPath) || !fs::is_directory(currentPath)) {
+            return children;
+        }
+        for (const auto& entry : fs::directory_iterator(currentPath)) {
+            json node;
+            node["name"] = entry.path().filename().string();
+            node["path"] = fs::relative(entry.path(), rootPath).string();
+            node["isDirectory"] = entry.is_directory();
+            if (entry.is_regular_file()) {
+                node["size"] = entry.file_size();
+                node["modifiedDate"] = StringUtils::FormatFileTime(fs::last_write_time(entry));
+            }
+            else if (entry.is_directory()) {
+                node["children"] = BuildDirectoryTree(entry.path(), rootPath);
+            }
+            children.push_back(node);
+        }
+        return children;
+    }
+
+    // directory_iterator order is unspecified; the index sorts by name
+    json SortedByName(json children) {
+        for (size_t i = 0; i < children.size(); i++) {
+            if (children[i].contains("children")) {
+                children[i]["children"] = SortedByName(children[i]["children"]);
+            }
+        }
+        std::sort(children.begin(), children.end(), [](const json& a, const json& b) {
+            return a["name"].get<std::string>() < b["name"].get<std::string>();
+        });
+        return children;
+    }
+
+    // Files are dated a month back, so only the live log counts as recently written
+    void GenerateLogFolder(const fs::path& root, int days) {
+        fs::file_time_type old = fs::file_time_type::clock::now() - std::chrono::hours(24 * 30);
+        for (int day = 0; day < days; day++) {
+            for (int camera = 0; camera < CAMERAS_PER_DAY; camera++) {
+                fs::path folder = root / ("2025-" + std::to_string(1000 + day)) / ("cam" + std::to_string(camera));
+                fs::create_directories(folder);
+                for (int file = 0; file < FILES_PER_CAMERA; file++) {
+                    fs::path path = folder / ("log" + std::to_string(file) + ".txt");
+                    std::ofstream(path.string().c_str()) << "x";
+                    fs::last_write_time(path, old);
+                }
+            }
+        }
+    }
+
+    void Append(const fs::path& path, const char* text) {
+        std::ofstream file(path.string().c_str(), std::ios::app);
+        file << text;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    int files = (int)IntOption(argc, argv, "--files", quick ? 5000 : 100000);
+    int cycles = (int)IntOption(argc, argv, "--cycles", quick ? 5 : 20);
+    int days = std::max(1, files / (CAMERAS_PER_DAY * FILES_PER_CAMERA));
+
+    std::string scratch = MakeScratchDir("logindexbench");
+    fs::path root = fs::path(scratch) / "Log";
+    std::string snapshot = (fs::path(scratch) / "log_index.json").string();
+    Stopwatch watch;
+    GenerateLogFolder(root, days);
+    printf("%d files in %d folders generated in %.1f s\n", days * CAMERAS_PER_DAY * FILES_PER_CAMERA,
+        days * (CAMERAS_PER_DAY + 1) + 1, watch.Seconds());
+
+    fs::path lastDay = root / ("2025-" + std::to_string(1000 + days - 1));
+    fs::path live = lastDay / "cam0" / "log0.txt";
+    Append(live, "y");
+
+    std::string last;
+    double rescanMs = 0;
+    for (int i = 0; i < cycles; i++) {
+        watch.Restart();
+        std::string current = BuildDirectoryTree(root, root).dump();
+        if (current != last) {
+            last = current;
+        }
+        rescanMs += watch.Millis();
+    }
+    printf("full rescan cycle            %9.2f ms\n", rescanMs / cycles);
+
+    LogIndex* index = new LogIndex(snapshot);
+    watch.Restart();
+    index->Refresh(root.string());
+    std::string built = index->SerializeTree();
+    printf("index first build            %9.2f ms\n", watch.Millis());
+    if (SortedByName(json::parse(built)) != SortedByName(json::parse(last))) {
+        fprintf(stderr, "index tree differs from the rescan\n");
+        RemoveTree(scratch);
+        return 1;
+    }
+
+    double idleMs = 0;
+    for (int i = 0; i < cycles; i++) {
+        watch.Restart();
+        if (index->Refresh(root.string())) {
+            index->SerializeTree();
+        }
+        idleMs += watch.Millis();
+    }
+    printf("index cycle, no change       %9.2f ms  (listed %d folders, checked %d of %d files)\n", idleMs / cycles,
+        index->GetStats().directoriesListed, index->GetStats().filesChecked, index->GetStats().files);
+
+    double liveMs = 0;
+    for (int i = 0; i < cycles; i++) {
+        Append(live, "more");
+        watch.Restart();
+        if (index->Refresh(root.string())) {
+            index->SerializeTree();
+        }
+        liveMs += watch.Millis();
+    }
+    printf("index cycle, live log grew   %9.2f ms\n", liveMs / cycles);
+
+    double addedMs = 0;
+    for (int i = 0; i < cycles; i++) {
+        std::ofstream((lastDay / "cam1" / ("new" + std::to_string(i) + ".txt")).string().c_str()) << "z";
+        watch.Restart();
+        if (index->Refresh(root.string())) {
+            index->SerializeTree();
+        }
+        addedMs += watch.Millis();
+    }
+    printf("index cycle, file added      %9.2f ms\n", addedMs / cycles);
+
+    std::string before = index->SerializeTree();
+    watch.Restart();
+    delete index;
+    printf("snapshot save                %9.2f ms  (%lld bytes)\n", watch.Millis(),
+        (long long)fs::file_size(snapshot));
+
+    watch.Restart();
+    index = new LogIndex(snapshot);
+    double loadMs = watch.Millis();
+    watch.Restart();
+    index->Refresh(root.string());
+    bool unchanged = index->SerializeTree() == before;
+    printf("restart: snapshot load %.2f ms, first refresh %.2f ms, tree unchanged %s\n", loadMs, watch.Millis(),
+        unchanged ? "yes" : "no");
+    delete index;
+
+    RemoveTree(scratch);
+    return unchanged ? 0 : 1;
+}
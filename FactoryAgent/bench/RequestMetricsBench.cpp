@@ -0,0 +1,100 @@
+/*
+ * RequestMetricsBench.cpp
+ * Cost of RequestMetrics::Record, which every HTTP exchange pays: one thread
+ * cycling through the endpoints an agent talks to, then four threads all
+ * recording the heartbeat endpoint at once so they fight over the same
+ * counters. Fails when either averages above 1 us per call
+ */
+
+#include "../include/network/RequestMetrics.h"
+#include "../include/common/Constants.h"
+#include "BenchSupport.h"
+#include <cstdio>
+#include <thread>
+
+using namespace BenchSupport;
+
+namespace {
+    const double LIMIT_NANOS = 1000.0;
+    const int CONTENDING_THREADS = 4;
+
+    // Varied enough to touch every phase histogram and a spread of buckets
+    TransportTimings MakeTimings(long long i) {
+        TransportTimings timings;
+        timings.reusedConnection = i % 8 != 0;
+        if (!timings.reusedConnection) {
+            timings.resolveMicros = 40 + i % 300;
+            timings.connectMicros = 200 + i % 900;
+        }
+        timings.firstByteMicros = 500 + (i * 7919) % 20000;
+        timings.transferMicros = 50 + (i * 104729) % 5000;
+        timings.totalMicros = timings.resolveMicros + timings.connectMicros +
+            timings.firstByteMicros + timings.transferMicros;
+        timings.bytesSent = 200 + i % 4000;
+        timings.bytesReceived = 100 + i % 1000;
+        return timings;
+    }
+
+    void RecordMany(RequestMetrics& metrics, const std::vector<std::wstring>& endpoints, long long calls) {
+        for (long long i = 0; i < calls; i++) {
+            metrics.Record(endpoints[(size_t)(i % (long long)endpoints.size())], MakeTimings(i), i % 97 == 0);
+        }
+    }
+
+    long long Recorded(const RequestMetrics& metrics) {
+        std::vector<EndpointMetricsSnapshot> snapshots = metrics.GetSnapshots();
+        long long count = 0;
+        for (size_t i = 0; i < snapshots.size(); i++) {
+            count += snapshots[i].total.count;
+        }
+        return count;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    long long calls = IntOption(argc, argv, "--calls", quick ? 200000 : 20000000);
+
+    std::vector<std::wstring> endpoints;
+    endpoints.push_back(AgentConstants::ENDPOINT_HEARTBEAT);
+    endpoints.push_back(AgentConstants::ENDPOINT_REGISTER);
+    endpoints.push_back(AgentConstants::ENDPOINT_SYNC_MODELS);
+    endpoints.push_back(AgentConstants::ENDPOINT_SYNC_LOGS);
+    endpoints.push_back(AgentConstants::ENDPOINT_SYNC_LOGS_DELTA);
+    endpoints.push_back(AgentConstants::ENDPOINT_UPLOAD_MODEL);
+    endpoints.push_back(L"/api/agent/downloadmodel");
+
+    RequestMetrics single;
+    Stopwatch watch;
+    RecordMany(single, endpoints, calls);
+    double singleNanos = watch.Seconds() * 1e9 / (double)calls;
+
+    RequestMetrics contended;
+    std::vector<std::wstring> heartbeat(1, AgentConstants::ENDPOINT_HEARTBEAT);
+    std::vector<std::thread> threads;
+    watch.Restart();
+    for (int t = 0; t < CONTENDING_THREADS; t++) {
+        threads.push_back(std::thread([&contended, &heartbeat, calls]() {
+            RecordMany(contended, heartbeat, calls);
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) {
+        threads[t].join();
+    }
+    // Wall time over one thread's calls: what each caller waited per Record
+    double contendedNanos = watch.Seconds() * 1e9 / (double)calls;
+
+    printf("single thread   %10lld calls  %7.1f ns per Record\n", calls, singleNanos);
+    printf("%d threads       %10lld calls  %7.1f ns per Record, one endpoint\n", CONTENDING_THREADS,
+        calls * CONTENDING_THREADS, contendedNanos);
+
+    if (Recorded(single) != calls || Recorded(contended) != calls * CONTENDING_THREADS) {
+        fprintf(stderr, "recorded counts do not match the calls made\n");
+        return 1;
+    }
+    if (singleNanos > LIMIT_NANOS || contendedNanos > LIMIT_NANOS) {
+        fprintf(stderr, "Record costs more than %.0f ns\n", LIMIT_NANOS);
+        return 1;
+    }
+    return 0;
+}
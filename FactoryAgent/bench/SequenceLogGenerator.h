@@ -0,0 +1,148 @@
+#ifndef SEQUENCE_LOG_GENERATOR_H
+#define SEQUENCE_LOG_GENERATOR_H
+
+/*
+ * SequenceLogGenerator.h
+ * Synthetic sequence logs in the format BarrelLogAnalyzer reads: barrels run a
+ * run of the sequences, each as a START and an END line, with now and then an
+ * END before its START, an operation that never ends, a malformed data field or
+ * a line without fields mixed in. noiseLines adds that many machine trace lines
+ * per operation, as the busier PCs write them. Same seed, same log
+ */
+
+#include <string>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+namespace BenchSupport {
+
+    class SequenceLogGenerator {
+    public:
+        SequenceLogGenerator(unsigned seed, int noiseLines) : random_(seed), noiseLines_(noiseLines) {
+            barrel_ = 0;
+            clock_ = 0;
+        }
+
+        // Appends whole barrels until text holds at least targetBytes
+        void Append(std::string& text, size_t targetBytes) {
+            if (text.empty()) {
+                text += "SEM_LOG_VERSION\t2\n";
+                text += "DateTime\tLevel\tLine\tPC\tModule\tThread\tSource\tCode\tSequence\tEvent\tData\n";
+            }
+            while (text.size() < targetBytes) {
+                AppendBarrel(text);
+            }
+        }
+
+        // Writes about totalBytes to path a few megabytes at a time
+        bool WriteFile(const std::string& path, long long totalBytes) {
+            std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+            const size_t chunkBytes = 4 * 1024 * 1024;
+            std::string chunk;
+            long long written = 0;
+            Append(chunk, chunkBytes);
+            while (file && written < totalBytes) {
+                if (written > 0) {
+                    chunk.clear();
+                    while (chunk.size() < chunkBytes) {
+                        AppendBarrel(chunk);
+                    }
+                }
+                file.write(chunk.data(), (std::streamsize)chunk.size());
+                written += (long long)chunk.size();
+            }
+            return (bool)file;
+        }
+
+    private:
+        std::mt19937 random_;
+        int noiseLines_;
+        int barrel_;
+        double clock_;
+
+        int Pick(int count) {
+            return (int)(random_() % (unsigned)count);
+        }
+
+        void AppendLine(std::string& text, const char* sequence, const char* event, const std::string& data) {
+            char prefix[96];
+            snprintf(prefix, sizeof(prefix), "2026-10-17 08:%02d:%06.3f\tINFO\tL1\tPC3\tSeq\tT%d\tSeqRunner\t0\t",
+                (int)(clock_ / 60000) % 60, (clock_ / 1000) - 60 * (int)(clock_ / 60000), 1 + Pick(8));
+            text += prefix;
+            text += sequence;
+            text += '\t';
+            text += event;
+            text += '\t';
+            text += data;
+            text += '\n';
+        }
+
+        void AppendNoise(std::string& text) {
+            char line[160];
+            snprintf(line, sizeof(line),
+                "2026-10-17 08:00:01.000\tDEBUG\tL1\tPC3\tAxis\tT2\tServo\t0\tpos=%d vel=%d torque=%d\n",
+                Pick(100000), Pick(1000), Pick(100));
+            text += line;
+        }
+
+        void AppendBarrel(std::string& text) {
+            static const char* const SEQUENCES[] = { "Sequence_Load", "Sequence_Clamp", "Sequence_Drill",
+                "Sequence_Inspect", "Sequence_Wash", "Sequence_Unload", "Sequence_Mark", "Sequence_Measure" };
+            const int sequenceCount = 8;
+
+            barrel_++;
+            std::string id = std::to_string(barrel_);
+            if (Pick(50) == 0) {
+                id = "\"" + id + "\"";
+            }
+            clock_ += Pick(4) == 0 ? 300.5 : 5;
+
+            int operations = 3 + Pick(sequenceCount - 2);
+            int first = Pick(sequenceCount);
+            for (int i = 0; i < operations; i++) {
+                const char* sequence = SEQUENCES[(first + i) % sequenceCount];
+                double start = clock_ + (Pick(3) == 0 ? 250 : 0);
+                double end = start + 20 + Pick(880) + (Pick(2) == 0 ? 0.25 : 0);
+                int kind = Pick(100);
+
+                std::string startData = "{\"barrelId\":" + id + ",\"startTs\":" + Number(start) + "}";
+                std::string endData = "{\"barrelId\":" + id + ",\"endTs\":" + Number(end);
+                if (kind >= 10) {
+                    endData += ",\"idealMs\":" + std::to_string(100 + Pick(700));
+                }
+                endData += "}";
+                if (kind == 50) {
+                    startData.erase(startData.size() - 1);
+                }
+
+                if (kind < 3) {
+                    AppendLine(text, sequence, "END", endData);
+                    AppendLine(text, sequence, "START", startData);
+                }
+                else {
+                    AppendLine(text, sequence, "START", startData);
+                    if (kind < 98) {
+                        AppendLine(text, sequence, "END", endData);
+                    }
+                }
+                for (int n = 0; n < noiseLines_; n++) {
+                    AppendNoise(text);
+                }
+                if (kind == 60) {
+                    text += "2026-10-17\tnoise line without fields\n";
+                }
+                clock_ = Pick(5) < 3 ? std::max(clock_, end) : clock_ + 1;
+            }
+        }
+
+        static std::string Number(double value) {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.17g", value);
+            return buffer;
+        }
+    };
+}
+
+#endif
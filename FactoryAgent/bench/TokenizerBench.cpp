@@ -0,0 +1,178 @@
+/*
+ * TokenizerBench.cpp
+ * GB/s over an in-memory sequence log (--mb) for: the naive reading (std::getline,
+ * a split on every tab, nlohmann::json::parse of the data field); a memchr per
+ * delimiter; LogTokenizer::SplitLine; SplitLine with ReadFlatObject picking the
+ * four members the analysis needs; and the whole BarrelLogAnalyzer pass. The
+ * tokenizer rows run at each level this CPU supports and must agree
+ */
+
+#include "../include/utilities/LogTokenizer.h"
+#include "../include/services/BarrelLogAnalyzer.h"
+#include "../third_party/json/json.hpp"
+#include "BenchSupport.h"
+#include "SequenceLogGenerator.h"
+#include <sstream>
+#include <functional>
+#include <cstring>
+#include <cstdio>
+
+using namespace BenchSupport;
+using json = nlohmann::json;
+
+namespace {
+    const int SPLIT_FIELDS = 12;
+    const char* const LEVEL_NAMES[] = { "scalar", "sse2", "avx2" };
+    const char* const EVENT_KEYS[] = { "barrelId", "startTs", "endTs", "idealMs" };
+
+    // Best of repeats; the checksum keeps the work from being optimized away and lets rows be compared
+    unsigned long long Measure(const char* name, const std::string& log, int repeats,
+        const std::function<unsigned long long()>& pass) {
+        double best = 0;
+        unsigned long long checksum = 0;
+        for (int i = 0; i < repeats; i++) {
+            Stopwatch watch;
+            checksum = pass();
+            double seconds = watch.Seconds();
+            best = i == 0 ? seconds : std::min(best, seconds);
+        }
+        printf("%-34s %8.3f s  %6.2f GB/s\n", name, best, (double)log.size() / best / 1e9);
+        return checksum;
+    }
+
+    unsigned long long NaivePass(const std::string& log) {
+        std::istringstream stream(log);
+        std::string line;
+        unsigned long long checksum = 0;
+        while (std::getline(stream, line)) {
+            std::vector<std::string> fields;
+            size_t start = 0;
+            size_t tab;
+            while ((tab = line.find('\t', start)) != std::string::npos) {
+                fields.push_back(line.substr(start, tab - start));
+                start = tab + 1;
+            }
+            fields.push_back(line.substr(start));
+            if (fields.size() < 11) {
+                continue;
+            }
+            json data = json::parse(fields[10], nullptr, false);
+            if (!data.is_object()) {
+                continue;
+            }
+            if (data.contains("startTs") && data["startTs"].is_number()) {
+                checksum += (unsigned long long)data["startTs"].get<double>();
+            }
+            if (data.contains("endTs") && data["endTs"].is_number()) {
+                checksum += (unsigned long long)data["endTs"].get<double>();
+            }
+        }
+        return checksum;
+    }
+
+    unsigned long long MemchrPass(const std::string& log) {
+        unsigned long long fieldCount = 0;
+        const char* p = log.data();
+        const char* end = p + log.size();
+        while (p < end) {
+            const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+            if (!lineEnd) {
+                lineEnd = end;
+            }
+            const char* field = p;
+            int count = 1;
+            while (count < SPLIT_FIELDS) {
+                const char* tab = (const char*)memchr(field, '\t', lineEnd - field);
+                if (!tab) {
+                    break;
+                }
+                field = tab + 1;
+                count++;
+            }
+            fieldCount += count;
+            p = lineEnd + 1;
+        }
+        return fieldCount;
+    }
+
+    unsigned long long SplitPass(const std::string& log) {
+        unsigned long long fieldCount = 0;
+        const char* p = log.data();
+        const char* end = p + log.size();
+        const char* fields[SPLIT_FIELDS];
+        int count;
+        while (p < end) {
+            const char* lineEnd = LogTokenizer::SplitLine(p, end, fields, SPLIT_FIELDS, count);
+            fieldCount += count;
+            p = lineEnd + 1;
+        }
+        return fieldCount;
+    }
+
+    unsigned long long KeysPass(const std::string& log) {
+        unsigned long long checksum = 0;
+        const char* p = log.data();
+        const char* end = p + log.size();
+        const char* fields[SPLIT_FIELDS];
+        JsonToken values[4];
+        int count;
+        while (p < end) {
+            const char* lineEnd = LogTokenizer::SplitLine(p, end, fields, SPLIT_FIELDS, count);
+            if (count > 10 && LogTokenizer::ReadFlatObject(fields[10], count > 11 ? fields[11] - 1 : lineEnd,
+                EVENT_KEYS, 4, values)) {
+                // startTs and endTs
+                for (int key = 1; key <= 2; key++) {
+                    double value;
+                    if (values[key].type == JsonToken::NUMBER &&
+                        LogTokenizer::ParseNumber(values[key].begin, values[key].end, value)) {
+                        checksum += (unsigned long long)value;
+                    }
+                }
+            }
+            p = lineEnd + 1;
+        }
+        return checksum;
+    }
+
+    unsigned long long AnalyzerPass(const std::string& log) {
+        BarrelLogAnalyzer analyzer;
+        analyzer.Feed(log.data(), log.size());
+        analyzer.Finish();
+        return (unsigned long long)analyzer.GetEventCount();
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    long long megabytes = IntOption(argc, argv, "--mb", quick ? 8 : 256);
+    int repeats = quick ? 1 : 3;
+
+    std::string log;
+    SequenceLogGenerator generator(5, 2);
+    generator.Append(log, (size_t)(megabytes << 20));
+    printf("%lld MB log in memory, CPU level %s\n", (long long)log.size() >> 20,
+        LEVEL_NAMES[LogTokenizer::GetLevel()]);
+
+    LogTokenizer::Level widest = LogTokenizer::GetLevel();
+    unsigned long long naive = Measure("getline + json::parse", log, 1, [&log]() { return NaivePass(log); });
+    unsigned long long memchrFields = Measure("split: memchr per delimiter", log, repeats,
+        [&log]() { return MemchrPass(log); });
+
+    bool agree = true;
+    for (int level = LogTokenizer::LEVEL_SCALAR; level <= widest; level++) {
+        LogTokenizer::SetLevel((LogTokenizer::Level)level);
+        std::string split = std::string("split: LogTokenizer ") + LEVEL_NAMES[level];
+        std::string keys = std::string("split + keys: LogTokenizer ") + LEVEL_NAMES[level];
+        std::string analysis = std::string("BarrelLogAnalyzer ") + LEVEL_NAMES[level];
+        agree = Measure(split.c_str(), log, repeats, [&log]() { return SplitPass(log); }) == memchrFields && agree;
+        agree = Measure(keys.c_str(), log, repeats, [&log]() { return KeysPass(log); }) == naive && agree;
+        Measure(analysis.c_str(), log, 1, [&log]() { return AnalyzerPass(log); });
+    }
+    LogTokenizer::SetLevel(widest);
+
+    if (!agree) {
+        fprintf(stderr, "tokenizer rows disagree with the memchr split or the json::parse baseline\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * TransportBench.cpp
+ * Heartbeat, sync, upload and download through HttpClient and the POSIX
+ * transport against StandInServer on loopback: latency percentiles for the
+ * small calls, throughput for the transfers, and how often sockets were reused
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/common/Constants.h"
+#include "../include/utilities/Sha256.h"
+#include "BenchSupport.h"
+#include <cstdio>
+
+using namespace BenchSupport;
+
+namespace {
+    void PrintLatency(const char* name, std::vector<double>& millis, double seconds) {
+        printf("%-10s %6zu calls  %8.0f/s  p50 %7.3f ms  p95 %7.3f ms  p99 %7.3f ms\n", name, millis.size(),
+            (double)millis.size() / seconds, Percentile(millis, 0.50), Percentile(millis, 0.95),
+            Percentile(millis, 0.99));
+    }
+
+    json MakeModelList(int count) {
+        json request;
+        request["pcId"] = 1;
+        request["models"] = json::array();
+        for (int i = 0; i < count; i++) {
+            json model;
+            model["modelName"] = "MODEL_" + std::to_string(i);
+            model["modelPath"] = "D:\\Models\\MODEL_" + std::to_string(i);
+            model["isCurrent"] = i == 0;
+            request["models"].push_back(model);
+        }
+        return request;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    int calls = (int)IntOption(argc, argv, "--calls", quick ? 50 : 2000);
+    long long transferMb = IntOption(argc, argv, "--mb", quick ? 4 : 256);
+
+    StandInServer server;
+    if (!server.Start(0)) {
+        fprintf(stderr, "stand-in server did not start\n");
+        return 1;
+    }
+    HttpClient client(server.GetBaseUrl());
+
+    json registration;
+    registration["lineNumber"] = 1;
+    registration["pcNumber"] = 1;
+    json response;
+    if (!client.Post(AgentConstants::ENDPOINT_REGISTER, registration, response)) {
+        fprintf(stderr, "register failed\n");
+        return 1;
+    }
+
+    json heartbeat;
+    heartbeat["pcId"] = response.value("pcId", 1);
+    heartbeat["isApplicationRunning"] = true;
+    std::vector<double> millis;
+    Stopwatch total;
+    for (int i = 0; i < calls; i++) {
+        Stopwatch one;
+        if (!client.Post(AgentConstants::ENDPOINT_HEARTBEAT, heartbeat, response)) {
+            fprintf(stderr, "heartbeat %d failed\n", i);
+            return 1;
+        }
+        millis.push_back(one.Millis());
+    }
+    PrintLatency("heartbeat", millis, total.Seconds());
+
+    json models = MakeModelList(200);
+    millis.clear();
+    total.Restart();
+    for (int i = 0; i < calls; i++) {
+        Stopwatch one;
+        if (!client.Post(AgentConstants::ENDPOINT_SYNC_MODELS, models, response)) {
+            fprintf(stderr, "sync %d failed\n", i);
+            return 1;
+        }
+        millis.push_back(one.Millis());
+    }
+    PrintLatency("sync", millis, total.Seconds());
+
+    std::map<std::wstring, CompressionStats> gzip = client.GetCompressionStats();
+    CompressionStats sync = gzip[AgentConstants::ENDPOINT_SYNC_MODELS];
+    if (sync.requestsCompressed > 0) {
+        printf("sync gzip  %6lld bodies  %8.1fx  %7.1f us each\n", sync.requestsCompressed,
+            (double)sync.requestRawBytes / (double)sync.requestWireBytes,
+            (double)sync.compressMicros / (double)sync.requestsCompressed);
+    }
+
+    std::string scratch = MakeScratchDir("transportbench");
+    std::string payload = MakePayload((size_t)(transferMb * 1024 * 1024), 7);
+    std::string uploadPath = scratch + "/upload.bin";
+    std::string downloadPath = scratch + "/download.bin";
+    bool ok = WriteFile(uploadPath, payload);
+
+    Stopwatch transfer;
+    ok = ok && client.UploadFile(AgentConstants::ENDPOINT_UPLOAD_MODEL, uploadPath, "bench", response);
+    double uploadSeconds = transfer.Seconds();
+
+    server.SetModelPayload(payload);
+    std::string digest = Sha256::HashString(payload);
+    transfer.Restart();
+    ok = ok && client.DownloadFile("/api/agent/downloadmodel/1", downloadPath, digest);
+    double downloadSeconds = transfer.Seconds();
+    RemoveTree(scratch);
+
+    if (!ok) {
+        fprintf(stderr, "transfer failed\n");
+        return 1;
+    }
+    printf("upload     %6lld MB   %8.1f MB/s\n", transferMb, (double)transferMb / uploadSeconds);
+    printf("download   %6lld MB   %8.1f MB/s\n", transferMb, (double)transferMb / downloadSeconds);
+
+    ConnectionStats stats = client.GetConnectionStats();
+    printf("sockets    %lld requests, %lld reused, %lld new\n", stats.requests, stats.connectionsReused,
+        stats.newHandshakes);
+
+    server.Stop();
+    return 0;
+}
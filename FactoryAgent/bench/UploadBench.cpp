@@ -0,0 +1,144 @@
+/*
+ * UploadBench.cpp
+ * Model upload to StandInServer two ways: the buffered path UploadFile used to
+ * take, which read the whole zip into memory before sending it, and today's
+ * UploadFile, which streams it from a mapped window. Reports peak RSS above
+ * the starting point and throughput for each
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/HttpTransport.h"
+#include "../include/network/StandInServer.h"
+#include "../include/common/Constants.h"
+#include "BenchSupport.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace BenchSupport;
+
+namespace {
+    const char* const BOUNDARY = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+    // Written a window at a time so making the file does not raise the peak being measured
+    bool MakeModelFile(const std::string& path, long long size) {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        std::string window = MakePayload(1024 * 1024, 3);
+        for (long long written = 0; written < size; written += (long long)window.size()) {
+            size_t length = (size_t)std::min((long long)window.size(), size - written);
+            file.write(window.data(), (std::streamsize)length);
+        }
+        return (bool)file;
+    }
+
+    // The upload as it was: the whole file in a vector, then prefix, data and suffix written in turn
+    bool BufferedUpload(const std::wstring& host, int port, const std::string& filePath) {
+        std::ifstream file(filePath.c_str(), std::ios::binary | std::ios::ate);
+        std::streamsize fileSize = file.tellg();
+        file.seekg(0, std::ios::beg);
+        std::vector<char> fileData((size_t)fileSize);
+        if (!file.read(fileData.data(), fileSize)) {
+            return false;
+        }
+
+        std::ostringstream bodyStream;
+        bodyStream << "--" << BOUNDARY << "\r\n";
+        bodyStream << "Content-Disposition: form-data; name=\"modelName\"\r\n\r\nbench\r\n";
+        bodyStream << "--" << BOUNDARY << "\r\n";
+        bodyStream << "Content-Disposition: form-data; name=\"file\"; filename=\"model.zip\"\r\n";
+        bodyStream << "Content-Type: application/octet-stream\r\n\r\n";
+        std::string prefix = bodyStream.str();
+        std::string suffix = std::string("\r\n--") + BOUNDARY + "--\r\n";
+
+        long long prefixEnd = (long long)prefix.size();
+        long long dataEnd = prefixEnd + (long long)fileData.size();
+
+        TransportRequest request;
+        request.method = L"POST";
+        request.host = host;
+        request.port = port;
+        request.path = AgentConstants::ENDPOINT_UPLOAD_MODEL;
+        request.headers.push_back(std::make_pair(std::string("Content-Type"),
+            std::string("multipart/form-data; boundary=") + BOUNDARY));
+        request.bodyLength = dataEnd + (long long)suffix.size();
+        request.bodySource = [&](long long offset, const char*& data, size_t& length) {
+            if (offset < prefixEnd) {
+                data = prefix.data() + offset;
+                length = (size_t)(prefixEnd - offset);
+            }
+            else if (offset < dataEnd) {
+                data = fileData.data() + (offset - prefixEnd);
+                length = (size_t)(dataEnd - offset);
+            }
+            else {
+                data = suffix.data() + (offset - dataEnd);
+                length = (size_t)((long long)suffix.size() - (offset - dataEnd));
+            }
+            return true;
+        };
+
+        HttpTransport* transport = HttpTransport::CreateDefault();
+        TransportResponse response;
+        bool sent = transport->Send(request, response, BodySink());
+        delete transport;
+        return sent && response.statusCode == AgentConstants::HTTP_OK;
+    }
+
+    void PrintRow(const char* name, long long megabytes, double seconds, long long baseKb, long long peakKb) {
+        printf("%-9s %6lld MB  %8.1f MB/s  peak RSS +%7.1f MB\n", name, megabytes, (double)megabytes / seconds,
+            (double)(peakKb - baseKb) / 1024.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = HasFlag(argc, argv, "--quick");
+    long long megabytes = IntOption(argc, argv, "--mb", quick ? 64 : 1024);
+
+    StandInServer server;
+    if (!server.Start(0)) {
+        fprintf(stderr, "stand-in server did not start\n");
+        return 1;
+    }
+    HttpClient client(server.GetBaseUrl());
+
+    std::string scratch = MakeScratchDir("uploadbench");
+    std::string modelPath = scratch + "/model.zip";
+    if (!MakeModelFile(modelPath, megabytes * 1024 * 1024)) {
+        fprintf(stderr, "could not write %s\n", modelPath.c_str());
+        RemoveTree(scratch);
+        return 1;
+    }
+
+    // Streamed first: if the peak cannot be reset, the buffered run's peak still stands out
+    ResetPeakRss();
+    long long baseKb = PeakRssKb();
+    Stopwatch watch;
+    json response;
+    bool streamed = client.UploadFile(AgentConstants::ENDPOINT_UPLOAD_MODEL, modelPath, "bench", response);
+    double streamedSeconds = watch.Seconds();
+    long long streamedPeakKb = PeakRssKb();
+
+    ResetPeakRss();
+    long long bufferedBaseKb = PeakRssKb();
+    watch.Restart();
+    bool buffered = BufferedUpload(L"127.0.0.1", server.GetPort(), modelPath);
+    double bufferedSeconds = watch.Seconds();
+    long long bufferedPeakKb = PeakRssKb();
+
+    RemoveTree(scratch);
+    server.Stop();
+
+    if (!streamed || !buffered) {
+        fprintf(stderr, "upload failed: streamed %d buffered %d\n", streamed, buffered);
+        return 1;
+    }
+    PrintRow("buffered", megabytes, bufferedSeconds, bufferedBaseKb, bufferedPeakKb);
+    PrintRow("streamed", megabytes, streamedSeconds, baseKb, streamedPeakKb);
+
+    // The point of streaming: memory does not grow with the file
+    if ((streamedPeakKb - baseKb) * 4 > (bufferedPeakKb - bufferedBaseKb)) {
+        fprintf(stderr, "streamed upload held more than a quarter of what buffering did\n");
+        return 1;
+    }
+    return 0;
+}
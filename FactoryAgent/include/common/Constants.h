@@ -11,38 +11,156 @@ namespace AgentConstants {
 
     /* Timing constants */
     const int HEARTBEAT_INTERVAL_SECONDS = 10;
-    const int MAX_REGISTRATION_RETRIES = 3;
     const int MAX_CONNECTION_FAILURES = 5;
-    const int RETRY_DELAY_SECONDS = 5;
-    const int FILE_MONITOR_INTERVAL_MS = 15000;
 
     /* Network constants */
     const int DEFAULT_HTTP_PORT = 80;
     const int DEFAULT_HTTPS_PORT = 443;
     const char* const DEFAULT_IP_ADDRESS = "0.0.0.0";
 
+    /* HTTP status codes */
+    const int HTTP_OK = 200;
+    const int HTTP_PARTIAL_CONTENT = 206;
+    const int HTTP_NOT_MODIFIED = 304;
+    const int HTTP_BAD_REQUEST = 400;
+    const int HTTP_NOT_FOUND = 404;
+    const int HTTP_UNSUPPORTED_MEDIA_TYPE = 415;
+    const int HTTP_TOO_MANY_REQUESTS = 429;
+    const int HTTP_SERVER_ERROR = 500;
+    const int HTTP_RANGE_NOT_SATISFIABLE = 416;
+
+    /* Connection pool constants */
+    const int POOL_IDLE_TIMEOUT_SECONDS = 90;
+    const int POOL_MAX_CONNECTIONS_PER_HOST = 8;
+    const int POOL_MAX_TRACKED_SOCKETS = 16;
+    const int SOCKET_TIMEOUT_MS = 30000;
+
+    /* Request queue constants */
+    const int REQUEST_INTERACTIVE_THREADS = 2;
+    const int REQUEST_BULK_THREADS = 2;
+    const int HEARTBEAT_TIMEOUT_MS = 8000;
+
+    /* Retry and circuit breaker constants */
+    const int RECONNECT_BASE_DELAY_MS = 2000;
+    const int RECONNECT_MAX_DELAY_MS = 60000;
+    const int HEARTBEAT_RETRY_MAX_DELAY_MS = 60000;
+    const int BREAKER_FAILURE_THRESHOLD = 3;
+    const int BREAKER_OPEN_BASE_MS = 5000;
+    const int BREAKER_OPEN_MAX_MS = 120000;
+
+    /* Command channel constants */
+    const int COMMAND_CHANNEL_HOLD_SECONDS = 120;           // server closes after this; reconnected at once
+    const int COMMAND_CHANNEL_RETRY_BASE_MS = 1000;
+    const int COMMAND_CHANNEL_RETRY_MAX_MS = 60000;
+    const size_t COMMAND_CHANNEL_MAX_LINE_BYTES = 64 * 1024 * 1024;
+    const char* const CONTENT_TYPE_NDJSON = "application/x-ndjson";
+
+    /* Outbox constants */
+    const char* const OUTBOX_FILE_NAME = "agent_outbox.log";
+    const size_t OUTBOX_REPLAY_BATCH = 32;                  // messages per replay request
+    const size_t OUTBOX_REPLAY_BATCH_BYTES = 4 * 1024 * 1024;
+    const long long OUTBOX_COMPACT_BYTES = 1024 * 1024;     // rewrite once mostly delivered and this big
+
+    /* Request metrics constants */
+    const int METRICS_REPORT_INTERVAL_SECONDS = 60;
+
+    /* Batched sync constants */
+    const int SYNC_BATCH_REPROBE_CYCLES = 60;
+    const int MODEL_SYNC_REFRESH_SECONDS = 300;
+
+    /* Transfer constants */
+    const int UPLOAD_CHUNK_SIZE = 4 * 1024 * 1024;
+    const int DOWNLOAD_CHECKPOINT_BYTES = 8 * 1024 * 1024;
+    const char* const HEADER_CONTENT_SHA256 = "X-Content-SHA256";
+
+    /* Model chunk upload constants */
+    const int MODEL_CHUNK_MIN_BYTES = 16 * 1024;
+    const int MODEL_CHUNK_AVERAGE_BITS = 16;                // 64 KiB average chunk
+    const int MODEL_CHUNK_MAX_BYTES = 256 * 1024;
+    const int MODEL_CHUNK_QUERY_HASHES = 4096;              // hashes per missing-chunk query
+    const long long MODEL_CHUNK_BATCH_BYTES = 8LL * 1024 * 1024;
+    const char* const CONTENT_TYPE_OCTET_STREAM = "application/octet-stream";
+
+    /* Bandwidth limiter constants */
+    const int BANDWIDTH_BURST_MS = 250;
+    const int BANDWIDTH_MIN_BURST_BYTES = 16 * 1024;
+
+    /* Compression constants */
+    const int COMPRESSION_MIN_BYTES = 1024;
+    const int COMPRESSION_LEVEL = 6;
+
+    /* Segmented download constants */
+    const long long SEGMENTED_DOWNLOAD_MIN_BYTES = 32LL * 1024 * 1024;
+    const int SEGMENT_INITIAL_WORKERS = 2;
+    const int SEGMENT_MAX_WORKERS = 6;
+    const long long SEGMENT_INITIAL_BYTES = 4LL * 1024 * 1024;
+    const long long SEGMENT_MIN_BYTES = 1LL * 1024 * 1024;
+    const long long SEGMENT_MAX_BYTES = 64LL * 1024 * 1024;
+    const int SEGMENT_TARGET_MS = 2000;
+    const int SEGMENT_WINDOW_MS = 1000;
+    const int SEGMENT_MAX_FAILURES = 8;
+    const int SEGMENT_IDLE_WAIT_MS = 50;
+    const int SEGMENT_CHECKPOINT_MS = 1000;
+
     /* File system constants */
     const char* const TEMP_FOLDER_NAME = "temp";
     const char* const ZIP_EXTENSION = ".zip";
+    const char* const PART_EXTENSION = ".part";
+    const char* const META_EXTENSION = ".meta";
     const char* const CONFIG_FILE_NAME = "agent_config.json";
+    const char* const MODEL_CACHE_FILE_NAME = "model_cache.json";
+    const char* const LOG_INDEX_FILE_NAME = "log_index.json";
+
+    /* Directory watcher constants */
+    const int DIRECTORY_WATCH_DEBOUNCE_MS = 200;        // quiet time that ends a burst of changes
+    const int DIRECTORY_WATCH_MAX_DELAY_MS = 1000;      // a file written without pause is still reported this often
+    const int DIRECTORY_WATCH_RETRY_MS = 5000;          // reopen interval after the folder went away
+    const size_t DIRECTORY_WATCH_BUFFER_BYTES = 64 * 1024;  // the most ReadDirectoryChangesW takes on a network share
+    const size_t DIRECTORY_WATCH_MAX_PATHS = 10000;         // past this a burst is reported as a rescan instead
+
+    /* Directory scanner constants */
+    const int DIRECTORY_SCAN_MAX_THREADS = 8;                   // past this one disk only queues the requests deeper
+    const size_t DIRECTORY_SCAN_BUFFER_BYTES = 64 * 1024;       // getdents64 batch, a few hundred names per call
+
+    /* Log index constants */
+    const int LOG_INDEX_HOT_SECONDS = 3600;                     // files written this recently are re-checked every cycle
+    const int LOG_INDEX_VERIFY_CYCLES = 60;                     // every folder is listed again at least this often
+    const int LOG_INDEX_SNAPSHOT_INTERVAL_MS = 5 * 60 * 1000;   // most frequent snapshot while the tree keeps changing
+
+    /* Log analysis constants */
+    const size_t LOG_ANALYSIS_READ_BYTES = 1024 * 1024;
+    const size_t LOG_ANALYSIS_MAX_LINE_BYTES = 1024 * 1024;     // longer lines are dropped, not buffered
+    const size_t LOG_CONTENT_WINDOW_BYTES = 1024 * 1024;        // of the file mapped and escaped at a time
 
     /* Protocol constants */
     const wchar_t* const HTTP_PROTOCOL = L"http";
     const wchar_t* const HTTPS_PROTOCOL = L"https";
     const wchar_t* const PROTOCOL_SEPARATOR = L"://";
+    const char* const CONTENT_TYPE_JSON = "application/json";
+    const char* const CONTENT_TYPE_CBOR = "application/cbor";
+    const char* const CONTENT_TYPE_MSGPACK = "application/x-msgpack";
 
     /* API Endpoints */
     const wchar_t* const ENDPOINT_REGISTER = L"/api/agent/register";
     const wchar_t* const ENDPOINT_HEARTBEAT = L"/api/agent/heartbeat";
     const wchar_t* const ENDPOINT_UPDATE_CONFIG = L"/api/agent/updateconfig";
+    const wchar_t* const ENDPOINT_UPDATE_CONFIG_DELTA = L"/api/agent/updateconfigdelta";
     const wchar_t* const ENDPOINT_UPDATE_LOG = L"/api/agent/updatelog";
     const wchar_t* const ENDPOINT_SYNC_LOGS = L"/api/agent/synclogs";
+    const wchar_t* const ENDPOINT_SYNC_LOGS_DELTA = L"/api/agent/synclogsdelta";
     const wchar_t* const ENDPOINT_SYNC_MODELS = L"/api/agent/syncmodels";
+    const wchar_t* const ENDPOINT_SYNC_BATCH = L"/api/agent/syncbatch";
     const wchar_t* const ENDPOINT_COMMAND_RESULT = L"/api/agent/commandresult";
+    const wchar_t* const ENDPOINT_COMMAND_RESULTS = L"/api/agent/commandresults";
+    const wchar_t* const ENDPOINT_COMMAND_CHANNEL = L"/api/agent/commandchannel";
     const wchar_t* const ENDPOINT_UPLOAD_MODEL = L"/api/agent/uploadmodelfile";
+    const wchar_t* const ENDPOINT_DOWNLOAD_MODEL = L"/api/agent/downloadmodel";
+    const wchar_t* const ENDPOINT_MODEL_CHUNKS_MISSING = L"/api/ModelLibrary/chunks/missing";
+    const wchar_t* const ENDPOINT_MODEL_CHUNKS = L"/api/ModelLibrary/chunks";
 
     /* Command types */
     const char* const COMMAND_UPDATE_CONFIG = "UpdateConfig";
+    const char* const COMMAND_UPDATE_CONFIG_DELTA = "UpdateConfigDelta";
     const char* const COMMAND_CHANGE_MODEL = "ChangeModel";
     const char* const COMMAND_UPLOAD_MODEL = "UploadModel";
     const char* const COMMAND_DELETE_MODEL = "DeleteModel";
@@ -51,6 +169,15 @@ namespace AgentConstants {
     // [MOVED HERE FOR CONSISTENCY]
     const char* const COMMAND_UPDATE_AGENT_SETTINGS = "UpdateAgentSettings";
     const char* const COMMAND_RESET_AGENT = "ResetAgent";
+    const char* const COMMAND_SET_BANDWIDTH_LIMIT = "SetBandwidthLimit";
+    const char* const COMMAND_ANALYZE_LOG_FILE = "AnalyzeLogFile";
+
+    /* Protocol features negotiated at registration */
+    const char* const FEATURE_CONFIG_DELTA = "configdelta";
+    const char* const FEATURE_COMMAND_CHANNEL = "commandchannel";
+    const char* const FEATURE_LOG_DELTA = "logdelta";
+    const char* const FEATURE_LOG_ANALYSIS = "loganalysis";
+    const char* const CONFIG_NEED_FULL = "NeedFullConfig";
 
     /* Status values */
     const char* const STATUS_IN_PROGRESS = "InProgress";
@@ -15,6 +15,7 @@ struct AgentSettings {
     std::string ipAddress;       // <--- THIS WAS MISSING
     std::wstring serverUrl;
     std::wstring exeName;
+    int bandwidthLimitKbps;      // cap for model transfers; 0 = unlimited
 
     AgentSettings() {
         pcId = 0;
@@ -22,6 +23,7 @@ struct AgentSettings {
         pcNumber = 0;
         modelVersion = "3.5";
         ipAddress = "";          // Initialize it
+        bandwidthLimitKbps = 0;
     }
 };
 
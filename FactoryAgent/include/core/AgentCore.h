@@ -14,9 +14,12 @@ class HttpClient;
 class RegistrationService;
 class HeartbeatService;
 class CommandExecutor;
+class CommandChannel;
+class OutboxService;
 class ConfigService;
 class LogService;
 class ModelService;
+class BatchSyncService;
 class ConfigManager;
 class ProcessMonitor;
 
@@ -38,19 +41,26 @@ private:
     RegistrationService* registrationService_;
     HeartbeatService* heartbeatService_;
     CommandExecutor* commandExecutor_;
+    CommandChannel* commandChannel_;
+    OutboxService* outbox_;
     ConfigService* configService_;
     LogService* logService_;
     ModelService* modelService_;
+    BatchSyncService* batchSyncService_;
     ConfigManager* configManager_;
     ProcessMonitor* processMonitor_;
 
     HANDLE workerThread_;
+    HANDLE commandsDoneEvent_;
+    HANDLE localChangesEvent_;      // config, log or model files changed on disk
     bool isRunning_;
     bool stopRequested_;
     int connectionFailureCount_;
 
     static DWORD WINAPI WorkerThreadProc(LPVOID param);
     void WorkerLoop();
+    void SyncToServer();
+    void SleepUnlessStopped(int milliseconds);
 
     AgentCore(const AgentCore&);
 };
@@ -0,0 +1,99 @@
+#ifndef DIRECTORY_WATCHER_H
+#define DIRECTORY_WATCHER_H
+
+/*
+ * DirectoryWatcher.h
+ * Reports changes under a folder as the OS announces them: ReadDirectoryChangesW
+ * on Windows, inotify elsewhere. Events are coalesced by path and handed over
+ * once a burst has been quiet for DIRECTORY_WATCH_DEBOUNCE_MS, or at the latest
+ * DIRECTORY_WATCH_MAX_DELAY_MS after its first event. When the OS dropped events
+ * (its buffer overflowed, or the folder was gone for a while) the batch says so,
+ * and the receiver has to rescan instead of trusting the paths
+ */
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+struct DirectoryChanges {
+    std::vector<std::string> paths;     // relative to the watched folder, each once
+    bool entriesChanged;                // something was created, removed or renamed, not just written
+    bool overflowed;                    // events were lost; paths is incomplete
+
+    DirectoryChanges() {
+        entriesChanged = false;
+        overflowed = false;
+    }
+};
+
+class DirectoryWatcher {
+public:
+    typedef std::function<void(const DirectoryChanges& changes)> ChangeHandler;
+
+    DirectoryWatcher();
+    ~DirectoryWatcher();
+
+    // handler runs on the watcher's thread. False when the folder cannot be watched at all
+    bool Start(const std::string& folderPath, bool recursive, const ChangeHandler& handler);
+    void Stop();
+    bool IsWatching() const;
+
+private:
+    std::string folderPath_;
+    bool recursive_;
+    ChangeHandler handler_;
+    std::thread thread_;
+    std::atomic<bool> stopRequested_;
+    bool watchOpen_;
+
+    // Coalesced since the last hand-over; only the watcher thread touches these
+    std::set<std::string> pendingPaths_;
+    bool pendingEntriesChanged_;
+    bool pendingOverflow_;
+    std::chrono::steady_clock::time_point firstPending_;
+    std::chrono::steady_clock::time_point lastPending_;
+
+#ifdef _WIN32
+    HANDLE directory_;
+    HANDLE stopEvent_;
+    OVERLAPPED overlapped_;
+    std::vector<DWORD> buffer_;     // DWORD-aligned, as ReadDirectoryChangesW requires
+    bool readPending_;
+#else
+    int inotifyFd_;
+    int wakePipe_[2];
+    std::map<int, std::string> watches_;    // watch descriptor to folder relative to the root
+#endif
+
+    bool OpenWatch();
+    void CloseWatch();
+    // Waits up to timeoutMs for events and queues them; false once the watch broke
+    bool ReadEvents(int timeoutMs);
+    void Run();
+    void SleepUnlessStopped(int milliseconds);
+
+    void Queue(const std::string& relativePath, bool entryChanged);
+    void QueueOverflow();
+    void DispatchIfDue(bool force);
+    int MillisecondsUntilDue() const;
+
+#ifdef _WIN32
+    bool Arm();
+#else
+    bool AddWatches(const std::string& relativePath);
+#endif
+
+    DirectoryWatcher(const DirectoryWatcher&);
+    DirectoryWatcher& operator=(const DirectoryWatcher&);
+};
+
+#endif
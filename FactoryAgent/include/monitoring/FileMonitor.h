@@ -3,11 +3,13 @@
 
 /*
  * FileMonitor.h
- * Monitors file changes
+ * Monitors file changes: the file's folder is watched for change notifications
+ * and the content is compared by hash, so an edit that keeps the size and the
+ * write time is still reported, and an untouched file is never read
  */
 
+#include "DirectoryWatcher.h"
 #include <string>
-#include <windows.h>
 
 typedef void (*FileChangeCallback)(const std::string& content, void* userData);
 
@@ -16,21 +18,25 @@ public:
     FileMonitor();
     ~FileMonitor();
 
+    // callback runs on the watcher's thread, within a second of the change
     bool StartMonitoring(const std::string& filePath, FileChangeCallback callback, void* userData);
     void StopMonitoring();
     bool IsMonitoring() const;
 
 private:
-    HANDLE monitorThread_;
+    DirectoryWatcher watcher_;
     bool isMonitoring_;
     std::string filePath_;
+    std::string fileName_;      // lowercased, to match against the watcher's paths
     std::string lastHash_;
     FileChangeCallback callback_;
     void* userData_;
 
-    static DWORD WINAPI MonitorThreadFunc(LPVOID param);
-    void MonitorLoop();
-    bool GetFileHash(const std::string& filePath, std::string& hash);
+    void OnChanges(const DirectoryChanges& changes);
+    void CheckFile();
+
+    FileMonitor(const FileMonitor&);
+    FileMonitor& operator=(const FileMonitor&);
 };
 
-#endif
\ No newline at end of file
+#endif
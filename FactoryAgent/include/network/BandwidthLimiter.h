@@ -0,0 +1,47 @@
+#ifndef BANDWIDTH_LIMITER_H
+#define BANDWIDTH_LIMITER_H
+
+/*
+ * BandwidthLimiter.h
+ * Token bucket shared by every bulk transfer loop, so model uploads and
+ * downloads together stay under the per-PC cap and leave the line network
+ * to PLC and camera traffic. Heartbeats and other interactive requests
+ * never touch it
+ */
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+
+class BandwidthLimiter {
+public:
+    BandwidthLimiter();
+    ~BandwidthLimiter();
+
+    // 0 removes the cap; waiters are woken so a change applies to transfers already running
+    void SetLimitKbps(int kbps);
+    int GetLimitKbps() const;
+
+    // Blocks until bytes may go on the wire; returns at once while unlimited
+    void Acquire(size_t bytes);
+    // Largest window a transfer loop should hand over at a time, so pacing stays smooth;
+    // 0 while unlimited
+    size_t GetWindowBytes() const;
+
+private:
+    int limitKbps_;
+    double bytesPerSecond_;
+    double burstBytes_;
+    double tokens_;
+    std::chrono::steady_clock::time_point lastRefill_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+
+    void Refill(const std::chrono::steady_clock::time_point& now);
+
+    BandwidthLimiter(const BandwidthLimiter&);
+    BandwidthLimiter& operator=(const BandwidthLimiter&);
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+/*
+ * CircuitBreaker.h
+ * Per-endpoint breaker: after repeated server-side failures the endpoint is
+ * short-circuited for a jittered, growing interval, then a single half-open
+ * probe decides whether it closes again
+ */
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include "RetryPolicy.h"
+
+enum CircuitState {
+    CIRCUIT_CLOSED = 0,
+    CIRCUIT_OPEN = 1,
+    CIRCUIT_HALF_OPEN = 2
+};
+
+class CircuitBreaker {
+public:
+    CircuitBreaker(int failureThreshold, int openBaseMs, int openMaxMs);
+    ~CircuitBreaker();
+
+    // False while the circuit is open; once it expires exactly one caller is let through as the probe
+    bool AllowRequest(const std::wstring& key);
+    void RecordSuccess(const std::wstring& key);
+    void RecordFailure(const std::wstring& key);
+    CircuitState GetState(const std::wstring& key) const;
+
+private:
+    struct Circuit {
+        CircuitState state;
+        int consecutiveFailures;
+        bool probeInFlight;
+        std::chrono::steady_clock::time_point openUntil;
+        RetryPolicy openBackoff;
+
+        Circuit(int openBaseMs, int openMaxMs)
+            : state(CIRCUIT_CLOSED), consecutiveFailures(0), probeInFlight(false),
+            openBackoff(openBaseMs, openMaxMs) {
+        }
+    };
+
+    int failureThreshold_;
+    int openBaseMs_;
+    int openMaxMs_;
+    std::map<std::wstring, Circuit> circuits_;
+    mutable std::mutex mutex_;
+
+    Circuit& GetCircuit(const std::wstring& key);
+
+    CircuitBreaker(const CircuitBreaker&);
+    CircuitBreaker& operator=(const CircuitBreaker&);
+};
+
+#endif
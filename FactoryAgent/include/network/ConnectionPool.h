@@ -0,0 +1,68 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+/*
+ * ConnectionPool.h
+ * Long-lived WinHTTP session with per-host keep-alive connections
+ */
+
+#ifdef _WIN32
+
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <windows.h>
+#include <winhttp.h>
+#include "HttpTransport.h"
+
+class ConnectionPool {
+public:
+    ConnectionPool();
+    ~ConnectionPool();
+
+    // Returns a connect handle for host:port; every Acquire needs a matching Release
+    HINTERNET Acquire(const std::wstring& host, int port);
+    void Release(const std::wstring& host, int port);
+
+    // Classifies the socket the request ran on as new or reused; returns true when reused
+    bool RecordResponse(const std::wstring& host, int port, HINTERNET hRequest);
+    // After a connection-level error the session is recycled, since its idle sockets may be as
+    // dead as the one that failed; returns true if a retry is worthwhile
+    bool ReportFailure(DWORD error);
+
+    void EvictIdle();
+    ConnectionStats GetStats() const;
+
+private:
+    struct HostEntry {
+        HINTERNET hConnect;
+        ULONGLONG lastUsed;
+        int inUse;
+        std::set<unsigned short> localPorts;
+    };
+
+    HINTERNET hSession_;
+    bool recycleSession_;       // set on a connection error, done once no request is in flight
+    std::map<std::wstring, HostEntry> hosts_;
+    mutable std::mutex mutex_;
+
+    std::atomic<long long> requests_;
+    std::atomic<long long> connectionsReused_;
+    std::atomic<long long> newHandshakes_;
+    std::atomic<long long> idleEvictions_;
+    std::atomic<long long> failedHealthChecks_;
+
+    bool EnsureSession();
+    void CloseEntry(HostEntry& entry);
+    void CloseSession();
+    static std::wstring MakeKey(const std::wstring& host, int port);
+
+    ConnectionPool(const ConnectionPool&);
+    ConnectionPool& operator=(const ConnectionPool&);
+};
+
+#endif // _WIN32
+
+#endif
@@ -7,34 +7,223 @@
  */
 
 #include <string>
-#include <windows.h>
-#include <winhttp.h>
+#include "HttpTransport.h"
+#include "SegmentScheduler.h"
+#include "RequestQueue.h"
+#include "CircuitBreaker.h"
+#include "RequestMetrics.h"
+#include "BandwidthLimiter.h"
+#include "../utilities/WireCodec.h"
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <memory>
 #include "../../third_party/json/json.hpp"
 
-#pragma comment(lib, "winhttp.lib")
-
 using json = nlohmann::json;
 
+// Outcome of an asynchronous request; response is only meaningful when success is true
+struct HttpResult {
+    bool success;
+    json response;
+
+    HttpResult() {
+        success = false;
+    }
+};
+
+// One byte range of a local file, sent under its content hash
+struct UploadChunk {
+    std::string filePath;
+    long long offset;
+    size_t length;
+    std::string hash;
+
+    UploadChunk() {
+        offset = 0;
+        length = 0;
+    }
+};
+
+// What identifies a downloaded entity, for conditional requests the next time round
+struct DownloadValidators {
+    std::string etag;
+    std::string lastModified;
+    std::string sha256;
+
+    bool IsEmpty() const {
+        return etag.empty() && lastModified.empty();
+    }
+};
+
+enum DownloadOutcome {
+    DOWNLOAD_FAILED,
+    DOWNLOAD_COMPLETED,
+    DOWNLOAD_NOT_MODIFIED       // the server still has the entity described by the cached validators
+};
+
+class RandomAccessFile;
+
 class HttpClient {
 public:
     HttpClient(const std::wstring& serverUrl);
+    // Takes ownership of transport; used to run the client over a non-default backend
+    HttpClient(const std::wstring& serverUrl, HttpTransport* transport);
     ~HttpClient();
 
     bool Post(const std::wstring& endpoint, const json& data, json& response);
+    // Also reports the HTTP status, so callers can tell "endpoint missing" (404) from a network failure
+    bool Post(const std::wstring& endpoint, const json& data, json& response, int& statusCode);
+    // Feeds the response to a SAX handler instead of building a DOM; JSON bodies are parsed
+    // chunk by chunk as they arrive. Post() is this with a DOM-building handler
+    bool PostStreaming(const std::wstring& endpoint, const json& data, json::json_sax_t& handler,
+        int& statusCode);
     bool Get(const std::wstring& endpoint, json& response);
+    // Posts JSON and hands the raw response body to sink as it arrives, for responses the
+    // server keeps open such as the command channel. Returning false from sink ends it, and so
+    // does cancel from another thread, without waiting for the server's next write
+    bool OpenStream(const std::wstring& endpoint, const json& data, const BodySink& sink,
+        TransportCancel* cancel, int& statusCode);
+    // Posts a JSON body of bodyLength bytes pulled from source, for bodies too large to build
+    // in memory. Sent as it comes: never gzipped or re-encoded, and not held to the bandwidth cap
+    bool PostBody(const std::wstring& endpoint, const BodySource& source, long long bodyLength, json& response);
     bool UploadFile(const std::wstring& endpoint, const std::string& filePath,
         const std::string& modelName, json& response);
-    bool DownloadFile(const std::string& url, const std::string& outputPath);
+    // Sends the chunks in one octet-stream body, each framed as "<hash> <length>\n<bytes>";
+    // file data is streamed from mapped windows and counts against the bandwidth cap
+    bool UploadChunks(const std::wstring& endpoint, const std::vector<UploadChunk>& chunks, json& response);
+    // Resumes from a previous <outputPath>.part when possible and verifies the SHA-256
+    // against expectedSha256, or against the server's digest header when none is given
+    bool DownloadFile(const std::string& url, const std::string& outputPath,
+        const std::string& expectedSha256 = "");
+    // Asks first with If-None-Match / If-Modified-Since from cached (a one-byte probe either
+    // way) and only downloads when the entity changed. fresh receives the validators of the
+    // entity the probe saw, to be cached once the caller has used the file
+    DownloadOutcome DownloadFileIfChanged(const std::string& url, const std::string& outputPath,
+        const DownloadValidators& cached, DownloadValidators& fresh, const std::string& expectedSha256 = "");
+
+    // Asynchronous variants run on the request queue. Heartbeats and syncs belong on the
+    // interactive lane and transfers on the bulk lane, so neither waits behind the other
+    std::future<HttpResult> PostAsync(const std::wstring& endpoint, const json& data,
+        RequestLane lane = REQUEST_LANE_INTERACTIVE);
+    void PostAsync(const std::wstring& endpoint, const json& data, RequestLane lane,
+        const std::function<void(const HttpResult&)>& completion);
+    std::future<bool> PostStreamingAsync(const std::wstring& endpoint, const json& data,
+        const std::shared_ptr<json::json_sax_t>& handler, RequestLane lane = REQUEST_LANE_INTERACTIVE);
+    std::future<HttpResult> UploadFileAsync(const std::wstring& endpoint, const std::string& filePath,
+        const std::string& modelName);
+    std::future<bool> DownloadFileAsync(const std::string& url, const std::string& outputPath,
+        const std::string& expectedSha256 = "");
+    std::future<DownloadOutcome> DownloadFileIfChangedAsync(const std::string& url, const std::string& outputPath,
+        const DownloadValidators& cached, DownloadValidators* fresh, const std::string& expectedSha256 = "");
+
+    // Body encoding for Post/Get; negotiated at registration, JSON until then
+    void SetWireEncoding(WireEncoding encoding);
+    WireEncoding GetWireEncoding() const;
+
+    // Caps upload and download bodies, in kilobits per second, across all transfers; 0 lifts
+    // the cap. Heartbeats, syncs and command results are never held back by it
+    void SetBandwidthLimit(int kbps);
+    int GetBandwidthLimit() const;
+
+    // Downloads at least this large are fetched as parallel segments when the server honours
+    // ranges; 0 keeps every download on one stream. SEGMENTED_DOWNLOAD_MIN_BYTES until set
+    void SetSegmentedDownloadThreshold(long long bytes);
+
+    // Ends every exchange in flight, whichever thread it is on, and fails new ones at once
+    // until ResumeTransfers; lets a thread stuck in a long transfer be stopped and joined
+    void CancelTransfers();
+    void ResumeTransfers();
+
+    // Sync, result and upload endpoints fail fast while the server is failing them
+    CircuitState GetCircuitState(const std::wstring& endpoint) const;
+
+    ConnectionStats GetConnectionStats() const;
+    // Gzip accounting per endpoint path (query string ignored); also in the metrics summary
+    std::map<std::wstring, CompressionStats> GetCompressionStats() const;
+
+    // Latency histograms per endpoint path (query string ignored), for every request made
+    bool GetEndpointMetrics(const std::wstring& endpoint, EndpointMetricsSnapshot& snapshot) const;
+    // Interval summary for the heartbeat; acknowledge once the server has taken it
+    json CollectMetricsSummary();
+    void AcknowledgeMetricsSummary();
 
 private:
     std::wstring serverUrl_;
     std::wstring hostName_;
     int port_;
     bool useHttps_;
+    HttpTransport* transport_;
+    RequestQueue* requestQueue_;
+    CircuitBreaker* circuitBreaker_;
+    RequestMetrics* requestMetrics_;
+    BandwidthLimiter* bandwidthLimiter_;
+    std::atomic<int> wireEncoding_;
+    std::atomic<long long> segmentedMinBytes_;
+    std::set<TransportCancel*> transfers_;  // one per exchange in flight
+    bool transfersCancelled_;
+    std::mutex transfersMutex_;
+
+    struct DownloadState {
+        std::string url;
+        std::string etag;
+        long long offset;                   // sequential mode: bytes already on disk
+        long long total;                    // segmented mode: pre-allocated file size
+        std::vector<ByteRange> completed;   // segmented mode: ranges already on disk
+
+        DownloadState() {
+            offset = 0;
+            total = 0;
+        }
+    };
+
+    struct SegmentJob {
+        std::wstring host;
+        int port;
+        std::wstring path;
+        bool useHttps;
+        std::string etag;
+        RandomAccessFile* file;
+        SegmentScheduler* scheduler;
+        std::atomic<bool> entityChanged;
+        std::atomic<int> finishedWorkers;
+    };
 
     bool ParseUrl();
+    bool ResolveUrl(const std::string& url, std::wstring& host, int& port,
+        std::wstring& path, bool& useHttps) const;
     bool SendRequest(const std::wstring& method, const std::wstring& endpoint,
-        const std::string& data, std::string& response);
+        const std::string& data, WireEncoding encoding, json::json_sax_t& handler, int& statusCode);
+    bool SendPost(const std::wstring& endpoint, const json& data, json::json_sax_t& handler, int& statusCode);
+    static std::wstring CircuitKey(const std::wstring& endpoint);
+    static bool UsesCircuitBreaker(const std::wstring& circuit);
+    void RecordOutcome(const std::wstring& circuit, int statusCode);
+    // Every exchange goes through here so it lands in requestMetrics_ and CancelTransfers reaches it
+    bool Transmit(TransportRequest& request, TransportResponse& reply, const BodySink& sink);
+    TransportRequest MakeRequest(const std::wstring& method, const std::wstring& host, int port,
+        const std::wstring& path, bool useHttps) const;
+    void RecordCompression(const std::wstring& endpoint, bool request,
+        long long rawBytes, long long wireBytes, long long micros);
+    // total is -1 when the server sent "*"; false when the header is not a valid byte range
+    static bool ParseContentRange(const std::string& contentRange, long long& start, long long& end,
+        long long& total);
+    static bool LoadDownloadState(const std::string& metaPath, DownloadState& state);
+    static bool SaveDownloadState(const std::string& metaPath, const DownloadState& state);
+    bool ProbeRanges(const std::wstring& host, int port, const std::wstring& path, bool useHttps,
+        long long& total, std::string& etag, std::string& digest);
+    bool DownloadSegmented(SegmentJob& job, const std::string& partPath,
+        const std::string& metaPath, DownloadState& state);
+    void RunSegmentWorker(SegmentJob* job, int workerIndex);
+    bool FetchSegment(SegmentJob* job, const ByteRange& segment, long long& written);
+    static bool FinalizeDownload(const std::string& partPath, const std::string& metaPath,
+        const std::string& outputPath, const std::string& expectedSha256);
+
+    HttpClient(const HttpClient&);
+    HttpClient& operator=(const HttpClient&);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+/*
+ * HttpTransport.h
+ * Wire-level HTTP/1.1 exchange underneath HttpClient
+ * WinHTTP on Windows, plain POSIX sockets elsewhere
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <mutex>
+
+struct ConnectionStats {
+    long long requests;
+    long long connectionsReused;
+    long long newHandshakes;
+    long long idleEvictions;
+    long long failedHealthChecks;
+
+    ConnectionStats() {
+        requests = 0;
+        connectionsReused = 0;
+        newHandshakes = 0;
+        idleEvictions = 0;
+        failedHealthChecks = 0;
+    }
+};
+
+// Pulls the request body one window at a time: given an offset, points data at the bytes
+// that start there. The window must stay valid until the next call, so mapped views work
+// without copying. Returning false aborts the request.
+typedef std::function<bool(long long offset, const char*& data, size_t& length)> BodySource;
+
+// Receives the response body as it arrives; returning false aborts the read
+typedef std::function<bool(const char* data, size_t length)> BodySink;
+
+// Lets another thread end an exchange that is blocked on the network. The transport arms
+// it with a closer for the connection in use, and Cancel runs that closer, so a read waiting
+// on a quiet server returns at once instead of at the next byte
+class TransportCancel {
+public:
+    TransportCancel() {
+        cancelled_ = false;
+    }
+
+    void Cancel() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+        if (closer_) {
+            closer_();
+            closer_ = std::function<void()>();
+        }
+    }
+
+    // Clears a previous Cancel so the owner can start over
+    void Reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = false;
+        closer_ = std::function<void()>();
+    }
+
+    bool IsCancelled() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cancelled_;
+    }
+
+    // For transports. Arm returns false when already cancelled; Disarm returns true when
+    // the closer ran, so the connection is no longer the transport's to close or reuse
+    bool Arm(const std::function<void()>& closer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_) {
+            return false;
+        }
+        closer_ = closer;
+        return true;
+    }
+
+    bool Disarm() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closer_ = std::function<void()>();
+        return cancelled_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::function<void()> closer_;
+    bool cancelled_;
+
+    TransportCancel(const TransportCancel&);
+    TransportCancel& operator=(const TransportCancel&);
+};
+
+struct TransportRequest {
+    std::wstring method;
+    std::wstring host;
+    int port;
+    bool useHttps;
+    std::wstring path;
+    std::vector<std::pair<std::string, std::string> > headers;
+    std::string body;           // in-memory body, used when there is no bodySource
+    BodySource bodySource;      // streamed body of bodyLength bytes
+    long long bodyLength;
+    TransportCancel* cancel;    // optional; lets another thread end the exchange
+
+    TransportRequest() {
+        port = 0;
+        useHttps = false;
+        bodyLength = 0;
+        cancel = NULL;
+    }
+
+    // Sending it twice cannot repeat a side effect; sync, upload and command results are POSTs
+    bool IsIdempotent() const {
+        return method == L"GET" || method == L"HEAD";
+    }
+};
+
+// Where the time of one exchange went, in microseconds. resolve/connect/tls are zero when a
+// kept-alive connection was reused; firstByte runs from the end of the request to the first
+// response byte, transfer from there to the end of the body
+struct TransportTimings {
+    long long resolveMicros;
+    long long connectMicros;
+    long long tlsMicros;
+    long long firstByteMicros;
+    long long transferMicros;
+    long long totalMicros;
+    long long bytesSent;
+    long long bytesReceived;
+    bool reusedConnection;
+
+    TransportTimings() {
+        resolveMicros = 0;
+        connectMicros = 0;
+        tlsMicros = 0;
+        firstByteMicros = 0;
+        transferMicros = 0;
+        totalMicros = 0;
+        bytesSent = 0;
+        bytesReceived = 0;
+        reusedConnection = false;
+    }
+};
+
+struct TransportResponse {
+    int statusCode;
+    std::map<std::string, std::string> headers;     // names are lower-case
+    TransportTimings timings;
+
+    TransportResponse() {
+        statusCode = 0;
+    }
+
+    std::string Header(const std::string& lowerName) const {
+        std::map<std::string, std::string>::const_iterator it = headers.find(lowerName);
+        return (it != headers.end()) ? it->second : "";
+    }
+};
+
+class HttpTransport {
+public:
+    virtual ~HttpTransport() {}
+
+    // Runs one exchange and streams the response body into sink. False means the exchange
+    // did not complete: the connection failed, the server hung up early or the sink aborted.
+    // A GET or HEAD that dies on a stale keep-alive socket before any response byte is retried once.
+    // A cancelled exchange fails and is never retried.
+    virtual bool Send(const TransportRequest& request, TransportResponse& response, const BodySink& sink) = 0;
+
+    virtual ConnectionStats GetStats() const = 0;
+
+    // WinHTTP on Windows, POSIX sockets everywhere else
+    static HttpTransport* CreateDefault();
+};
+
+#endif
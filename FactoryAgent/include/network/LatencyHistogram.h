@@ -0,0 +1,62 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+/*
+ * LatencyHistogram.h
+ * Log-linear (HDR-style) histogram with lock-free recording: every power of two
+ * is split into 16 linear sub-buckets, so any recorded value is reported within
+ * about 6% of its true value from 1 up to 2^40
+ */
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// Point-in-time copy of a histogram; cheap to subtract for interval reporting
+struct HistogramSnapshot {
+    std::vector<long long> counts;
+    long long count;
+    long long sum;
+    long long max;
+
+    HistogramSnapshot() {
+        count = 0;
+        sum = 0;
+        max = 0;
+    }
+
+    // Highest value equivalent to the bucket holding the given percentile (0-100); 0 when empty
+    long long ValueAtPercentile(double percentile) const;
+    long long Mean() const;
+    // What was recorded after earlier was taken; max is bounded by the highest non-empty bucket
+    HistogramSnapshot Since(const HistogramSnapshot& earlier) const;
+};
+
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int MAX_VALUE_BITS = 40;
+    static const int BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    LatencyHistogram();
+
+    // Wait-free apart from the max update; negative values count as 0, oversized ones are clamped
+    void Record(long long value);
+    HistogramSnapshot Snapshot() const;
+
+    static int BucketIndex(long long value);
+    static long long BucketLowest(int index);
+    static long long BucketHighest(int index);
+
+private:
+    std::atomic<long long> counts_[BUCKET_COUNT];
+    std::atomic<long long> count_;
+    std::atomic<long long> sum_;
+    std::atomic<long long> max_;
+
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef POSIX_HTTP_TRANSPORT_H
+#define POSIX_HTTP_TRANSPORT_H
+
+/*
+ * PosixHttpTransport.h
+ * HTTP/1.1 client over plain BSD sockets with per-host keep-alive
+ * Used on Linux hosts; plain http only, there is no TLS in this transport
+ */
+
+#ifndef _WIN32
+
+#include "HttpTransport.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+class SocketStream;
+
+class PosixHttpTransport : public HttpTransport {
+public:
+    PosixHttpTransport();
+    ~PosixHttpTransport();
+
+    bool Send(const TransportRequest& request, TransportResponse& response, const BodySink& sink);
+    ConnectionStats GetStats() const;
+
+private:
+    struct IdleSocket {
+        int fd;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    std::map<std::string, std::vector<IdleSocket> > idle_;
+    std::mutex mutex_;
+
+    std::atomic<long long> requests_;
+    std::atomic<long long> connectionsReused_;
+    std::atomic<long long> newHandshakes_;
+    std::atomic<long long> idleEvictions_;
+    std::atomic<long long> failedHealthChecks_;
+
+    int Checkout(const std::string& key, const std::string& host, int port, bool& reused,
+        TransportTimings& timings);
+    void Checkin(const std::string& key, int fd);
+    void EvictIdle();
+
+    static int Connect(const std::string& host, int port, TransportTimings& timings);
+    static long long MicrosBetween(const std::chrono::steady_clock::time_point& from,
+        const std::chrono::steady_clock::time_point& to);
+    static bool IsAlive(int fd);
+    static bool WriteRequest(SocketStream& stream, const TransportRequest& request, const std::string& host);
+    static bool ReadResponse(SocketStream& stream, const TransportRequest& request, TransportResponse& response,
+        const BodySink& sink, bool& aborted, bool& keepAlive);
+
+    PosixHttpTransport(const PosixHttpTransport&);
+    PosixHttpTransport& operator=(const PosixHttpTransport&);
+};
+
+#endif // _WIN32
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef REQUEST_METRICS_H
+#define REQUEST_METRICS_H
+
+/*
+ * RequestMetrics.h
+ * Per-endpoint latency histograms and byte counts for every HTTP exchange.
+ * Recording never takes a lock once an endpoint has been seen; the summary
+ * for the heartbeat covers what happened since the last one the server took
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "HttpTransport.h"
+#include "LatencyHistogram.h"
+#include "../../third_party/json/json.hpp"
+
+using json = nlohmann::json;
+
+// Per-endpoint gzip accounting; ratio is rawBytes / wireBytes, CPU cost is the micros
+struct CompressionStats {
+    long long requestsCompressed;
+    long long requestRawBytes;
+    long long requestWireBytes;
+    long long compressMicros;
+    long long responsesCompressed;
+    long long responseRawBytes;
+    long long responseWireBytes;
+    long long decompressMicros;
+
+    CompressionStats() {
+        requestsCompressed = 0;
+        requestRawBytes = 0;
+        requestWireBytes = 0;
+        compressMicros = 0;
+        responsesCompressed = 0;
+        responseRawBytes = 0;
+        responseWireBytes = 0;
+        decompressMicros = 0;
+    }
+
+    CompressionStats Since(const CompressionStats& earlier) const;
+};
+
+struct EndpointMetricsSnapshot {
+    std::wstring endpoint;
+    HistogramSnapshot total;
+    HistogramSnapshot resolve;
+    HistogramSnapshot connect;
+    HistogramSnapshot tls;
+    HistogramSnapshot firstByte;
+    HistogramSnapshot transfer;
+    long long failures;
+    long long reusedConnections;
+    long long bytesSent;
+    long long bytesReceived;
+    CompressionStats compression;
+
+    EndpointMetricsSnapshot() {
+        failures = 0;
+        reusedConnections = 0;
+        bytesSent = 0;
+        bytesReceived = 0;
+    }
+
+    EndpointMetricsSnapshot Since(const EndpointMetricsSnapshot& earlier) const;
+};
+
+class RequestMetrics {
+public:
+    // Endpoints beyond this share one "(other)" entry
+    static const int MAX_ENDPOINTS = 32;
+
+    RequestMetrics();
+    ~RequestMetrics();
+
+    // failed: no response at all, or a 5xx. Total time is recorded either way
+    void Record(const std::wstring& endpoint, const TransportTimings& timings, bool failed);
+    // request: a body gzipped before sending; otherwise a gzipped response inflated
+    void RecordCompression(const std::wstring& endpoint, bool request,
+        long long rawBytes, long long wireBytes, long long micros);
+
+    bool GetSnapshot(const std::wstring& endpoint, EndpointMetricsSnapshot& snapshot) const;
+    std::vector<EndpointMetricsSnapshot> GetSnapshots() const;
+
+    // Summary of everything recorded since the last acknowledged one; until the server
+    // acknowledges, the next summary keeps covering the same interval
+    json CollectSummary();
+    void AcknowledgeSummary();
+
+private:
+    struct EndpointMetrics {
+        std::wstring endpoint;
+        size_t hash;
+        LatencyHistogram total;
+        LatencyHistogram resolve;
+        LatencyHistogram connect;
+        LatencyHistogram tls;
+        LatencyHistogram firstByte;
+        LatencyHistogram transfer;
+        std::atomic<long long> failures;
+        std::atomic<long long> reusedConnections;
+        std::atomic<long long> bytesSent;
+        std::atomic<long long> bytesReceived;
+        std::atomic<long long> requestsCompressed;
+        std::atomic<long long> requestRawBytes;
+        std::atomic<long long> requestWireBytes;
+        std::atomic<long long> compressMicros;
+        std::atomic<long long> responsesCompressed;
+        std::atomic<long long> responseRawBytes;
+        std::atomic<long long> responseWireBytes;
+        std::atomic<long long> decompressMicros;
+
+        EndpointMetrics(const std::wstring& name, size_t nameHash)
+            : endpoint(name), hash(nameHash), failures(0), reusedConnections(0),
+            bytesSent(0), bytesReceived(0), requestsCompressed(0), requestRawBytes(0),
+            requestWireBytes(0), compressMicros(0), responsesCompressed(0), responseRawBytes(0),
+            responseWireBytes(0), decompressMicros(0) {
+        }
+
+        EndpointMetricsSnapshot Snapshot() const;
+    };
+
+    // Slots are written once, before published_ is bumped, and never move afterwards
+    EndpointMetrics* slots_[MAX_ENDPOINTS];
+    std::atomic<int> published_;
+    std::mutex insertMutex_;
+
+    std::mutex summaryMutex_;
+    std::map<std::wstring, EndpointMetricsSnapshot> baseline_;
+    std::map<std::wstring, EndpointMetricsSnapshot> pending_;
+    std::chrono::steady_clock::time_point baselineTime_;
+    std::chrono::steady_clock::time_point pendingTime_;
+
+    EndpointMetrics* Find(const std::wstring& endpoint, size_t hash) const;
+    EndpointMetrics* FindOrAdd(const std::wstring& endpoint);
+    static size_t Hash(const std::wstring& endpoint);
+    static json SummarizeEndpoint(const EndpointMetricsSnapshot& interval);
+
+    RequestMetrics(const RequestMetrics&);
+    RequestMetrics& operator=(const RequestMetrics&);
+};
+
+#endif
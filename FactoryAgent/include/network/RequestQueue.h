@@ -0,0 +1,48 @@
+#ifndef REQUEST_QUEUE_H
+#define REQUEST_QUEUE_H
+
+/*
+ * RequestQueue.h
+ * Small I/O thread pool with separate lanes so bulk transfers
+ * never occupy the threads that serve heartbeats and small syncs
+ */
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+enum RequestLane {
+    REQUEST_LANE_INTERACTIVE = 0,   // heartbeats, syncs, command results
+    REQUEST_LANE_BULK = 1           // model uploads and downloads
+};
+
+class RequestQueue {
+public:
+    RequestQueue(int interactiveThreads, int bulkThreads);
+    ~RequestQueue();
+
+    // Returns false once the queue is shutting down; the task is not run in that case
+    bool Submit(RequestLane lane, const std::function<void()>& task);
+    void Shutdown();
+
+private:
+    struct Lane {
+        std::deque<std::function<void()> > tasks;
+        std::vector<std::thread> workers;
+        std::condition_variable wake;
+    };
+
+    Lane lanes_[2];
+    std::mutex mutex_;
+    bool stopping_;
+
+    void WorkerLoop(Lane* lane);
+
+    RequestQueue(const RequestQueue&);
+    RequestQueue& operator=(const RequestQueue&);
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+/*
+ * RetryPolicy.h
+ * Exponential backoff with decorrelated jitter: each delay is drawn from
+ * [base, previous * 3] and capped, so a fleet that failed together does not
+ * come back together
+ */
+
+#include <random>
+
+class RetryPolicy {
+public:
+    RetryPolicy(int baseDelayMs, int maxDelayMs);
+
+    int NextDelayMs();
+    // Call after a success; the next failure starts again from the base delay
+    void Reset();
+    int GetAttempts() const;
+
+private:
+    int baseDelayMs_;
+    int maxDelayMs_;
+    long long previousDelayMs_;
+    int attempts_;
+    std::mt19937 random_;
+};
+
+#endif
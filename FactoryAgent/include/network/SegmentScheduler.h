@@ -0,0 +1,66 @@
+#ifndef SEGMENT_SCHEDULER_H
+#define SEGMENT_SCHEDULER_H
+
+/*
+ * SegmentScheduler.h
+ * Hands out byte ranges to parallel download workers and adapts
+ * segment size and concurrency to the measured throughput
+ */
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+struct ByteRange {
+    long long start;    // inclusive
+    long long end;      // exclusive
+
+    ByteRange() : start(0), end(0) {}
+    ByteRange(long long s, long long e) : start(s), end(e) {}
+    long long Length() const { return end - start; }
+};
+
+enum SegmentAssignment {
+    SEGMENT_ASSIGNED,   // segment holds a range to fetch
+    SEGMENT_WAIT,       // nothing for this worker right now; ask again shortly
+    SEGMENT_FINISHED    // every byte has been fetched or the download was abandoned
+};
+
+class SegmentScheduler {
+public:
+    SegmentScheduler(long long totalSize, const std::vector<ByteRange>& completed,
+        int initialWorkers, int maxWorkers);
+
+    SegmentAssignment Next(int workerIndex, ByteRange& segment);
+    // Reports a fully written segment and how long it took
+    void Complete(const ByteRange& written, long long elapsedMs);
+    // Keeps what a failed segment did write and puts its unfetched tail back into the queue
+    void Fail(const ByteRange& written, const ByteRange& remainder);
+
+    bool IsComplete() const;
+    int GetActiveWorkers() const;
+    long long GetSegmentSize() const;
+    std::vector<ByteRange> GetCompletedRanges() const;
+
+private:
+    long long totalSize_;
+    std::vector<ByteRange> pending_;
+    std::vector<ByteRange> completed_;
+    int inFlight_;
+    int failures_;
+    int activeWorkers_;
+    int maxWorkers_;
+    long long segmentSize_;
+    double perWorkerBytesPerMs_;
+
+    std::chrono::steady_clock::time_point windowStart_;
+    long long windowBytes_;
+    double lastAggregateBytesPerMs_;
+
+    mutable std::mutex mutex_;
+
+    void AddCompleted(const ByteRange& range);
+    void Adapt(long long bytes, long long elapsedMs);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SOCKET_STREAM_H
+#define SOCKET_STREAM_H
+
+/*
+ * SocketStream.h
+ * Buffered HTTP/1.1 framing over a connected POSIX socket
+ * Shared by PosixHttpTransport and StandInServer
+ */
+
+#ifndef _WIN32
+
+#include "HttpTransport.h"
+#include <string>
+#include <map>
+
+class SocketStream {
+public:
+    explicit SocketStream(int fd);
+
+    // Reads one CRLF-terminated line; fails on EOF, timeout or an oversized line
+    bool ReadLine(std::string& line);
+    // Reads "Name: value" lines up to the blank line; names are lower-cased
+    bool ReadHeaders(std::map<std::string, std::string>& headers);
+
+    // Body framings; sink may be empty to discard. aborted is set when the sink refuses data
+    bool ReadExact(long long length, const BodySink& sink, bool& aborted);
+    bool ReadChunked(const BodySink& sink, bool& aborted);
+    bool ReadToClose(const BodySink& sink, bool& aborted);
+
+    bool WriteAll(const char* data, size_t length);
+    bool WriteAll(const std::string& data);
+
+    // True once anything at all has arrived from the peer
+    bool ReceivedAny() const;
+    // Raw socket traffic, framing and headers included
+    long long GetBytesRead() const;
+    long long GetBytesWritten() const;
+
+private:
+    int fd_;
+    char buffer_[16 * 1024];
+    size_t begin_;
+    size_t end_;
+    bool receivedAny_;
+    bool peerClosed_;
+    long long bytesRead_;
+    long long bytesWritten_;
+
+    bool Fill();
+
+    SocketStream(const SocketStream&);
+    SocketStream& operator=(const SocketStream&);
+};
+
+#endif // _WIN32
+
+#endif
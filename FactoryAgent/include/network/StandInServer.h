@@ -0,0 +1,150 @@
+#ifndef STAND_IN_SERVER_H
+#define STAND_IN_SERVER_H
+
+/*
+ * StandInServer.h
+ * In-process loopback server that answers the agent API endpoints
+ * the way FactoryMonitoringWeb does, so the agent's network paths can be
+ * exercised and measured on Linux without the real server or a database
+ */
+
+#ifndef _WIN32
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include "../../third_party/json/json.hpp"
+
+using json = nlohmann::json;
+
+class SocketStream;
+
+struct StandInEndpointStats {
+    long long requests;
+    long long bytesIn;      // request bodies as received on the wire
+    long long bytesOut;     // response bodies as sent on the wire
+
+    StandInEndpointStats() {
+        requests = 0;
+        bytesIn = 0;
+        bytesOut = 0;
+    }
+};
+
+class StandInServer {
+public:
+    StandInServer();
+    ~StandInServer();
+
+    // Listens on 127.0.0.1; port 0 picks a free one
+    bool Start(int port = 0);
+    void Stop();
+    int GetPort() const;
+    std::wstring GetBaseUrl() const;
+
+    // Served by GET /api/agent/downloadmodel/<id> with an ETag, Last-Modified, byte ranges,
+    // If-None-Match / If-Modified-Since and X-Content-SHA256
+    void SetModelPayload(const std::string& payload);
+    // Pushed at once over an open command channel, otherwise handed out with the next
+    // heartbeat; either way it is considered in progress from then on
+    void QueueCommand(const json& command);
+    // On by default; off, registration does not offer the channel and its endpoint is a 404
+    void SetCommandChannelEnabled(bool enabled);
+    // On by default; off, registration offers only JSON and CBOR / MessagePack bodies are
+    // refused with 415, as a server rolled back to a JSON-only build would
+    void SetBinaryEncodingsEnabled(bool enabled);
+    // Holds each JSON reply this long after the request was acted on, as a stalled server would
+    void SetReplyDelay(int milliseconds);
+    // Makes a download pay one round trip of this many milliseconds before its headers and one
+    // per 256 KB after them, as a long link with a window of that size would
+    void SetDownloadRoundTrip(int milliseconds);
+    // Hangs up downloads once this many more body bytes have gone out, in total, and keeps
+    // hanging them up, as a dropped link would; -1 (the default) lets them run
+    void SetDownloadCutoff(long long bytes);
+    // Starts each ranged download at the requested start rounded down to a multiple of this
+    // many bytes, labelled as such in Content-Range, as a block-aligned caching proxy would;
+    // 0 (the default) serves exactly the range asked for
+    void SetRangeAlignment(long long bytes);
+
+    std::map<std::string, StandInEndpointStats> GetStats() const;
+    std::vector<json> GetCommandResults() const;
+    // The server's copy of the monitored config, kept current by full and delta syncs
+    std::string GetConfigContent() const;
+    // The server's copy of the log tree, as LogStructureJson holds it
+    std::string GetLogStructure() const;
+    // Files rebuilt by the last chunked upload of modelName, by manifest path
+    std::map<std::string, std::string> GetAssembledModel(const std::string& modelName) const;
+    // Empties the chunk store, as if it had been cleaned up between query and commit
+    void DropChunks();
+
+private:
+    struct Payload {
+        std::string data;
+        std::string etag;
+        std::string digest;
+        std::string lastModified;   // HTTP-date of the SetModelPayload call
+    };
+
+    struct Request {
+        std::string method;
+        std::string path;
+        std::map<std::string, std::string> headers;
+        std::string body;
+        long long wireBytes;
+        bool malformed;     // body could not be decoded
+    };
+
+    int listenFd_;
+    int port_;
+    std::atomic<bool> running_;
+    std::thread acceptThread_;
+    std::vector<std::thread> connectionThreads_;
+    std::set<int> openConnections_;
+
+    std::shared_ptr<const Payload> payload_;
+    json pendingCommands_;
+    std::condition_variable commandQueued_;
+    bool channelEnabled_;
+    std::atomic<bool> binaryEncodings_;
+    std::atomic<int> replyDelayMs_;
+    std::atomic<int> downloadRoundTripMs_;
+    long long downloadAllowance_;   // body bytes left before the cutoff, -1 for no cutoff
+    std::atomic<long long> rangeAlignment_;
+    std::vector<json> commandResults_;
+    std::map<std::string, int> registeredPcs_;
+    std::string configContent_;
+    std::string logStructure_;
+    std::string logVersion_;
+    std::map<std::string, std::string> chunks_;
+    std::map<std::string, std::map<std::string, std::string> > assembledModels_;
+    std::map<std::string, StandInEndpointStats> stats_;
+    mutable std::mutex mutex_;
+
+    void AcceptLoop();
+    void ServeConnection(int fd);
+    bool ReadRequest(SocketStream& stream, Request& request, bool& keepAlive);
+    bool HandleRequest(SocketStream& stream, const Request& request, bool keepAlive);
+    json HandleJson(const std::string& endpoint, const json& body, int& status);
+    bool StoreConfigSection(const json& section);
+    bool StoreLogSection(const json& section);
+    json StoreChunkBatch(const std::string& body, int& status);
+    json AssembleModel(const json& manifest);
+    bool SendDownload(SocketStream& stream, const Request& request, bool keepAlive, long long& bytesOut);
+    bool SendCommandChannel(SocketStream& stream, const Request& request, bool keepAlive, long long& bytesOut);
+    static std::string BuildHead(int status, const std::string& contentType, long long contentLength,
+        const std::vector<std::pair<std::string, std::string> >& headers, bool keepAlive);
+    void Record(const std::string& endpoint, long long bytesIn, long long bytesOut);
+
+    StandInServer(const StandInServer&);
+    StandInServer& operator=(const StandInServer&);
+};
+
+#endif // _WIN32
+
+#endif
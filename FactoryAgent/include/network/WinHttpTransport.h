@@ -0,0 +1,45 @@
+#ifndef WIN_HTTP_TRANSPORT_H
+#define WIN_HTTP_TRANSPORT_H
+
+/*
+ * WinHttpTransport.h
+ * HttpTransport on top of WinHTTP and the pooled session
+ */
+
+#ifdef _WIN32
+
+#include "HttpTransport.h"
+#include "ConnectionPool.h"
+#include <chrono>
+
+#pragma comment(lib, "winhttp.lib")
+
+class WinHttpTransport : public HttpTransport {
+public:
+    WinHttpTransport();
+    ~WinHttpTransport();
+
+    bool Send(const TransportRequest& request, TransportResponse& response, const BodySink& sink);
+    ConnectionStats GetStats() const;
+
+private:
+    ConnectionPool* connectionPool_;
+
+    static std::wstring BuildHeaders(const TransportRequest& request, long long bodyLength, DWORD& declaredLength);
+    static bool WriteStreamedBody(HINTERNET hRequest, const TransportRequest& request);
+    static bool ReadHeaders(HINTERNET hRequest, TransportResponse& response);
+    static bool ReadBody(HINTERNET hRequest, const BodySink& sink, bool& aborted, TransportTimings& timings);
+    static void ReadPhaseTimes(HINTERNET hRequest, TransportTimings& timings);
+#ifdef WINHTTP_OPTION_REQUEST_TIMES
+    static long long PhaseMicros(const WINHTTP_REQUEST_TIMES& times, int startIndex, int endIndex);
+#endif
+    static long long MicrosBetween(const std::chrono::steady_clock::time_point& from,
+        const std::chrono::steady_clock::time_point& to);
+
+    WinHttpTransport(const WinHttpTransport&);
+    WinHttpTransport& operator=(const WinHttpTransport&);
+};
+
+#endif // _WIN32
+
+#endif
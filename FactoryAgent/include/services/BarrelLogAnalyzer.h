@@ -0,0 +1,91 @@
+#ifndef BARREL_LOG_ANALYZER_H
+#define BARREL_LOG_ANALYZER_H
+
+/*
+ * BarrelLogAnalyzer.h
+ * Barrel execution analysis of a sequence log, the agent-side counterpart of the
+ * dashboard's logParser.ts. Lines are tab separated: field 8 is the sequence
+ * name, field 9 START or END, field 10 a JSON object with barrelId, startTs, endTs
+ * and idealMs. LogTokenizer splits the lines and reads the data. The file is read
+ * once, in fixed-size chunks, and only per-barrel operation timelines are kept.
+ * The result names each sequence once and sends an operation as a bare array; the
+ * dashboard expands it back into AnalysisResult
+ */
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <istream>
+
+struct BarrelOperation {
+    int nameIndex;              // into the analyzer's sequence names
+    int sequence;               // order of first appearance within the barrel, from 1
+    double startTime;
+    double endTime;
+    double idealDuration;
+    double actualDuration;
+    bool hasStart;
+    bool hasEnd;
+    bool hasActual;             // an END arrived after a START
+
+    BarrelOperation() {
+        nameIndex = 0;
+        sequence = 0;
+        startTime = 0;
+        endTime = 0;
+        idealDuration = 0;
+        actualDuration = 0;
+        hasStart = false;
+        hasEnd = false;
+        hasActual = false;
+    }
+};
+
+struct BarrelTimeline {
+    std::string barrelId;       // as the dashboard prints it
+    std::vector<BarrelOperation> operations;
+};
+
+class BarrelLogAnalyzer {
+public:
+    BarrelLogAnalyzer();
+    ~BarrelLogAnalyzer();
+
+    // Any split of the log into pieces gives the same result
+    void Feed(const char* data, size_t length);
+    // Reads the stream to its end; false on a read error
+    bool FeedStream(std::istream& stream);
+    // Processes a last line without a newline
+    void Finish();
+
+    // {"sequences":[name,...],"barrels":[{"barrelId","totalExecutionTime","operations":[[nameIndex,
+    // sequence,globalStartTime,globalEndTime,actualDuration,idealDuration],...]}],"summary":{...}}.
+    // Barrels, operations and summary follow logParser.ts. Written as text: a log of nothing but
+    // events gives a result a fifth its size
+    void BuildResult(std::string& text) const;
+
+    long long GetLineCount() const;
+    long long GetEventCount() const;
+
+private:
+    std::vector<BarrelTimeline> barrels_;
+    std::unordered_map<std::string, int> barrelIndex_;          // type-tagged barrelId -> barrels_
+    std::vector<std::string> sequenceNames_;
+    std::unordered_map<std::string, int> sequenceIndex_;
+    std::string lastBarrelKey_;     // consecutive lines are mostly about the same barrel
+    int lastBarrel_;
+    std::string pending_;       // a line cut by the end of the previous piece
+    std::string key_;           // reused for name lookups
+    bool skipping_;             // inside a line longer than LOG_ANALYSIS_MAX_LINE_BYTES
+    long long lines_;
+    long long events_;
+
+    void ParseLine(const char* begin, const char* end);
+    void ParseFields(const char* const* fields, int fieldCount, const char* end);
+    BarrelOperation& FindOperation(int barrel, const char* name, size_t nameLength);
+
+    BarrelLogAnalyzer(const BarrelLogAnalyzer&);
+    BarrelLogAnalyzer& operator=(const BarrelLogAnalyzer&);
+};
+
+#endif
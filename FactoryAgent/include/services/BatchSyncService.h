@@ -0,0 +1,45 @@
+#ifndef BATCH_SYNC_SERVICE_H
+#define BATCH_SYNC_SERVICE_H
+
+/*
+ * BatchSyncService.h
+ * Sends the changed config, log-tree and model sections in one round trip
+ * Falls back to the per-section endpoints on servers without /syncbatch
+ */
+
+#include "../common/Types.h"
+#include "../../third_party/json/json.hpp"
+
+using json = nlohmann::json;
+
+class HttpClient;
+class ConfigService;
+class LogService;
+class ModelService;
+
+class BatchSyncService {
+public:
+    BatchSyncService(AgentSettings* settings, HttpClient* client, ConfigService* configService,
+        LogService* logService, ModelService* modelService);
+    ~BatchSyncService();
+
+    void SyncToServer();
+
+private:
+    AgentSettings* settings_;
+    HttpClient* httpClient_;
+    ConfigService* configService_;
+    LogService* logService_;
+    ModelService* modelService_;
+
+    bool batchSupported_;
+    int cyclesSinceProbe_;
+
+    bool SendBatch(json& request);
+    void SyncIndividually();
+
+    BatchSyncService(const BatchSyncService&);
+    BatchSyncService& operator=(const BatchSyncService&);
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef COMMAND_CHANNEL_H
+#define COMMAND_CHANNEL_H
+
+/*
+ * CommandChannel.h
+ * Keeps a streamed request open to the server's command channel so commands
+ * arrive the moment they are queued instead of with the next heartbeat.
+ * The server writes one {"commands":[...]} line per batch and a bare newline
+ * as keep-alive. While the channel is down the heartbeat delivers commands
+ */
+
+#include "../network/HttpClient.h"
+#include "../../third_party/json/json.hpp"
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+using json = nlohmann::json;
+
+class CommandChannel {
+public:
+    typedef std::function<void(const json& commands)> CommandHandler;
+
+    // handler runs on the channel thread and should only queue the commands
+    CommandChannel(HttpClient* client, const CommandHandler& handler);
+    ~CommandChannel();
+
+    // Restarts the channel when it is already running for another pcId
+    void Start(int pcId);
+    void Stop();
+    // True while the server is holding the channel open; the heartbeat then leaves commands to it
+    bool IsConnected() const;
+
+private:
+    HttpClient* httpClient_;
+    CommandHandler handler_;
+    int pcId_;
+    std::thread thread_;
+    std::atomic<bool> stopRequested_;
+    std::atomic<bool> connected_;
+    std::mutex waitMutex_;
+    std::condition_variable wake_;
+    TransportCancel cancel_;    // ends the open channel when Stop is called
+
+    void Run();
+    // One channel from open to close; statusCode is 0 when the server was not reached
+    bool Listen(int& statusCode);
+    void Dispatch(const std::string& line);
+    void WaitUnlessStopped(int milliseconds);
+
+    CommandChannel(const CommandChannel&);
+    CommandChannel& operator=(const CommandChannel&);
+};
+
+#endif
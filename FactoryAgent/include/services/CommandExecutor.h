@@ -8,6 +8,10 @@
  */
 
 #include "../common/Types.h"
+#include <windows.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 #include "../../third_party/json/json.hpp"
 
 using json = nlohmann::json;
@@ -15,21 +19,46 @@ using json = nlohmann::json;
 class HttpClient;
 class ConfigService;
 class ModelService;
+class OutboxService;
+class LogContentBody;
 
 class CommandExecutor {
 public:
-    CommandExecutor(HttpClient* client, ConfigService* configSvc, ModelService* modelSvc);
+    // Results go through outbox, so a result produced while the server is unreachable is not lost
+    CommandExecutor(HttpClient* client, ConfigService* configSvc, ModelService* modelSvc, OutboxService* outbox);
     ~CommandExecutor();
 
     void ProcessCommands(const json& commands);
 
+    // Runs commands on a dedicated thread so long transfers never hold up the heartbeat loop;
+    // completedEvent is signalled after each batch so the caller can sync right away
+    bool Start(HANDLE completedEvent);
+    // Cancels the transfer in progress through HttpClient and waits for the thread to end
+    void Stop();
+    void EnqueueCommands(const json& commands);
+
 private:
     HttpClient* httpClient_;
     ConfigService* configService_;
     ModelService* modelService_;
+    OutboxService* outbox_;
+
+    HANDLE commandThread_;
+    HANDLE completedEvent_;
+    std::deque<json> pendingBatches_;
+    std::mutex queueMutex_;
+    std::condition_variable queueWake_;
+    bool stopRequested_;
+
+    static DWORD WINAPI CommandThreadProc(LPVOID param);
+    void CommandLoop();
+    // Commands left in a batch when Stop is called are not started
+    bool IsStopRequested();
 
     bool ExecuteCommand(const json& command);
     void SendCommandResult(int commandId, const CommandResult& result);
+    // Too large for outbox: sent once, directly
+    bool SendStreamedResult(LogContentBody& body);
     std::string GetLogFolderPath(); // Helper for log analyzer
 
 
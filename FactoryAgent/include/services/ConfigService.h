@@ -9,11 +9,16 @@
 
 #include "../common/Types.h"
 #include "../monitoring/ConfigManager.h"
+#include <windows.h>
+#include <mutex>
+#include <vector>
+#include <cstdint>
 #include "../../third_party/json/json.hpp"
 
 using json = nlohmann::json;
 
 class HttpClient;
+class FileMonitor;
 
 class ConfigService {
 public:
@@ -21,13 +26,44 @@ public:
     ~ConfigService();
 
     void SyncConfigToServer();
+    // Batched sync: fills section only when the config changed since the last ack. The section
+    // is a line delta against the server's copy when possible, the full content otherwise
+    bool CollectSyncSection(json& section);
+    void AcknowledgeSyncSection(const json& section);
+    // The server's copy no longer matches our base; the next section carries the full content
+    void ResetSyncBase();
+    // Set from the features the server announced at registration
+    void SetDeltaSyncEnabled(bool enabled);
+
+    // Signals changedEvent within a second of the config file changing on disk
+    bool StartWatching(HANDLE changedEvent);
+    void StopWatching();
+
     bool ApplyConfigFromServer(const std::string& content);
+    // needFull is set when the local file is not the base the delta was made against
+    bool ApplyConfigDeltaFromServer(const json& delta, bool& needFull);
 
 private:
     AgentSettings* settings_;
     HttpClient* httpClient_;
     ConfigManager* configManager_;
-    std::string lastConfigContent_;
+    bool deltaEnabled_;
+
+    // The server's copy, by SHA-256 and per-line hash; the content itself is not kept
+    std::string lastConfigHash_;
+    std::vector<uint64_t> lastLineHashes_;
+    // What the section in flight would make the server's copy once acknowledged
+    std::string pendingConfigHash_;
+    std::vector<uint64_t> pendingLineHashes_;
+    std::mutex configMutex_;    // sync runs on the worker thread, apply on the command thread
+
+    FileMonitor* configMonitor_;
+    HANDLE changedEvent_;
+
+    static void OnConfigFileChanged(const std::string& content, void* userData);
+
+    bool PostDelta(const json& section, bool& needFull);
+    void SetBase(const std::string& content);
 
     ConfigService(const ConfigService&);
     ConfigService& operator=(const ConfigService&);
@@ -3,20 +3,86 @@
 
 #include "../common/Types.h"
 #include "../network/HttpClient.h"
+#include "../utilities/JsonStreamParser.h"
 #include "../../third_party/json/json.hpp"
+#include <chrono>
+#include <future>
+#include <memory>
+#include <functional>
 
 using json = nlohmann::json;
 
+// Typed SAX reader for the heartbeat reply. Only the commands array is materialised;
+// success and hasPendingCommands are read straight off the stream and anything else is skipped
+class HeartbeatResponseReader : public json::json_sax_t {
+public:
+    HeartbeatResponseReader();
+
+    bool IsSuccess() const;
+    bool HasPendingCommands() const;
+    json& GetCommands();
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t& s) override;
+    bool string(string_t& val) override;
+    bool binary(binary_t& val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t& val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string& last_token,
+        const nlohmann::detail::exception& ex) override;
+
+private:
+    enum Field {
+        FIELD_OTHER,
+        FIELD_SUCCESS,
+        FIELD_HAS_PENDING,
+        FIELD_COMMANDS
+    };
+
+    bool success_;
+    bool hasPendingCommands_;
+    json commands_;
+    JsonDomBuilder commandsBuilder_;
+    int depth_;             // nesting outside the commands subtree
+    int commandsDepth_;     // > 0 while events are forwarded to commandsBuilder_
+    Field field_;
+
+    bool BeginContainer(bool isArray, std::size_t elements);
+    bool EndContainer(bool isArray);
+
+    HeartbeatResponseReader(const HeartbeatResponseReader&);
+    HeartbeatResponseReader& operator=(const HeartbeatResponseReader&);
+};
+
 class HeartbeatService {
 public:
-    HeartbeatService();
+    typedef std::function<void(const json& commands)> CommandHandler;
+
+    // lateCommands receives commands from a reply that arrived after its beat gave up waiting
+    explicit HeartbeatService(const CommandHandler& lateCommands);
     ~HeartbeatService();
 
+    // commands NULL tells the server a command channel is open and should deliver them instead
     bool SendHeartbeat(int pcId, bool isAppRunning, HttpClient* client, json* commands);
 
 private:
+    std::chrono::steady_clock::time_point lastMetricsReport_;
+    CommandHandler lateCommands_;
+    // A beat that outlived its wait. The server claims commands before it replies, so the
+    // reply is still collected rather than dropped
+    std::future<bool> late_;
+    std::shared_ptr<HeartbeatResponseReader> lateReader_;
+
+    // False while the late beat is still outstanding
+    bool CollectLate();
+
     json BuildHeartbeatRequest(int pcId, bool isAppRunning);
-    bool ParseHeartbeatResponse(const json& response, json* commands);
 
     HeartbeatService(const HeartbeatService&);
     HeartbeatService& operator=(const HeartbeatService&);
@@ -8,7 +8,7 @@ using json = nlohmann::json;
 
 namespace LogAnalyzer
 {
-    std::string HandleGetLogFileContent(const std::string& commandData);
+    bool AnalyzeLogFile(const std::string& filePath, std::string& resultJson, std::string& error);
     json BuildFileTree(const std::wstring& rootPath, const std::wstring& relativePath = L"");
     std::string WStringToString(const std::wstring& wstr);
     std::wstring StringToWString(const std::string& str);
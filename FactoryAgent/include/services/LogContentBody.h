@@ -0,0 +1,44 @@
+#ifndef LOG_CONTENT_BODY_H
+#define LOG_CONTENT_BODY_H
+
+/*
+ * LogContentBody.h
+ * The commandresult body of a GetLogFileContent command, produced a window at a
+ * time from the memory-mapped log. resultData carries {"content","encoding","size",
+ * "success"} as a string, so the log's bytes are escaped for two levels of string
+ * on the way out. The body is what serializing the whole result would give, at
+ * the cost of one window whatever the log's size
+ */
+
+#include "../utilities/MappedFile.h"
+#include "../utilities/JsonEscaper.h"
+#include <string>
+
+class LogContentBody {
+public:
+    LogContentBody();
+    ~LogContentBody();
+
+    // Maps the log and measures the body, one pass over the file
+    bool Open(const std::string& filePath, int commandId, std::string& error);
+    long long GetLength() const;
+
+    // For a BodySource: offset is where the previous window ended, or 0 to start over.
+    // Fails if the log changed under the view since it was measured
+    bool Read(long long offset, const char*& data, size_t& length);
+
+private:
+    MappedFile file_;
+    JsonEscaper escaper_;
+    std::string head_;          // the body up to the first content byte
+    std::string tail_;          // and after the last
+    std::string window_;        // escaped bytes of the current window
+    long long contentLength_;
+    long long position_;        // body offset the next Read starts at
+    long long fileOffset_;      // next file byte to escape
+
+    LogContentBody(const LogContentBody&);
+    LogContentBody& operator=(const LogContentBody&);
+};
+
+#endif
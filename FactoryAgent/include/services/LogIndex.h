@@ -0,0 +1,186 @@
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+/*
+ * LogIndex.h
+ * In-memory copy of the log folder tree, kept current without walking all of it.
+ * A folder is listed again only when its own write time moved (a file was added,
+ * removed or renamed in it); files written in the last hour are re-checked every
+ * cycle, since appending to a file does not touch its folder; and every folder is
+ * listed again once per LOG_INDEX_VERIFY_CYCLES as a backstop. Fed by a
+ * DirectoryWatcher, it lists only the folders the watcher named instead. The index
+ * is snapshotted to disk so a restart starts from it instead of from nothing.
+ * Every node has a 64-bit fingerprint; the root's is the tree's version, and Diff
+ * compares fingerprints against the tree the server holds to find what to send
+ */
+
+#include "../../third_party/json/json.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+
+using json = nlohmann::json;
+
+struct LogIndexFile {
+    std::string name;
+    unsigned long long size;
+    long long writeTime;        // file_time_type ticks
+    std::string modifiedDate;   // writeTime as StringUtils::FormatFileTime renders it
+
+    LogIndexFile() {
+        size = 0;
+        writeTime = 0;
+    }
+};
+
+struct LogIndexDirectory {
+    long long writeTime;
+    std::vector<LogIndexFile> files;            // sorted by name
+    std::vector<std::string> subdirectories;    // sorted
+    std::string serialized;                     // children array as JSON text; empty once anything below changed
+    unsigned long long fingerprint;             // valid while fingerprinted
+    bool fingerprinted;
+
+    LogIndexDirectory() {
+        writeTime = 0;
+        fingerprint = 0;
+        fingerprinted = false;
+    }
+
+    // Something in this folder or below it changed
+    void Invalidate() {
+        serialized.clear();
+        fingerprinted = false;
+    }
+};
+
+// One node of a folder as the server holds it: where its name is and a fingerprint, not the
+// node itself. 24 bytes and the name, against a hundred or more for the node's JSON
+struct LogTreeEntry {
+    unsigned int nameOffset;            // into LogTreeFolder::names
+    unsigned int nameLength;
+    bool isDirectory;
+    unsigned long long fingerprint;     // file: name, size and date; folder: its entries
+
+    LogTreeEntry() {
+        nameOffset = 0;
+        nameLength = 0;
+        isDirectory = false;
+        fingerprint = 0;
+    }
+};
+
+struct LogTreeFolder {
+    unsigned long long fingerprint;
+    std::string names;                  // every entry's name, back to back
+    std::vector<LogTreeEntry> entries;  // sorted by name
+
+    LogTreeFolder() {
+        fingerprint = 0;
+    }
+
+    std::string_view Name(const LogTreeEntry& entry) const {
+        return std::string_view(names).substr(entry.nameOffset, entry.nameLength);
+    }
+};
+
+// Every folder of the tree the server holds, by path relative to the root
+typedef std::map<std::string, LogTreeFolder> LogTreeBase;
+
+struct LogIndexStats {
+    int directories;
+    int files;
+    int directoriesListed;  // in the last Refresh
+    int filesChecked;       // hot files re-checked in the last Refresh
+
+    LogIndexStats() {
+        directories = 0;
+        files = 0;
+        directoriesListed = 0;
+        filesChecked = 0;
+    }
+};
+
+class LogIndex {
+public:
+    LogIndex(const std::string& snapshotPath);
+    ~LogIndex();
+
+    // Brings the index up to date with rootPath; true when anything changed
+    bool Refresh(const std::string& rootPath);
+    // Paths relative to the root, as a DirectoryWatcher reports them; safe from any thread.
+    // Once marked, Refresh trusts the marks and stops walking the tree until SetEventDriven(false)
+    void SetEventDriven(bool enabled);
+    void MarkChanged(const std::vector<std::string>& relativePaths, bool overflowed);
+
+    // The text LogService::BuildDirectoryTree(...).dump() gives for the same tree. Folders whose
+    // subtree did not change since the last call reuse their text, so one live log costs its path
+    const std::string& SerializeTree();
+    // Root fingerprint as hex. Depends only on names, sizes and dates, so the same tree has
+    // the same version across restarts
+    std::string GetVersion();
+    // The current tree as a base, for after a full snapshot is acknowledged
+    void DescribeTree(LogTreeBase& tree);
+    // Ops turning base into the current tree: {"op":"add"|"modify","node":{...}} with the node as
+    // SerializeTree writes it, or {"op":"remove","path":"..."}. Subtrees whose fingerprint matches
+    // are skipped whole. changed receives the current record of every folder that differs and
+    // removed the folders that are gone, which is what base needs once the ops are acknowledged
+    void Diff(const LogTreeBase& base, json& ops, LogTreeBase& changed, std::vector<std::string>& removed);
+    const LogIndexStats& GetStats() const;
+
+    // Writes the snapshot if the tree changed since the last one
+    void SaveSnapshot();
+
+private:
+    std::string snapshotPath_;
+    std::string rootPath_;
+    std::map<std::string, LogIndexDirectory> directories_;  // by path relative to the root, "" for the root
+    long long cycle_;
+    bool snapshotDirty_;
+    std::chrono::steady_clock::time_point lastSnapshot_;
+    LogIndexStats stats_;
+    bool walked_;               // a full walk has checked the snapshot against the disk
+
+    std::mutex markMutex_;
+    bool eventDriven_;
+    std::set<std::string> marked_;
+    bool relistAll_;            // the watcher lost events; every folder is listed again
+
+    // forceList lists the folder whatever its write time; walk descends into every subfolder
+    // rather than only into those new to the index
+    bool RefreshDirectory(const std::string& relativePath, long long hotSince, bool forceList, bool walk);
+    bool RefreshMarked(const std::set<std::string>& marked, long long hotSince);
+    void InvalidateAncestors(const std::string& relativePath);
+    // previous supplies formatted dates for files that did not change
+    bool ListDirectory(const std::filesystem::path& fullPath, const LogIndexDirectory& previous,
+        LogIndexDirectory& listed);
+    bool CheckHotFiles(const std::filesystem::path& fullPath, LogIndexDirectory& directory, long long hotSince);
+    bool CheckFiles(const std::filesystem::path& fullPath, LogIndexDirectory& directory,
+        const std::set<std::string>& names, bool& missing);
+    bool CheckFile(const std::filesystem::path& fullPath, LogIndexFile& file, bool& missing);
+    void RemoveSubtree(const std::string& relativePath);
+    const std::string& SerializeChildren(const std::string& relativePath);
+    std::string SerializeFile(const std::string& parentPath, const LogIndexFile& file);
+    std::string SerializeFolder(const std::string& relativePath, const std::string& name);
+    // A file or folder of the index, as SerializeChildren writes it
+    std::string SerializeNode(const std::string& parentPath, const std::string& name, bool isDirectory);
+    unsigned long long Fingerprint(const std::string& relativePath);
+    void DescribeFolder(const std::string& relativePath, LogTreeFolder& folder);
+    void DescribeSubtree(const std::string& relativePath, LogTreeBase& tree);
+    void DiffFolder(const std::string& relativePath, const LogTreeBase& base, json& ops,
+        LogTreeBase& changed, std::vector<std::string>& removed);
+    bool IsVerifyTurn(const std::string& relativePath) const;
+    std::filesystem::path FullPath(const std::string& relativePath) const;
+
+    void LoadSnapshot();
+
+    LogIndex(const LogIndex&);
+    LogIndex& operator=(const LogIndex&);
+};
+
+#endif
@@ -8,11 +8,14 @@
  */
 
 #include "../common/Types.h"
+#include "LogIndex.h"
+#include <windows.h>
 #include "../../third_party/json/json.hpp"
 
 using json = nlohmann::json;
 
 class HttpClient;
+class DirectoryWatcher;
 
 class LogService {
 public:
@@ -20,13 +23,40 @@ public:
     ~LogService();
 
     void SyncLogsToServer();
+    // The section is the whole tree, or add/remove/modify ops against the version the server
+    // last acknowledged when it supports log deltas; "version" is the ack token either way
+    bool CollectSyncSection(json& section);
+    void AcknowledgeSyncSection(const json& section);
+    // Registration stores a tree without a version, so this also drops the base
+    void SetDeltaSyncEnabled(bool enabled);
+    // The server does not hold our base; the next section is the whole tree
+    void ResetSyncBase();
+    // Feeds the index from change notifications instead of walking the folder each cycle.
+    // changedEvent is signalled when files appear, go or are renamed; a log that only grows
+    // is picked up by the regular cycle, so an active log does not resend the tree every second
+    bool StartWatching(HANDLE changedEvent);
+    void StopWatching();
+
     static std::string FormatTime(std::filesystem::file_time_type ftime);
     static nlohmann::json BuildDirectoryTree(const std::filesystem::path& currentPath, const std::filesystem::path& rootPath);
 
 private:
     AgentSettings* settings_;
     HttpClient* httpClient_;
-    std::string lastSyncedStructure_;
+    LogIndex* logIndex_;
+    DirectoryWatcher* logWatcher_;
+    bool deltaEnabled_;
+
+    // What the server holds: its version and, with deltas, a name and fingerprint per node
+    // rather than the JSON itself. The pending fields become it once the section is acked
+    std::string serverVersion_;
+    LogTreeBase serverTree_;
+    std::string pendingVersion_;
+    bool pendingFull_;
+    LogTreeBase pendingFolders_;
+    std::vector<std::string> pendingRemoved_;
+
+    bool PostDelta(const json& section, bool& needFull);
 
     LogService(const LogService&);
     LogService& operator=(const LogService&);
@@ -0,0 +1,44 @@
+#ifndef MODEL_CACHE_INDEX_H
+#define MODEL_CACHE_INDEX_H
+
+/*
+ * ModelCacheIndex.h
+ * Remembers, per model, the validators (ETag, Last-Modified, SHA-256) of the last
+ * download and a fingerprint of the folder it was extracted to. The validators are
+ * only handed out while the folder still matches, so a model edited or deleted on
+ * the PC is downloaded again instead of being reported as current
+ */
+
+#include "../network/HttpClient.h"
+#include "../../third_party/json/json.hpp"
+#include <string>
+#include <mutex>
+
+using json = nlohmann::json;
+
+class ModelCacheIndex {
+public:
+    ModelCacheIndex(const std::string& indexPath);
+    ~ModelCacheIndex();
+
+    // False when nothing is cached for the model or its folder changed since
+    bool Lookup(const std::string& modelName, const std::string& folderPath, DownloadValidators& validators);
+    void Record(const std::string& modelName, const std::string& folderPath, const DownloadValidators& validators);
+    void Forget(const std::string& modelName);
+
+    // Hash of the relative path, size and write time of every file under folderPath; empty if it is missing
+    static std::string FingerprintFolder(const std::string& folderPath);
+
+private:
+    std::string indexPath_;
+    json entries_;
+    std::mutex mutex_;
+
+    void Load();
+    void Save();
+
+    ModelCacheIndex(const ModelCacheIndex&);
+    ModelCacheIndex& operator=(const ModelCacheIndex&);
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef MODEL_CHUNK_UPLOADER_H
+#define MODEL_CHUNK_UPLOADER_H
+
+/*
+ * ModelChunkUploader.h
+ * Uploads a model folder to the library's chunk store: every file is split with
+ * content-defined chunking, the server is asked which chunk hashes it lacks, only
+ * those are sent, and a manifest of files and chunk lists lets it rebuild the model.
+ * A model that differs from one already in the library in a single weight file
+ * costs roughly that file, not the whole folder
+ */
+
+#include "../network/HttpClient.h"
+#include "../../third_party/json/json.hpp"
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct ChunkUploadStats {
+    int files;
+    int chunks;             // distinct chunks in the model
+    int chunksSent;
+    long long totalBytes;   // size of the model on disk
+    long long bytesSent;    // chunk data actually uploaded
+
+    ChunkUploadStats() {
+        files = 0;
+        chunks = 0;
+        chunksSent = 0;
+        totalBytes = 0;
+        bytesSent = 0;
+    }
+};
+
+class ModelChunkUploader {
+public:
+    ModelChunkUploader(HttpClient* client);
+    ~ModelChunkUploader();
+
+    // commitEndpoint receives the manifest and assembles the model once every chunk is stored
+    bool Upload(const std::string& folderPath, const std::string& modelName, const std::wstring& commitEndpoint);
+    const ChunkUploadStats& GetStats() const;
+
+private:
+    HttpClient* httpClient_;
+    ChunkUploadStats stats_;
+
+    // Manifest of every file under folderPath; unique holds one UploadChunk per distinct hash
+    bool BuildManifest(const std::string& folderPath, const std::string& modelName,
+        json& manifest, std::vector<UploadChunk>& unique);
+    bool QueryMissing(const std::vector<UploadChunk>& unique, std::vector<UploadChunk>& missing);
+    bool SendChunks(const std::vector<UploadChunk>& chunks);
+
+    ModelChunkUploader(const ModelChunkUploader&);
+    ModelChunkUploader& operator=(const ModelChunkUploader&);
+};
+
+#endif
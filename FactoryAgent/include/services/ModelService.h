@@ -10,11 +10,15 @@
 #include "../common/Types.h"
 #include "../monitoring/ConfigManager.h"
 #include "../../third_party/json/json.hpp"
+#include <windows.h>
 #include <vector>
+#include <chrono>
 
 using json = nlohmann::json;
 
 class HttpClient;
+class ModelCacheIndex;
+class DirectoryWatcher;
 
 class ModelService {
 public:
@@ -23,15 +27,34 @@ public:
 
     std::vector<ModelInfo> GetModelFolders();
     void SyncModelsToServer();
+    // Batched sync: the model list is only resent when it changed or the refresh interval passed
+    bool CollectSyncSection(json& section);
+    void AcknowledgeSyncSection(const json& section);
+    // Signals changedEvent within a second of a model folder appearing, going or changing
+    bool StartWatching(HANDLE changedEvent);
+    void StopWatching();
+
     bool ChangeModel(const std::string& modelName);
+    // Skips the transfer when the extracted folder is still the one the server distributes:
+    // a matching Sha256 costs no request, matching validators cost one bodiless 304
     bool UploadModelToServer(const json& data);
     bool DeleteModel(const std::string& modelName);
-    bool UploadModelToLibrary(const std::string& modelName, const std::string& uploadUrl);
+    // Uses the library's chunk store when the server offers chunkedUploadUrl, and a zip of the
+    // whole folder otherwise or when the chunked upload fails
+    bool UploadModelToLibrary(const std::string& modelName, const std::string& uploadUrl,
+        const std::string& chunkedUploadUrl = "");
 
 private:
     AgentSettings* settings_;
     HttpClient* httpClient_;
     ConfigManager* configManager_;
+    ModelCacheIndex* modelCache_;
+    DirectoryWatcher* modelWatcher_;
+    std::string lastSyncedModels_;
+    std::chrono::steady_clock::time_point lastModelsAck_;
+
+    json BuildModelArray();
+    void ApplyUploadedModel(const json& data, const std::string& modelName, const std::string& extractPath);
 
     ModelService(const ModelService&);
     ModelService& operator=(const ModelService&);
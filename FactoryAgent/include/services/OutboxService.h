@@ -0,0 +1,54 @@
+#ifndef OUTBOX_SERVICE_H
+#define OUTBOX_SERVICE_H
+
+/*
+ * OutboxService.h
+ * Delivers messages the server must not lose, command results above all,
+ * through an OutboxLog: a message is on disk before anything is sent, and
+ * leaves the log only once the server has answered it. Whatever an outage
+ * or a crash left behind is replayed oldest first, in bounded batches, the
+ * next time the server is reachable
+ */
+
+#include "../utilities/OutboxLog.h"
+#include "../../third_party/json/json.hpp"
+#include <string>
+#include <mutex>
+
+using json = nlohmann::json;
+
+class HttpClient;
+
+class OutboxService {
+public:
+    OutboxService(HttpClient* client);
+    ~OutboxService();
+
+    bool Open(const std::string& filePath);
+
+    // Durable once this returns true; a pending message with the same key is replaced
+    bool Enqueue(const std::wstring& endpoint, const json& body, const std::string& coalesceKey);
+
+    // Sends what is pending until the log is empty or the server stops answering.
+    // Returns false when messages are left for the next attempt
+    bool Flush();
+    size_t GetPendingCount() const;
+
+private:
+    HttpClient* httpClient_;
+    OutboxLog log_;
+    std::mutex flushMutex_;
+    bool batchEndpointMissing_;
+
+    // Number of entries, from the front of the batch, that the server accepted and the log
+    // recorded as delivered. unrecorded is set when the log could not write an ack
+    size_t DeliverResults(const std::vector<OutboxEntry>& entries, size_t start, bool& unrecorded);
+    bool DeliverOne(const OutboxEntry& entry, bool& unrecorded);
+
+    static bool IsDelivered(bool sent, int statusCode);
+
+    OutboxService(const OutboxService&);
+    OutboxService& operator=(const OutboxService&);
+};
+
+#endif
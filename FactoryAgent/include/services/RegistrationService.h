@@ -3,6 +3,8 @@
 
 #include "../common/Types.h"
 #include "../network/HttpClient.h"
+#include <set>
+#include <string>
 #include "../../third_party/json/json.hpp"
 
 using json = nlohmann::json;
@@ -13,8 +15,12 @@ public:
     ~RegistrationService();
 
     bool RegisterWithServer(AgentSettings* settings, HttpClient* client);
+    // Optional protocol features the server announced in its last registration response
+    bool ServerSupports(const std::string& feature) const;
 
 private:
+    std::set<std::string> serverFeatures_;
+
     json BuildRegistrationRequest(AgentSettings* settings);
     bool ParseRegistrationResponse(const json& response, int* pcId);
 
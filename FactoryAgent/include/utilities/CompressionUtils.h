@@ -0,0 +1,46 @@
+#ifndef COMPRESSION_UTILS_H
+#define COMPRESSION_UTILS_H
+
+/*
+ * CompressionUtils.h
+ * gzip encoding for HTTP bodies (zlib)
+ */
+
+#include <string>
+#include <vector>
+#include <functional>
+
+class CompressionUtils {
+public:
+    static bool GzipCompress(const std::string& input, std::string& output);
+    // Accepts both gzip and zlib-wrapped deflate streams
+    static bool GzipDecompress(const std::string& input, std::string& output);
+
+private:
+    CompressionUtils();
+};
+
+// Incremental gzip/zlib decoder for bodies that are consumed while they arrive
+class GzipStreamDecoder {
+public:
+    GzipStreamDecoder();
+    ~GzipStreamDecoder();
+
+    // Inflates input and hands each decoded block to sink; false on corrupt data or if sink refuses
+    bool Feed(const char* data, size_t length, const std::function<bool(const char*, size_t)>& sink);
+    // True once the end of the compressed stream has been seen
+    bool IsFinished() const;
+    long long GetDecodedBytes() const;
+
+private:
+    void* stream_;      // z_stream; kept opaque so callers don't need zlib.h
+    bool failed_;
+    bool finished_;
+    long long decodedBytes_;
+    std::vector<char> buffer_;
+
+    GzipStreamDecoder(const GzipStreamDecoder&);
+    GzipStreamDecoder& operator=(const GzipStreamDecoder&);
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef CONTENT_CHUNKER_H
+#define CONTENT_CHUNKER_H
+
+/*
+ * ContentChunker.h
+ * Content-defined chunking (FastCDC, gear rolling hash) with a SHA-256 per chunk.
+ * Boundaries depend only on the bytes around them, so an edit in one place
+ * changes the chunks at that place and leaves the rest of the file hashing the same
+ */
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+struct ContentChunk {
+    long long offset;
+    size_t length;
+    std::string hash;   // lowercase hex SHA-256
+
+    ContentChunk() {
+        offset = 0;
+        length = 0;
+    }
+};
+
+class ContentChunker {
+public:
+    // Chunks of the whole file, in order; an empty file has none
+    static bool ChunkFile(const std::string& filePath, std::vector<ContentChunk>& chunks);
+    // Length of the first chunk of data; length itself when no cut point falls earlier
+    static size_t FindBoundary(const unsigned char* data, size_t length);
+
+private:
+    ContentChunker();
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef DIRECTORY_SCANNER_H
+#define DIRECTORY_SCANNER_H
+
+/*
+ * DirectoryScanner.h
+ * Lists folders with the OS's bulk calls, which hand back name, type, size and
+ * write time together: FindFirstFileExW with FIND_FIRST_EX_LARGE_FETCH on Windows,
+ * getdents64 and statx elsewhere. A recursive scan walks subfolders on a small
+ * work-stealing pool and lays the tree out as one flat array, each folder's
+ * children side by side and sorted by name, so building JSON or an index from it
+ * is a linear pass with no further file system calls
+ */
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+struct ScanEntry {
+    std::string name;           // in the encoding std::filesystem::path::string() uses
+    bool isDirectory;
+    bool isLink;                // symbolic link or junction; a recursive scan does not descend into it
+    unsigned long long size;    // files only
+    long long writeTime;        // file_time_type ticks; files only outside Windows
+    int firstChild;             // folders: children are [firstChild, firstChild + childCount)
+    int childCount;
+
+    ScanEntry() {
+        isDirectory = false;
+        isLink = false;
+        size = 0;
+        writeTime = 0;
+        firstChild = 0;
+        childCount = 0;
+    }
+};
+
+struct ScanStats {
+    int folders;                // listed, the root included
+    int failedFolders;          // could not be listed; present in the result without children
+    int threads;
+
+    ScanStats() {
+        folders = 0;
+        failedFolders = 0;
+        threads = 0;
+    }
+};
+
+class DirectoryScanner {
+public:
+    DirectoryScanner();
+    ~DirectoryScanner();
+
+    // entries[0] is the root itself; without recursive only its own children follow it.
+    // False when the root cannot be listed
+    bool Scan(const std::string& rootPath, bool recursive, std::vector<ScanEntry>& entries);
+    const ScanStats& GetStats() const;
+
+    // One folder, on the calling thread; children sorted by name, firstChild and childCount unset
+    static bool ListFolder(const std::string& folderPath, std::vector<ScanEntry>& entries);
+    // Path of entry relative to the scanned root, built from the parents the walk went through
+    static std::string RelativePath(const std::string& parentPath, const ScanEntry& entry);
+
+private:
+    struct Job {
+        std::string path;
+        int block;
+    };
+
+    struct Block {
+        std::vector<ScanEntry> entries;     // a folder's children; a folder's firstChild names its block
+        bool listed;
+
+        Block() {
+            listed = false;
+        }
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    ScanStats stats_;
+
+    // Shared by the workers of one Scan
+    std::mutex blockMutex_;
+    std::deque<Block> blocks_;
+    WorkQueue* queues_;
+    int queueCount_;
+    std::atomic<int> outstanding_;      // jobs queued or running
+    std::atomic<int> queued_;
+    std::mutex idleMutex_;
+    std::condition_variable workAvailable_;
+
+    void Worker(int index);
+    bool NextJob(int index, Job& job);
+    void Push(int index, const Job& job);
+    void RunJob(int index, const Job& job);
+    void Layout(std::vector<ScanEntry>& entries);
+
+    DirectoryScanner(const DirectoryScanner&);
+    DirectoryScanner& operator=(const DirectoryScanner&);
+};
+
+#endif
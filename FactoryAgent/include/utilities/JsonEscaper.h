@@ -0,0 +1,46 @@
+#ifndef JSON_ESCAPER_H
+#define JSON_ESCAPER_H
+
+/*
+ * JsonEscaper.h
+ * Escapes bytes for the inside of a JSON string a piece at a time, so text of any
+ * size can be written into a body without being held whole. Depth 2 escapes for a
+ * string inside the text of another string, as when a result is JSON carried in a
+ * string member. Output matches nlohmann's dump with error_handler_t::replace:
+ * invalid UTF-8 becomes U+FFFD
+ */
+
+#include <string>
+#include <cstddef>
+
+class JsonEscaper {
+public:
+    explicit JsonEscaper(int depth);
+
+    // Appends the escaped form of data to out, or only counts it when out is NULL; returns
+    // the bytes produced. A UTF-8 sequence cut by the end of data is finished by the next call
+    size_t Escape(const char* data, size_t length, std::string* out);
+    // Ends the text: a sequence still incomplete becomes U+FFFD
+    size_t Finish(std::string* out);
+    // Forgets any partial sequence, to escape a new text from its start
+    void Reset();
+
+private:
+    int backslashes_;           // before an escape letter: 2^(depth-1)
+    int literalBackslashes_;    // before a literal quote or backslash: 2^depth - 1
+    char partial_[4];           // bytes of a sequence not yet complete
+    int partialLength_;
+    int remaining_;             // continuation bytes still expected
+    unsigned char low_;         // range of the next continuation byte
+    unsigned char high_;
+
+    size_t Put(const char* data, size_t length, std::string* out);
+    size_t PutEscape(char letter, std::string* out);
+    size_t PutReplacement(std::string* out);
+    size_t PutControl(unsigned char c, std::string* out);
+
+    JsonEscaper(const JsonEscaper&);
+    JsonEscaper& operator=(const JsonEscaper&);
+};
+
+#endif
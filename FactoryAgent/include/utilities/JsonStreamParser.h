@@ -0,0 +1,105 @@
+#ifndef JSON_STREAM_PARSER_H
+#define JSON_STREAM_PARSER_H
+
+/*
+ * JsonStreamParser.h
+ * Push-style JSON parser: bytes are fed as they arrive from the network and
+ * reported to an nlohmann SAX handler, so no complete copy of the body is needed
+ */
+
+#include <string>
+#include <vector>
+#include "../../third_party/json/json.hpp"
+
+using json = nlohmann::json;
+
+class JsonStreamParser {
+public:
+    explicit JsonStreamParser(json::json_sax_t* handler);
+    ~JsonStreamParser();
+
+    // Returns false on a syntax error or when the handler asks to stop
+    bool Feed(const char* data, size_t length);
+    // True when exactly one complete value was parsed (a trailing number is closed here)
+    bool Finish();
+
+private:
+    enum Expect {
+        EXPECT_VALUE,
+        EXPECT_VALUE_OR_END,    // right after '['
+        EXPECT_KEY,             // after ',' inside an object
+        EXPECT_KEY_OR_END,      // right after '{'
+        EXPECT_COLON,
+        EXPECT_COMMA_OR_END,
+        EXPECT_DONE
+    };
+
+    enum Lexeme {
+        LEXEME_NONE,
+        LEXEME_STRING,
+        LEXEME_NUMBER,
+        LEXEME_LITERAL
+    };
+
+    json::json_sax_t* handler_;
+    std::vector<char> containers_;  // '{' or '[' per open level
+    Expect expect_;
+    Lexeme lexeme_;
+    bool failed_;
+
+    // Partial token carried across Feed calls
+    std::string token_;
+    bool tokenIsKey_;
+    bool escaped_;
+    int unicodeDigits_;             // hex digits still expected after \u
+    unsigned int unicodeValue_;
+    unsigned int highSurrogate_;
+
+    size_t ScanString(const char* data, size_t pos, size_t length);
+    bool ApplyEscape(char c);
+    bool ApplyUnicodeDigit(char c);
+    void AppendCodePoint(unsigned int codePoint);
+    bool Structural(char c);
+    bool EndString();
+    bool EndNumber();
+    bool EndLiteral();
+    bool AfterValue();
+    bool ExpectsValue() const;
+    bool Fail();
+
+    JsonStreamParser(const JsonStreamParser&);
+    JsonStreamParser& operator=(const JsonStreamParser&);
+};
+
+// SAX handler that builds an ordinary json DOM; string values are moved, not copied
+class JsonDomBuilder : public json::json_sax_t {
+public:
+    explicit JsonDomBuilder(json& root);
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t& s) override;
+    bool string(string_t& val) override;
+    bool binary(binary_t& val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t& val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string& last_token,
+        const nlohmann::detail::exception& ex) override;
+
+private:
+    json& root_;
+    std::vector<json*> stack_;
+    std::string key_;
+
+    json* AddValue(json&& value);
+
+    JsonDomBuilder(const JsonDomBuilder&);
+    JsonDomBuilder& operator=(const JsonDomBuilder&);
+};
+
+#endif
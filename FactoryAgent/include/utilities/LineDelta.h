@@ -0,0 +1,38 @@
+#ifndef LINE_DELTA_H
+#define LINE_DELTA_H
+
+/*
+ * LineDelta.h
+ * Line-level edit scripts for text files that both sides already hold a base of.
+ * The sender only needs per-line hashes of the base; the receiver applies the ops
+ * to its own copy and checks the SHA-256 of the result. Format, shared with the server:
+ *   [{"copy": [start, count]}, {"insert": ["line\n", ...]}, ...]
+ * Lines keep their '\n' (and any '\r'), so concatenating them restores the exact bytes
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "../../third_party/json/json.hpp"
+
+using json = nlohmann::json;
+
+class LineDelta {
+public:
+    static void SplitLines(const std::string& content, std::vector<std::string>& lines);
+    // 64-bit FNV-1a per line; cheap enough to run on every sync cycle
+    static std::vector<uint64_t> HashLines(const std::string& content);
+
+    // Ops turning the base (known only by its line hashes) into content. A hash collision
+    // produces a wrong copy, which the receiver's SHA-256 check rejects
+    static json Diff(const std::vector<uint64_t>& baseLineHashes, const std::string& content);
+    // False on malformed ops or a copy outside the base
+    static bool Apply(const std::string& base, const json& ops, std::string& result);
+
+private:
+    static uint64_t HashLine(const char* data, size_t length);
+
+    LineDelta();
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef LOG_TOKENIZER_H
+#define LOG_TOKENIZER_H
+
+/*
+ * LogTokenizer.h
+ * Line and field splitting for tab-separated logs, and a reader that picks a few
+ * members out of a flat JSON object without building one. Newlines and tabs are
+ * found 32 or 16 bytes at a time with AVX2 or SSE2 when the CPU has them, a byte
+ * at a time otherwise
+ */
+
+#include <string>
+
+// A member value as it appears in the text; nothing is converted until asked for
+struct JsonToken {
+    enum Type { NONE, STRING, NUMBER, LITERAL, NESTED };
+
+    Type type;
+    const char* begin;          // a STRING's text is inside the quotes, escapes left in place
+    const char* end;
+    bool escaped;
+
+    JsonToken() {
+        type = NONE;
+        begin = NULL;
+        end = NULL;
+        escaped = false;
+    }
+};
+
+class LogTokenizer {
+public:
+    enum Level { LEVEL_SCALAR, LEVEL_SSE2, LEVEL_AVX2 };
+
+    // Splits the line starting at begin: the start of each field, the first at begin, goes
+    // into fields until maxFields of them are found. Returns the newline ending the line, or
+    // end when there is none. Field i runs to fields[i + 1] - 1, the last to the line's end
+    static const char* SplitLine(const char* begin, const char* end, const char** fields, int maxFields, int& fieldCount);
+
+    // The widest level this CPU runs, unless lowered by SetLevel
+    static Level GetLevel();
+    // Caps the level, to compare them or to rule one out; returns the level now in use
+    static Level SetLevel(Level level);
+
+    // Reads the object in [begin, end), checking its syntax as JSON.parse would, and sets
+    // values[i] to the value of member keys[i], the last one if repeated. Values of other
+    // members are only checked; nested ones only for balance. False when it is not an object
+    static bool ReadFlatObject(const char* begin, const char* end, const char* const* keys, int keyCount, JsonToken* values);
+
+    // A JSON number, exact for short decimals without going through from_chars
+    static bool ParseNumber(const char* begin, const char* end, double& value);
+
+private:
+    LogTokenizer();
+};
+
+#endif
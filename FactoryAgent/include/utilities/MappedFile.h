@@ -0,0 +1,55 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+/*
+ * MappedFile.h
+ * Read-only file access through a sliding memory-mapped window
+ */
+
+#include <string>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const std::string& filePath);
+    // For a file another process still has open for writing, such as today's log. Only
+    // the bytes there at open are mapped; the view keeps the writer from truncating below them
+    bool OpenShared(const std::wstring& filePath);
+    void Close();
+    bool IsOpen() const;
+    long long GetSize() const;
+
+    // Maps [offset, offset + length) and returns a pointer to its first byte.
+    // The pointer stays valid until the next MapWindow or Close.
+    const char* MapWindow(long long offset, size_t length);
+
+private:
+#ifdef _WIN32
+    HANDLE hFile_;
+    HANDLE hMapping_;
+    LPVOID view_;
+#else
+    int fd_;
+    void* view_;
+    size_t viewLength_;
+#endif
+    long long size_;
+    long long granularity_;
+
+    void UnmapView();
+#ifdef _WIN32
+    bool MapOpenedFile();
+#endif
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef OUTBOX_LOG_H
+#define OUTBOX_LOG_H
+
+/*
+ * OutboxLog.h
+ * Append-only file of outbound messages that survives a crash or power cut.
+ * Each record is [length][CRC-32][payload]: a put carries a sequence number,
+ * a coalescing key, the endpoint and the body; an ack names a delivered
+ * sequence. Opening the file replays it: a later put replaces a pending one
+ * with the same key, an ack removes one, and a torn or corrupt tail is cut
+ * off. Only the index lives in memory; bodies are read back when sent
+ */
+
+#include "RandomAccessFile.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+struct OutboxEntry {
+    long long sequence;
+    std::string key;
+    std::string endpoint;
+    long long bodyOffset;   // where the body sits in the file
+    size_t bodyLength;
+
+    OutboxEntry() {
+        sequence = 0;
+        bodyOffset = 0;
+        bodyLength = 0;
+    }
+};
+
+class OutboxLog {
+public:
+    OutboxLog();
+    ~OutboxLog();
+
+    bool Open(const std::string& filePath);
+    void Close();
+
+    // On disk before it returns; a pending entry with the same key is superseded
+    bool Append(const std::string& key, const std::string& endpoint, const std::string& body, long long& sequence);
+    // Acking a superseded or unknown sequence is a no-op
+    bool Acknowledge(long long sequence);
+
+    // Oldest pending entries first, at most maxEntries
+    std::vector<OutboxEntry> Peek(size_t maxEntries) const;
+    bool ReadBody(const OutboxEntry& entry, std::string& body) const;
+    size_t GetPendingCount() const;
+    long long GetFileSize() const;
+
+private:
+    std::string filePath_;
+    RandomAccessFile file_;
+    long long fileSize_;
+    long long deadBytes_;       // records that no longer describe a pending entry
+    long long nextSequence_;
+    std::map<long long, OutboxEntry> pending_;      // by sequence
+    std::map<std::string, long long> pendingByKey_;
+    std::map<long long, long long> recordBytes_;    // on-disk size of each pending put
+    mutable std::mutex mutex_;
+
+    bool Replay();
+    bool WriteRecord(const std::string& payload, long long& payloadOffset);
+    void ApplyPut(const OutboxEntry& entry, long long recordSize);
+    void ApplyAck(long long sequence);
+    bool CompactIfWorthwhile();
+
+    static std::string BuildPut(long long sequence, const std::string& key, const std::string& endpoint,
+        const std::string& body, size_t& bodyStart);
+
+    OutboxLog(const OutboxLog&);
+    OutboxLog& operator=(const OutboxLog&);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef RANDOM_ACCESS_FILE_H
+#define RANDOM_ACCESS_FILE_H
+
+/*
+ * RandomAccessFile.h
+ * Writable file with positioned writes that several threads can share
+ */
+
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+class RandomAccessFile {
+public:
+    RandomAccessFile();
+    ~RandomAccessFile();
+
+    // Opens or creates the file without truncating it
+    bool Open(const std::string& filePath);
+    void Close();
+    bool IsOpen() const;
+
+    bool Resize(long long size);
+    // Writes at an absolute offset without touching any shared file pointer
+    bool WriteAt(long long offset, const char* data, size_t length);
+    bool Flush();
+
+private:
+#ifdef _WIN32
+    HANDLE hFile_;
+#else
+    int fd_;
+#endif
+
+    RandomAccessFile(const RandomAccessFile&);
+    RandomAccessFile& operator=(const RandomAccessFile&);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+/*
+ * Sha256.h
+ * Incremental SHA-256 digest
+ */
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class Sha256 {
+public:
+    Sha256();
+
+    void Reset();
+    void Update(const void* data, size_t length);
+    // Returns the lowercase hex digest; the object must be Reset before reuse
+    std::string FinalHex();
+
+    static std::string HashString(const std::string& data);
+    // Hashes the first prefixLength bytes of a file, or all of it when prefixLength is negative
+    static bool HashFile(const std::string& filePath, std::string& hexDigest, long long prefixLength = -1);
+
+private:
+    uint32_t state_[8];
+    uint64_t totalLength_;
+    unsigned char buffer_[64];
+    size_t bufferLength_;
+
+    void Transform(const unsigned char* block);
+};
+
+#endif
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <vector>
+#include <filesystem>
 
 class StringUtils {
 public:
@@ -20,6 +21,8 @@ public:
     static bool EndsWith(const std::string& str, const std::string& suffix);
     static std::vector<std::string> Split(const std::string& str, char delimiter);
     static std::string Replace(const std::string& str, const std::string& from, const std::string& to);
+    // Local time as "yyyy-MM-dd HH:mm:ss", the form log file dates are sent to the server in
+    static std::string FormatFileTime(std::filesystem::file_time_type ftime);
 
 private:
     StringUtils();
@@ -0,0 +1,37 @@
+#ifndef WIRE_CODEC_H
+#define WIRE_CODEC_H
+
+/*
+ * WireCodec.h
+ * Body encodings for agent API payloads: JSON text, or CBOR / MessagePack
+ * once the server has accepted one at registration
+ */
+
+#include <string>
+#include "../../third_party/json/json.hpp"
+
+using json = nlohmann::json;
+
+enum WireEncoding {
+    WIRE_ENCODING_JSON = 0,
+    WIRE_ENCODING_CBOR = 1,
+    WIRE_ENCODING_MSGPACK = 2
+};
+
+class WireCodec {
+public:
+    static bool Encode(const json& value, WireEncoding encoding, std::string& output);
+    // Picks the decoder from the response Content-Type; anything unrecognised is parsed as JSON
+    static bool Decode(const std::string& input, const std::string& contentType, json& value);
+
+    static const char* ContentType(WireEncoding encoding);
+    static const char* Name(WireEncoding encoding);
+    static bool FromName(const std::string& name, WireEncoding& encoding);
+    // Encodings this agent can speak, most preferred first; sent at registration
+    static json SupportedNames();
+
+private:
+    WireCodec();
+};
+
+#endif
@@ -66,6 +66,8 @@ bool LoadSettings(AgentSettings& settings) {
             settings.modelVersion = config["modelVersion"];
         }
 
+        settings.bandwidthLimitKbps = config.value("bandwidthLimitKbps", 0);
+
         std::string serverUrlStr = config["serverUrl"];
         std::string exeNameStr = config["exeName"];
         settings.serverUrl = std::wstring(serverUrlStr.begin(), serverUrlStr.end());
@@ -95,6 +97,10 @@ void SaveSettings(const AgentSettings& settings) {
         config["modelVersion"] = settings.modelVersion;
     }
 
+    if (settings.bandwidthLimitKbps > 0) {
+        config["bandwidthLimitKbps"] = settings.bandwidthLimitKbps;
+    }
+
     std::string serverUrlStr(settings.serverUrl.begin(), settings.serverUrl.end());
     std::string exeNameStr(settings.exeName.begin(), settings.exeName.end());
     config["serverUrl"] = serverUrlStr;
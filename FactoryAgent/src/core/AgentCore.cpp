@@ -2,9 +2,13 @@
 #include "../include/services/RegistrationService.h"
 #include "../include/services/HeartbeatService.h"
 #include "../include/services/CommandExecutor.h"
+#include "../include/services/CommandChannel.h"
+#include "../include/services/OutboxService.h"
 #include "../include/services/ConfigService.h"
 #include "../include/services/LogService.h"
 #include "../include/services/ModelService.h"
+#include "../include/services/BatchSyncService.h"
+#include "../include/network/RetryPolicy.h"
 #include "../include/network/HttpClient.h"
 #include "../include/monitoring/ConfigManager.h"
 #include "../include/monitoring/ProcessMonitor.h"
@@ -18,12 +22,17 @@ AgentCore::AgentCore() {
     registrationService_ = NULL;
     heartbeatService_ = NULL;
     commandExecutor_ = NULL;
+    commandChannel_ = NULL;
+    outbox_ = NULL;
     configService_ = NULL;
     logService_ = NULL;
     modelService_ = NULL;
+    batchSyncService_ = NULL;
     configManager_ = NULL;
     processMonitor_ = NULL;
     workerThread_ = NULL;
+    commandsDoneEvent_ = NULL;
+    localChangesEvent_ = NULL;
     isRunning_ = false;
     stopRequested_ = false;
     connectionFailureCount_ = 0;
@@ -32,7 +41,10 @@ AgentCore::AgentCore() {
 AgentCore::~AgentCore() {
     Stop();
 
+    if (commandChannel_) delete commandChannel_;
     if (commandExecutor_) delete commandExecutor_;
+    if (outbox_) delete outbox_;
+    if (batchSyncService_) delete batchSyncService_;
     if (modelService_) delete modelService_;
     if (logService_) delete logService_;
     if (configService_) delete configService_;
@@ -41,20 +53,36 @@ AgentCore::~AgentCore() {
     if (processMonitor_) delete processMonitor_;
     if (configManager_) delete configManager_;
     if (httpClient_) delete httpClient_;
+    if (commandsDoneEvent_) CloseHandle(commandsDoneEvent_);
+    if (localChangesEvent_) CloseHandle(localChangesEvent_);
 }
 
 bool AgentCore::Initialize(const AgentSettings& settings) {
     settings_ = settings;
 
     httpClient_ = new HttpClient(settings.serverUrl);
+    httpClient_->SetBandwidthLimit(settings.bandwidthLimitKbps);
     registrationService_ = new RegistrationService();
-    heartbeatService_ = new HeartbeatService();
     configManager_ = new ConfigManager();
     processMonitor_ = new ProcessMonitor();
     configService_ = new ConfigService(&settings_, httpClient_, configManager_);
     logService_ = new LogService(&settings_, httpClient_);
     modelService_ = new ModelService(&settings_, httpClient_, configManager_);
-    commandExecutor_ = new CommandExecutor(httpClient_, configService_, modelService_);
+    batchSyncService_ = new BatchSyncService(&settings_, httpClient_, configService_, logService_, modelService_);
+    outbox_ = new OutboxService(httpClient_);
+    if (!outbox_->Open(AgentConstants::OUTBOX_FILE_NAME)) {
+        return false;
+    }
+    commandExecutor_ = new CommandExecutor(httpClient_, configService_, modelService_, outbox_);
+    CommandExecutor* executor = commandExecutor_;
+    heartbeatService_ = new HeartbeatService([executor](const json& commands) {
+        executor->EnqueueCommands(commands);
+    });
+    commandChannel_ = new CommandChannel(httpClient_, [executor](const json& commands) {
+        executor->EnqueueCommands(commands);
+    });
+    commandsDoneEvent_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+    localChangesEvent_ = CreateEvent(NULL, FALSE, FALSE, NULL);
 
     return true;
 }
@@ -66,6 +94,12 @@ void AgentCore::Start() {
 
     isRunning_ = true;
     stopRequested_ = false;
+    commandExecutor_->Start(commandsDoneEvent_);
+
+    // Local edits reach the server within about a second instead of at the next heartbeat
+    configService_->StartWatching(localChangesEvent_);
+    logService_->StartWatching(localChangesEvent_);
+    modelService_->StartWatching(localChangesEvent_);
     workerThread_ = CreateThread(NULL, 0, WorkerThreadProc, this, 0, NULL);
 }
 
@@ -75,6 +109,9 @@ void AgentCore::Stop() {
     }
 
     stopRequested_ = true;
+    if (commandsDoneEvent_) {
+        SetEvent(commandsDoneEvent_);
+    }
 
     if (workerThread_) {
         WaitForSingleObject(workerThread_, 5000);
@@ -82,6 +119,12 @@ void AgentCore::Stop() {
         workerThread_ = NULL;
     }
 
+    commandChannel_->Stop();
+    commandExecutor_->Stop();
+    configService_->StopWatching();
+    logService_->StopWatching();
+    modelService_->StopWatching();
+
     isRunning_ = false;
 }
 
@@ -106,63 +149,87 @@ DWORD WINAPI AgentCore::WorkerThreadProc(LPVOID param) {
 
 void AgentCore::WorkerLoop() {
     bool registered = false;
-    int registrationRetries = 0;
+    const ULONGLONG interval = (ULONGLONG)AgentConstants::HEARTBEAT_INTERVAL_SECONDS * 1000;
+    ULONGLONG nextHeartbeat = 0;
+
+    // Jittered backoff instead of a fixed schedule: after a server restart the fleet
+    // spreads its reconnects out rather than hitting it again in lockstep
+    RetryPolicy reconnectBackoff(AgentConstants::RECONNECT_BASE_DELAY_MS, AgentConstants::RECONNECT_MAX_DELAY_MS);
+    RetryPolicy heartbeatBackoff((int)interval, AgentConstants::HEARTBEAT_RETRY_MAX_DELAY_MS);
 
     while (!stopRequested_) {
         if (!registered) {
-            if (registrationRetries < AgentConstants::MAX_REGISTRATION_RETRIES) {
-                registered = registrationService_->RegisterWithServer(&settings_, httpClient_);
-                if (!registered) {
-                    registrationRetries++;
-                    connectionFailureCount_++;
-
-                    if (connectionFailureCount_ >= AgentConstants::MAX_CONNECTION_FAILURES) {
-                        int result = MessageBoxA(NULL,
-                            "Cannot connect to server. The agent has failed to connect multiple times.\n\n"
-                            "Click 'Retry' to try connecting again.\n"
-                            "Click 'Cancel' to exit the application.",
-                            "Server Connection Failed",
-                            MB_RETRYCANCEL | MB_ICONERROR | MB_TOPMOST | MB_SETFOREGROUND);
-
-                        if (result == IDCANCEL) {
-                            stopRequested_ = true;
-                            isRunning_ = false;
-                            PostQuitMessage(0);
-                            return;
-                        }
-                        else {
-                            connectionFailureCount_ = 0;
-                            registrationRetries = 0;
-                        }
+            registered = registrationService_->RegisterWithServer(&settings_, httpClient_);
+            if (!registered) {
+                connectionFailureCount_++;
+
+                if (connectionFailureCount_ >= AgentConstants::MAX_CONNECTION_FAILURES) {
+                    int result = MessageBoxA(NULL,
+                        "Cannot connect to server. The agent has failed to connect multiple times.\n\n"
+                        "Click 'Retry' to try connecting again.\n"
+                        "Click 'Cancel' to exit the application.",
+                        "Server Connection Failed",
+                        MB_RETRYCANCEL | MB_ICONERROR | MB_TOPMOST | MB_SETFOREGROUND);
+
+                    if (result == IDCANCEL) {
+                        stopRequested_ = true;
+                        isRunning_ = false;
+                        PostQuitMessage(0);
+                        return;
+                    }
+                    else {
+                        connectionFailureCount_ = 0;
+                        reconnectBackoff.Reset();
                     }
                 }
-                else {
-                    connectionFailureCount_ = 0;
-                }
+
+                SleepUnlessStopped(reconnectBackoff.NextDelayMs());
+                continue;
+            }
+
+            configService_->SetDeltaSyncEnabled(
+                registrationService_->ServerSupports(AgentConstants::FEATURE_CONFIG_DELTA));
+            logService_->SetDeltaSyncEnabled(
+                registrationService_->ServerSupports(AgentConstants::FEATURE_LOG_DELTA));
+
+            // Commands pushed the moment they are queued; the heartbeat covers any gap in the channel
+            if (registrationService_->ServerSupports(AgentConstants::FEATURE_COMMAND_CHANNEL)) {
+                commandChannel_->Start(settings_.pcId);
             }
             else {
-                for (int i = 0; i < AgentConstants::RETRY_DELAY_SECONDS && !stopRequested_; ++i) {
-                    Sleep(1000);
-                }
-                registrationRetries = 0;
+                commandChannel_->Stop();
             }
+
+            connectionFailureCount_ = 0;
+            reconnectBackoff.Reset();
+            heartbeatBackoff.Reset();
+            nextHeartbeat = 0;
         }
 
-        if (registered) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= nextHeartbeat) {
+            // Fixed-rate schedule: beats are due every interval from the previous due time,
+            // so the time spent syncing does not push the next heartbeat back
+            nextHeartbeat = (nextHeartbeat == 0 || now - nextHeartbeat >= interval) ?
+                now + interval : nextHeartbeat + interval;
+
             json commands;
             bool heartbeatSuccess = heartbeatService_->SendHeartbeat(
                 settings_.pcId, 
                 processMonitor_->IsProcessRunning(settings_.exeName),
                 httpClient_, 
-                &commands
+                commandChannel_->IsConnected() ? NULL : &commands
             );
 
             if (!heartbeatSuccess) {
                 connectionFailureCount_++;
 
+                // Retry later than the normal interval, by a random amount, so a recovering
+                // server is not met by every PC's heartbeat in the same second
+                nextHeartbeat = GetTickCount64() + (ULONGLONG)heartbeatBackoff.NextDelayMs();
+
                 if (connectionFailureCount_ >= AgentConstants::MAX_CONNECTION_FAILURES) {
                     registered = false;
-                    registrationRetries = 0;
 
                     int result = MessageBoxA(NULL,
                         "Lost connection to server. Heartbeat failed multiple times.\n\n"
@@ -184,27 +251,45 @@ void AgentCore::WorkerLoop() {
             }
             else {
                 connectionFailureCount_ = 0;
+                heartbeatBackoff.Reset();
 
                 if (!commands.empty()) {
-                    commandExecutor_->ProcessCommands(commands);
-                    
-                    // IMMEDIATE SYNC after command execution
-                    // Skip heartbeat delay - update database right away
-                    configService_->SyncConfigToServer();
-                    logService_->SyncLogsToServer();
-                    modelService_->SyncModelsToServer();
-                }
-                else {
-                    // Normal periodic sync (no commands)
-                    configService_->SyncConfigToServer();
-                    logService_->SyncLogsToServer();
-                    modelService_->SyncModelsToServer();
+                    // Commands run on the executor's thread; a multi-GB model transfer
+                    // would otherwise hold every heartbeat until it finished
+                    commandExecutor_->EnqueueCommands(commands);
                 }
+
+                // Results written while the server was out of reach
+                outbox_->Flush();
+
+                // Normal periodic sync
+                SyncToServer();
             }
         }
 
-        for (int i = 0; i < AgentConstants::HEARTBEAT_INTERVAL_SECONDS && !stopRequested_; ++i) {
-            Sleep(1000);
+        // Sleep until the next heartbeat is due, waking early when a command batch completes
+        // or a watched file changes
+        now = GetTickCount64();
+        DWORD waitMs = (nextHeartbeat > now) ? (DWORD)(nextHeartbeat - now) : 0;
+        HANDLE wakeEvents[2] = { commandsDoneEvent_, localChangesEvent_ };
+        DWORD woken = WaitForMultipleObjects(2, wakeEvents, FALSE, waitMs);
+        if (woken <= WAIT_OBJECT_0 + 1 && !stopRequested_ && registered) {
+            // IMMEDIATE SYNC after command execution
+            // Skip heartbeat delay - update database right away
+            SyncToServer();
         }
     }
+}
+
+void AgentCore::SleepUnlessStopped(int milliseconds) {
+    while (milliseconds > 0 && !stopRequested_) {
+        int step = (milliseconds < 250) ? milliseconds : 250;
+        Sleep(step);
+        milliseconds -= step;
+    }
+}
+
+void AgentCore::SyncToServer() {
+    // Changed config, log-tree and model sections go out together in one request
+    batchSyncService_->SyncToServer();
 }
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include "../include/monitoring/DirectoryWatcher.h"
+#include "../include/common/Constants.h"
+#include <filesystem>
+
+#ifndef _WIN32
+#include <sys/inotify.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+DirectoryWatcher::DirectoryWatcher() {
+    recursive_ = false;
+    stopRequested_ = false;
+    watchOpen_ = false;
+    pendingEntriesChanged_ = false;
+    pendingOverflow_ = false;
+#ifdef _WIN32
+    directory_ = INVALID_HANDLE_VALUE;
+    stopEvent_ = NULL;
+    ZeroMemory(&overlapped_, sizeof(overlapped_));
+    readPending_ = false;
+#else
+    inotifyFd_ = -1;
+    wakePipe_[0] = -1;
+    wakePipe_[1] = -1;
+#endif
+}
+
+DirectoryWatcher::~DirectoryWatcher() {
+    Stop();
+}
+
+bool DirectoryWatcher::Start(const std::string& folderPath, bool recursive, const ChangeHandler& handler) {
+    if (thread_.joinable()) {
+        return false;
+    }
+
+    folderPath_ = folderPath;
+    recursive_ = recursive;
+    handler_ = handler;
+    stopRequested_ = false;
+    pendingPaths_.clear();
+    pendingEntriesChanged_ = false;
+    pendingOverflow_ = false;
+
+#ifdef _WIN32
+    stopEvent_ = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (stopEvent_ == NULL) {
+        return false;
+    }
+#else
+    if (pipe(wakePipe_) != 0) {
+        return false;
+    }
+    fcntl(wakePipe_[0], F_SETFD, FD_CLOEXEC);
+    fcntl(wakePipe_[1], F_SETFD, FD_CLOEXEC);
+#endif
+
+    if (!OpenWatch()) {
+        Stop();
+        return false;
+    }
+
+    thread_ = std::thread(&DirectoryWatcher::Run, this);
+    return true;
+}
+
+void DirectoryWatcher::Stop() {
+    stopRequested_ = true;
+
+#ifdef _WIN32
+    if (stopEvent_) {
+        SetEvent(stopEvent_);
+    }
+#else
+    if (wakePipe_[1] >= 0) {
+        char wake = 1;
+        ssize_t written = write(wakePipe_[1], &wake, 1);
+        (void)written;
+    }
+#endif
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    CloseWatch();
+
+#ifdef _WIN32
+    if (stopEvent_) {
+        CloseHandle(stopEvent_);
+        stopEvent_ = NULL;
+    }
+#else
+    for (int i = 0; i < 2; i++) {
+        if (wakePipe_[i] >= 0) {
+            close(wakePipe_[i]);
+            wakePipe_[i] = -1;
+        }
+    }
+#endif
+}
+
+bool DirectoryWatcher::IsWatching() const {
+    return thread_.joinable() && !stopRequested_;
+}
+
+void DirectoryWatcher::Run() {
+    while (!stopRequested_) {
+        if (!watchOpen_) {
+            // Gone or unreadable: try again later, and have the receiver rescan once it is back
+            if (!OpenWatch()) {
+                // The receiver hears about the loss now, not once the folder is back
+                DispatchIfDue(true);
+                SleepUnlessStopped(AgentConstants::DIRECTORY_WATCH_RETRY_MS);
+                continue;
+            }
+            QueueOverflow();
+        }
+
+        if (!ReadEvents(MillisecondsUntilDue())) {
+            CloseWatch();
+            QueueOverflow();
+        }
+
+        if (!stopRequested_) {
+            DispatchIfDue(false);
+        }
+    }
+}
+
+void DirectoryWatcher::Queue(const std::string& relativePath, bool entryChanged) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (pendingPaths_.empty() && !pendingOverflow_) {
+        firstPending_ = now;
+    }
+    lastPending_ = now;
+    pendingEntriesChanged_ = pendingEntriesChanged_ || entryChanged;
+
+    // A flood is cheaper to answer with one rescan than with every path in it
+    if (pendingOverflow_ || pendingPaths_.size() >= AgentConstants::DIRECTORY_WATCH_MAX_PATHS) {
+        QueueOverflow();
+        return;
+    }
+    pendingPaths_.insert(relativePath);
+}
+
+void DirectoryWatcher::QueueOverflow() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (pendingPaths_.empty() && !pendingOverflow_) {
+        firstPending_ = now;
+    }
+    lastPending_ = now;
+    pendingOverflow_ = true;
+    pendingPaths_.clear();
+}
+
+int DirectoryWatcher::MillisecondsUntilDue() const {
+    if (pendingPaths_.empty() && !pendingOverflow_) {
+        return -1;
+    }
+
+    std::chrono::steady_clock::time_point due = lastPending_ +
+        std::chrono::milliseconds(AgentConstants::DIRECTORY_WATCH_DEBOUNCE_MS);
+    std::chrono::steady_clock::time_point latest = firstPending_ +
+        std::chrono::milliseconds(AgentConstants::DIRECTORY_WATCH_MAX_DELAY_MS);
+    if (latest < due) {
+        due = latest;
+    }
+
+    long long remaining = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        due - std::chrono::steady_clock::now()).count();
+    return remaining > 0 ? (int)remaining : 0;
+}
+
+void DirectoryWatcher::DispatchIfDue(bool force) {
+    if (pendingPaths_.empty() && !pendingOverflow_) {
+        return;
+    }
+    if (!force && MillisecondsUntilDue() > 0) {
+        return;
+    }
+
+    DirectoryChanges changes;
+    changes.paths.assign(pendingPaths_.begin(), pendingPaths_.end());
+    changes.entriesChanged = pendingEntriesChanged_;
+    changes.overflowed = pendingOverflow_;
+
+    pendingPaths_.clear();
+    pendingEntriesChanged_ = false;
+    pendingOverflow_ = false;
+
+    if (handler_) {
+        handler_(changes);
+    }
+}
+
+#ifdef _WIN32
+
+bool DirectoryWatcher::OpenWatch() {
+    directory_ = CreateFileA(folderPath_.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (directory_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    ZeroMemory(&overlapped_, sizeof(overlapped_));
+    overlapped_.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    buffer_.resize(AgentConstants::DIRECTORY_WATCH_BUFFER_BYTES / sizeof(DWORD));
+
+    watchOpen_ = true;
+    if (overlapped_.hEvent == NULL || !Arm()) {
+        CloseWatch();
+        return false;
+    }
+    return true;
+}
+
+bool DirectoryWatcher::Arm() {
+    HANDLE event = overlapped_.hEvent;
+    ZeroMemory(&overlapped_, sizeof(overlapped_));
+    overlapped_.hEvent = event;
+    ResetEvent(event);
+
+    DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+        FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
+    readPending_ = ReadDirectoryChangesW(directory_, &buffer_[0], (DWORD)(buffer_.size() * sizeof(DWORD)),
+        recursive_ ? TRUE : FALSE, filter, NULL, &overlapped_, NULL) != FALSE;
+    return readPending_;
+}
+
+void DirectoryWatcher::CloseWatch() {
+    if (directory_ != INVALID_HANDLE_VALUE) {
+        // The read has to be finished before its buffer can go
+        if (readPending_) {
+            DWORD bytes = 0;
+            CancelIoEx(directory_, &overlapped_);
+            GetOverlappedResult(directory_, &overlapped_, &bytes, TRUE);
+            readPending_ = false;
+        }
+        CloseHandle(directory_);
+        directory_ = INVALID_HANDLE_VALUE;
+    }
+    if (overlapped_.hEvent) {
+        CloseHandle(overlapped_.hEvent);
+        overlapped_.hEvent = NULL;
+    }
+    watchOpen_ = false;
+}
+
+bool DirectoryWatcher::ReadEvents(int timeoutMs) {
+    HANDLE handles[2] = { overlapped_.hEvent, stopEvent_ };
+    DWORD wait = WaitForMultipleObjects(2, handles, FALSE, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs);
+    if (wait != WAIT_OBJECT_0) {
+        return true;
+    }
+
+    DWORD bytes = 0;
+    BOOL completed = GetOverlappedResult(directory_, &overlapped_, &bytes, FALSE);
+    readPending_ = false;
+    if (!completed) {
+        // More changes than the buffer holds; the folder itself is still watched
+        if (GetLastError() == ERROR_NOTIFY_ENUM_DIR) {
+            QueueOverflow();
+            return Arm();
+        }
+        return false;
+    }
+
+    // Zero bytes is the same overflow, reported the other way
+    if (bytes == 0) {
+        QueueOverflow();
+        return Arm();
+    }
+
+    char* cursor = (char*)&buffer_[0];
+    while (true) {
+        FILE_NOTIFY_INFORMATION* info = (FILE_NOTIFY_INFORMATION*)cursor;
+        int wideLength = (int)(info->FileNameLength / sizeof(WCHAR));
+
+        // Paths in the code page the rest of the agent opens files with
+        int length = WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, NULL, 0, NULL, NULL);
+        std::string path(length, '\0');
+        if (length > 0) {
+            WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, &path[0], length, NULL, NULL);
+        }
+        Queue(path, info->Action != FILE_ACTION_MODIFIED);
+
+        if (info->NextEntryOffset == 0) {
+            break;
+        }
+        cursor += info->NextEntryOffset;
+    }
+
+    // The OS keeps collecting between completions, so nothing is missed while this ran
+    return Arm();
+}
+
+void DirectoryWatcher::SleepUnlessStopped(int milliseconds) {
+    WaitForSingleObject(stopEvent_, (DWORD)milliseconds);
+}
+
+#else
+
+namespace {
+    const unsigned int WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO |
+        IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+}
+
+bool DirectoryWatcher::OpenWatch() {
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        return false;
+    }
+
+    watchOpen_ = true;
+    if (!AddWatches("")) {
+        CloseWatch();
+        return false;
+    }
+    return true;
+}
+
+bool DirectoryWatcher::AddWatches(const std::string& relativePath) {
+    // inotify watches one folder per descriptor, so a recursive watch is one per folder in the tree
+    fs::path fullPath = relativePath.empty() ? fs::path(folderPath_) : fs::path(folderPath_) / relativePath;
+    int wd = inotify_add_watch(inotifyFd_, fullPath.c_str(), WATCH_MASK);
+    if (wd < 0) {
+        return !relativePath.empty();
+    }
+
+    // A folder moved inside the tree keeps its descriptor; this re-points it at the new path
+    watches_[wd] = relativePath;
+
+    if (recursive_) {
+        std::error_code error;
+        for (fs::directory_iterator it(fullPath, error), end; !error && it != end; it.increment(error)) {
+            std::error_code entryError;
+            if (it->is_directory(entryError) && !it->is_symlink(entryError)) {
+                AddWatches((fs::path(relativePath) / it->path().filename()).string());
+            }
+        }
+    }
+    return true;
+}
+
+void DirectoryWatcher::CloseWatch() {
+    if (inotifyFd_ >= 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+    watches_.clear();
+    watchOpen_ = false;
+}
+
+bool DirectoryWatcher::ReadEvents(int timeoutMs) {
+    struct pollfd fds[2];
+    fds[0].fd = inotifyFd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakePipe_[0];
+    fds[1].events = POLLIN;
+
+    if (poll(fds, 2, timeoutMs) <= 0 || !(fds[0].revents & POLLIN)) {
+        return true;
+    }
+
+    std::vector<char> buffer(AgentConstants::DIRECTORY_WATCH_BUFFER_BYTES);
+    while (true) {
+        ssize_t length = read(inotifyFd_, &buffer[0], buffer.size());
+        if (length <= 0) {
+            return true;
+        }
+
+        for (ssize_t offset = 0; offset < length; ) {
+            const struct inotify_event* event = (const struct inotify_event*)&buffer[offset];
+            offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                QueueOverflow();
+                continue;
+            }
+
+            std::map<int, std::string>::iterator watch = watches_.find(event->wd);
+            if (watch == watches_.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watches_.erase(watch);
+                continue;
+            }
+
+            // The parent reports a subfolder leaving; only the root going away ends the watch
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                if (watch->second.empty()) {
+                    return false;
+                }
+                continue;
+            }
+
+            std::string path = event->len > 0 ? (fs::path(watch->second) / event->name).string() : watch->second;
+            if (recursive_ && (event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                // Files created in it before this watch existed are found by whoever lists the new folder
+                AddWatches(path);
+            }
+
+            Queue(path, (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) != 0);
+        }
+    }
+}
+
+void DirectoryWatcher::SleepUnlessStopped(int milliseconds) {
+    struct pollfd fds[1];
+    fds[0].fd = wakePipe_[0];
+    fds[0].events = POLLIN;
+    poll(fds, 1, milliseconds);
+}
+
+#endif
@@ -1,9 +1,12 @@
 #include "../include/monitoring/FileMonitor.h"
 #include "../include/utilities/FileUtils.h"
-#include "../include/common/Constants.h"
+#include "../include/utilities/StringUtils.h"
+#include "../include/utilities/Sha256.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
 
 FileMonitor::FileMonitor() {
-    monitorThread_ = NULL;
     isMonitoring_ = false;
     callback_ = NULL;
     userData_ = NULL;
@@ -21,22 +24,25 @@ bool FileMonitor::StartMonitoring(const std::string& filePath, FileChangeCallbac
     filePath_ = filePath;
     callback_ = callback;
     userData_ = userData;
-    isMonitoring_ = true;
 
-    GetFileHash(filePath_, lastHash_);
+    fs::path path(filePath_);
+    fileName_ = StringUtils::ToLower(path.filename().string());
+
+    std::string content;
+    lastHash_ = FileUtils::ReadFileContent(filePath_, content) ? Sha256::HashString(content) : "";
 
-    monitorThread_ = CreateThread(NULL, 0, MonitorThreadFunc, this, 0, NULL);
-    return (monitorThread_ != NULL);
+    // The folder, not the file: editors that save by writing a new file and renaming it
+    // over the old one replace the file, and a watch on it would go with it
+    isMonitoring_ = watcher_.Start(path.parent_path().string(), false, [this](const DirectoryChanges& changes) {
+        OnChanges(changes);
+    });
+    return isMonitoring_;
 }
 
 void FileMonitor::StopMonitoring() {
     if (isMonitoring_) {
         isMonitoring_ = false;
-        if (monitorThread_) {
-            WaitForSingleObject(monitorThread_, 5000);
-            CloseHandle(monitorThread_);
-            monitorThread_ = NULL;
-        }
+        watcher_.Stop();
     }
 }
 
@@ -44,54 +50,28 @@ bool FileMonitor::IsMonitoring() const {
     return isMonitoring_;
 }
 
-DWORD WINAPI FileMonitor::MonitorThreadFunc(LPVOID param) {
-    FileMonitor* monitor = (FileMonitor*)param;
-    monitor->MonitorLoop();
-    return 0;
-}
-
-void FileMonitor::MonitorLoop() {
-    while (isMonitoring_) {
-        std::string currentHash;
-        if (GetFileHash(filePath_, currentHash)) {
-            if (currentHash != lastHash_) {
-                lastHash_ = currentHash;
-                if (callback_ != NULL) {
-                    std::string content;
-                    if (FileUtils::ReadFileContent(filePath_, content)) {
-                        callback_(content, userData_);
-                    }
-                }
-            }
-        }
-
-        Sleep(AgentConstants::FILE_MONITOR_INTERVAL_MS);
+void FileMonitor::OnChanges(const DirectoryChanges& changes) {
+    bool touched = changes.overflowed;
+    for (size_t i = 0; i < changes.paths.size() && !touched; i++) {
+        touched = StringUtils::ToLower(changes.paths[i]) == fileName_;
     }
-}
 
-bool FileMonitor::GetFileHash(const std::string& filePath, std::string& hash) {
-    HANDLE hFile = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ,
-        NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
-    if (hFile == INVALID_HANDLE_VALUE) {
-        return false;
+    if (touched) {
+        CheckFile();
     }
+}
 
-    LARGE_INTEGER fileSize;
-    if (!GetFileSizeEx(hFile, &fileSize)) {
-        CloseHandle(hFile);
-        return false;
+void FileMonitor::CheckFile() {
+    std::string content;
+    if (!FileUtils::ReadFileContent(filePath_, content)) {
+        return;
     }
 
-    char buffer[32];
-    sprintf_s(buffer, sizeof(buffer), "%lld", fileSize.QuadPart);
-    hash = buffer;
-
-    FILETIME ftModified;
-    if (GetFileTime(hFile, NULL, NULL, &ftModified)) {
-        sprintf_s(buffer, sizeof(buffer), "_%u", ftModified.dwLowDateTime);
-        hash += buffer;
+    std::string currentHash = Sha256::HashString(content);
+    if (currentHash != lastHash_) {
+        lastHash_ = currentHash;
+        if (callback_ != NULL) {
+            callback_(content, userData_);
+        }
     }
-
-    CloseHandle(hFile);
-    return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,70 @@
+#include "../include/network/BandwidthLimiter.h"
+#include "../include/common/Constants.h"
+
+BandwidthLimiter::BandwidthLimiter()
+    : limitKbps_(0), bytesPerSecond_(0), burstBytes_(0), tokens_(0) {
+    lastRefill_ = std::chrono::steady_clock::now();
+}
+
+BandwidthLimiter::~BandwidthLimiter() {
+}
+
+void BandwidthLimiter::SetLimitKbps(int kbps) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        limitKbps_ = kbps > 0 ? kbps : 0;
+        bytesPerSecond_ = (double)limitKbps_ * 1000.0 / 8.0;
+
+        // The bucket holds a quarter second of traffic, but never less than one socket-sized write
+        burstBytes_ = bytesPerSecond_ * AgentConstants::BANDWIDTH_BURST_MS / 1000.0;
+        if (burstBytes_ < AgentConstants::BANDWIDTH_MIN_BURST_BYTES) {
+            burstBytes_ = AgentConstants::BANDWIDTH_MIN_BURST_BYTES;
+        }
+
+        lastRefill_ = std::chrono::steady_clock::now();
+        if (tokens_ > burstBytes_) {
+            tokens_ = burstBytes_;
+        }
+    }
+    changed_.notify_all();
+}
+
+int BandwidthLimiter::GetLimitKbps() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limitKbps_;
+}
+
+size_t BandwidthLimiter::GetWindowBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limitKbps_ > 0 ? (size_t)burstBytes_ : 0;
+}
+
+void BandwidthLimiter::Refill(const std::chrono::steady_clock::time_point& now) {
+    double elapsed = std::chrono::duration<double>(now - lastRefill_).count();
+    lastRefill_ = now;
+
+    tokens_ += elapsed * bytesPerSecond_;
+    if (tokens_ > burstBytes_) {
+        tokens_ = burstBytes_;
+    }
+}
+
+void BandwidthLimiter::Acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (bytesPerSecond_ > 0) {
+        Refill(std::chrono::steady_clock::now());
+
+        // A write larger than the bucket waits for a full bucket and leaves it in debt,
+        // which the following writes pay back
+        double needed = (double)bytes < burstBytes_ ? (double)bytes : burstBytes_;
+        if (tokens_ >= needed) {
+            tokens_ -= (double)bytes;
+            return;
+        }
+
+        long long waitMicros = (long long)((needed - tokens_) / bytesPerSecond_ * 1000000.0) + 1;
+        changed_.wait_for(lock, std::chrono::microseconds(waitMicros));
+    }
+}
@@ -0,0 +1,75 @@
+#include "../include/network/CircuitBreaker.h"
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, int openBaseMs, int openMaxMs)
+    : failureThreshold_(failureThreshold), openBaseMs_(openBaseMs), openMaxMs_(openMaxMs) {
+}
+
+CircuitBreaker::~CircuitBreaker() {
+}
+
+CircuitBreaker::Circuit& CircuitBreaker::GetCircuit(const std::wstring& key) {
+    std::map<std::wstring, Circuit>::iterator it = circuits_.find(key);
+    if (it == circuits_.end()) {
+        it = circuits_.insert(std::make_pair(key, Circuit(openBaseMs_, openMaxMs_))).first;
+    }
+    return it->second;
+}
+
+bool CircuitBreaker::AllowRequest(const std::wstring& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Circuit& circuit = GetCircuit(key);
+
+    if (circuit.state == CIRCUIT_CLOSED) {
+        return true;
+    }
+
+    if (circuit.state == CIRCUIT_OPEN) {
+        if (std::chrono::steady_clock::now() < circuit.openUntil) {
+            return false;
+        }
+        circuit.state = CIRCUIT_HALF_OPEN;
+        circuit.probeInFlight = false;
+    }
+
+    // Half-open: one probe at a time, everyone else keeps failing fast
+    if (circuit.probeInFlight) {
+        return false;
+    }
+    circuit.probeInFlight = true;
+    return true;
+}
+
+void CircuitBreaker::RecordSuccess(const std::wstring& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Circuit& circuit = GetCircuit(key);
+
+    circuit.state = CIRCUIT_CLOSED;
+    circuit.consecutiveFailures = 0;
+    circuit.probeInFlight = false;
+    circuit.openBackoff.Reset();
+}
+
+void CircuitBreaker::RecordFailure(const std::wstring& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Circuit& circuit = GetCircuit(key);
+
+    circuit.consecutiveFailures++;
+    // A request admitted before the circuit opened does not extend the open interval
+    if (circuit.state == CIRCUIT_OPEN) {
+        return;
+    }
+    if (circuit.state == CIRCUIT_HALF_OPEN || circuit.consecutiveFailures >= failureThreshold_) {
+        // Each re-open waits longer (with jitter) until a probe gets through
+        circuit.state = CIRCUIT_OPEN;
+        circuit.probeInFlight = false;
+        circuit.openUntil = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(circuit.openBackoff.NextDelayMs());
+    }
+}
+
+CircuitState CircuitBreaker::GetState(const std::wstring& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::map<std::wstring, Circuit>::const_iterator it = circuits_.find(key);
+    return (it == circuits_.end()) ? CIRCUIT_CLOSED : it->second.state;
+}
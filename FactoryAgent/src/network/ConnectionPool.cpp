@@ -0,0 +1,225 @@
+#ifdef _WIN32
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "../include/network/ConnectionPool.h"
+#include "../include/common/Constants.h"
+
+/*
+ * ConnectionPool.cpp
+ * WinHTTP keeps idle sockets alive per session handle, so a single session
+ * reused across requests gives keep-alive for free. This class owns that
+ * session plus one connect handle per host and tracks how often the
+ * underlying socket was actually reused.
+ */
+
+ConnectionPool::ConnectionPool()
+    : hSession_(NULL), recycleSession_(false), requests_(0), connectionsReused_(0), newHandshakes_(0),
+    idleEvictions_(0), failedHealthChecks_(0) {
+}
+
+ConnectionPool::~ConnectionPool() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CloseSession();
+}
+
+std::wstring ConnectionPool::MakeKey(const std::wstring& host, int port) {
+    return host + L":" + std::to_wstring(port);
+}
+
+bool ConnectionPool::EnsureSession() {
+    if (hSession_) {
+        return true;
+    }
+
+    hSession_ = WinHttpOpen(L"Factory Agent/1.0",
+        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+        WINHTTP_NO_PROXY_NAME,
+        WINHTTP_NO_PROXY_BYPASS, 0);
+    if (!hSession_) {
+        return false;
+    }
+
+    DWORD maxConns = AgentConstants::POOL_MAX_CONNECTIONS_PER_HOST;
+    WinHttpSetOption(hSession_, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &maxConns, sizeof(maxConns));
+
+    return true;
+}
+
+void ConnectionPool::CloseEntry(HostEntry& entry) {
+    if (entry.hConnect) {
+        WinHttpCloseHandle(entry.hConnect);
+        entry.hConnect = NULL;
+    }
+    entry.localPorts.clear();
+}
+
+void ConnectionPool::CloseSession() {
+    std::map<std::wstring, HostEntry>::iterator it;
+    for (it = hosts_.begin(); it != hosts_.end(); ++it) {
+        CloseEntry(it->second);
+    }
+    hosts_.clear();
+
+    if (hSession_) {
+        WinHttpCloseHandle(hSession_);
+        hSession_ = NULL;
+    }
+}
+
+HINTERNET ConnectionPool::Acquire(const std::wstring& host, int port) {
+    EvictIdle();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // A new connect handle would still draw on the session's dead sockets, so the whole
+    // session goes, once no request is still using one of its handles
+    if (recycleSession_) {
+        bool inFlight = false;
+        std::map<std::wstring, HostEntry>::iterator entry;
+        for (entry = hosts_.begin(); entry != hosts_.end(); ++entry) {
+            inFlight = inFlight || entry->second.inUse > 0;
+        }
+        if (!inFlight) {
+            CloseSession();
+            recycleSession_ = false;
+        }
+    }
+
+    if (!EnsureSession()) {
+        return NULL;
+    }
+
+    std::wstring key = MakeKey(host, port);
+    std::map<std::wstring, HostEntry>::iterator it = hosts_.find(key);
+
+    if (it == hosts_.end()) {
+        HINTERNET hConnect = WinHttpConnect(hSession_, host.c_str(), (INTERNET_PORT)port, 0);
+        if (!hConnect) {
+            return NULL;
+        }
+
+        HostEntry entry;
+        entry.hConnect = hConnect;
+        entry.lastUsed = GetTickCount64();
+        entry.inUse = 0;
+        it = hosts_.insert(std::make_pair(key, entry)).first;
+    }
+
+    it->second.inUse++;
+    it->second.lastUsed = GetTickCount64();
+    requests_++;
+
+    return it->second.hConnect;
+}
+
+void ConnectionPool::Release(const std::wstring& host, int port) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::map<std::wstring, HostEntry>::iterator it = hosts_.find(MakeKey(host, port));
+    if (it != hosts_.end() && it->second.inUse > 0) {
+        it->second.inUse--;
+        it->second.lastUsed = GetTickCount64();
+    }
+}
+
+bool ConnectionPool::RecordResponse(const std::wstring& host, int port, HINTERNET hRequest) {
+    WINHTTP_CONNECTION_INFO info;
+    ZeroMemory(&info, sizeof(info));
+    info.cbSize = sizeof(info);
+    DWORD size = sizeof(info);
+
+    if (!WinHttpQueryOption(hRequest, WINHTTP_OPTION_CONNECTION_INFO, &info, &size)) {
+        return false;
+    }
+
+    // The local port identifies the socket: a port already seen for this host means keep-alive reuse
+    unsigned short localPort = 0;
+    if (info.LocalAddress.ss_family == AF_INET) {
+        localPort = ntohs(((SOCKADDR_IN*)&info.LocalAddress)->sin_port);
+    }
+    else if (info.LocalAddress.ss_family == AF_INET6) {
+        localPort = ntohs(((SOCKADDR_IN6*)&info.LocalAddress)->sin6_port);
+    }
+
+    if (localPort == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::map<std::wstring, HostEntry>::iterator it = hosts_.find(MakeKey(host, port));
+    if (it == hosts_.end()) {
+        return false;
+    }
+
+    if (it->second.localPorts.count(localPort) > 0) {
+        connectionsReused_++;
+        return true;
+    }
+
+    newHandshakes_++;
+    if ((int)it->second.localPorts.size() >= AgentConstants::POOL_MAX_TRACKED_SOCKETS) {
+        it->second.localPorts.erase(it->second.localPorts.begin());
+    }
+    it->second.localPorts.insert(localPort);
+    return false;
+}
+
+bool ConnectionPool::ReportFailure(DWORD error) {
+    bool connectionLevel =
+        error == ERROR_WINHTTP_CONNECTION_ERROR ||
+        error == ERROR_WINHTTP_CANNOT_CONNECT ||
+        error == ERROR_WINHTTP_TIMEOUT ||
+        error == ERROR_WINHTTP_SECURE_FAILURE ||
+        error == ERROR_WINHTTP_NAME_NOT_RESOLVED;
+
+    if (!connectionLevel) {
+        return false;
+    }
+
+    failedHealthChecks_++;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    recycleSession_ = true;
+
+    // A reset on a pooled keep-alive socket is the one case where an immediate retry helps
+    return error == ERROR_WINHTTP_CONNECTION_ERROR;
+}
+
+void ConnectionPool::EvictIdle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ULONGLONG now = GetTickCount64();
+    ULONGLONG idleLimit = (ULONGLONG)AgentConstants::POOL_IDLE_TIMEOUT_SECONDS * 1000;
+
+    std::map<std::wstring, HostEntry>::iterator it = hosts_.begin();
+    while (it != hosts_.end()) {
+        if (it->second.inUse == 0 && now - it->second.lastUsed > idleLimit) {
+            CloseEntry(it->second);
+            it = hosts_.erase(it);
+            idleEvictions_++;
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // Idle sockets belong to the session, so closing it is the only way to actually drop them
+    if (hosts_.empty() && hSession_) {
+        WinHttpCloseHandle(hSession_);
+        hSession_ = NULL;
+    }
+}
+
+ConnectionStats ConnectionPool::GetStats() const {
+    ConnectionStats stats;
+    stats.requests = requests_.load();
+    stats.connectionsReused = connectionsReused_.load();
+    stats.newHandshakes = newHandshakes_.load();
+    stats.idleEvictions = idleEvictions_.load();
+    stats.failedHealthChecks = failedHealthChecks_.load();
+    return stats;
+}
+
+#endif // _WIN32
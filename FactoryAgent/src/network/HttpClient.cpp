@@ -1,15 +1,144 @@
 #include "../include/network/HttpClient.h"
 #include "../include/common/Constants.h"
+#include "../include/utilities/MappedFile.h"
+#include "../include/utilities/RandomAccessFile.h"
+#include "../include/utilities/StringUtils.h"
+#include "../include/utilities/Sha256.h"
+#include "../include/utilities/CompressionUtils.h"
+#include "../include/utilities/JsonStreamParser.h"
 #include <sstream>
+#include <algorithm>
 #include <vector>
 #include <fstream>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <cstdlib>
+#include <cwchar>
 
-HttpClient::HttpClient(const std::wstring& serverUrl) : port_(80), useHttps_(false) {
+namespace fs = std::filesystem;
+
+HttpClient::HttpClient(const std::wstring& serverUrl) : port_(80), useHttps_(false), wireEncoding_(WIRE_ENCODING_JSON),
+    segmentedMinBytes_(AgentConstants::SEGMENTED_DOWNLOAD_MIN_BYTES), transfersCancelled_(false) {
+    serverUrl_ = serverUrl;
+    transport_ = HttpTransport::CreateDefault();
+    circuitBreaker_ = new CircuitBreaker(AgentConstants::BREAKER_FAILURE_THRESHOLD,
+        AgentConstants::BREAKER_OPEN_BASE_MS, AgentConstants::BREAKER_OPEN_MAX_MS);
+    requestMetrics_ = new RequestMetrics();
+    bandwidthLimiter_ = new BandwidthLimiter();
+    requestQueue_ = new RequestQueue(AgentConstants::REQUEST_INTERACTIVE_THREADS,
+        AgentConstants::REQUEST_BULK_THREADS);
+    ParseUrl();
+}
+
+HttpClient::HttpClient(const std::wstring& serverUrl, HttpTransport* transport) : port_(80), useHttps_(false), wireEncoding_(WIRE_ENCODING_JSON),
+    segmentedMinBytes_(AgentConstants::SEGMENTED_DOWNLOAD_MIN_BYTES), transfersCancelled_(false) {
     serverUrl_ = serverUrl;
+    transport_ = transport;
+    circuitBreaker_ = new CircuitBreaker(AgentConstants::BREAKER_FAILURE_THRESHOLD,
+        AgentConstants::BREAKER_OPEN_BASE_MS, AgentConstants::BREAKER_OPEN_MAX_MS);
+    requestMetrics_ = new RequestMetrics();
+    bandwidthLimiter_ = new BandwidthLimiter();
+    requestQueue_ = new RequestQueue(AgentConstants::REQUEST_INTERACTIVE_THREADS,
+        AgentConstants::REQUEST_BULK_THREADS);
     ParseUrl();
 }
 
 HttpClient::~HttpClient() {
+    // Lifting the cap releases transfers parked in the limiter so the queue can drain
+    bandwidthLimiter_->SetLimitKbps(0);
+
+    // Queue threads still use the transport, so they have to be gone before it is
+    delete requestQueue_;
+    delete transport_;
+    delete circuitBreaker_;
+    delete requestMetrics_;
+    delete bandwidthLimiter_;
+}
+
+ConnectionStats HttpClient::GetConnectionStats() const {
+    return transport_->GetStats();
+}
+
+bool HttpClient::Transmit(TransportRequest& request, TransportResponse& reply, const BodySink& sink) {
+    // Callers that cancel on their own (the command channel) are reached through theirs
+    TransportCancel exchange;
+    TransportCancel* callerCancel = request.cancel;
+    request.cancel = callerCancel ? callerCancel : &exchange;
+    {
+        std::lock_guard<std::mutex> lock(transfersMutex_);
+        if (transfersCancelled_) {
+            request.cancel = callerCancel;
+            return false;
+        }
+        transfers_.insert(request.cancel);
+    }
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    bool sent = transport_->Send(request, reply, sink);
+
+    {
+        // Taken before exchange goes out of scope, so CancelTransfers never runs a dead closer
+        std::lock_guard<std::mutex> lock(transfersMutex_);
+        transfers_.erase(request.cancel);
+    }
+    request.cancel = callerCancel;
+
+    // Total includes a transport-level retry on a stale socket; the phases are the final attempt's
+    reply.timings.totalMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+    requestMetrics_->Record(CircuitKey(request.path), reply.timings,
+        !sent || reply.statusCode >= AgentConstants::HTTP_SERVER_ERROR);
+    return sent;
+}
+
+void HttpClient::CancelTransfers() {
+    std::lock_guard<std::mutex> lock(transfersMutex_);
+    transfersCancelled_ = true;
+    for (std::set<TransportCancel*>::iterator it = transfers_.begin(); it != transfers_.end(); ++it) {
+        (*it)->Cancel();
+    }
+}
+
+void HttpClient::ResumeTransfers() {
+    std::lock_guard<std::mutex> lock(transfersMutex_);
+    transfersCancelled_ = false;
+}
+
+void HttpClient::SetBandwidthLimit(int kbps) {
+    bandwidthLimiter_->SetLimitKbps(kbps);
+}
+
+int HttpClient::GetBandwidthLimit() const {
+    return bandwidthLimiter_->GetLimitKbps();
+}
+
+void HttpClient::SetSegmentedDownloadThreshold(long long bytes) {
+    segmentedMinBytes_ = bytes;
+}
+
+bool HttpClient::GetEndpointMetrics(const std::wstring& endpoint, EndpointMetricsSnapshot& snapshot) const {
+    return requestMetrics_->GetSnapshot(CircuitKey(endpoint), snapshot);
+}
+
+json HttpClient::CollectMetricsSummary() {
+    return requestMetrics_->CollectSummary();
+}
+
+void HttpClient::AcknowledgeMetricsSummary() {
+    requestMetrics_->AcknowledgeSummary();
+}
+
+TransportRequest HttpClient::MakeRequest(const std::wstring& method, const std::wstring& host, int port,
+    const std::wstring& path, bool useHttps) const {
+    TransportRequest request;
+    request.method = method;
+    request.host = host;
+    request.port = port;
+    request.path = path;
+    request.useHttps = useHttps;
+    return request;
 }
 
 bool HttpClient::ParseUrl() {
@@ -26,7 +155,7 @@ bool HttpClient::ParseUrl() {
         if (portStart != std::wstring::npos && (pathStart == std::wstring::npos || portStart < pathStart)) {
             hostName_ = serverUrl_.substr(hostStart, portStart - hostStart);
             size_t portEnd = (pathStart != std::wstring::npos) ? pathStart : serverUrl_.length();
-            port_ = _wtoi(serverUrl_.substr(portStart + 1, portEnd - portStart - 1).c_str());
+            port_ = (int)wcstol(serverUrl_.substr(portStart + 1, portEnd - portStart - 1).c_str(), NULL, 10);
         }
         else if (pathStart != std::wstring::npos) {
             hostName_ = serverUrl_.substr(hostStart, pathStart - hostStart);
@@ -43,111 +172,356 @@ bool HttpClient::ParseUrl() {
 }
 
 bool HttpClient::SendRequest(const std::wstring& method, const std::wstring& endpoint,
-    const std::string& data, std::string& response) {
-    HINTERNET hSession = WinHttpOpen(L"Factory Agent/1.0",
-        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-        WINHTTP_NO_PROXY_NAME,
-        WINHTTP_NO_PROXY_BYPASS, 0);
-    if (!hSession) {
-        return false;
+    const std::string& data, WireEncoding encoding, json::json_sax_t& handler, int& statusCode) {
+    TransportRequest request = MakeRequest(method, hostName_, port_, endpoint, useHttps_);
+    request.headers.push_back(std::make_pair(std::string("Content-Type"),
+        std::string(WireCodec::ContentType(encoding))));
+    if (encoding != WIRE_ENCODING_JSON) {
+        // JSON stays acceptable so error pages and older actions still parse
+        request.headers.push_back(std::make_pair(std::string("Accept"),
+            std::string(WireCodec::ContentType(encoding)) + ", " + AgentConstants::CONTENT_TYPE_JSON + ";q=0.9"));
     }
+    request.headers.push_back(std::make_pair(std::string("Accept-Encoding"), std::string("gzip")));
 
-    HINTERNET hConnect = WinHttpConnect(hSession, hostName_.c_str(), port_, 0);
-    if (!hConnect) {
-        WinHttpCloseHandle(hSession);
-        return false;
+    // Small bodies such as the heartbeat are not worth the CPU or the gzip header overhead
+    if ((int)data.size() >= AgentConstants::COMPRESSION_MIN_BYTES) {
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        std::string compressed;
+        if (CompressionUtils::GzipCompress(data, compressed) && compressed.size() < data.size()) {
+            request.body.swap(compressed);
+            request.headers.push_back(std::make_pair(std::string("Content-Encoding"), std::string("gzip")));
+
+            long long micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started).count();
+            RecordCompression(endpoint, true, (long long)data.size(), (long long)request.body.size(), micros);
+        }
     }
+    if (request.body.empty()) {
+        request.body = data;
+    }
+
+    // JSON bodies go through the push parser chunk by chunk as they come off the socket
+    // (and out of the inflater), so the response is never held in full. CBOR/MessagePack
+    // readers need the whole body, so those are buffered and parsed at the end.
+    TransportResponse reply;
+    JsonStreamParser parser(&handler);
+    std::unique_ptr<GzipStreamDecoder> inflater;
+    std::string buffered;
+    std::string contentType;
+    bool started = false;
+    bool discard = false;
+    bool streamJson = true;
+    long long wireBytes = 0;
+    long long inflateMicros = 0;
 
-    DWORD flags = (useHttps_ ? WINHTTP_FLAG_SECURE : 0);
-    HINTERNET hRequest = WinHttpOpenRequest(hConnect, method.c_str(), endpoint.c_str(),
-        NULL, WINHTTP_NO_REFERER,
-        WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-    if (!hRequest) {
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
+    BodySink consume = [&](const char* chunk, size_t length) {
+        if (streamJson) {
+            return parser.Feed(chunk, length);
+        }
+        buffered.append(chunk, length);
+        return true;
+    };
+
+    // The transport has the status line and headers in reply before the first body chunk
+    BodySink sink = [&](const char* chunk, size_t length) {
+        if (!started) {
+            started = true;
+            contentType = StringUtils::ToLower(reply.Header("content-type"));
+            streamJson = contentType.find(AgentConstants::CONTENT_TYPE_CBOR) == std::string::npos &&
+                contentType.find(AgentConstants::CONTENT_TYPE_MSGPACK) == std::string::npos;
+
+            std::string contentEncoding = StringUtils::ToLower(reply.Header("content-encoding"));
+            if (contentEncoding == "gzip" || contentEncoding == "deflate") {
+                inflater.reset(new GzipStreamDecoder());
+            }
+
+            // Post retries this request as JSON; the error body must not reach the handler
+            discard = encoding != WIRE_ENCODING_JSON &&
+                reply.statusCode == AgentConstants::HTTP_UNSUPPORTED_MEDIA_TYPE;
+        }
+        if (discard) {
+            return true;
+        }
+        if (!inflater) {
+            return consume(chunk, length);
+        }
+
+        std::chrono::steady_clock::time_point inflateStarted = std::chrono::steady_clock::now();
+        wireBytes += (long long)length;
+        bool accepted = inflater->Feed(chunk, length, consume);
+        inflateMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - inflateStarted).count();
+        return accepted;
+    };
+
+    bool sent = Transmit(request, reply, sink);
+    statusCode = reply.statusCode;
+    if (!sent || !started || discard) {
         return false;
     }
 
-    std::wstring headers = L"Content-Type: application/json\r\n";
-    bool result = false;
+    if (inflater) {
+        if (!inflater->IsFinished()) {
+            return false;
+        }
+        RecordCompression(endpoint, false, inflater->GetDecodedBytes(), wireBytes, inflateMicros);
+    }
+
+    if (streamJson) {
+        return parser.Finish();
+    }
 
-    if (WinHttpSendRequest(hRequest, headers.c_str(), -1,
-        (LPVOID)data.c_str(), data.length(), data.length(), 0)) {
-        if (WinHttpReceiveResponse(hRequest, NULL)) {
-            DWORD size = 0;
-            std::vector<char> buffer;
+    try {
+        json::input_format_t format = contentType.find(AgentConstants::CONTENT_TYPE_CBOR) != std::string::npos ?
+            json::input_format_t::cbor : json::input_format_t::msgpack;
+        return json::sax_parse(buffered, &handler, format);
+    }
+    catch (...) {
+        return false;
+    }
+}
 
-            do {
-                size = 0;
-                if (WinHttpQueryDataAvailable(hRequest, &size) && size > 0) {
-                    buffer.resize(size + 1);
-                    DWORD downloaded = 0;
-                    if (WinHttpReadData(hRequest, buffer.data(), size, &downloaded)) {
-                        buffer[downloaded] = 0;
-                        response.append(buffer.data(), downloaded);
-                    }
-                }
-            } while (size > 0);
+void HttpClient::RecordCompression(const std::wstring& endpoint, bool request,
+    long long rawBytes, long long wireBytes, long long micros) {
+    requestMetrics_->RecordCompression(CircuitKey(endpoint), request, rawBytes, wireBytes, micros);
+}
 
-            result = true;
+std::map<std::wstring, CompressionStats> HttpClient::GetCompressionStats() const {
+    std::map<std::wstring, CompressionStats> stats;
+    std::vector<EndpointMetricsSnapshot> snapshots = requestMetrics_->GetSnapshots();
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        const CompressionStats& gzip = snapshots[i].compression;
+        if (gzip.requestsCompressed > 0 || gzip.responsesCompressed > 0) {
+            stats[snapshots[i].endpoint] = gzip;
         }
     }
+    return stats;
+}
 
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
+bool HttpClient::Post(const std::wstring& endpoint, const json& data, json& response) {
+    int statusCode = 0;
+    return Post(endpoint, data, response, statusCode);
+}
 
-    return result;
+bool HttpClient::Post(const std::wstring& endpoint, const json& data, json& response, int& statusCode) {
+    JsonDomBuilder builder(response);
+    return PostStreaming(endpoint, data, builder, statusCode);
 }
 
-bool HttpClient::Post(const std::wstring& endpoint, const json& data, json& response) {
-    std::string postData = data.dump();
-    std::string responseStr;
+bool HttpClient::PostStreaming(const std::wstring& endpoint, const json& data, json::json_sax_t& handler,
+    int& statusCode) {
+    std::wstring circuit = CircuitKey(endpoint);
+    bool guarded = UsesCircuitBreaker(circuit);
 
-    if (SendRequest(L"POST", endpoint, postData, responseStr)) {
-        try {
-            response = json::parse(responseStr);
+    statusCode = 0;
+    if (guarded && !circuitBreaker_->AllowRequest(circuit)) {
+        return false;
+    }
+
+    bool parsed = SendPost(endpoint, data, handler, statusCode);
+    if (guarded) {
+        RecordOutcome(circuit, statusCode);
+    }
+    return parsed;
+}
+
+bool HttpClient::SendPost(const std::wstring& endpoint, const json& data, json::json_sax_t& handler,
+    int& statusCode) {
+    WireEncoding encoding = GetWireEncoding();
+    std::string postData;
+    if (!WireCodec::Encode(data, encoding, postData)) {
+        return false;
+    }
+
+    bool parsed = SendRequest(L"POST", endpoint, postData, encoding, handler, statusCode);
+
+    // A server rolled back to a JSON-only build rejects binary bodies; stay on JSON from then on
+    if (encoding != WIRE_ENCODING_JSON && statusCode == AgentConstants::HTTP_UNSUPPORTED_MEDIA_TYPE) {
+        SetWireEncoding(WIRE_ENCODING_JSON);
+        return SendPost(endpoint, data, handler, statusCode);
+    }
+
+    return parsed;
+}
+
+bool HttpClient::OpenStream(const std::wstring& endpoint, const json& data, const BodySink& sink,
+    TransportCancel* cancel, int& statusCode) {
+    // Always JSON and never gzip: lines have to reach sink the moment the server flushes them
+    TransportRequest request = MakeRequest(L"POST", hostName_, port_, endpoint, useHttps_);
+    request.headers.push_back(std::make_pair(std::string("Content-Type"),
+        std::string(AgentConstants::CONTENT_TYPE_JSON)));
+    request.headers.push_back(std::make_pair(std::string("Accept"),
+        std::string(AgentConstants::CONTENT_TYPE_NDJSON)));
+    request.body = data.dump();
+    request.cancel = cancel;
+
+    TransportResponse reply;
+    BodySink forward = [&](const char* chunk, size_t length) {
+        // Error pages are not channel content
+        if (reply.statusCode != AgentConstants::HTTP_OK) {
             return true;
         }
-        catch (...) {
-            return false;
-        }
+        return sink(chunk, length);
+    };
+
+    bool sent = Transmit(request, reply, forward);
+    statusCode = reply.statusCode;
+    return sent && statusCode == AgentConstants::HTTP_OK;
+}
+
+std::wstring HttpClient::CircuitKey(const std::wstring& endpoint) {
+    // getconfigupdate?pcId=... and friends share one circuit per path
+    size_t query = endpoint.find(L'?');
+    return (query == std::wstring::npos) ? endpoint : endpoint.substr(0, query);
+}
+
+bool HttpClient::UsesCircuitBreaker(const std::wstring& circuit) {
+    // Registration and heartbeats are the liveness probe and are paced by AgentCore's
+    // reconnect backoff, so they are never short-circuited
+    return circuit != AgentConstants::ENDPOINT_REGISTER && circuit != AgentConstants::ENDPOINT_HEARTBEAT;
+}
+
+void HttpClient::RecordOutcome(const std::wstring& circuit, int statusCode) {
+    // No status means the request never got an answer; 4xx other than 429 is the caller's problem
+    if (statusCode == 0 || statusCode >= AgentConstants::HTTP_SERVER_ERROR ||
+        statusCode == AgentConstants::HTTP_TOO_MANY_REQUESTS) {
+        circuitBreaker_->RecordFailure(circuit);
+    }
+    else {
+        circuitBreaker_->RecordSuccess(circuit);
     }
+}
 
-    return false;
+CircuitState HttpClient::GetCircuitState(const std::wstring& endpoint) const {
+    return circuitBreaker_->GetState(CircuitKey(endpoint));
 }
 
 bool HttpClient::Get(const std::wstring& endpoint, json& response) {
-    std::string responseStr;
+    JsonDomBuilder builder(response);
+    int statusCode = 0;
+    return SendRequest(L"GET", endpoint, "", GetWireEncoding(), builder, statusCode);
+}
 
-    if (SendRequest(L"GET", endpoint, "", responseStr)) {
-        try {
-            response = json::parse(responseStr);
-            return true;
-        }
-        catch (...) {
-            return false;
+void HttpClient::SetWireEncoding(WireEncoding encoding) {
+    wireEncoding_ = (int)encoding;
+}
+
+WireEncoding HttpClient::GetWireEncoding() const {
+    return (WireEncoding)wireEncoding_.load();
+}
+
+std::future<HttpResult> HttpClient::PostAsync(const std::wstring& endpoint, const json& data,
+    RequestLane lane) {
+    std::shared_ptr<std::promise<HttpResult> > promise(new std::promise<HttpResult>());
+    std::future<HttpResult> future = promise->get_future();
+
+    PostAsync(endpoint, data, lane, [promise](const HttpResult& result) {
+        promise->set_value(result);
+    });
+
+    return future;
+}
+
+void HttpClient::PostAsync(const std::wstring& endpoint, const json& data, RequestLane lane,
+    const std::function<void(const HttpResult&)>& completion) {
+    bool queued = requestQueue_->Submit(lane, [this, endpoint, data, completion]() {
+        HttpResult result;
+        result.success = Post(endpoint, data, result.response);
+        if (completion) {
+            completion(result);
         }
+    });
+
+    if (!queued && completion) {
+        completion(HttpResult());
+    }
+}
+
+std::future<bool> HttpClient::PostStreamingAsync(const std::wstring& endpoint, const json& data,
+    const std::shared_ptr<json::json_sax_t>& handler, RequestLane lane) {
+    std::shared_ptr<std::promise<bool> > promise(new std::promise<bool>());
+    std::future<bool> future = promise->get_future();
+
+    // The task holds its own reference, so a caller that stops waiting cannot free the handler
+    bool queued = requestQueue_->Submit(lane, [this, promise, endpoint, data, handler]() {
+        int statusCode = 0;
+        promise->set_value(PostStreaming(endpoint, data, *handler, statusCode));
+    });
+
+    if (!queued) {
+        promise->set_value(false);
+    }
+
+    return future;
+}
+
+std::future<HttpResult> HttpClient::UploadFileAsync(const std::wstring& endpoint,
+    const std::string& filePath, const std::string& modelName) {
+    std::shared_ptr<std::promise<HttpResult> > promise(new std::promise<HttpResult>());
+    std::future<HttpResult> future = promise->get_future();
+
+    bool queued = requestQueue_->Submit(REQUEST_LANE_BULK, [this, promise, endpoint, filePath, modelName]() {
+        HttpResult result;
+        result.success = UploadFile(endpoint, filePath, modelName, result.response);
+        promise->set_value(result);
+    });
+
+    if (!queued) {
+        promise->set_value(HttpResult());
+    }
+
+    return future;
+}
+
+std::future<bool> HttpClient::DownloadFileAsync(const std::string& url, const std::string& outputPath,
+    const std::string& expectedSha256) {
+    std::shared_ptr<std::promise<bool> > promise(new std::promise<bool>());
+    std::future<bool> future = promise->get_future();
+
+    bool queued = requestQueue_->Submit(REQUEST_LANE_BULK, [this, promise, url, outputPath, expectedSha256]() {
+        promise->set_value(DownloadFile(url, outputPath, expectedSha256));
+    });
+
+    if (!queued) {
+        promise->set_value(false);
+    }
+
+    return future;
+}
+
+std::future<DownloadOutcome> HttpClient::DownloadFileIfChangedAsync(const std::string& url,
+    const std::string& outputPath, const DownloadValidators& cached, DownloadValidators* fresh,
+    const std::string& expectedSha256) {
+    std::shared_ptr<std::promise<DownloadOutcome> > promise(new std::promise<DownloadOutcome>());
+    std::future<DownloadOutcome> future = promise->get_future();
+
+    // fresh is written on the queue thread; the caller reads it after the future is ready
+    bool queued = requestQueue_->Submit(REQUEST_LANE_BULK,
+        [this, promise, url, outputPath, cached, fresh, expectedSha256]() {
+        promise->set_value(DownloadFileIfChanged(url, outputPath, cached, *fresh, expectedSha256));
+    });
+
+    if (!queued) {
+        promise->set_value(DOWNLOAD_FAILED);
     }
 
-    return false;
+    return future;
 }
 
 bool HttpClient::UploadFile(const std::wstring& endpoint, const std::string& filePath,
     const std::string& modelName, json& response) {
-    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
+    // The file is streamed through a sliding mapped window so memory stays flat regardless of size
+    MappedFile file;
+    if (!file.Open(filePath)) {
         return false;
     }
 
-    std::streamsize fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<char> fileData(fileSize);
-    if (!file.read(fileData.data(), fileSize)) {
+    std::wstring circuit = CircuitKey(endpoint);
+    if (!circuitBreaker_->AllowRequest(circuit)) {
         return false;
     }
-    file.close();
+
+    long long fileSize = file.GetSize();
 
     size_t lastSlash = filePath.find_last_of("\\/");
     std::string fileName = (lastSlash != std::string::npos) ? filePath.substr(lastSlash + 1) : filePath;
@@ -165,103 +539,200 @@ bool HttpClient::UploadFile(const std::wstring& endpoint, const std::string& fil
     std::string bodyPrefix = bodyStream.str();
     std::string bodySuffix = "\r\n--" + boundary + "--\r\n";
 
-    DWORD totalSize = bodyPrefix.length() + fileData.size() + bodySuffix.length();
+    long long prefixLength = (long long)bodyPrefix.length();
 
-    HINTERNET hSession = WinHttpOpen(L"Factory Agent/1.0",
-        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-        WINHTTP_NO_PROXY_NAME,
-        WINHTTP_NO_PROXY_BYPASS, 0);
-    if (!hSession) return false;
+    TransportRequest request = MakeRequest(L"POST", hostName_, port_, endpoint, useHttps_);
+    request.headers.push_back(std::make_pair(std::string("Content-Type"),
+        "multipart/form-data; boundary=" + boundary));
+    request.bodyLength = prefixLength + fileSize + (long long)bodySuffix.length();
+
+    // Prefix and suffix come straight from their strings, the file from its mapped window
+    request.bodySource = [&](long long offset, const char*& data, size_t& length) {
+        if (offset < prefixLength) {
+            data = bodyPrefix.data() + offset;
+            length = (size_t)(prefixLength - offset);
+            return true;
+        }
+
+        long long fileOffset = offset - prefixLength;
+        if (fileOffset < fileSize) {
+            // Under a bandwidth cap the windows shrink to the bucket size so the pacing stays smooth
+            long long window = AgentConstants::UPLOAD_CHUNK_SIZE;
+            size_t limitedWindow = bandwidthLimiter_->GetWindowBytes();
+            if (limitedWindow > 0 && (long long)limitedWindow < window) {
+                window = (long long)limitedWindow;
+            }
+
+            long long remaining = fileSize - fileOffset;
+            length = (size_t)(remaining < window ? remaining : window);
+            data = file.MapWindow(fileOffset, length);
+            if (data == NULL) {
+                return false;
+            }
+            bandwidthLimiter_->Acquire(length);
+            return true;
+        }
+
+        size_t suffixOffset = (size_t)(fileOffset - fileSize);
+        data = bodySuffix.data() + suffixOffset;
+        length = bodySuffix.length() - suffixOffset;
+        return true;
+    };
+
+    TransportResponse reply;
+    JsonDomBuilder builder(response);
+    JsonStreamParser parser(&builder);
+    BodySink sink = [&parser](const char* chunk, size_t length) {
+        return parser.Feed(chunk, length);
+    };
+    bool sent = Transmit(request, reply, sink);
+    RecordOutcome(circuit, reply.statusCode);
+    if (!sent) {
+        return false;
+    }
+
+    return parser.Finish();
+}
 
-    HINTERNET hConnect = WinHttpConnect(hSession, hostName_.c_str(), port_, 0);
-    if (!hConnect) {
-        WinHttpCloseHandle(hSession);
+bool HttpClient::UploadChunks(const std::wstring& endpoint, const std::vector<UploadChunk>& chunks,
+    json& response) {
+    if (chunks.empty()) {
         return false;
     }
 
-    DWORD flags = (useHttps_ ? WINHTTP_FLAG_SECURE : 0);
-    HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"POST", endpoint.c_str(),
-        NULL, WINHTTP_NO_REFERER,
-        WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-    if (!hRequest) {
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
+    std::wstring circuit = CircuitKey(endpoint);
+    if (!circuitBreaker_->AllowRequest(circuit)) {
         return false;
     }
 
-    std::wstring contentType = L"Content-Type: multipart/form-data; boundary=" +
-        std::wstring(boundary.begin(), boundary.end()) + L"\r\n";
-
-    bool result = false;
-
-    if (WinHttpSendRequest(hRequest, contentType.c_str(), -1,
-        WINHTTP_NO_REQUEST_DATA, 0, totalSize, 0)) {
-        DWORD written = 0;
-
-        if (WinHttpWriteData(hRequest, bodyPrefix.c_str(), bodyPrefix.length(), &written)) {
-            if (WinHttpWriteData(hRequest, fileData.data(), fileData.size(), &written)) {
-                if (WinHttpWriteData(hRequest, bodySuffix.c_str(), bodySuffix.length(), &written)) {
-                    if (WinHttpReceiveResponse(hRequest, NULL)) {
-                        std::string responseStr;
-                        DWORD size = 0;
-                        std::vector<char> buffer;
-
-                        do {
-                            size = 0;
-                            if (WinHttpQueryDataAvailable(hRequest, &size) && size > 0) {
-                                buffer.resize(size + 1);
-                                DWORD downloaded = 0;
-                                if (WinHttpReadData(hRequest, buffer.data(), size, &downloaded)) {
-                                    buffer[downloaded] = 0;
-                                    responseStr.append(buffer.data(), downloaded);
-                                }
-                            }
-                        } while (size > 0);
-
-                        try {
-                            response = json::parse(responseStr);
-                            result = true;
-                        }
-                        catch (...) {
-                            result = false;
-                        }
-                    }
-                }
+    // Each record is its header followed by the data; starts[i] is where record i begins
+    std::vector<std::string> headers;
+    std::vector<long long> starts;
+    long long bodyLength = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        headers.push_back(chunks[i].hash + " " + std::to_string((unsigned long long)chunks[i].length) + "\n");
+        starts.push_back(bodyLength);
+        bodyLength += (long long)headers[i].length() + (long long)chunks[i].length;
+    }
+
+    TransportRequest request = MakeRequest(L"POST", hostName_, port_, endpoint, useHttps_);
+    request.headers.push_back(std::make_pair(std::string("Content-Type"),
+        std::string(AgentConstants::CONTENT_TYPE_OCTET_STREAM)));
+    request.bodyLength = bodyLength;
+
+    // Chunks of the same file usually follow each other, so the file stays open between them
+    MappedFile file;
+    std::string openPath;
+    request.bodySource = [&](long long offset, const char*& data, size_t& length) {
+        size_t index = (size_t)(std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin()) - 1;
+        const UploadChunk& chunk = chunks[index];
+
+        long long within = offset - starts[index];
+        long long headerLength = (long long)headers[index].length();
+        if (within < headerLength) {
+            data = headers[index].data() + within;
+            length = (size_t)(headerLength - within);
+            return true;
+        }
+
+        if (openPath != chunk.filePath) {
+            file.Close();
+            openPath.clear();
+            if (!file.Open(chunk.filePath)) {
+                return false;
             }
+            openPath = chunk.filePath;
+        }
+
+        long long dataOffset = within - headerLength;
+        long long window = (long long)chunk.length - dataOffset;
+        size_t limitedWindow = bandwidthLimiter_->GetWindowBytes();
+        if (limitedWindow > 0 && (long long)limitedWindow < window) {
+            window = (long long)limitedWindow;
         }
+
+        length = (size_t)window;
+        data = file.MapWindow(chunk.offset + dataOffset, length);
+        if (data == NULL) {
+            return false;
+        }
+        bandwidthLimiter_->Acquire(length);
+        return true;
+    };
+
+    TransportResponse reply;
+    JsonDomBuilder builder(response);
+    JsonStreamParser parser(&builder);
+    BodySink sink = [&parser](const char* chunk, size_t length) {
+        return parser.Feed(chunk, length);
+    };
+    bool sent = Transmit(request, reply, sink);
+    RecordOutcome(circuit, reply.statusCode);
+    if (!sent || reply.statusCode != AgentConstants::HTTP_OK) {
+        return false;
+    }
+
+    return parser.Finish();
+}
+
+bool HttpClient::PostBody(const std::wstring& endpoint, const BodySource& source, long long bodyLength,
+    json& response) {
+    std::wstring circuit = CircuitKey(endpoint);
+    bool guarded = UsesCircuitBreaker(circuit);
+    if (guarded && !circuitBreaker_->AllowRequest(circuit)) {
+        return false;
     }
 
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
+    TransportRequest request = MakeRequest(L"POST", hostName_, port_, endpoint, useHttps_);
+    request.headers.push_back(std::make_pair(std::string("Content-Type"),
+        std::string(AgentConstants::CONTENT_TYPE_JSON)));
+    request.bodySource = source;
+    request.bodyLength = bodyLength;
+
+    TransportResponse reply;
+    JsonDomBuilder builder(response);
+    JsonStreamParser parser(&builder);
+    BodySink sink = [&parser](const char* chunk, size_t length) {
+        return parser.Feed(chunk, length);
+    };
+    bool sent = Transmit(request, reply, sink);
+    if (guarded) {
+        RecordOutcome(circuit, reply.statusCode);
+    }
+    if (!sent || reply.statusCode != AgentConstants::HTTP_OK) {
+        return false;
+    }
 
-    return result;
+    return parser.Finish();
 }
 
-bool HttpClient::DownloadFile(const std::string& url, const std::string& outputPath) {
+bool HttpClient::ResolveUrl(const std::string& url, std::wstring& host, int& port,
+    std::wstring& path, bool& useHttps) const {
     std::wstring wUrl(url.begin(), url.end());
 
     size_t schemeEnd = wUrl.find(AgentConstants::PROTOCOL_SEPARATOR);
     if (schemeEnd == std::wstring::npos) {
         wUrl = serverUrl_ + std::wstring(url.begin(), url.end());
         schemeEnd = wUrl.find(AgentConstants::PROTOCOL_SEPARATOR);
+        if (schemeEnd == std::wstring::npos) {
+            return false;
+        }
     }
 
     std::wstring scheme = wUrl.substr(0, schemeEnd);
-    bool useHttps = (scheme == AgentConstants::HTTPS_PROTOCOL);
+    useHttps = (scheme == AgentConstants::HTTPS_PROTOCOL);
 
     size_t hostStart = schemeEnd + 3;
     size_t portStart = wUrl.find(L":", hostStart);
     size_t pathStart = wUrl.find(L"/", hostStart);
 
-    std::wstring host;
-    int port = useHttps ? AgentConstants::DEFAULT_HTTPS_PORT : AgentConstants::DEFAULT_HTTP_PORT;
-    std::wstring path = L"/";
+    port = useHttps ? AgentConstants::DEFAULT_HTTPS_PORT : AgentConstants::DEFAULT_HTTP_PORT;
+    path = L"/";
 
     if (portStart != std::wstring::npos && (pathStart == std::wstring::npos || portStart < pathStart)) {
         host = wUrl.substr(hostStart, portStart - hostStart);
         size_t portEnd = (pathStart != std::wstring::npos) ? pathStart : wUrl.length();
-        port = _wtoi(wUrl.substr(portStart + 1, portEnd - portStart - 1).c_str());
+        port = (int)wcstol(wUrl.substr(portStart + 1, portEnd - portStart - 1).c_str(), NULL, 10);
         if (pathStart != std::wstring::npos) {
             path = wUrl.substr(pathStart);
         }
@@ -274,58 +745,526 @@ bool HttpClient::DownloadFile(const std::string& url, const std::string& outputP
         host = wUrl.substr(hostStart);
     }
 
-    HINTERNET hSession = WinHttpOpen(L"Factory Agent/1.0",
-        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-        WINHTTP_NO_PROXY_NAME,
-        WINHTTP_NO_PROXY_BYPASS, 0);
-    if (!hSession) return false;
+    return !host.empty();
+}
+
+bool HttpClient::ParseContentRange(const std::string& contentRange, long long& start, long long& end,
+    long long& total) {
+    // Content-Range: bytes <start>-<end>/<total>, where the total may be "*"
+    size_t space = contentRange.find(' ');
+    size_t dash = contentRange.find('-');
+    size_t slash = contentRange.find('/');
+    if (space == std::string::npos || dash == std::string::npos || slash == std::string::npos ||
+        dash < space || slash < dash || contentRange.compare(0, space, "bytes") != 0) {
+        return false;
+    }
+
+    const char* text = contentRange.c_str();
+    char* stop = NULL;
+    start = strtoll(text + space + 1, &stop, 10);
+    if (stop != text + dash) {
+        return false;
+    }
+    end = strtoll(text + dash + 1, &stop, 10);
+    if (stop != text + slash || start < 0 || end < start) {
+        return false;
+    }
+    total = (contentRange.compare(slash + 1, 1, "*") == 0) ? -1 : strtoll(text + slash + 1, NULL, 10);
+    return total < 0 || end < total;
+}
+
+bool HttpClient::LoadDownloadState(const std::string& metaPath, DownloadState& state) {
+    std::ifstream metaFile(metaPath, std::ios::binary);
+    if (!metaFile.is_open()) {
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(metaFile)), std::istreambuf_iterator<char>());
+
+    try {
+        json meta = json::parse(content);
+        state.url = meta.value("url", "");
+        state.etag = meta.value("etag", "");
+        state.offset = meta.value("offset", 0LL);
+        state.total = meta.value("total", 0LL);
+        state.completed.clear();
+        if (meta.contains("completed") && meta["completed"].is_array()) {
+            for (size_t i = 0; i < meta["completed"].size(); i++) {
+                const json& range = meta["completed"][i];
+                state.completed.push_back(ByteRange(range[0].get<long long>(), range[1].get<long long>()));
+            }
+        }
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
+
+bool HttpClient::SaveDownloadState(const std::string& metaPath, const DownloadState& state) {
+    json meta;
+    meta["url"] = state.url;
+    meta["etag"] = state.etag;
+    meta["offset"] = state.offset;
+    if (state.total > 0) {
+        meta["total"] = state.total;
+        json completed = json::array();
+        for (size_t i = 0; i < state.completed.size(); i++) {
+            completed.push_back(json::array({ state.completed[i].start, state.completed[i].end }));
+        }
+        meta["completed"] = completed;
+    }
+
+    std::ofstream metaFile(metaPath, std::ios::binary | std::ios::trunc);
+    if (!metaFile.is_open()) {
+        return false;
+    }
+    metaFile << meta.dump();
+    return metaFile.good();
+}
+
+bool HttpClient::DownloadFile(const std::string& url, const std::string& outputPath,
+    const std::string& expectedSha256) {
+    std::wstring host;
+    std::wstring path;
+    int port = 0;
+    bool useHttps = false;
+    if (!ResolveUrl(url, host, port, path, useHttps)) {
+        return false;
+    }
+
+    std::string partPath = outputPath + AgentConstants::PART_EXTENSION;
+    std::string metaPath = partPath + AgentConstants::META_EXTENSION;
+
+    // Resume only from bytes that are both recorded in the sidecar and actually on disk,
+    // and only when there is an ETag to prove the server still has the same entity
+    DownloadState state;
+    std::error_code ec;
+    if (!LoadDownloadState(metaPath, state) || state.url != url || state.etag.empty()) {
+        state = DownloadState();
+        state.url = url;
+    }
+    long long onDisk = fs::exists(partPath, ec) ? (long long)fs::file_size(partPath, ec) : 0;
+    if (state.total > 0) {
+        // A segmented part file is pre-allocated, so its size must match exactly
+        if (ec || onDisk != state.total) {
+            state = DownloadState();
+            state.url = url;
+        }
+    }
+    else {
+        if (ec || onDisk < state.offset) {
+            state.offset = ec ? 0 : onDisk;
+        }
+        if (state.offset > 0) {
+            fs::resize_file(partPath, state.offset, ec);
+            if (ec) {
+                state.offset = 0;
+            }
+        }
+    }
+    if (state.offset == 0 && state.total == 0) {
+        fs::remove(partPath, ec);
+        fs::remove(metaPath, ec);
+    }
+
+    // Large files on range-capable servers are fetched as parallel segments
+    long long segmentedMinBytes = segmentedMinBytes_;
+    if (state.offset == 0 && (state.total > 0 || segmentedMinBytes > 0)) {
+        long long total = 0;
+        std::string etag;
+        std::string serverDigest;
+        // Parallel segments only pay off on an uncapped link; a segmented resume stays segmented
+        bool capped = bandwidthLimiter_->GetLimitKbps() > 0;
+        if (ProbeRanges(host, port, path, useHttps, total, etag, serverDigest) &&
+            (state.total > 0 || (!capped && segmentedMinBytes > 0 && total >= segmentedMinBytes))) {
+            if (state.total != total || state.etag != etag) {
+                fs::remove(partPath, ec);
+                state = DownloadState();
+                state.url = url;
+                state.total = total;
+                state.etag = etag;
+            }
+
+            RandomAccessFile partFile;
+
+            SegmentJob job;
+            job.host = host;
+            job.port = port;
+            job.path = path;
+            job.useHttps = useHttps;
+            job.etag = etag;
+            job.file = &partFile;
+            job.scheduler = NULL;
+            job.entityChanged = false;
+            job.finishedWorkers = 0;
+
+            if (!DownloadSegmented(job, partPath, metaPath, state)) {
+                return false;
+            }
+            return FinalizeDownload(partPath, metaPath, outputPath,
+                expectedSha256.empty() ? serverDigest : expectedSha256);
+        }
+    }
+
+    // Ranges are no longer available: a leftover segmented part cannot be continued sequentially
+    if (state.total > 0) {
+        fs::remove(partPath, ec);
+        state = DownloadState();
+        state.url = url;
+    }
+
+    TransportRequest request = MakeRequest(L"GET", host, port, path, useHttps);
+    if (state.offset > 0) {
+        // If-Range makes the server send the full entity (200) when the ETag no longer matches
+        request.headers.push_back(std::make_pair(std::string("Range"),
+            "bytes=" + std::to_string(state.offset) + "-"));
+        request.headers.push_back(std::make_pair(std::string("If-Range"), state.etag));
+    }
+
+    TransportResponse reply;
+    std::fstream outFile;
+    bool prepared = false;
+    bool writing = false;
+    bool misplaced = false;
+    long long expectedTotal = -1;
+    long long sinceCheckpoint = 0;
+
+    // Runs once the status line and headers are in, before the first body byte is stored
+    std::function<void()> prepare = [&]() {
+        prepared = true;
+
+        if (reply.statusCode == AgentConstants::HTTP_PARTIAL_CONTENT && state.offset > 0) {
+            // Bytes from anywhere but our offset would land at the wrong place in the part file
+            long long start = 0;
+            long long end = 0;
+            long long total = -1;
+            if (!ParseContentRange(reply.Header("content-range"), start, end, total) || start != state.offset) {
+                misplaced = true;
+                return;
+            }
+            expectedTotal = (total >= 0) ? total : end + 1;
+        }
+        else if (reply.statusCode == AgentConstants::HTTP_OK) {
+            state.offset = 0;
+            std::string contentLength = reply.Header("content-length");
+            if (!contentLength.empty()) {
+                expectedTotal = strtoll(contentLength.c_str(), NULL, 10);
+            }
+        }
+        else {
+            return;
+        }
+
+        std::string etag = reply.Header("etag");
+        if (!etag.empty()) {
+            state.etag = etag;
+        }
+
+        outFile.open(partPath, std::ios::binary | std::ios::in | std::ios::out |
+            (state.offset == 0 ? std::ios::trunc : std::ios::openmode(0)));
+        if (outFile.is_open()) {
+            outFile.seekp(state.offset);
+            writing = true;
+            SaveDownloadState(metaPath, state);
+        }
+    };
+
+    BodySink sink = [&](const char* data, size_t length) {
+        if (!prepared) {
+            prepare();
+        }
+        if (!writing) {
+            // Error bodies (416 and friends) are drained and ignored; a misplaced range is not read
+            return !misplaced;
+        }
+
+        bandwidthLimiter_->Acquire(length);
+        outFile.write(data, length);
+        if (!outFile) {
+            return false;
+        }
+        state.offset += (long long)length;
+        sinceCheckpoint += (long long)length;
+
+        if (sinceCheckpoint >= AgentConstants::DOWNLOAD_CHECKPOINT_BYTES) {
+            outFile.flush();
+            SaveDownloadState(metaPath, state);
+            sinceCheckpoint = 0;
+        }
+        return true;
+    };
+
+    bool sent = Transmit(request, reply, sink);
+    if (!prepared && reply.statusCode != 0) {
+        // Empty entity: no body callback ever ran, but the part file still has to exist
+        prepare();
+    }
+
+    if (misplaced) {
+        // The server does not honour our offset, so what is on disk cannot be continued; the
+        // whole entity is fetched again without a Range
+        fs::remove(partPath, ec);
+        fs::remove(metaPath, ec);
+        return DownloadFile(url, outputPath, expectedSha256);
+    }
+
+    bool complete = false;
+    if (writing) {
+        outFile.close();
+        SaveDownloadState(metaPath, state);
+        complete = sent && (expectedTotal < 0 || state.offset == expectedTotal);
+    }
+    else if (sent && reply.statusCode == AgentConstants::HTTP_RANGE_NOT_SATISFIABLE && state.offset > 0) {
+        // Nothing left past our offset: the part file already holds the whole entity
+        complete = true;
+    }
+
+    if (!complete) {
+        return false;
+    }
+
+    std::string serverDigest = reply.Header(StringUtils::ToLower(AgentConstants::HEADER_CONTENT_SHA256));
+    return FinalizeDownload(partPath, metaPath, outputPath,
+        expectedSha256.empty() ? serverDigest : expectedSha256);
+}
+
+DownloadOutcome HttpClient::DownloadFileIfChanged(const std::string& url, const std::string& outputPath,
+    const DownloadValidators& cached, DownloadValidators& fresh, const std::string& expectedSha256) {
+    fresh = DownloadValidators();
+
+    std::wstring host;
+    std::wstring path;
+    int port = 0;
+    bool useHttps = false;
+    if (!ResolveUrl(url, host, port, path, useHttps)) {
+        return DOWNLOAD_FAILED;
+    }
+
+    // If-None-Match is evaluated before the range, so an unchanged entity costs a bodiless 304
+    TransportRequest request = MakeRequest(L"GET", host, port, path, useHttps);
+    request.headers.push_back(std::make_pair(std::string("Range"), std::string("bytes=0-0")));
+    if (!cached.etag.empty()) {
+        request.headers.push_back(std::make_pair(std::string("If-None-Match"), cached.etag));
+    }
+    else if (!cached.lastModified.empty()) {
+        request.headers.push_back(std::make_pair(std::string("If-Modified-Since"), cached.lastModified));
+    }
+
+    // A server that ignores the range answers 200 with the whole file; that is left to DownloadFile
+    TransportResponse reply;
+    BodySink sink = [&reply](const char*, size_t) {
+        return reply.statusCode != AgentConstants::HTTP_OK;
+    };
+    Transmit(request, reply, sink);
+
+    if (reply.statusCode == AgentConstants::HTTP_NOT_MODIFIED && !cached.IsEmpty()) {
+        fresh = cached;
+        return DOWNLOAD_NOT_MODIFIED;
+    }
+    if (reply.statusCode != AgentConstants::HTTP_OK && reply.statusCode != AgentConstants::HTTP_PARTIAL_CONTENT) {
+        return DOWNLOAD_FAILED;
+    }
+
+    fresh.etag = reply.Header("etag");
+    fresh.lastModified = reply.Header("last-modified");
+    fresh.sha256 = StringUtils::ToLower(StringUtils::Trim(
+        reply.Header(StringUtils::ToLower(AgentConstants::HEADER_CONTENT_SHA256))));
+
+    // Without a digest of its own the file is checked against the one the probe reported, so
+    // the validators handed back describe the bytes that were actually stored
+    std::string digest = expectedSha256.empty() ? fresh.sha256 : expectedSha256;
+    if (!DownloadFile(url, outputPath, digest)) {
+        return DOWNLOAD_FAILED;
+    }
+    if (digest.empty()) {
+        // Nothing proved the entity did not change between the probe and the download
+        fresh = DownloadValidators();
+    }
+    return DOWNLOAD_COMPLETED;
+}
+
+bool HttpClient::ProbeRanges(const std::wstring& host, int port, const std::wstring& path, bool useHttps,
+    long long& total, std::string& etag, std::string& digest) {
+    // A one-byte range tells us the size, the ETag and whether ranges are honoured at all
+    TransportRequest request = MakeRequest(L"GET", host, port, path, useHttps);
+    request.headers.push_back(std::make_pair(std::string("Range"), std::string("bytes=0-0")));
 
-    HINTERNET hConnect = WinHttpConnect(hSession, host.c_str(), port, 0);
-    if (!hConnect) {
-        WinHttpCloseHandle(hSession);
+    TransportResponse reply;
+    if (!Transmit(request, reply, BodySink()) ||
+        reply.statusCode != AgentConstants::HTTP_PARTIAL_CONTENT) {
         return false;
     }
 
-    DWORD flags = useHttps ? WINHTTP_FLAG_SECURE : 0;
-    HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"GET", path.c_str(),
-        NULL, WINHTTP_NO_REFERER,
-        WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-    if (!hRequest) {
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
+    long long start = 0;
+    long long end = 0;
+    if (!ParseContentRange(reply.Header("content-range"), start, end, total) || start != 0) {
+        return false;
+    }
+    etag = reply.Header("etag");
+    digest = reply.Header(StringUtils::ToLower(AgentConstants::HEADER_CONTENT_SHA256));
+
+    // Without an ETag a segment could silently mix two versions of the file
+    return total > 0 && !etag.empty();
+}
+
+bool HttpClient::DownloadSegmented(SegmentJob& job, const std::string& partPath,
+    const std::string& metaPath, DownloadState& state) {
+    if (!job.file->Open(partPath)) {
+        return false;
+    }
+
+    // Pre-allocate so every worker can write its range in place
+    if (!job.file->Resize(state.total)) {
+        job.file->Close();
+        return false;
+    }
+
+    SaveDownloadState(metaPath, state);
+
+    SegmentScheduler scheduler(state.total, state.completed,
+        AgentConstants::SEGMENT_INITIAL_WORKERS, AgentConstants::SEGMENT_MAX_WORKERS);
+    job.scheduler = &scheduler;
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < AgentConstants::SEGMENT_MAX_WORKERS; i++) {
+        workers.push_back(std::thread(&HttpClient::RunSegmentWorker, this, &job, i));
+    }
+
+    // Checkpoint progress while the workers run so a crash loses at most one interval;
+    // polling at the idle interval keeps a fast download from idling out the last tick
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+    while (job.finishedWorkers < AgentConstants::SEGMENT_MAX_WORKERS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(AgentConstants::SEGMENT_IDLE_WAIT_MS));
+        if (std::chrono::steady_clock::now() - lastCheckpoint <
+            std::chrono::milliseconds(AgentConstants::SEGMENT_CHECKPOINT_MS)) {
+            continue;
+        }
+        job.file->Flush();
+        state.completed = scheduler.GetCompletedRanges();
+        SaveDownloadState(metaPath, state);
+        lastCheckpoint = std::chrono::steady_clock::now();
+    }
+
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    job.file->Flush();
+    job.file->Close();
+
+    std::error_code ec;
+    if (job.entityChanged) {
+        // The file changed on the server mid-download; the bytes on disk are worthless
+        fs::remove(partPath, ec);
+        fs::remove(metaPath, ec);
         return false;
     }
 
-    bool result = false;
-
-    if (WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
-        WINHTTP_NO_REQUEST_DATA, 0, 0, 0)) {
-        if (WinHttpReceiveResponse(hRequest, NULL)) {
-            std::ofstream outFile(outputPath, std::ios::binary);
-            if (outFile.is_open()) {
-                DWORD size = 0;
-                std::vector<char> buffer;
-
-                do {
-                    size = 0;
-                    if (WinHttpQueryDataAvailable(hRequest, &size) && size > 0) {
-                        buffer.resize(size);
-                        DWORD downloaded = 0;
-                        if (WinHttpReadData(hRequest, buffer.data(), size, &downloaded)) {
-                            outFile.write(buffer.data(), downloaded);
-                        }
-                    }
-                } while (size > 0);
-
-                outFile.close();
-                result = true;
+    state.completed = scheduler.GetCompletedRanges();
+    SaveDownloadState(metaPath, state);
+
+    return scheduler.IsComplete();
+}
+
+void HttpClient::RunSegmentWorker(SegmentJob* job, int workerIndex) {
+    while (!job->entityChanged) {
+        ByteRange segment;
+        SegmentAssignment assignment = job->scheduler->Next(workerIndex, segment);
+        if (assignment == SEGMENT_FINISHED) {
+            break;
+        }
+        if (assignment == SEGMENT_WAIT) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(AgentConstants::SEGMENT_IDLE_WAIT_MS));
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        long long written = 0;
+        bool ok = FetchSegment(job, segment, written);
+
+        ByteRange done(segment.start, segment.start + written);
+        if (ok) {
+            job->scheduler->Complete(done, (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started).count());
+        }
+        else {
+            job->scheduler->Fail(done, ByteRange(done.end, segment.end));
+        }
+    }
+
+    job->finishedWorkers++;
+}
+
+bool HttpClient::FetchSegment(SegmentJob* job, const ByteRange& segment, long long& written) {
+    written = 0;
+
+    TransportRequest request = MakeRequest(L"GET", job->host, job->port, job->path, job->useHttps);
+    request.headers.push_back(std::make_pair(std::string("Range"),
+        "bytes=" + std::to_string(segment.start) + "-" + std::to_string(segment.end - 1)));
+    request.headers.push_back(std::make_pair(std::string("If-Range"), job->etag));
+
+    TransportResponse reply;
+    bool checked = false;
+    BodySink sink = [&](const char* data, size_t length) {
+        if (reply.statusCode != AgentConstants::HTTP_PARTIAL_CONTENT) {
+            return false;
+        }
+        if (!checked) {
+            // Any other range would be written over bytes that belong elsewhere in the file
+            long long start = 0;
+            long long end = 0;
+            long long total = -1;
+            if (!ParseContentRange(reply.Header("content-range"), start, end, total) ||
+                start != segment.start || end != segment.end - 1) {
+                return false;
             }
+            checked = true;
+        }
+        if (written + (long long)length > segment.Length()) {
+            return false;
         }
+
+        bandwidthLimiter_->Acquire(length);
+
+        // Positioned write: workers share one file without sharing a file pointer
+        if (!job->file->WriteAt(segment.start + written, data, length)) {
+            return false;
+        }
+        written += (long long)length;
+        return true;
+    };
+
+    bool sent = Transmit(request, reply, sink);
+
+    if (reply.statusCode == AgentConstants::HTTP_OK) {
+        // If-Range fell back to the full entity: the ETag no longer matches
+        job->entityChanged = true;
+        return false;
     }
 
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
+    return sent && reply.statusCode == AgentConstants::HTTP_PARTIAL_CONTENT && written == segment.Length();
+}
 
-    return result;
-}
\ No newline at end of file
+bool HttpClient::FinalizeDownload(const std::string& partPath, const std::string& metaPath,
+    const std::string& outputPath, const std::string& expectedSha256) {
+    std::error_code ec;
+
+    if (!expectedSha256.empty()) {
+        std::string digest;
+        if (!Sha256::HashFile(partPath, digest) ||
+            StringUtils::ToLower(digest) != StringUtils::ToLower(StringUtils::Trim(expectedSha256))) {
+            // Corrupt or mixed content: a resume cannot fix it, so start over next time
+            fs::remove(partPath, ec);
+            fs::remove(metaPath, ec);
+            return false;
+        }
+    }
+
+    fs::rename(partPath, outputPath, ec);
+    if (ec) {
+        return false;
+    }
+
+    fs::remove(metaPath, ec);
+    return true;
+}
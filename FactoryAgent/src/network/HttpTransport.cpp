@@ -0,0 +1,15 @@
+#include "../include/network/HttpTransport.h"
+
+#ifdef _WIN32
+#include "../include/network/WinHttpTransport.h"
+#else
+#include "../include/network/PosixHttpTransport.h"
+#endif
+
+HttpTransport* HttpTransport::CreateDefault() {
+#ifdef _WIN32
+    return new WinHttpTransport();
+#else
+    return new PosixHttpTransport();
+#endif
+}
@@ -0,0 +1,145 @@
+#include "../include/network/LatencyHistogram.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+ * LatencyHistogram.cpp
+ * Values below 16 get a bucket each; above that, a value with its top bit at
+ * position p lands in row p-3, and the next four bits pick the column. Recording
+ * is an index computation plus a few relaxed atomic adds.
+ */
+
+static int HighestBit(unsigned long long value) {
+#ifdef _MSC_VER
+    // 32-bit scans so the Win32 build works too
+    unsigned long index = 0;
+    if (_BitScanReverse(&index, (unsigned long)(value >> 32))) {
+        return (int)index + 32;
+    }
+    _BitScanReverse(&index, (unsigned long)value);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+LatencyHistogram::LatencyHistogram() : count_(0), sum_(0), max_(0) {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::BucketIndex(long long value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return value < 0 ? 0 : (int)value;
+    }
+
+    unsigned long long clamped = (unsigned long long)value;
+    if (clamped >= (1ULL << MAX_VALUE_BITS)) {
+        clamped = (1ULL << MAX_VALUE_BITS) - 1;
+    }
+
+    int shift = HighestBit(clamped) - SUB_BUCKET_BITS;
+    return shift * SUB_BUCKET_COUNT + (int)(clamped >> shift);
+}
+
+long long LatencyHistogram::BucketLowest(int index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    long long mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+    return mantissa << shift;
+}
+
+long long LatencyHistogram::BucketHighest(int index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    long long mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(long long value) {
+    if (value < 0) {
+        value = 0;
+    }
+
+    counts_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    long long seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+    // Not atomic as a whole: a record racing the copy may show in the buckets but not in
+    // count, or the other way round. Percentiles are computed from the buckets alone
+    HistogramSnapshot snapshot;
+    snapshot.counts.resize(BUCKET_COUNT);
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+long long HistogramSnapshot::ValueAtPercentile(double percentile) const {
+    long long total = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    if (percentile < 0) {
+        percentile = 0;
+    }
+    if (percentile > 100) {
+        percentile = 100;
+    }
+
+    // Rank of the sample the percentile falls on, 1-based and rounded up
+    long long rank = (long long)(percentile / 100.0 * (double)total + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+
+    long long seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            long long highest = LatencyHistogram::BucketHighest((int)i);
+            return (max > 0 && highest > max) ? max : highest;
+        }
+    }
+    return max;
+}
+
+long long HistogramSnapshot::Mean() const {
+    return count > 0 ? sum / count : 0;
+}
+
+HistogramSnapshot HistogramSnapshot::Since(const HistogramSnapshot& earlier) const {
+    HistogramSnapshot delta;
+    delta.counts.resize(counts.size());
+    for (size_t i = 0; i < counts.size(); i++) {
+        long long before = (i < earlier.counts.size()) ? earlier.counts[i] : 0;
+        delta.counts[i] = counts[i] - before;
+        if (delta.counts[i] > 0) {
+            long long highest = LatencyHistogram::BucketHighest((int)i);
+            delta.max = (highest > max) ? max : highest;
+        }
+    }
+    delta.count = count - earlier.count;
+    delta.sum = sum - earlier.sum;
+    return delta;
+}
@@ -0,0 +1,359 @@
+#ifndef _WIN32
+
+#include "../include/network/PosixHttpTransport.h"
+#include "../include/network/SocketStream.h"
+#include "../include/common/Constants.h"
+#include "../include/utilities/StringUtils.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+/*
+ * PosixHttpTransport.cpp
+ * Mirrors what WinHTTP does for us on Windows: idle sockets are parked per host
+ * and handed to the next request, with a cheap liveness peek before reuse.
+ */
+
+PosixHttpTransport::PosixHttpTransport()
+    : requests_(0), connectionsReused_(0), newHandshakes_(0),
+    idleEvictions_(0), failedHealthChecks_(0) {
+}
+
+PosixHttpTransport::~PosixHttpTransport() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::map<std::string, std::vector<IdleSocket> >::iterator it;
+    for (it = idle_.begin(); it != idle_.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            close(it->second[i].fd);
+        }
+    }
+    idle_.clear();
+}
+
+ConnectionStats PosixHttpTransport::GetStats() const {
+    ConnectionStats stats;
+    stats.requests = requests_.load();
+    stats.connectionsReused = connectionsReused_.load();
+    stats.newHandshakes = newHandshakes_.load();
+    stats.idleEvictions = idleEvictions_.load();
+    stats.failedHealthChecks = failedHealthChecks_.load();
+    return stats;
+}
+
+int PosixHttpTransport::Connect(const std::string& host, int port, TransportTimings& timings) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    struct addrinfo* addresses = NULL;
+    int resolved = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    std::chrono::steady_clock::time_point connecting = std::chrono::steady_clock::now();
+    timings.resolveMicros = MicrosBetween(started, connecting);
+    if (resolved != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo* address = addresses; address != NULL; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        struct timeval timeout;
+        timeout.tv_sec = AgentConstants::SOCKET_TIMEOUT_MS / 1000;
+        timeout.tv_usec = (AgentConstants::SOCKET_TIMEOUT_MS % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // Heartbeats are a single small write; Nagle would only add latency
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(addresses);
+    timings.connectMicros = MicrosBetween(connecting, std::chrono::steady_clock::now());
+    return fd;
+}
+
+long long PosixHttpTransport::MicrosBetween(const std::chrono::steady_clock::time_point& from,
+    const std::chrono::steady_clock::time_point& to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+bool PosixHttpTransport::IsAlive(int fd) {
+    // An idle keep-alive socket must have nothing to read: EOF means the server closed it,
+    // and stray bytes would corrupt the next response
+    char probe;
+    ssize_t peeked = recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    return peeked < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+void PosixHttpTransport::EvictIdle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::seconds idleLimit(AgentConstants::POOL_IDLE_TIMEOUT_SECONDS);
+
+    std::map<std::string, std::vector<IdleSocket> >::iterator it = idle_.begin();
+    while (it != idle_.end()) {
+        std::vector<IdleSocket>& sockets = it->second;
+        for (size_t i = 0; i < sockets.size();) {
+            if (now - sockets[i].since > idleLimit) {
+                close(sockets[i].fd);
+                sockets.erase(sockets.begin() + i);
+                idleEvictions_++;
+            }
+            else {
+                i++;
+            }
+        }
+
+        if (sockets.empty()) {
+            it = idle_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+int PosixHttpTransport::Checkout(const std::string& key, const std::string& host, int port, bool& reused,
+    TransportTimings& timings) {
+    EvictIdle();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::map<std::string, std::vector<IdleSocket> >::iterator it = idle_.find(key);
+        while (it != idle_.end() && !it->second.empty()) {
+            int fd = it->second.back().fd;
+            it->second.pop_back();
+
+            if (IsAlive(fd)) {
+                reused = true;
+                return fd;
+            }
+
+            close(fd);
+            failedHealthChecks_++;
+        }
+    }
+
+    reused = false;
+    return Connect(host, port, timings);
+}
+
+void PosixHttpTransport::Checkin(const std::string& key, int fd) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<IdleSocket>& sockets = idle_[key];
+    if ((int)sockets.size() >= AgentConstants::POOL_MAX_CONNECTIONS_PER_HOST) {
+        close(fd);
+        return;
+    }
+
+    IdleSocket entry;
+    entry.fd = fd;
+    entry.since = std::chrono::steady_clock::now();
+    sockets.push_back(entry);
+}
+
+bool PosixHttpTransport::WriteRequest(SocketStream& stream, const TransportRequest& request,
+    const std::string& host) {
+    bool streamed = (bool)request.bodySource;
+    long long bodyLength = streamed ? request.bodyLength : (long long)request.body.length();
+
+    std::string head = std::string(request.method.begin(), request.method.end()) + " " +
+        std::string(request.path.begin(), request.path.end()) + " HTTP/1.1\r\n";
+    head += "Host: " + host;
+    if (request.port != AgentConstants::DEFAULT_HTTP_PORT) {
+        head += ":" + std::to_string(request.port);
+    }
+    head += "\r\nUser-Agent: Factory Agent/1.0\r\n";
+
+    bool hasContentLength = false;
+    for (size_t i = 0; i < request.headers.size(); i++) {
+        if (StringUtils::ToLower(request.headers[i].first) == "content-length") {
+            hasContentLength = true;
+        }
+        head += request.headers[i].first + ": " + request.headers[i].second + "\r\n";
+    }
+
+    if (!hasContentLength && (bodyLength > 0 || request.method == L"POST" || request.method == L"PUT")) {
+        head += "Content-Length: " + std::to_string(bodyLength) + "\r\n";
+    }
+    head += "\r\n";
+
+    if (!streamed) {
+        // Small JSON bodies ride in the same segment as the headers
+        head += request.body;
+        return stream.WriteAll(head);
+    }
+
+    if (!stream.WriteAll(head)) {
+        return false;
+    }
+
+    long long offset = 0;
+    while (offset < bodyLength) {
+        const char* data = NULL;
+        size_t length = 0;
+        if (!request.bodySource(offset, data, length) || !data || length == 0) {
+            return false;
+        }
+        if (!stream.WriteAll(data, length)) {
+            return false;
+        }
+        offset += (long long)length;
+    }
+
+    return true;
+}
+
+bool PosixHttpTransport::ReadResponse(SocketStream& stream, const TransportRequest& request,
+    TransportResponse& response, const BodySink& sink, bool& aborted, bool& keepAlive) {
+    std::string statusLine;
+    std::string version;
+    std::chrono::steady_clock::time_point requestSent = std::chrono::steady_clock::now();
+    bool first = true;
+
+    // Interim 1xx responses (100 Continue) carry headers but no body
+    do {
+        response.headers.clear();
+        if (!stream.ReadLine(statusLine)) {
+            return false;
+        }
+        if (first) {
+            response.timings.firstByteMicros = MicrosBetween(requestSent, std::chrono::steady_clock::now());
+            first = false;
+        }
+
+        size_t space = statusLine.find(' ');
+        if (space == std::string::npos || statusLine.compare(0, 5, "HTTP/") != 0) {
+            return false;
+        }
+        version = statusLine.substr(0, space);
+        response.statusCode = atoi(statusLine.c_str() + space + 1);
+
+        if (!stream.ReadHeaders(response.headers)) {
+            return false;
+        }
+    } while (response.statusCode >= 100 && response.statusCode < 200);
+
+    std::string connection = StringUtils::ToLower(response.Header("connection"));
+    keepAlive = (version == "HTTP/1.1") ? (connection != "close") : (connection == "keep-alive");
+
+    if (request.method == L"HEAD" || response.statusCode == 204 || response.statusCode == 304) {
+        return true;
+    }
+
+    std::chrono::steady_clock::time_point bodyStarted = std::chrono::steady_clock::now();
+    bool complete = false;
+
+    std::string transferEncoding = StringUtils::ToLower(response.Header("transfer-encoding"));
+    std::string contentLength = response.Header("content-length");
+    if (transferEncoding.find("chunked") != std::string::npos) {
+        complete = stream.ReadChunked(sink, aborted);
+    }
+    else if (!contentLength.empty()) {
+        complete = stream.ReadExact(strtoll(contentLength.c_str(), NULL, 10), sink, aborted);
+    }
+    else {
+        keepAlive = false;
+        complete = stream.ReadToClose(sink, aborted);
+    }
+
+    response.timings.transferMicros = MicrosBetween(bodyStarted, std::chrono::steady_clock::now());
+    return complete;
+}
+
+bool PosixHttpTransport::Send(const TransportRequest& request, TransportResponse& response, const BodySink& sink) {
+    if (request.useHttps) {
+        return false;
+    }
+
+    std::string host(request.host.begin(), request.host.end());
+    std::string key = host + ":" + std::to_string(request.port);
+
+    // Second attempt only happens when a parked keep-alive socket turned out to be dead
+    for (int attempt = 0; attempt < 2; attempt++) {
+        response = TransportResponse();
+
+        bool reused = false;
+        int fd = Checkout(key, host, request.port, reused, response.timings);
+        if (fd < 0) {
+            failedHealthChecks_++;
+            return false;
+        }
+        response.timings.reusedConnection = reused;
+
+        // Shutting the socket down wakes a blocked read; the descriptor stays ours to close
+        if (request.cancel && !request.cancel->Arm([fd]() { shutdown(fd, SHUT_RDWR); })) {
+            Checkin(key, fd);
+            return false;
+        }
+
+        requests_++;
+        if (reused) {
+            connectionsReused_++;
+        }
+        else {
+            newHandshakes_++;
+        }
+
+        SocketStream stream(fd);
+        bool aborted = false;
+        bool keepAlive = false;
+
+        bool exchanged = WriteRequest(stream, request, host) &&
+            ReadResponse(stream, request, response, sink, aborted, keepAlive);
+        response.timings.bytesSent = stream.GetBytesWritten();
+        response.timings.bytesReceived = stream.GetBytesRead();
+        bool cancelled = request.cancel && request.cancel->Disarm();
+
+        if (exchanged) {
+            if (keepAlive && !cancelled) {
+                Checkin(key, fd);
+            }
+            else {
+                close(fd);
+            }
+            return true;
+        }
+
+        close(fd);
+
+        if (aborted || cancelled) {
+            return false;
+        }
+        failedHealthChecks_++;
+
+        // Only a reused socket that died before the server said anything is worth another try,
+        // and only for a request the server may safely see twice
+        if (!reused || stream.ReceivedAny() || !request.IsIdempotent()) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+#endif // _WIN32
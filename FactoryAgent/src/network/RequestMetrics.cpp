@@ -0,0 +1,256 @@
+#include "../include/network/RequestMetrics.h"
+#include <algorithm>
+
+static const wchar_t* const OVERFLOW_ENDPOINT = L"(other)";
+
+CompressionStats CompressionStats::Since(const CompressionStats& earlier) const {
+    CompressionStats delta;
+    delta.requestsCompressed = requestsCompressed - earlier.requestsCompressed;
+    delta.requestRawBytes = requestRawBytes - earlier.requestRawBytes;
+    delta.requestWireBytes = requestWireBytes - earlier.requestWireBytes;
+    delta.compressMicros = compressMicros - earlier.compressMicros;
+    delta.responsesCompressed = responsesCompressed - earlier.responsesCompressed;
+    delta.responseRawBytes = responseRawBytes - earlier.responseRawBytes;
+    delta.responseWireBytes = responseWireBytes - earlier.responseWireBytes;
+    delta.decompressMicros = decompressMicros - earlier.decompressMicros;
+    return delta;
+}
+
+EndpointMetricsSnapshot EndpointMetricsSnapshot::Since(const EndpointMetricsSnapshot& earlier) const {
+    EndpointMetricsSnapshot delta;
+    delta.endpoint = endpoint;
+    delta.total = total.Since(earlier.total);
+    delta.resolve = resolve.Since(earlier.resolve);
+    delta.connect = connect.Since(earlier.connect);
+    delta.tls = tls.Since(earlier.tls);
+    delta.firstByte = firstByte.Since(earlier.firstByte);
+    delta.transfer = transfer.Since(earlier.transfer);
+    delta.failures = failures - earlier.failures;
+    delta.reusedConnections = reusedConnections - earlier.reusedConnections;
+    delta.bytesSent = bytesSent - earlier.bytesSent;
+    delta.bytesReceived = bytesReceived - earlier.bytesReceived;
+    delta.compression = compression.Since(earlier.compression);
+    return delta;
+}
+
+EndpointMetricsSnapshot RequestMetrics::EndpointMetrics::Snapshot() const {
+    EndpointMetricsSnapshot snapshot;
+    snapshot.endpoint = endpoint;
+    snapshot.total = total.Snapshot();
+    snapshot.resolve = resolve.Snapshot();
+    snapshot.connect = connect.Snapshot();
+    snapshot.tls = tls.Snapshot();
+    snapshot.firstByte = firstByte.Snapshot();
+    snapshot.transfer = transfer.Snapshot();
+    snapshot.failures = failures.load(std::memory_order_relaxed);
+    snapshot.reusedConnections = reusedConnections.load(std::memory_order_relaxed);
+    snapshot.bytesSent = bytesSent.load(std::memory_order_relaxed);
+    snapshot.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+    snapshot.compression.requestsCompressed = requestsCompressed.load(std::memory_order_relaxed);
+    snapshot.compression.requestRawBytes = requestRawBytes.load(std::memory_order_relaxed);
+    snapshot.compression.requestWireBytes = requestWireBytes.load(std::memory_order_relaxed);
+    snapshot.compression.compressMicros = compressMicros.load(std::memory_order_relaxed);
+    snapshot.compression.responsesCompressed = responsesCompressed.load(std::memory_order_relaxed);
+    snapshot.compression.responseRawBytes = responseRawBytes.load(std::memory_order_relaxed);
+    snapshot.compression.responseWireBytes = responseWireBytes.load(std::memory_order_relaxed);
+    snapshot.compression.decompressMicros = decompressMicros.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+RequestMetrics::RequestMetrics() : published_(0) {
+    for (int i = 0; i < MAX_ENDPOINTS; i++) {
+        slots_[i] = NULL;
+    }
+    baselineTime_ = std::chrono::steady_clock::now();
+    pendingTime_ = baselineTime_;
+}
+
+RequestMetrics::~RequestMetrics() {
+    for (int i = 0; i < MAX_ENDPOINTS; i++) {
+        delete slots_[i];
+    }
+}
+
+size_t RequestMetrics::Hash(const std::wstring& endpoint) {
+    // FNV-1a; only used to skip string compares while scanning the slots
+    size_t hash = (size_t)2166136261u;
+    for (size_t i = 0; i < endpoint.length(); i++) {
+        hash = (hash ^ (size_t)endpoint[i]) * (size_t)16777619u;
+    }
+    return hash;
+}
+
+RequestMetrics::EndpointMetrics* RequestMetrics::Find(const std::wstring& endpoint, size_t hash) const {
+    int published = published_.load(std::memory_order_acquire);
+    for (int i = 0; i < published; i++) {
+        if (slots_[i]->hash == hash && slots_[i]->endpoint == endpoint) {
+            return slots_[i];
+        }
+    }
+    return NULL;
+}
+
+RequestMetrics::EndpointMetrics* RequestMetrics::FindOrAdd(const std::wstring& endpoint) {
+    size_t hash = Hash(endpoint);
+    EndpointMetrics* metrics = Find(endpoint, hash);
+    if (metrics) {
+        return metrics;
+    }
+
+    std::lock_guard<std::mutex> lock(insertMutex_);
+
+    // Someone may have added it between the lock-free scan and taking the lock
+    metrics = Find(endpoint, hash);
+    if (metrics) {
+        return metrics;
+    }
+
+    int published = published_.load(std::memory_order_relaxed);
+    if (published == MAX_ENDPOINTS) {
+        return slots_[MAX_ENDPOINTS - 1];
+    }
+
+    // The last slot is kept for the overflow entry
+    if (published == MAX_ENDPOINTS - 1) {
+        slots_[published] = new EndpointMetrics(OVERFLOW_ENDPOINT, Hash(OVERFLOW_ENDPOINT));
+    }
+    else {
+        slots_[published] = new EndpointMetrics(endpoint, hash);
+    }
+
+    published_.store(published + 1, std::memory_order_release);
+    return slots_[published];
+}
+
+void RequestMetrics::Record(const std::wstring& endpoint, const TransportTimings& timings, bool failed) {
+    EndpointMetrics* metrics = FindOrAdd(endpoint);
+
+    metrics->total.Record(timings.totalMicros);
+    if (timings.reusedConnection) {
+        metrics->reusedConnections.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (timings.resolveMicros > 0 || timings.connectMicros > 0) {
+        metrics->resolve.Record(timings.resolveMicros);
+        metrics->connect.Record(timings.connectMicros);
+    }
+    if (timings.tlsMicros > 0) {
+        metrics->tls.Record(timings.tlsMicros);
+    }
+
+    if (failed) {
+        metrics->failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        metrics->firstByte.Record(timings.firstByteMicros);
+        metrics->transfer.Record(timings.transferMicros);
+    }
+
+    metrics->bytesSent.fetch_add(timings.bytesSent, std::memory_order_relaxed);
+    metrics->bytesReceived.fetch_add(timings.bytesReceived, std::memory_order_relaxed);
+}
+
+void RequestMetrics::RecordCompression(const std::wstring& endpoint, bool request,
+    long long rawBytes, long long wireBytes, long long micros) {
+    EndpointMetrics* metrics = FindOrAdd(endpoint);
+
+    if (request) {
+        metrics->requestsCompressed.fetch_add(1, std::memory_order_relaxed);
+        metrics->requestRawBytes.fetch_add(rawBytes, std::memory_order_relaxed);
+        metrics->requestWireBytes.fetch_add(wireBytes, std::memory_order_relaxed);
+        metrics->compressMicros.fetch_add(micros, std::memory_order_relaxed);
+    }
+    else {
+        metrics->responsesCompressed.fetch_add(1, std::memory_order_relaxed);
+        metrics->responseRawBytes.fetch_add(rawBytes, std::memory_order_relaxed);
+        metrics->responseWireBytes.fetch_add(wireBytes, std::memory_order_relaxed);
+        metrics->decompressMicros.fetch_add(micros, std::memory_order_relaxed);
+    }
+}
+
+bool RequestMetrics::GetSnapshot(const std::wstring& endpoint, EndpointMetricsSnapshot& snapshot) const {
+    EndpointMetrics* metrics = Find(endpoint, Hash(endpoint));
+    if (!metrics) {
+        return false;
+    }
+    snapshot = metrics->Snapshot();
+    return true;
+}
+
+std::vector<EndpointMetricsSnapshot> RequestMetrics::GetSnapshots() const {
+    std::vector<EndpointMetricsSnapshot> snapshots;
+    int published = published_.load(std::memory_order_acquire);
+    for (int i = 0; i < published; i++) {
+        snapshots.push_back(slots_[i]->Snapshot());
+    }
+    return snapshots;
+}
+
+json RequestMetrics::SummarizeEndpoint(const EndpointMetricsSnapshot& interval) {
+    json entry;
+    entry["endpoint"] = std::string(interval.endpoint.begin(), interval.endpoint.end());
+    entry["count"] = interval.total.count;
+    entry["failures"] = interval.failures;
+    entry["reusedConnections"] = interval.reusedConnections;
+    entry["p50Micros"] = interval.total.ValueAtPercentile(50);
+    entry["p95Micros"] = interval.total.ValueAtPercentile(95);
+    entry["p99Micros"] = interval.total.ValueAtPercentile(99);
+    entry["maxMicros"] = interval.total.max;
+    entry["resolveP95Micros"] = interval.resolve.ValueAtPercentile(95);
+    entry["connectP95Micros"] = interval.connect.ValueAtPercentile(95);
+    entry["tlsP95Micros"] = interval.tls.ValueAtPercentile(95);
+    entry["firstByteP95Micros"] = interval.firstByte.ValueAtPercentile(95);
+    entry["transferP95Micros"] = interval.transfer.ValueAtPercentile(95);
+    entry["bytesSent"] = interval.bytesSent;
+    entry["bytesReceived"] = interval.bytesReceived;
+
+    // Only endpoints that gzip at all carry these; the ratio is raw bytes per wire byte
+    const CompressionStats& gzip = interval.compression;
+    if (gzip.requestsCompressed > 0) {
+        entry["gzipRequests"] = gzip.requestsCompressed;
+        entry["gzipRequestRatio"] = (double)gzip.requestRawBytes / (double)std::max(gzip.requestWireBytes, 1LL);
+        entry["compressMicros"] = gzip.compressMicros;
+    }
+    if (gzip.responsesCompressed > 0) {
+        entry["gzipResponses"] = gzip.responsesCompressed;
+        entry["gzipResponseRatio"] = (double)gzip.responseRawBytes / (double)std::max(gzip.responseWireBytes, 1LL);
+        entry["decompressMicros"] = gzip.decompressMicros;
+    }
+    return entry;
+}
+
+json RequestMetrics::CollectSummary() {
+    std::lock_guard<std::mutex> lock(summaryMutex_);
+
+    std::vector<EndpointMetricsSnapshot> current = GetSnapshots();
+    pending_.clear();
+    pendingTime_ = std::chrono::steady_clock::now();
+
+    json endpoints = json::array();
+    for (size_t i = 0; i < current.size(); i++) {
+        std::map<std::wstring, EndpointMetricsSnapshot>::const_iterator it = baseline_.find(current[i].endpoint);
+        EndpointMetricsSnapshot interval = (it != baseline_.end()) ?
+            current[i].Since(it->second) : current[i].Since(EndpointMetricsSnapshot());
+
+        if (interval.total.count > 0) {
+            endpoints.push_back(SummarizeEndpoint(interval));
+        }
+        pending_[current[i].endpoint] = current[i];
+    }
+
+    json summary;
+    summary["intervalSeconds"] = std::chrono::duration_cast<std::chrono::seconds>(
+        pendingTime_ - baselineTime_).count();
+    summary["endpoints"] = endpoints;
+    return summary;
+}
+
+void RequestMetrics::AcknowledgeSummary() {
+    std::lock_guard<std::mutex> lock(summaryMutex_);
+
+    if (pending_.empty()) {
+        return;
+    }
+    baseline_.swap(pending_);
+    pending_.clear();
+    baselineTime_ = pendingTime_;
+}
@@ -0,0 +1,71 @@
+#include "../include/network/RequestQueue.h"
+
+RequestQueue::RequestQueue(int interactiveThreads, int bulkThreads) : stopping_(false) {
+    for (int i = 0; i < interactiveThreads; i++) {
+        lanes_[REQUEST_LANE_INTERACTIVE].workers.push_back(
+            std::thread(&RequestQueue::WorkerLoop, this, &lanes_[REQUEST_LANE_INTERACTIVE]));
+    }
+    for (int i = 0; i < bulkThreads; i++) {
+        lanes_[REQUEST_LANE_BULK].workers.push_back(
+            std::thread(&RequestQueue::WorkerLoop, this, &lanes_[REQUEST_LANE_BULK]));
+    }
+}
+
+RequestQueue::~RequestQueue() {
+    Shutdown();
+}
+
+bool RequestQueue::Submit(RequestLane lane, const std::function<void()>& task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        lanes_[lane].tasks.push_back(task);
+    }
+    lanes_[lane].wake.notify_one();
+    return true;
+}
+
+void RequestQueue::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+
+        // Queued work is dropped; only requests already on the wire are allowed to finish
+        for (int i = 0; i < 2; i++) {
+            lanes_[i].tasks.clear();
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        lanes_[i].wake.notify_all();
+        for (size_t j = 0; j < lanes_[i].workers.size(); j++) {
+            if (lanes_[i].workers[j].joinable()) {
+                lanes_[i].workers[j].join();
+            }
+        }
+    }
+}
+
+void RequestQueue::WorkerLoop(Lane* lane) {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            lane->wake.wait(lock, [this, lane]() { return stopping_ || !lane->tasks.empty(); });
+
+            if (stopping_) {
+                return;
+            }
+
+            task = lane->tasks.front();
+            lane->tasks.pop_front();
+        }
+
+        task();
+    }
+}
@@ -0,0 +1,40 @@
+#include "../include/network/RetryPolicy.h"
+#include <chrono>
+#include <thread>
+#include <functional>
+
+RetryPolicy::RetryPolicy(int baseDelayMs, int maxDelayMs)
+    : baseDelayMs_(baseDelayMs), maxDelayMs_(maxDelayMs), previousDelayMs_(baseDelayMs), attempts_(0) {
+    // Mixing in the clock and thread id keeps PCs (and policies) from sharing a sequence
+    // even where random_device is deterministic
+    std::random_device device;
+    unsigned int seed = device() ^
+        (unsigned int)std::chrono::steady_clock::now().time_since_epoch().count() ^
+        (unsigned int)std::hash<std::thread::id>()(std::this_thread::get_id());
+    random_.seed(seed);
+}
+
+int RetryPolicy::NextDelayMs() {
+    long long upper = previousDelayMs_ * 3;
+    if (upper > maxDelayMs_) {
+        upper = maxDelayMs_;
+    }
+    if (upper < baseDelayMs_) {
+        upper = baseDelayMs_;
+    }
+
+    std::uniform_int_distribution<long long> range(baseDelayMs_, upper);
+    previousDelayMs_ = range(random_);
+    attempts_++;
+
+    return (int)previousDelayMs_;
+}
+
+void RetryPolicy::Reset() {
+    previousDelayMs_ = baseDelayMs_;
+    attempts_ = 0;
+}
+
+int RetryPolicy::GetAttempts() const {
+    return attempts_;
+}
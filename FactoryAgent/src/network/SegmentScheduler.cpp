@@ -0,0 +1,166 @@
+#include "../include/network/SegmentScheduler.h"
+#include "../include/common/Constants.h"
+#include <algorithm>
+
+SegmentScheduler::SegmentScheduler(long long totalSize, const std::vector<ByteRange>& completed,
+    int initialWorkers, int maxWorkers) {
+    totalSize_ = totalSize;
+    inFlight_ = 0;
+    failures_ = 0;
+    maxWorkers_ = maxWorkers < 1 ? 1 : maxWorkers;
+    activeWorkers_ = initialWorkers < 1 ? 1 : (std::min)(initialWorkers, maxWorkers_);
+    segmentSize_ = AgentConstants::SEGMENT_INITIAL_BYTES;
+    perWorkerBytesPerMs_ = 0;
+    windowStart_ = std::chrono::steady_clock::now();
+    windowBytes_ = 0;
+    lastAggregateBytesPerMs_ = 0;
+
+    for (size_t i = 0; i < completed.size(); i++) {
+        AddCompleted(completed[i]);
+    }
+
+    // Whatever the completed list does not cover still has to be fetched
+    long long cursor = 0;
+    for (size_t i = 0; i < completed_.size(); i++) {
+        if (completed_[i].start > cursor) {
+            pending_.push_back(ByteRange(cursor, completed_[i].start));
+        }
+        cursor = (std::max)(cursor, completed_[i].end);
+    }
+    if (cursor < totalSize_) {
+        pending_.push_back(ByteRange(cursor, totalSize_));
+    }
+}
+
+SegmentAssignment SegmentScheduler::Next(int workerIndex, ByteRange& segment) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (failures_ >= AgentConstants::SEGMENT_MAX_FAILURES) {
+        return inFlight_ > 0 ? SEGMENT_WAIT : SEGMENT_FINISHED;
+    }
+
+    if (pending_.empty()) {
+        // A worker still in flight may fail and hand its tail back
+        return inFlight_ > 0 ? SEGMENT_WAIT : SEGMENT_FINISHED;
+    }
+
+    if (workerIndex >= activeWorkers_) {
+        return SEGMENT_WAIT;
+    }
+
+    ByteRange& front = pending_.front();
+    long long length = (std::min)(segmentSize_, front.Length());
+    segment = ByteRange(front.start, front.start + length);
+
+    front.start += length;
+    if (front.Length() <= 0) {
+        pending_.erase(pending_.begin());
+    }
+
+    inFlight_++;
+    return SEGMENT_ASSIGNED;
+}
+
+void SegmentScheduler::Complete(const ByteRange& written, long long elapsedMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    inFlight_--;
+    if (written.Length() > 0) {
+        AddCompleted(written);
+        Adapt(written.Length(), elapsedMs);
+    }
+}
+
+void SegmentScheduler::Fail(const ByteRange& written, const ByteRange& remainder) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    inFlight_--;
+    failures_++;
+
+    if (written.Length() > 0) {
+        AddCompleted(written);
+    }
+
+    // Retry the tail first so the file fills in order and checkpoints stay compact
+    if (remainder.Length() > 0) {
+        pending_.insert(pending_.begin(), remainder);
+    }
+
+    // Losing segments usually means the server or link is saturated: back off one worker
+    if (activeWorkers_ > 1) {
+        activeWorkers_--;
+    }
+}
+
+void SegmentScheduler::AddCompleted(const ByteRange& range) {
+    completed_.push_back(range);
+    std::sort(completed_.begin(), completed_.end(),
+        [](const ByteRange& a, const ByteRange& b) { return a.start < b.start; });
+
+    std::vector<ByteRange> merged;
+    for (size_t i = 0; i < completed_.size(); i++) {
+        if (!merged.empty() && completed_[i].start <= merged.back().end) {
+            merged.back().end = (std::max)(merged.back().end, completed_[i].end);
+        }
+        else {
+            merged.push_back(completed_[i]);
+        }
+    }
+    completed_.swap(merged);
+}
+
+void SegmentScheduler::Adapt(long long bytes, long long elapsedMs) {
+    if (elapsedMs < 1) {
+        elapsedMs = 1;
+    }
+
+    // Size segments so each takes roughly SEGMENT_TARGET_MS at the observed per-connection rate
+    double rate = (double)bytes / (double)elapsedMs;
+    perWorkerBytesPerMs_ = (perWorkerBytesPerMs_ == 0) ? rate : (perWorkerBytesPerMs_ * 0.7 + rate * 0.3);
+
+    long long target = (long long)(perWorkerBytesPerMs_ * AgentConstants::SEGMENT_TARGET_MS);
+    segmentSize_ = (std::max)((long long)AgentConstants::SEGMENT_MIN_BYTES,
+        (std::min)((long long)AgentConstants::SEGMENT_MAX_BYTES, target));
+
+    // Grow concurrency while the aggregate rate keeps improving, shrink when it falls off
+    windowBytes_ += bytes;
+    long long windowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - windowStart_).count();
+    if (windowMs < AgentConstants::SEGMENT_WINDOW_MS) {
+        return;
+    }
+
+    double aggregate = (double)windowBytes_ / (double)windowMs;
+    if (lastAggregateBytesPerMs_ == 0 || aggregate > lastAggregateBytesPerMs_ * 1.1) {
+        if (activeWorkers_ < maxWorkers_) {
+            activeWorkers_++;
+        }
+    }
+    else if (aggregate < lastAggregateBytesPerMs_ * 0.8 && activeWorkers_ > 1) {
+        activeWorkers_--;
+    }
+
+    lastAggregateBytesPerMs_ = aggregate;
+    windowBytes_ = 0;
+    windowStart_ = std::chrono::steady_clock::now();
+}
+
+bool SegmentScheduler::IsComplete() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_.size() == 1 && completed_[0].start == 0 && completed_[0].end >= totalSize_;
+}
+
+int SegmentScheduler::GetActiveWorkers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return activeWorkers_;
+}
+
+long long SegmentScheduler::GetSegmentSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segmentSize_;
+}
+
+std::vector<ByteRange> SegmentScheduler::GetCompletedRanges() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_;
+}
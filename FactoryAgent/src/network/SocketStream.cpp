@@ -0,0 +1,175 @@
+#ifndef _WIN32
+
+#include "../include/network/SocketStream.h"
+#include "../include/utilities/StringUtils.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstdlib>
+
+namespace {
+    const size_t MAX_LINE_LENGTH = 64 * 1024;
+    const int MAX_HEADER_LINES = 256;
+}
+
+SocketStream::SocketStream(int fd) : fd_(fd), begin_(0), end_(0), receivedAny_(false), peerClosed_(false),
+    bytesRead_(0), bytesWritten_(0) {
+}
+
+bool SocketStream::Fill() {
+    if (begin_ == end_) {
+        begin_ = 0;
+        end_ = 0;
+    }
+
+    while (true) {
+        ssize_t received = recv(fd_, buffer_ + end_, sizeof(buffer_) - end_, 0);
+        if (received > 0) {
+            end_ += (size_t)received;
+            bytesRead_ += (long long)received;
+            receivedAny_ = true;
+            return true;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        peerClosed_ = (received == 0);
+        return false;
+    }
+}
+
+bool SocketStream::ReadLine(std::string& line) {
+    line.clear();
+
+    while (true) {
+        for (size_t i = begin_; i < end_; i++) {
+            if (buffer_[i] == '\n') {
+                line.append(buffer_ + begin_, i - begin_);
+                begin_ = i + 1;
+                if (!line.empty() && line[line.length() - 1] == '\r') {
+                    line.erase(line.length() - 1);
+                }
+                return true;
+            }
+        }
+
+        line.append(buffer_ + begin_, end_ - begin_);
+        begin_ = end_;
+        if (line.length() > MAX_LINE_LENGTH || !Fill()) {
+            return false;
+        }
+    }
+}
+
+bool SocketStream::ReadHeaders(std::map<std::string, std::string>& headers) {
+    std::string line;
+    for (int i = 0; i < MAX_HEADER_LINES; i++) {
+        if (!ReadLine(line)) {
+            return false;
+        }
+        if (line.empty()) {
+            return true;
+        }
+
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            headers[StringUtils::ToLower(StringUtils::Trim(line.substr(0, colon)))] =
+                StringUtils::Trim(line.substr(colon + 1));
+        }
+    }
+    return false;
+}
+
+bool SocketStream::ReadExact(long long length, const BodySink& sink, bool& aborted) {
+    while (length > 0) {
+        if (begin_ == end_ && !Fill()) {
+            return false;
+        }
+
+        size_t available = end_ - begin_;
+        size_t take = ((long long)available < length) ? available : (size_t)length;
+        if (sink && !sink(buffer_ + begin_, take)) {
+            aborted = true;
+            return false;
+        }
+        begin_ += take;
+        length -= (long long)take;
+    }
+    return true;
+}
+
+bool SocketStream::ReadChunked(const BodySink& sink, bool& aborted) {
+    std::string line;
+    while (true) {
+        if (!ReadLine(line)) {
+            return false;
+        }
+
+        // Chunk extensions after ';' carry nothing we use
+        long long chunkSize = strtoll(line.c_str(), NULL, 16);
+        if (chunkSize < 0) {
+            return false;
+        }
+        if (chunkSize == 0) {
+            break;
+        }
+
+        if (!ReadExact(chunkSize, sink, aborted) || !ReadLine(line)) {
+            return false;
+        }
+    }
+
+    // Trailer section ends with a blank line
+    std::map<std::string, std::string> trailers;
+    return ReadHeaders(trailers);
+}
+
+bool SocketStream::ReadToClose(const BodySink& sink, bool& aborted) {
+    while (true) {
+        if (begin_ < end_) {
+            if (sink && !sink(buffer_ + begin_, end_ - begin_)) {
+                aborted = true;
+                return false;
+            }
+            begin_ = end_;
+        }
+        if (!Fill()) {
+            // An orderly shutdown is the normal end of a close-delimited body
+            return peerClosed_;
+        }
+    }
+}
+
+bool SocketStream::WriteAll(const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd_, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+        bytesWritten_ += (long long)sent;
+    }
+    return true;
+}
+
+bool SocketStream::WriteAll(const std::string& data) {
+    return WriteAll(data.data(), data.length());
+}
+
+bool SocketStream::ReceivedAny() const {
+    return receivedAny_;
+}
+
+long long SocketStream::GetBytesRead() const {
+    return bytesRead_;
+}
+
+long long SocketStream::GetBytesWritten() const {
+    return bytesWritten_;
+}
+
+#endif // _WIN32
@@ -0,0 +1,973 @@
+#ifndef _WIN32
+
+#include "../include/network/StandInServer.h"
+#include "../include/network/SocketStream.h"
+#include "../include/common/Constants.h"
+#include "../include/utilities/StringUtils.h"
+#include "../include/utilities/CompressionUtils.h"
+#include "../include/utilities/WireCodec.h"
+#include "../include/utilities/Sha256.h"
+#include "../include/utilities/LineDelta.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <cstdio>
+#include <chrono>
+#include <functional>
+
+/*
+ * StandInServer.cpp
+ * One thread per connection with HTTP/1.1 keep-alive. Response shapes follow
+ * AgentApiController (camelCase JSON). Uploads are counted and discarded so
+ * multi-GB transfers do not need multi-GB of memory on the server side.
+ */
+
+namespace {
+    const long long MAX_JSON_BODY_BYTES = 64LL * 1024 * 1024;
+    const size_t DOWNLOAD_WRITE_BYTES = 256 * 1024;
+    const int LISTEN_BACKLOG = 64;
+    const int CHANNEL_KEEPALIVE_MS = 3000;     // same cadence as AgentApiController
+
+    std::string Narrow(const wchar_t* text) {
+        std::wstring wide(text);
+        return std::string(wide.begin(), wide.end());
+    }
+
+    const char* ReasonPhrase(int status) {
+        switch (status) {
+        case 200: return "OK";
+        case 206: return "Partial Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 415: return "Unsupported Media Type";
+        case 416: return "Range Not Satisfiable";
+        default: return "Error";
+        }
+    }
+}
+
+StandInServer::StandInServer() : listenFd_(-1), port_(0), running_(false), channelEnabled_(true),
+    binaryEncodings_(true), replyDelayMs_(0), downloadRoundTripMs_(0), downloadAllowance_(-1),
+    rangeAlignment_(0) {
+    pendingCommands_ = json::array();
+    SetModelPayload("");
+}
+
+StandInServer::~StandInServer() {
+    Stop();
+}
+
+bool StandInServer::Start(int port) {
+    if (running_) {
+        return true;
+    }
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short)port);
+
+    if (bind(listenFd_, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listenFd_, LISTEN_BACKLOG) != 0) {
+        close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(listenFd_, (struct sockaddr*)&address, &length);
+    port_ = ntohs(address.sin_port);
+
+    running_ = true;
+    acceptThread_ = std::thread(&StandInServer::AcceptLoop, this);
+    return true;
+}
+
+void StandInServer::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    // shutdown() wakes the blocked accept() and every recv() on open connections
+    shutdown(listenFd_, SHUT_RDWR);
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+    close(listenFd_);
+    listenFd_ = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::set<int>::iterator it;
+        for (it = openConnections_.begin(); it != openConnections_.end(); ++it) {
+            shutdown(*it, SHUT_RDWR);
+        }
+    }
+    // Open command channels are waiting for a command, not on their socket
+    commandQueued_.notify_all();
+
+    // The accept thread is gone, so nothing else touches the thread list now
+    for (size_t i = 0; i < connectionThreads_.size(); i++) {
+        if (connectionThreads_[i].joinable()) {
+            connectionThreads_[i].join();
+        }
+    }
+    connectionThreads_.clear();
+}
+
+int StandInServer::GetPort() const {
+    return port_;
+}
+
+std::wstring StandInServer::GetBaseUrl() const {
+    return L"http://127.0.0.1:" + std::to_wstring(port_);
+}
+
+void StandInServer::SetModelPayload(const std::string& payload) {
+    std::shared_ptr<Payload> entity(new Payload());
+    entity->data = payload;
+    entity->digest = Sha256::HashString(payload);
+    entity->etag = "\"" + entity->digest + "\"";
+
+    char date[64];
+    time_t now = time(NULL);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+    entity->lastModified = date;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    payload_ = entity;
+}
+
+void StandInServer::QueueCommand(const json& command) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingCommands_.push_back(command);
+    }
+    commandQueued_.notify_all();
+}
+
+void StandInServer::SetCommandChannelEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    channelEnabled_ = enabled;
+}
+
+void StandInServer::SetBinaryEncodingsEnabled(bool enabled) {
+    binaryEncodings_ = enabled;
+}
+
+void StandInServer::SetReplyDelay(int milliseconds) {
+    replyDelayMs_ = milliseconds;
+}
+
+void StandInServer::SetDownloadRoundTrip(int milliseconds) {
+    downloadRoundTripMs_ = milliseconds;
+}
+
+void StandInServer::SetDownloadCutoff(long long bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    downloadAllowance_ = bytes;
+}
+
+void StandInServer::SetRangeAlignment(long long bytes) {
+    rangeAlignment_ = bytes;
+}
+
+std::map<std::string, StandInEndpointStats> StandInServer::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::vector<json> StandInServer::GetCommandResults() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return commandResults_;
+}
+
+std::string StandInServer::GetConfigContent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return configContent_;
+}
+
+std::string StandInServer::GetLogStructure() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return logStructure_;
+}
+
+std::map<std::string, std::string> StandInServer::GetAssembledModel(const std::string& modelName) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::map<std::string, std::string> >::const_iterator found =
+        assembledModels_.find(modelName);
+    return found != assembledModels_.end() ? found->second : std::map<std::string, std::string>();
+}
+
+void StandInServer::DropChunks() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunks_.clear();
+}
+
+json StandInServer::StoreChunkBatch(const std::string& body, int& status) {
+    json reply;
+    reply["success"] = true;
+
+    // Records of "<hash> <length>\n<bytes>"; a chunk is only kept when its bytes hash to its name
+    std::map<std::string, std::string> received;
+    size_t position = 0;
+    while (position < body.length()) {
+        size_t newline = body.find('\n', position);
+        size_t space = body.find(' ', position);
+        if (newline == std::string::npos || space == std::string::npos || space > newline) {
+            status = AgentConstants::HTTP_BAD_REQUEST;
+            break;
+        }
+
+        std::string hash = body.substr(position, space - position);
+        unsigned long long length = strtoull(body.c_str() + space + 1, NULL, 10);
+        position = newline + 1;
+        if (length > body.length() - position) {
+            status = AgentConstants::HTTP_BAD_REQUEST;
+            break;
+        }
+
+        std::string data = body.substr(position, (size_t)length);
+        position += (size_t)length;
+        if (Sha256::HashString(data) != hash) {
+            status = AgentConstants::HTTP_BAD_REQUEST;
+            break;
+        }
+        received[hash].swap(data);
+    }
+
+    if (status != AgentConstants::HTTP_OK) {
+        reply["success"] = false;
+        reply["message"] = "Malformed chunk batch";
+        return reply;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::map<std::string, std::string>::iterator it = received.begin(); it != received.end(); ++it) {
+        chunks_[it->first].swap(it->second);
+    }
+    reply["stored"] = (int)received.size();
+    return reply;
+}
+
+json StandInServer::AssembleModel(const json& manifest) {
+    json reply;
+    reply["success"] = false;
+    reply["missing"] = json::array();
+
+    if (!manifest.contains("files") || !manifest["files"].is_array()) {
+        reply["message"] = "Malformed manifest";
+        return reply;
+    }
+
+    std::map<std::string, std::string> files;
+    const json& entries = manifest["files"];
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::string content;
+        const json& hashes = entries[i]["chunks"];
+        for (size_t c = 0; c < hashes.size(); c++) {
+            std::map<std::string, std::string>::const_iterator chunk = chunks_.find(hashes[c].get<std::string>());
+            if (chunk == chunks_.end()) {
+                reply["missing"].push_back(hashes[c]);
+                continue;
+            }
+            content += chunk->second;
+        }
+        files[entries[i].value("path", "")].swap(content);
+    }
+
+    if (!reply["missing"].empty()) {
+        reply["message"] = "Chunks missing";
+        return reply;
+    }
+
+    assembledModels_[manifest.value("modelName", "")].swap(files);
+    reply["success"] = true;
+    reply.erase("missing");
+    return reply;
+}
+
+bool StandInServer::StoreConfigSection(const json& section) {
+    if (section.contains("configContent") && section["configContent"].is_string()) {
+        configContent_ = section["configContent"].get<std::string>();
+        return true;
+    }
+
+    // Same checks as the real server: the base must be our copy and the result must hash right
+    std::string updated;
+    if (section.value("baseHash", "") != Sha256::HashString(configContent_) ||
+        !section.contains("ops") || !LineDelta::Apply(configContent_, section["ops"], updated) ||
+        Sha256::HashString(updated) != section.value("hash", "")) {
+        return false;
+    }
+    configContent_.swap(updated);
+    return true;
+}
+
+bool StandInServer::StoreLogSection(const json& section) {
+    if (section.contains("logStructureJson") && section["logStructureJson"].is_string()) {
+        logStructure_ = section["logStructureJson"].get<std::string>();
+        logVersion_ = section.value("version", "");
+        return true;
+    }
+
+    // Same rules as the real server: ops apply only to the version named as their base
+    std::string version = section.value("version", "");
+    if (logVersion_.empty() || section.value("baseVersion", "") != logVersion_ || version.empty() ||
+        !section.contains("ops") || !section["ops"].is_array()) {
+        return false;
+    }
+
+    json tree = json::parse(logStructure_.empty() ? "[]" : logStructure_, nullptr, false);
+    if (!tree.is_array()) {
+        return false;
+    }
+
+    const json& ops = section["ops"];
+    for (size_t i = 0; i < ops.size(); i++) {
+        std::string op = ops[i].value("op", "");
+        std::string path = op == "remove" ? ops[i].value("path", "") :
+            (ops[i].contains("node") ? ops[i]["node"].value("path", "") : "");
+
+        std::vector<std::string> segments;
+        std::string segment;
+        for (size_t c = 0; c <= path.size(); c++) {
+            if (c == path.size() || path[c] == '\\' || path[c] == '/') {
+                if (!segment.empty()) {
+                    segments.push_back(segment);
+                }
+                segment.clear();
+            }
+            else {
+                segment += path[c];
+            }
+        }
+        if (segments.empty()) {
+            return false;
+        }
+
+        json* siblings = &tree;
+        for (size_t s = 0; s + 1 < segments.size(); s++) {
+            json* next = NULL;
+            for (size_t n = 0; n < siblings->size(); n++) {
+                json& node = (*siblings)[n];
+                if (node.value("name", "") == segments[s] && node.value("isDirectory", false) &&
+                    node.contains("children") && node["children"].is_array()) {
+                    next = &node["children"];
+                    break;
+                }
+            }
+            if (!next) {
+                return false;
+            }
+            siblings = next;
+        }
+
+        const std::string& name = segments.back();
+        size_t index = 0;
+        while (index < siblings->size() && (*siblings)[index].value("name", "") != name) {
+            index++;
+        }
+        bool found = index < siblings->size();
+
+        if (op == "add" || op == "modify") {
+            if (found) {
+                (*siblings)[index] = ops[i]["node"];
+            }
+            else if (op == "add") {
+                size_t position = 0;
+                while (position < siblings->size() && (*siblings)[position].value("name", "") < name) {
+                    position++;
+                }
+                siblings->insert(siblings->begin() + position, ops[i]["node"]);
+            }
+            else {
+                return false;
+            }
+        }
+        else if (op == "remove" && found) {
+            siblings->erase(siblings->begin() + index);
+        }
+        else {
+            return false;
+        }
+    }
+
+    logStructure_ = tree.dump();
+    logVersion_ = version;
+    return true;
+}
+
+void StandInServer::Record(const std::string& endpoint, long long bytesIn, long long bytesOut) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    StandInEndpointStats& stats = stats_[endpoint];
+    stats.requests++;
+    stats.bytesIn += bytesIn;
+    stats.bytesOut += bytesOut;
+}
+
+void StandInServer::AcceptLoop() {
+    while (running_) {
+        int fd = accept(listenFd_, NULL, NULL);
+        if (fd < 0) {
+            if (running_ && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        openConnections_.insert(fd);
+        connectionThreads_.push_back(std::thread(&StandInServer::ServeConnection, this, fd));
+    }
+}
+
+void StandInServer::ServeConnection(int fd) {
+    SocketStream stream(fd);
+
+    while (running_) {
+        Request request;
+        bool keepAlive = true;
+        if (!ReadRequest(stream, request, keepAlive)) {
+            break;
+        }
+        if (!HandleRequest(stream, request, keepAlive) || !keepAlive) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    openConnections_.erase(fd);
+    close(fd);
+}
+
+bool StandInServer::ReadRequest(SocketStream& stream, Request& request, bool& keepAlive) {
+    std::string line;
+    do {
+        if (!stream.ReadLine(line)) {
+            return false;
+        }
+    } while (line.empty());
+
+    std::vector<std::string> parts = StringUtils::Split(line, ' ');
+    if (parts.size() != 3) {
+        return false;
+    }
+    request.method = parts[0];
+    request.path = parts[1];
+    const std::string& version = parts[2];
+
+    // WinHTTP sends absolute URLs when the agent passes one as the object name
+    size_t scheme = request.path.find("://");
+    if (scheme != std::string::npos) {
+        size_t pathStart = request.path.find('/', scheme + 3);
+        request.path = (pathStart != std::string::npos) ? request.path.substr(pathStart) : "/";
+    }
+    size_t query = request.path.find('?');
+    if (query != std::string::npos) {
+        request.path.erase(query);
+    }
+
+    if (!stream.ReadHeaders(request.headers)) {
+        return false;
+    }
+
+    std::string connection = StringUtils::ToLower(request.headers["connection"]);
+    keepAlive = (version == "HTTP/1.1") ? (connection != "close") : (connection == "keep-alive");
+
+    // Uploads are only counted; everything else is a JSON body that gets parsed
+    bool discard = StringUtils::StartsWith(request.path, "/api/agent/upload");
+    request.wireBytes = 0;
+    request.malformed = false;
+    BodySink sink = [&request, discard](const char* data, size_t length) {
+        request.wireBytes += (long long)length;
+        if (discard) {
+            return true;
+        }
+        if ((long long)(request.body.length() + length) > MAX_JSON_BODY_BYTES) {
+            return false;
+        }
+        request.body.append(data, length);
+        return true;
+    };
+
+    bool aborted = false;
+    std::string transferEncoding = StringUtils::ToLower(request.headers["transfer-encoding"]);
+    std::string contentLength = request.headers["content-length"];
+    if (transferEncoding.find("chunked") != std::string::npos) {
+        if (!stream.ReadChunked(sink, aborted)) {
+            return false;
+        }
+    }
+    else if (!contentLength.empty()) {
+        if (!stream.ReadExact(strtoll(contentLength.c_str(), NULL, 10), sink, aborted)) {
+            return false;
+        }
+    }
+
+    if (StringUtils::ToLower(request.headers["content-encoding"]) == "gzip" && !request.body.empty()) {
+        std::string decoded;
+        if (CompressionUtils::GzipDecompress(request.body, decoded)) {
+            request.body.swap(decoded);
+        }
+        else {
+            request.malformed = true;
+        }
+    }
+
+    return true;
+}
+
+bool StandInServer::HandleRequest(SocketStream& stream, const Request& request, bool keepAlive) {
+    std::string downloadPrefix = Narrow(AgentConstants::ENDPOINT_DOWNLOAD_MODEL);
+    if (request.method == "GET" && StringUtils::StartsWith(request.path, downloadPrefix)) {
+        long long bytesOut = 0;
+        bool sent = SendDownload(stream, request, keepAlive, bytesOut);
+        Record(downloadPrefix, request.wireBytes, bytesOut);
+        return sent;
+    }
+
+    std::string channelPath = Narrow(AgentConstants::ENDPOINT_COMMAND_CHANNEL);
+    if (request.method == "POST" && request.path == channelPath) {
+        long long bytesOut = 0;
+        bool sent = SendCommandChannel(stream, request, keepAlive, bytesOut);
+        Record(channelPath, request.wireBytes, bytesOut);
+        return sent;
+    }
+
+    int status = request.malformed ? AgentConstants::HTTP_BAD_REQUEST : AgentConstants::HTTP_OK;
+    bool chunkBatch = request.path == Narrow(AgentConstants::ENDPOINT_MODEL_CHUNKS);
+    json body;
+    std::string requestType = StringUtils::ToLower(
+        request.headers.count("content-type") ? request.headers.find("content-type")->second : "");
+    bool binaryRequest = requestType.find(AgentConstants::CONTENT_TYPE_CBOR) != std::string::npos ||
+        requestType.find(AgentConstants::CONTENT_TYPE_MSGPACK) != std::string::npos;
+    if (status == AgentConstants::HTTP_OK && binaryRequest && !binaryEncodings_) {
+        status = AgentConstants::HTTP_UNSUPPORTED_MEDIA_TYPE;
+    }
+    if (status == AgentConstants::HTTP_OK && !request.body.empty() && !chunkBatch) {
+        if (!WireCodec::Decode(request.body, requestType, body)) {
+            status = AgentConstants::HTTP_BAD_REQUEST;
+        }
+    }
+
+    json reply;
+    if (status == AgentConstants::HTTP_OK && chunkBatch) {
+        reply = StoreChunkBatch(request.body, status);
+    }
+    else if (status == AgentConstants::HTTP_OK) {
+        reply = HandleJson(request.path, body, status);
+    }
+    else {
+        reply["success"] = false;
+        reply["message"] = status == AgentConstants::HTTP_UNSUPPORTED_MEDIA_TYPE ?
+            "Unsupported media type" : "Malformed request body";
+    }
+
+    if (replyDelayMs_ > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(replyDelayMs_.load()));
+    }
+
+    // Answer in a binary encoding only when the client listed it in Accept and this build speaks it
+    std::string accept = StringUtils::ToLower(
+        binaryEncodings_ && request.headers.count("accept") ? request.headers.find("accept")->second : "");
+    WireEncoding encoding = WIRE_ENCODING_JSON;
+    if (accept.find(AgentConstants::CONTENT_TYPE_CBOR) != std::string::npos) {
+        encoding = WIRE_ENCODING_CBOR;
+    }
+    else if (accept.find(AgentConstants::CONTENT_TYPE_MSGPACK) != std::string::npos) {
+        encoding = WIRE_ENCODING_MSGPACK;
+    }
+
+    std::string text;
+    WireCodec::Encode(reply, encoding, text);
+    std::vector<std::pair<std::string, std::string> > headers;
+
+    std::string acceptEncoding = StringUtils::ToLower(
+        request.headers.count("accept-encoding") ? request.headers.find("accept-encoding")->second : "");
+    if (acceptEncoding.find("gzip") != std::string::npos &&
+        (int)text.size() >= AgentConstants::COMPRESSION_MIN_BYTES) {
+        std::string compressed;
+        if (CompressionUtils::GzipCompress(text, compressed)) {
+            text.swap(compressed);
+            headers.push_back(std::make_pair(std::string("Content-Encoding"), std::string("gzip")));
+        }
+    }
+
+    std::string contentType = encoding == WIRE_ENCODING_JSON ?
+        std::string("application/json; charset=utf-8") : std::string(WireCodec::ContentType(encoding));
+    std::string response = BuildHead(status, contentType,
+        (long long)text.length(), headers, keepAlive) + text;
+    // Counted before the reply goes out, so a client that has its answer also sees it in GetStats
+    Record(request.path, request.wireBytes, (long long)text.length());
+    return stream.WriteAll(response);
+}
+
+json StandInServer::HandleJson(const std::string& endpoint, const json& body, int& status) {
+    json reply;
+    reply["success"] = true;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (endpoint == Narrow(AgentConstants::ENDPOINT_REGISTER)) {
+        // Re-registering the same line/PC keeps its id, like the real server
+        std::string key = std::to_string(body.value("lineNumber", 0)) + "-" +
+            std::to_string(body.value("pcNumber", 0));
+        if (registeredPcs_.count(key) == 0) {
+            int nextId = (int)registeredPcs_.size() + 1;
+            registeredPcs_[key] = nextId;
+        }
+        reply["pcId"] = registeredPcs_[key];
+
+        // Registration brings the tree without a version, as on the real server
+        if (body.contains("logStructureJson") && body["logStructureJson"].is_string()) {
+            logStructure_ = body["logStructureJson"].get<std::string>();
+            logVersion_.clear();
+        }
+
+        // First encoding from the agent's preference list that this server also speaks
+        if (binaryEncodings_ && body.contains("supportedEncodings") && body["supportedEncodings"].is_array()) {
+            for (size_t i = 0; i < body["supportedEncodings"].size(); i++) {
+                WireEncoding encoding;
+                if (body["supportedEncodings"][i].is_string() &&
+                    WireCodec::FromName(body["supportedEncodings"][i].get<std::string>(), encoding)) {
+                    reply["wireEncoding"] = WireCodec::Name(encoding);
+                    break;
+                }
+            }
+        }
+        reply["features"] = json::array({ AgentConstants::FEATURE_CONFIG_DELTA, AgentConstants::FEATURE_LOG_DELTA });
+        if (channelEnabled_) {
+            reply["features"].push_back(AgentConstants::FEATURE_COMMAND_CHANNEL);
+        }
+        reply["message"] = "Registration successful";
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_HEARTBEAT)) {
+        // An agent with its channel open gets commands there only
+        if (body.value("commandsOnChannel", false)) {
+            reply["hasPendingCommands"] = false;
+            reply["commands"] = json::array();
+        }
+        else {
+            reply["hasPendingCommands"] = !pendingCommands_.empty();
+            reply["commands"] = pendingCommands_;
+            pendingCommands_ = json::array();
+        }
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_COMMAND_RESULT)) {
+        commandResults_.push_back(body);
+        reply["message"] = "Command result recorded";
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_COMMAND_RESULTS)) {
+        // Recorded as received, replays included, so a test can count duplicates on the wire
+        if (body.contains("results") && body["results"].is_array()) {
+            for (size_t i = 0; i < body["results"].size(); i++) {
+                commandResults_.push_back(body["results"][i]);
+            }
+        }
+        reply["message"] = "Command results recorded";
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_UPDATE_CONFIG) ||
+        endpoint == Narrow(AgentConstants::ENDPOINT_UPDATE_CONFIG_DELTA)) {
+        if (!StoreConfigSection(body)) {
+            reply["success"] = false;
+            reply["needFull"] = true;
+            reply["message"] = "Config base does not match";
+        }
+        else {
+            reply["message"] = "Config updated successfully";
+        }
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_SYNC_LOGS) ||
+        endpoint == Narrow(AgentConstants::ENDPOINT_SYNC_LOGS_DELTA)) {
+        if (!StoreLogSection(body)) {
+            reply["success"] = false;
+            reply["needFull"] = true;
+            reply["message"] = "Log tree base does not match";
+        }
+        else {
+            reply["message"] = "Log structure synced";
+        }
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_UPDATE_LOG) ||
+        endpoint == Narrow(AgentConstants::ENDPOINT_SYNC_MODELS)) {
+        reply["message"] = "Synced";
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_SYNC_BATCH)) {
+        const char* sections[] = { "config", "logs", "models" };
+        reply["acks"] = json::object();
+        for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+            if (body.contains(sections[i])) {
+                reply["acks"][sections[i]] = true;
+            }
+        }
+        reply["needFull"] = json::array();
+        if (body.contains("config") && !StoreConfigSection(body["config"])) {
+            reply["acks"]["config"] = false;
+            reply["needFull"].push_back("config");
+        }
+        if (body.contains("logs") && !StoreLogSection(body["logs"])) {
+            reply["acks"]["logs"] = false;
+            reply["needFull"].push_back("logs");
+        }
+        reply["message"] = "Batch synced";
+    }
+    else if (endpoint == Narrow(AgentConstants::ENDPOINT_MODEL_CHUNKS_MISSING)) {
+        reply["missing"] = json::array();
+        if (body.contains("hashes") && body["hashes"].is_array()) {
+            for (size_t i = 0; i < body["hashes"].size(); i++) {
+                if (body["hashes"][i].is_string() && chunks_.count(body["hashes"][i].get<std::string>()) == 0) {
+                    reply["missing"].push_back(body["hashes"][i]);
+                }
+            }
+        }
+    }
+    else if (StringUtils::StartsWith(endpoint, "/api/ModelLibrary/receive-chunked/")) {
+        reply = AssembleModel(body);
+    }
+    else if (StringUtils::StartsWith(endpoint, "/api/agent/upload")) {
+        reply["message"] = "Model file uploaded successfully";
+        reply["data"]["modelFileId"] = 1;
+    }
+    else if (StringUtils::StartsWith(endpoint, "/api/agent/getconfigupdate")) {
+        reply["message"] = "No pending update";
+        reply["data"] = nullptr;
+    }
+    else {
+        status = AgentConstants::HTTP_NOT_FOUND;
+        reply["success"] = false;
+        reply["message"] = "Not found";
+    }
+
+    return reply;
+}
+
+bool StandInServer::SendDownload(SocketStream& stream, const Request& request, bool keepAlive,
+    long long& bytesOut) {
+    std::shared_ptr<const Payload> entity;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entity = payload_;
+    }
+
+    long long size = (long long)entity->data.length();
+    long long start = 0;
+    long long end = size;
+    int status = AgentConstants::HTTP_OK;
+
+    std::vector<std::pair<std::string, std::string> > headers;
+    headers.push_back(std::make_pair(std::string("ETag"), entity->etag));
+    headers.push_back(std::make_pair(std::string("Accept-Ranges"), std::string("bytes")));
+    headers.push_back(std::make_pair(std::string(AgentConstants::HEADER_CONTENT_SHA256), entity->digest));
+    headers.push_back(std::make_pair(std::string("Last-Modified"), entity->lastModified));
+
+    // Preconditions come before ranges: If-None-Match wins, If-Modified-Since only without it
+    std::map<std::string, std::string>::const_iterator ifNoneMatch = request.headers.find("if-none-match");
+    std::map<std::string, std::string>::const_iterator ifModifiedSince = request.headers.find("if-modified-since");
+    bool notModified = (ifNoneMatch != request.headers.end()) ?
+        ifNoneMatch->second.find(entity->etag) != std::string::npos :
+        (ifModifiedSince != request.headers.end() && ifModifiedSince->second == entity->lastModified);
+    if (notModified) {
+        return stream.WriteAll(BuildHead(AgentConstants::HTTP_NOT_MODIFIED,
+            "application/octet-stream", 0, headers, keepAlive));
+    }
+
+    std::map<std::string, std::string>::const_iterator range = request.headers.find("range");
+    std::map<std::string, std::string>::const_iterator ifRange = request.headers.find("if-range");
+    bool rangeApplies = range != request.headers.end() && StringUtils::StartsWith(range->second, "bytes=") &&
+        (ifRange == request.headers.end() || ifRange->second == entity->etag);
+
+    if (rangeApplies) {
+        std::string spec = range->second.substr(6);
+        size_t dash = spec.find('-');
+        if (dash != std::string::npos) {
+            std::string first = spec.substr(0, dash);
+            std::string last = spec.substr(dash + 1);
+
+            if (first.empty()) {
+                long long suffix = strtoll(last.c_str(), NULL, 10);
+                start = (suffix < size) ? size - suffix : 0;
+            }
+            else {
+                start = strtoll(first.c_str(), NULL, 10);
+                if (!last.empty()) {
+                    long long lastByte = strtoll(last.c_str(), NULL, 10);
+                    end = (lastByte + 1 < size) ? lastByte + 1 : size;
+                }
+                long long alignment = rangeAlignment_;
+                if (alignment > 0) {
+                    start -= start % alignment;
+                }
+            }
+
+            if (start >= size || start >= end) {
+                headers.push_back(std::make_pair(std::string("Content-Range"), "bytes */" + std::to_string(size)));
+                return stream.WriteAll(BuildHead(AgentConstants::HTTP_RANGE_NOT_SATISFIABLE,
+                    "application/octet-stream", 0, headers, keepAlive));
+            }
+
+            status = AgentConstants::HTTP_PARTIAL_CONTENT;
+            headers.push_back(std::make_pair(std::string("Content-Range"), "bytes " + std::to_string(start) + "-" +
+                std::to_string(end - 1) + "/" + std::to_string(size)));
+        }
+    }
+
+    int roundTripMs = downloadRoundTripMs_;
+    if (roundTripMs > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(roundTripMs));
+    }
+    if (!stream.WriteAll(BuildHead(status, "application/octet-stream", end - start, headers, keepAlive))) {
+        return false;
+    }
+
+    const char* data = entity->data.data();
+    for (long long offset = start; offset < end;) {
+        size_t chunk = (size_t)((end - offset) < (long long)DOWNLOAD_WRITE_BYTES ? (end - offset) : DOWNLOAD_WRITE_BYTES);
+        bool cut = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (downloadAllowance_ >= 0) {
+                cut = downloadAllowance_ < (long long)chunk;
+                chunk = cut ? (size_t)downloadAllowance_ : chunk;
+                downloadAllowance_ -= (long long)chunk;
+            }
+        }
+        if (!stream.WriteAll(data + offset, chunk)) {
+            return false;
+        }
+        offset += (long long)chunk;
+        bytesOut += (long long)chunk;
+        if (cut) {
+            // Returning false closes the connection short of the promised Content-Length
+            return false;
+        }
+        if (roundTripMs > 0 && offset < end) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(roundTripMs));
+        }
+    }
+
+    return true;
+}
+
+bool StandInServer::SendCommandChannel(SocketStream& stream, const Request& request, bool keepAlive,
+    long long& bytesOut) {
+    json body;
+    std::string contentType = request.headers.count("content-type") ?
+        request.headers.find("content-type")->second : "";
+    int holdSeconds = 0;
+    if (!request.malformed && WireCodec::Decode(request.body, contentType, body) && body.is_object()) {
+        holdSeconds = body.value("holdSeconds", 0);
+    }
+    if (holdSeconds <= 0) {
+        holdSeconds = AgentConstants::COMMAND_CHANNEL_HOLD_SECONDS;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!channelEnabled_) {
+            std::vector<std::pair<std::string, std::string> > none;
+            return stream.WriteAll(BuildHead(AgentConstants::HTTP_NOT_FOUND, "text/plain", 0, none, keepAlive));
+        }
+    }
+
+    std::string head = "HTTP/1.1 200 OK\r\n";
+    head += std::string("Content-Type: ") + AgentConstants::CONTENT_TYPE_NDJSON + "\r\n";
+    head += "Transfer-Encoding: chunked\r\n";
+    if (!keepAlive) {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+
+    // One chunk per write, so every line reaches the agent as soon as it is written
+    std::function<bool(const std::string&)> writeChunk = [&](const std::string& data) {
+        char size[32];
+        snprintf(size, sizeof(size), "%zx\r\n", data.size());
+        bytesOut += (long long)data.size();
+        return stream.WriteAll(std::string(size) + data + "\r\n");
+    };
+
+    if (!stream.WriteAll(head) || !writeChunk("\n")) {
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(holdSeconds);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_ && std::chrono::steady_clock::now() < deadline) {
+        if (!pendingCommands_.empty()) {
+            json message;
+            message["commands"] = pendingCommands_;
+            pendingCommands_ = json::array();
+
+            lock.unlock();
+            bool written = writeChunk(message.dump() + "\n");
+            lock.lock();
+            if (!written) {
+                return false;
+            }
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point wake = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(CHANNEL_KEEPALIVE_MS);
+        if (wake > deadline) {
+            wake = deadline;
+        }
+        bool queued = commandQueued_.wait_until(lock, wake, [this]() {
+            return !running_ || !pendingCommands_.empty();
+        });
+
+        if (!queued && std::chrono::steady_clock::now() < deadline) {
+            lock.unlock();
+            bool written = writeChunk("\n");
+            lock.lock();
+            if (!written) {
+                return false;
+            }
+        }
+    }
+    lock.unlock();
+
+    return stream.WriteAll("0\r\n\r\n");
+}
+
+std::string StandInServer::BuildHead(int status, const std::string& contentType, long long contentLength,
+    const std::vector<std::pair<std::string, std::string> >& headers, bool keepAlive) {
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " + ReasonPhrase(status) + "\r\n";
+    head += "Content-Type: " + contentType + "\r\n";
+    head += "Content-Length: " + std::to_string(contentLength) + "\r\n";
+    for (size_t i = 0; i < headers.size(); i++) {
+        head += headers[i].first + ": " + headers[i].second + "\r\n";
+    }
+    if (!keepAlive) {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+    return head;
+}
+
+#endif // _WIN32
@@ -0,0 +1,260 @@
+#ifdef _WIN32
+
+#include "../include/network/WinHttpTransport.h"
+#include "../include/utilities/StringUtils.h"
+#include <vector>
+#include <chrono>
+
+WinHttpTransport::WinHttpTransport() {
+    connectionPool_ = new ConnectionPool();
+}
+
+WinHttpTransport::~WinHttpTransport() {
+    delete connectionPool_;
+}
+
+ConnectionStats WinHttpTransport::GetStats() const {
+    return connectionPool_->GetStats();
+}
+
+std::wstring WinHttpTransport::BuildHeaders(const TransportRequest& request, long long bodyLength,
+    DWORD& declaredLength) {
+    std::wstring headers;
+    for (size_t i = 0; i < request.headers.size(); i++) {
+        const std::string& name = request.headers[i].first;
+        const std::string& value = request.headers[i].second;
+        headers += std::wstring(name.begin(), name.end()) + L": " +
+            std::wstring(value.begin(), value.end()) + L"\r\n";
+    }
+
+    // WinHttpSendRequest takes a 32-bit total length; larger bodies carry an explicit header instead
+    declaredLength = (DWORD)bodyLength;
+    if (bodyLength > MAXDWORD) {
+        headers += L"Content-Length: " + std::to_wstring(bodyLength) + L"\r\n";
+        declaredLength = WINHTTP_IGNORE_REQUEST_TOTAL_LENGTH;
+    }
+
+    return headers;
+}
+
+bool WinHttpTransport::WriteStreamedBody(HINTERNET hRequest, const TransportRequest& request) {
+    long long offset = 0;
+    while (offset < request.bodyLength) {
+        const char* data = NULL;
+        size_t length = 0;
+        if (!request.bodySource(offset, data, length) || !data || length == 0) {
+            return false;
+        }
+
+        // WinHttpWriteData takes a DWORD, so oversized windows go out in slices
+        size_t sent = 0;
+        while (sent < length) {
+            DWORD slice = (DWORD)((length - sent) < MAXDWORD ? (length - sent) : MAXDWORD);
+            DWORD written = 0;
+            if (!WinHttpWriteData(hRequest, data + sent, slice, &written)) {
+                return false;
+            }
+            sent += written;
+        }
+        offset += (long long)length;
+    }
+    return true;
+}
+
+bool WinHttpTransport::ReadHeaders(HINTERNET hRequest, TransportResponse& response) {
+    DWORD statusCode = 0;
+    DWORD size = sizeof(statusCode);
+    if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+        WINHTTP_HEADER_NAME_BY_INDEX, &statusCode, &size, WINHTTP_NO_HEADER_INDEX)) {
+        return false;
+    }
+    response.statusCode = (int)statusCode;
+
+    size = 0;
+    WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX,
+        WINHTTP_NO_OUTPUT_BUFFER, &size, WINHTTP_NO_HEADER_INDEX);
+    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || size == 0) {
+        return true;
+    }
+
+    std::wstring raw(size / sizeof(wchar_t), L'\0');
+    if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_RAW_HEADERS_CRLF, WINHTTP_HEADER_NAME_BY_INDEX,
+        &raw[0], &size, WINHTTP_NO_HEADER_INDEX)) {
+        return true;
+    }
+    raw.resize(size / sizeof(wchar_t));
+
+    // First line is the status line; the rest are "Name: value"
+    std::string text(raw.begin(), raw.end());
+    size_t lineStart = text.find("\r\n");
+    while (lineStart != std::string::npos) {
+        lineStart += 2;
+        size_t lineEnd = text.find("\r\n", lineStart);
+        std::string line = text.substr(lineStart,
+            (lineEnd == std::string::npos ? text.length() : lineEnd) - lineStart);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            response.headers[StringUtils::ToLower(StringUtils::Trim(line.substr(0, colon)))] =
+                StringUtils::Trim(line.substr(colon + 1));
+        }
+        lineStart = lineEnd;
+    }
+
+    return true;
+}
+
+long long WinHttpTransport::MicrosBetween(const std::chrono::steady_clock::time_point& from,
+    const std::chrono::steady_clock::time_point& to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+void WinHttpTransport::ReadPhaseTimes(HINTERNET hRequest, TransportTimings& timings) {
+#ifdef WINHTTP_OPTION_REQUEST_TIMES
+    // Windows 10 2004+ splits the send into DNS, TCP and TLS phases; older systems fail the
+    // query and those phases stay folded into firstByte
+    WINHTTP_REQUEST_TIMES times;
+    ZeroMemory(&times, sizeof(times));
+    DWORD size = sizeof(times);
+    if (!WinHttpQueryOption(hRequest, WINHTTP_OPTION_REQUEST_TIMES, &times, &size)) {
+        return;
+    }
+
+    timings.resolveMicros = PhaseMicros(times, WinHttpNameResolutionStart, WinHttpNameResolutionEnd);
+    timings.connectMicros = PhaseMicros(times, WinHttpConnectionEstablishmentStart,
+        WinHttpConnectionEstablishmentEnd);
+    timings.tlsMicros = PhaseMicros(times, WinHttpTlsHandshakeClientLeg1Start, WinHttpTlsHandshakeClientLeg3End);
+#endif
+}
+
+#ifdef WINHTTP_OPTION_REQUEST_TIMES
+long long WinHttpTransport::PhaseMicros(const WINHTTP_REQUEST_TIMES& times, int startIndex, int endIndex) {
+    // Entries are in 100 ns ticks; a phase that did not happen (reused socket, plain HTTP) is zero
+    if ((ULONG)endIndex >= times.cTimes || times.rgullTimes[startIndex] == 0 ||
+        times.rgullTimes[endIndex] < times.rgullTimes[startIndex]) {
+        return 0;
+    }
+    return (long long)((times.rgullTimes[endIndex] - times.rgullTimes[startIndex]) / 10);
+}
+#endif
+
+bool WinHttpTransport::ReadBody(HINTERNET hRequest, const BodySink& sink, bool& aborted,
+    TransportTimings& timings) {
+    DWORD size = 0;
+    std::vector<char> buffer;
+
+    do {
+        size = 0;
+        if (!WinHttpQueryDataAvailable(hRequest, &size)) {
+            return false;
+        }
+        if (size > 0) {
+            buffer.resize(size);
+            DWORD downloaded = 0;
+            if (!WinHttpReadData(hRequest, buffer.data(), size, &downloaded)) {
+                return false;
+            }
+            timings.bytesReceived += downloaded;
+            if (sink && !sink(buffer.data(), downloaded)) {
+                aborted = true;
+                return false;
+            }
+        }
+    } while (size > 0);
+
+    return true;
+}
+
+bool WinHttpTransport::Send(const TransportRequest& request, TransportResponse& response, const BodySink& sink) {
+    bool streamed = (bool)request.bodySource;
+    long long bodyLength = streamed ? request.bodyLength : (long long)request.body.length();
+    DWORD flags = request.useHttps ? WINHTTP_FLAG_SECURE : 0;
+
+    DWORD declaredLength = 0;
+    std::wstring headers = BuildHeaders(request, bodyLength, declaredLength);
+
+    // Second attempt only happens when a pooled keep-alive socket turned out to be dead under a
+    // request that is safe to repeat
+    for (int attempt = 0; attempt < 2; attempt++) {
+        response = TransportResponse();
+
+        HINTERNET hConnect = connectionPool_->Acquire(request.host, request.port);
+        if (!hConnect) {
+            return false;
+        }
+
+        HINTERNET hRequest = WinHttpOpenRequest(hConnect, request.method.c_str(), request.path.c_str(),
+            NULL, WINHTTP_NO_REFERER,
+            WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
+        if (!hRequest) {
+            connectionPool_->Release(request.host, request.port);
+            return false;
+        }
+
+        // Closing the request handle fails whatever call is blocked on it
+        if (request.cancel && !request.cancel->Arm([hRequest]() { WinHttpCloseHandle(hRequest); })) {
+            WinHttpCloseHandle(hRequest);
+            connectionPool_->Release(request.host, request.port);
+            return false;
+        }
+
+        bool result = false;
+        bool aborted = false;
+        bool responded = false;
+        DWORD error = 0;
+
+        LPVOID inlineBody = streamed ? WINHTTP_NO_REQUEST_DATA : (LPVOID)request.body.data();
+        DWORD inlineLength = streamed ? 0 : (DWORD)request.body.length();
+
+        // Body bytes only; WinHTTP does not expose what it put on the wire for headers
+        response.timings.bytesSent = bodyLength;
+
+        if (WinHttpSendRequest(hRequest,
+                headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : headers.c_str(),
+                headers.empty() ? 0 : (DWORD)-1,
+                inlineBody, inlineLength, declaredLength, 0) &&
+            (!streamed || WriteStreamedBody(hRequest, request))) {
+            std::chrono::steady_clock::time_point requestSent = std::chrono::steady_clock::now();
+
+            if (WinHttpReceiveResponse(hRequest, NULL)) {
+                std::chrono::steady_clock::time_point bodyStarted = std::chrono::steady_clock::now();
+                response.timings.firstByteMicros = MicrosBetween(requestSent, bodyStarted);
+                responded = true;
+                response.timings.reusedConnection =
+                    connectionPool_->RecordResponse(request.host, request.port, hRequest);
+                ReadPhaseTimes(hRequest, response.timings);
+
+                if (ReadHeaders(hRequest, response)) {
+                    result = ReadBody(hRequest, sink, aborted, response.timings);
+                }
+                response.timings.transferMicros = MicrosBetween(bodyStarted, std::chrono::steady_clock::now());
+            }
+        }
+
+        if (!result) {
+            error = GetLastError();
+        }
+
+        bool cancelled = request.cancel && request.cancel->Disarm();
+        if (!cancelled) {
+            WinHttpCloseHandle(hRequest);
+        }
+        connectionPool_->Release(request.host, request.port);
+
+        if (result) {
+            return true;
+        }
+        if (aborted || cancelled) {
+            return false;
+        }
+
+        // Once a response has started the sink may hold partial data, so only the caller can retry.
+        // A POST may have reached the server before the socket died, so it is not sent again
+        if (!connectionPool_->ReportFailure(error) || responded || !request.IsIdempotent()) {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+#endif // _WIN32
@@ -0,0 +1,402 @@
+#include "../include/services/BarrelLogAnalyzer.h"
+#include "../include/common/Constants.h"
+#include "../include/utilities/LogTokenizer.h"
+#include "../../third_party/json/json.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+
+using json = nlohmann::json;
+
+namespace {
+    const int SEQUENCE_FIELD = 8;
+    const int EVENT_FIELD = 9;
+    const int DATA_FIELD = 10;
+    const int SPLIT_FIELDS = DATA_FIELD + 2;    // one past the data field, for where it ends
+    const double DEFAULT_IDEAL_MS = 1000;
+
+    // As JavaScript's Number.prototype.toString prints it
+    void AppendNumber(std::string& text, double value) {
+        char buffer[32];
+        std::to_chars_result result;
+        if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), (long long)value);
+        }
+        else if (value == std::floor(value) && std::fabs(value) < 1e21) {
+            result.ptr = buffer + snprintf(buffer, sizeof(buffer), "%.0f", value);
+        }
+        else {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        }
+        text.append(buffer, result.ptr);
+    }
+
+    // The members of field 10 the analysis reads
+    const char* const EVENT_KEYS[] = { "barrelId", "startTs", "endTs", "idealMs" };
+    enum EventKey { BARREL_ID, START_TS, END_TS, IDEAL_MS, EVENT_KEY_COUNT };
+
+    struct EventData {
+        std::string barrelKey;      // type tag and text, so 1 and "1" stay two barrels as in the dashboard
+        std::string barrelId;
+        bool hasStart;
+        bool hasEnd;
+        bool hasIdeal;
+        double startTs;
+        double endTs;
+        double idealMs;
+
+        EventData() {
+            hasStart = false;
+            hasEnd = false;
+            hasIdeal = false;
+            startTs = 0;
+            endTs = 0;
+            idealMs = 0;
+        }
+    };
+
+    // A string, literal or object where a number belongs reads as absent
+    bool ReadTime(const JsonToken& token, double& value, bool& present) {
+        present = token.type == JsonToken::NUMBER;
+        return !present || LogTokenizer::ParseNumber(token.begin, token.end, value);
+    }
+
+    bool ReadEvent(const char* begin, const char* end, EventData& data) {
+        JsonToken values[EVENT_KEY_COUNT];
+        if (!LogTokenizer::ReadFlatObject(begin, end, EVENT_KEYS, EVENT_KEY_COUNT, values)) {
+            return false;
+        }
+
+        const JsonToken& id = values[BARREL_ID];
+        if (id.type == JsonToken::STRING) {
+            data.barrelId.assign(id.begin, id.end);
+            if (id.escaped) {
+                json decoded = json::parse("\"" + data.barrelId + "\"", nullptr, false);
+                if (!decoded.is_string()) {
+                    return false;
+                }
+                data.barrelId = decoded.get<std::string>();
+            }
+            data.barrelKey = "s" + data.barrelId;
+        }
+        else if (id.type == JsonToken::LITERAL) {
+            // A null barrelId breaks the dashboard parser outright; here it only drops the line
+            data.barrelId.assign(id.begin, id.end);
+            data.barrelKey = *id.begin == 'n' ? std::string() : "b" + data.barrelId;
+        }
+        else if (id.type == JsonToken::NUMBER) {
+            double value;
+            if (!LogTokenizer::ParseNumber(id.begin, id.end, value)) {
+                return false;
+            }
+            // An integer literal is already how JavaScript would print it
+            if (std::find_if(id.begin, id.end, [](char c) { return c == '.' || c == 'e' || c == 'E'; }) == id.end &&
+                id.end - id.begin < 16 && !(*id.begin == '-' && value == 0)) {
+                data.barrelId.assign(id.begin, id.end);
+            }
+            else {
+                AppendNumber(data.barrelId, value);
+            }
+            data.barrelKey = "n" + data.barrelId;
+        }
+
+        return ReadTime(values[START_TS], data.startTs, data.hasStart) &&
+            ReadTime(values[END_TS], data.endTs, data.hasEnd) &&
+            ReadTime(values[IDEAL_MS], data.idealMs, data.hasIdeal);
+    }
+
+    // parseInt's reading: leading digits, NaN when there are none
+    bool LeadingInteger(const std::string& text, double& value) {
+        size_t i = 0;
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) i++;
+        bool negative = i < text.size() && text[i] == '-';
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) i++;
+        if (i == text.size() || text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        value = 0;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+            value = value * 10 + (text[i++] - '0');
+        }
+        if (negative) {
+            value = -value;
+        }
+        return true;
+    }
+
+    bool StartsEarlier(const BarrelOperation* a, const BarrelOperation* b) {
+        return a->startTime < b->startTime;
+    }
+}
+
+BarrelLogAnalyzer::BarrelLogAnalyzer() {
+    lastBarrel_ = -1;
+    lines_ = 0;
+    events_ = 0;
+    skipping_ = false;
+}
+
+BarrelLogAnalyzer::~BarrelLogAnalyzer() {
+}
+
+long long BarrelLogAnalyzer::GetLineCount() const {
+    return lines_;
+}
+
+long long BarrelLogAnalyzer::GetEventCount() const {
+    return events_;
+}
+
+void BarrelLogAnalyzer::Feed(const char* data, size_t length) {
+    const char* p = data;
+    const char* end = data + length;
+    const char* fields[SPLIT_FIELDS];
+    int fieldCount;
+
+    while (p < end) {
+        // The rest of a line cut by the previous piece is only searched for its end; the line
+        // is split once whole
+        bool continued = skipping_ || !pending_.empty();
+        const char* lineEnd = LogTokenizer::SplitLine(p, end, fields, continued ? 0 : SPLIT_FIELDS, fieldCount);
+        bool complete = lineEnd < end;
+
+        if (skipping_ || pending_.size() + (lineEnd - p) > AgentConstants::LOG_ANALYSIS_MAX_LINE_BYTES) {
+            // Too long to be an event line; dropped instead of buffered
+            pending_.clear();
+            skipping_ = !complete;
+            if (complete) {
+                lines_++;
+            }
+        }
+        else if (!complete) {
+            pending_.append(p, end);
+        }
+        else if (!pending_.empty()) {
+            pending_.append(p, lineEnd);
+            ParseLine(pending_.data(), pending_.data() + pending_.size());
+            pending_.clear();
+        }
+        else {
+            ParseFields(fields, fieldCount, lineEnd);
+        }
+
+        p = complete ? lineEnd + 1 : end;
+    }
+}
+
+bool BarrelLogAnalyzer::FeedStream(std::istream& stream) {
+    std::vector<char> buffer(AgentConstants::LOG_ANALYSIS_READ_BYTES);
+    while (stream) {
+        stream.read(&buffer[0], buffer.size());
+        std::streamsize read = stream.gcount();
+        if (read > 0) {
+            Feed(&buffer[0], (size_t)read);
+        }
+    }
+    return !stream.bad();
+}
+
+void BarrelLogAnalyzer::Finish() {
+    if (!pending_.empty()) {
+        ParseLine(pending_.data(), pending_.data() + pending_.size());
+        pending_.clear();
+    }
+    else if (skipping_) {
+        lines_++;
+    }
+    skipping_ = false;
+}
+
+void BarrelLogAnalyzer::ParseLine(const char* begin, const char* end) {
+    const char* fields[SPLIT_FIELDS];
+    int fieldCount;
+    LogTokenizer::SplitLine(begin, end, fields, SPLIT_FIELDS, fieldCount);
+    ParseFields(fields, fieldCount, end);
+}
+
+void BarrelLogAnalyzer::ParseFields(const char* const* fields, int fieldCount, const char* end) {
+    lines_++;
+
+    // Fewer than 11 fields is not an event line
+    if (fieldCount <= DATA_FIELD) {
+        return;
+    }
+    const char* dataEnd = fieldCount > DATA_FIELD + 1 ? fields[DATA_FIELD + 1] - 1 : end;
+
+    EventData data;
+    if (!ReadEvent(fields[DATA_FIELD], dataEnd, data) || data.barrelKey.empty()) {
+        return;
+    }
+    events_++;
+
+    int barrel = lastBarrel_;
+    if (barrel < 0 || data.barrelKey != lastBarrelKey_) {
+        std::unordered_map<std::string, int>::iterator found = barrelIndex_.find(data.barrelKey);
+        if (found != barrelIndex_.end()) {
+            barrel = found->second;
+        }
+        else {
+            barrel = (int)barrels_.size();
+            barrelIndex_[data.barrelKey] = barrel;
+            barrels_.push_back(BarrelTimeline());
+            barrels_.back().barrelId = data.barrelId;
+        }
+        lastBarrelKey_.swap(data.barrelKey);
+        lastBarrel_ = barrel;
+    }
+
+    // The operation exists from its first line, whatever the event, as in the dashboard
+    const char* sequence = fields[SEQUENCE_FIELD];
+    BarrelOperation& operation = FindOperation(barrel, sequence, fields[EVENT_FIELD] - 1 - sequence);
+
+    const char* event = fields[EVENT_FIELD];
+    size_t eventLength = fields[DATA_FIELD] - 1 - event;
+    if (eventLength == 5 && memcmp(event, "START", 5) == 0) {
+        operation.startTime = data.hasStart ? data.startTs : 0;
+        operation.hasStart = true;
+    }
+    else if (eventLength == 3 && memcmp(event, "END", 3) == 0) {
+        operation.endTime = data.hasEnd ? data.endTs : 0;
+        operation.hasEnd = true;
+        operation.idealDuration = data.hasIdeal ? data.idealMs : DEFAULT_IDEAL_MS;
+        if (operation.hasStart) {
+            operation.actualDuration = operation.endTime - operation.startTime;
+            operation.hasActual = true;
+        }
+    }
+}
+
+BarrelOperation& BarrelLogAnalyzer::FindOperation(int barrel, const char* name, size_t nameLength) {
+    // Few distinct sequence names, many operations: each name is kept once
+    key_.assign(name, nameLength);
+    int nameIndex;
+    std::unordered_map<std::string, int>::iterator named = sequenceIndex_.find(key_);
+    if (named != sequenceIndex_.end()) {
+        nameIndex = named->second;
+    }
+    else {
+        nameIndex = (int)sequenceNames_.size();
+        sequenceIndex_[key_] = nameIndex;
+        sequenceNames_.push_back(key_);
+    }
+
+    // A barrel has at most one operation per sequence name, a handful: a scan beats a hash lookup
+    std::vector<BarrelOperation>& operations = barrels_[barrel].operations;
+    for (size_t i = 0; i < operations.size(); i++) {
+        if (operations[i].nameIndex == nameIndex) {
+            return operations[i];
+        }
+    }
+
+    operations.push_back(BarrelOperation());
+    operations.back().nameIndex = nameIndex;
+    operations.back().sequence = (int)operations.size();
+    return operations.back();
+}
+
+void BarrelLogAnalyzer::BuildResult(std::string& text) const {
+    // Barrels in parseInt order; ids that are not numbers keep their order, after the rest
+    std::vector<std::pair<double, int> > numbered;
+    std::vector<int> unnumbered;
+    for (size_t i = 0; i < barrels_.size(); i++) {
+        double value;
+        if (LeadingInteger(barrels_[i].barrelId, value)) {
+            numbered.push_back(std::make_pair(value, (int)i));
+        }
+        else {
+            unnumbered.push_back((int)i);
+        }
+    }
+    std::stable_sort(numbered.begin(), numbered.end(),
+        [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first < b.first; });
+    std::vector<int> order;
+    for (size_t i = 0; i < numbered.size(); i++) {
+        order.push_back(numbered[i].second);
+    }
+    order.insert(order.end(), unnumbered.begin(), unnumbered.end());
+
+    text = "{\"sequences\":[";
+    for (size_t i = 0; i < sequenceNames_.size(); i++) {
+        if (i > 0) {
+            text += ",";
+        }
+        text += json(sequenceNames_[i]).dump(-1, ' ', false, json::error_handler_t::replace);
+    }
+    text += "],\"barrels\":[";
+
+    double totalTime = 0;
+    double minTime = 0;
+    double maxTime = 0;
+    std::vector<const BarrelOperation*> complete;
+
+    for (size_t b = 0; b < order.size(); b++) {
+        const BarrelTimeline& barrel = barrels_[order[b]];
+
+        // Operations with both ends, by start time; ties keep their first-seen order
+        complete.clear();
+        for (size_t i = 0; i < barrel.operations.size(); i++) {
+            const BarrelOperation& operation = barrel.operations[i];
+            if (operation.hasStart && operation.hasEnd && operation.hasActual) {
+                complete.push_back(&operation);
+            }
+        }
+        std::stable_sort(complete.begin(), complete.end(), StartsEarlier);
+
+        // Wall time from the first start to the last end, less the gaps where nothing ran
+        double executionTime = 0;
+        if (!complete.empty()) {
+            double lastEnd = complete[0]->endTime;
+            double waiting = 0;
+            double activeEnd = complete[0]->endTime;
+            for (size_t i = 1; i < complete.size(); i++) {
+                lastEnd = std::max(lastEnd, complete[i]->endTime);
+                if (complete[i]->startTime > activeEnd) {
+                    waiting += complete[i]->startTime - activeEnd;
+                    activeEnd = complete[i]->endTime;
+                }
+                else {
+                    activeEnd = std::max(activeEnd, complete[i]->endTime);
+                }
+            }
+            executionTime = (lastEnd - complete[0]->startTime) - waiting;
+        }
+
+        text += b > 0 ? ",{\"barrelId\":" : "{\"barrelId\":";
+        text += json(barrel.barrelId).dump(-1, ' ', false, json::error_handler_t::replace);
+        text += ",\"totalExecutionTime\":";
+        AppendNumber(text, executionTime);
+        text += ",\"operations\":[";
+        for (size_t i = 0; i < complete.size(); i++) {
+            const BarrelOperation& operation = *complete[i];
+            text += i > 0 ? ",[" : "[";
+            AppendNumber(text, operation.nameIndex);
+            text += ",";
+            AppendNumber(text, operation.sequence);
+            text += ",";
+            AppendNumber(text, operation.startTime);
+            text += ",";
+            AppendNumber(text, operation.endTime);
+            text += ",";
+            AppendNumber(text, operation.actualDuration);
+            text += ",";
+            AppendNumber(text, operation.idealDuration);
+            text += "]";
+        }
+        text += "]}";
+
+        totalTime += executionTime;
+        minTime = b == 0 ? executionTime : std::min(minTime, executionTime);
+        maxTime = b == 0 ? executionTime : std::max(maxTime, executionTime);
+    }
+
+    text += "],\"summary\":{\"totalBarrels\":" + std::to_string(order.size());
+    text += ",\"averageExecutionTime\":";
+    AppendNumber(text, order.empty() ? 0 : totalTime / order.size());
+    text += ",\"minExecutionTime\":";
+    AppendNumber(text, minTime);
+    text += ",\"maxExecutionTime\":";
+    AppendNumber(text, maxTime);
+    text += ",\"lines\":" + std::to_string(lines_) + ",\"events\":" + std::to_string(events_) + "}}";
+}
@@ -0,0 +1,113 @@
+#include "../include/services/BatchSyncService.h"
+#include "../include/services/ConfigService.h"
+#include "../include/services/LogService.h"
+#include "../include/services/ModelService.h"
+#include "../include/network/HttpClient.h"
+#include "../include/common/Constants.h"
+
+BatchSyncService::BatchSyncService(AgentSettings* settings, HttpClient* client, ConfigService* configService,
+    LogService* logService, ModelService* modelService) {
+    settings_ = settings;
+    httpClient_ = client;
+    configService_ = configService;
+    logService_ = logService;
+    modelService_ = modelService;
+    batchSupported_ = true;
+    cyclesSinceProbe_ = 0;
+}
+
+BatchSyncService::~BatchSyncService() {
+}
+
+void BatchSyncService::SyncToServer() {
+    // Older servers answer 404; retry the batch now and then so an upgraded server is picked up
+    if (!batchSupported_) {
+        if (++cyclesSinceProbe_ < AgentConstants::SYNC_BATCH_REPROBE_CYCLES) {
+            SyncIndividually();
+            return;
+        }
+        cyclesSinceProbe_ = 0;
+        batchSupported_ = true;
+    }
+
+    json request;
+    request["pcId"] = settings_->pcId;
+
+    json section;
+    if (configService_->CollectSyncSection(section)) {
+        request["config"] = section;
+    }
+    if (logService_->CollectSyncSection(section)) {
+        request["logs"] = section;
+    }
+    if (modelService_->CollectSyncSection(section)) {
+        request["models"] = section;
+    }
+
+    // Nothing changed: no round trip at all
+    if (request.size() == 1) {
+        return;
+    }
+
+    if (!SendBatch(request) && !batchSupported_) {
+        SyncIndividually();
+    }
+}
+
+bool BatchSyncService::SendBatch(json& request) {
+    json response;
+    int statusCode = 0;
+
+    bool posted = httpClient_->Post(AgentConstants::ENDPOINT_SYNC_BATCH, request, response, statusCode);
+
+    // The route is missing (empty or JSON 404 body alike), as opposed to a network failure
+    if (statusCode == AgentConstants::HTTP_NOT_FOUND) {
+        batchSupported_ = false;
+        cyclesSinceProbe_ = 0;
+        return false;
+    }
+
+    if (!posted) {
+        return false;
+    }
+
+    if (!response.contains("acks") || !response["acks"].is_object()) {
+        return false;
+    }
+
+    // Unacked sections stay dirty and are collected again next cycle
+    const json& acks = response["acks"];
+    if (request.contains("config") && acks.value("config", false)) {
+        configService_->AcknowledgeSyncSection(request["config"]);
+    }
+    if (request.contains("logs") && acks.value("logs", false)) {
+        logService_->AcknowledgeSyncSection(request["logs"]);
+    }
+    if (request.contains("models") && acks.value("models", false)) {
+        modelService_->AcknowledgeSyncSection(request["models"]);
+    }
+
+    // A delta against a copy the server no longer has: resend the whole section next cycle
+    if (response.contains("needFull") && response["needFull"].is_array()) {
+        const json& needFull = response["needFull"];
+        for (size_t i = 0; i < needFull.size(); i++) {
+            if (!needFull[i].is_string()) {
+                continue;
+            }
+            if (needFull[i].get<std::string>() == "config") {
+                configService_->ResetSyncBase();
+            }
+            else if (needFull[i].get<std::string>() == "logs") {
+                logService_->ResetSyncBase();
+            }
+        }
+    }
+
+    return true;
+}
+
+void BatchSyncService::SyncIndividually() {
+    configService_->SyncConfigToServer();
+    logService_->SyncLogsToServer();
+    modelService_->SyncModelsToServer();
+}
@@ -0,0 +1,131 @@
+#include "../include/services/CommandChannel.h"
+#include "../include/network/RetryPolicy.h"
+#include "../include/common/Constants.h"
+#include <chrono>
+
+CommandChannel::CommandChannel(HttpClient* client, const CommandHandler& handler) {
+    httpClient_ = client;
+    handler_ = handler;
+    pcId_ = 0;
+    stopRequested_ = false;
+    connected_ = false;
+}
+
+CommandChannel::~CommandChannel() {
+    Stop();
+}
+
+void CommandChannel::Start(int pcId) {
+    if (thread_.joinable()) {
+        if (pcId == pcId_) {
+            return;
+        }
+        Stop();
+    }
+
+    pcId_ = pcId;
+    stopRequested_ = false;
+    cancel_.Reset();
+    thread_ = std::thread(&CommandChannel::Run, this);
+}
+
+void CommandChannel::Stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(waitMutex_);
+        stopRequested_ = true;
+    }
+    wake_.notify_all();
+
+    // A read in progress would otherwise last until the server's next keep-alive
+    cancel_.Cancel();
+    thread_.join();
+    connected_ = false;
+}
+
+bool CommandChannel::IsConnected() const {
+    return connected_;
+}
+
+void CommandChannel::Run() {
+    RetryPolicy backoff(AgentConstants::COMMAND_CHANNEL_RETRY_BASE_MS, AgentConstants::COMMAND_CHANNEL_RETRY_MAX_MS);
+
+    while (!stopRequested_) {
+        int statusCode = 0;
+        bool held = Listen(statusCode);
+        connected_ = false;
+
+        if (stopRequested_) {
+            break;
+        }
+
+        // Endpoint missing: an older server, the heartbeat carries commands for good
+        if (statusCode == AgentConstants::HTTP_NOT_FOUND) {
+            break;
+        }
+
+        // The server ends a healthy channel after its hold time; reopen straight away
+        if (held) {
+            backoff.Reset();
+            continue;
+        }
+
+        WaitUnlessStopped(backoff.NextDelayMs());
+    }
+}
+
+bool CommandChannel::Listen(int& statusCode) {
+    json request;
+    request["pcId"] = pcId_;
+    request["holdSeconds"] = AgentConstants::COMMAND_CHANNEL_HOLD_SECONDS;
+
+    std::string line;
+    bool overflow = false;
+    BodySink sink = [&](const char* data, size_t length) {
+        if (stopRequested_) {
+            return false;
+        }
+
+        // The server's first byte arrives as soon as it has taken the channel
+        connected_ = true;
+
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] != '\n') {
+                if (line.size() < AgentConstants::COMMAND_CHANNEL_MAX_LINE_BYTES) {
+                    line.push_back(data[i]);
+                }
+                else {
+                    overflow = true;
+                }
+                continue;
+            }
+
+            if (!line.empty() && !overflow) {
+                Dispatch(line);
+            }
+            line.clear();
+            overflow = false;
+        }
+        return true;
+    };
+
+    return httpClient_->OpenStream(AgentConstants::ENDPOINT_COMMAND_CHANNEL, request, sink, &cancel_, statusCode);
+}
+
+void CommandChannel::Dispatch(const std::string& line) {
+    json message = json::parse(line, nullptr, false);
+    if (!message.is_object() || !message.contains("commands") || !message["commands"].is_array() ||
+        message["commands"].empty()) {
+        return;
+    }
+
+    handler_(message["commands"]);
+}
+
+void CommandChannel::WaitUnlessStopped(int milliseconds) {
+    std::unique_lock<std::mutex> lock(waitMutex_);
+    wake_.wait_for(lock, std::chrono::milliseconds(milliseconds), [this]() { return stopRequested_.load(); });
+}
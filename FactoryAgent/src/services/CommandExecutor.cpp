@@ -1,19 +1,106 @@
 #include "../include/services/CommandExecutor.h"
 #include "../include/services/LogAnalyzerCommands.h"
+#include "../include/services/LogContentBody.h"
 #include "../include/services/ConfigService.h"
 #include "../include/services/ModelService.h"
+#include "../include/services/OutboxService.h"
 #include "../include/network/HttpClient.h"
 #include "../include/common/Constants.h"
 #include <fstream>
 #include <iostream>
 
-CommandExecutor::CommandExecutor(HttpClient* client, ConfigService* configSvc, ModelService* modelSvc) {
+CommandExecutor::CommandExecutor(HttpClient* client, ConfigService* configSvc, ModelService* modelSvc,
+    OutboxService* outbox) {
     httpClient_ = client;
     configService_ = configSvc;
     modelService_ = modelSvc;
+    outbox_ = outbox;
+    commandThread_ = NULL;
+    completedEvent_ = NULL;
+    stopRequested_ = false;
 }
 
 CommandExecutor::~CommandExecutor() {
+    Stop();
+}
+
+bool CommandExecutor::Start(HANDLE completedEvent) {
+    if (commandThread_) {
+        return true;
+    }
+
+    completedEvent_ = completedEvent;
+    stopRequested_ = false;
+    commandThread_ = CreateThread(NULL, 0, CommandThreadProc, this, 0, NULL);
+    return commandThread_ != NULL;
+}
+
+void CommandExecutor::Stop() {
+    if (!commandThread_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        stopRequested_ = true;
+        pendingBatches_.clear();
+    }
+    queueWake_.notify_all();
+
+    // A download or upload in progress would otherwise run to the end. The thread has to be
+    // gone before we return: AgentCore frees the client and services it uses right after
+    httpClient_->CancelTransfers();
+    WaitForSingleObject(commandThread_, INFINITE);
+    CloseHandle(commandThread_);
+    commandThread_ = NULL;
+    httpClient_->ResumeTransfers();
+}
+
+void CommandExecutor::EnqueueCommands(const json& commands) {
+    if (!commandThread_) {
+        ProcessCommands(commands);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        pendingBatches_.push_back(commands);
+    }
+    queueWake_.notify_one();
+}
+
+bool CommandExecutor::IsStopRequested() {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    return stopRequested_;
+}
+
+DWORD WINAPI CommandExecutor::CommandThreadProc(LPVOID param) {
+    CommandExecutor* executor = (CommandExecutor*)param;
+    executor->CommandLoop();
+    return 0;
+}
+
+void CommandExecutor::CommandLoop() {
+    while (true) {
+        json batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            queueWake_.wait(lock, [this]() { return stopRequested_ || !pendingBatches_.empty(); });
+
+            if (stopRequested_) {
+                return;
+            }
+
+            batch = pendingBatches_.front();
+            pendingBatches_.pop_front();
+        }
+
+        ProcessCommands(batch);
+
+        if (completedEvent_) {
+            SetEvent(completedEvent_);
+        }
+    }
 }
 
 void CommandExecutor::ProcessCommands(const json& commands) {
@@ -22,7 +109,7 @@ void CommandExecutor::ProcessCommands(const json& commands) {
     }
 
     int count = commands.size();
-    for (int i = 0; i < count; i++) {
+    for (int i = 0; i < count && !IsStopRequested(); i++) {
         ExecuteCommand(commands[i]);
     }
 }
@@ -49,6 +136,21 @@ bool CommandExecutor::ExecuteCommand(const json& command) {
             }
         }
     }
+    else if (commandType == AgentConstants::COMMAND_UPDATE_CONFIG_DELTA) {
+        if (command.contains("commandData")) {
+            json data = json::parse(command["commandData"].get<std::string>(), nullptr, false);
+            bool needFull = false;
+            if (configService_->ApplyConfigDeltaFromServer(data, needFull)) {
+                result.success = true;
+                result.status = AgentConstants::STATUS_COMPLETED;
+            }
+            else if (needFull) {
+                // The server answers this by queueing a plain UpdateConfig with the whole file
+                result.resultData = AgentConstants::CONFIG_NEED_FULL;
+                result.errorMessage = "Local config does not match the delta base";
+            }
+        }
+    }
     else if (commandType == AgentConstants::COMMAND_CHANGE_MODEL) {
         if (command.contains("commandData")) {
             json data = json::parse(command["commandData"].get<std::string>());
@@ -88,7 +190,8 @@ bool CommandExecutor::ExecuteCommand(const json& command) {
             if (data.contains("ModelName") && data.contains("UploadUrl")) {
                 std::string modelName = data["ModelName"].get<std::string>();
                 std::string uploadUrl = data["UploadUrl"].get<std::string>();
-                if (modelService_->UploadModelToLibrary(modelName, uploadUrl)) {
+                std::string chunkedUploadUrl = data.value("ChunkedUploadUrl", "");
+                if (modelService_->UploadModelToLibrary(modelName, uploadUrl, chunkedUploadUrl)) {
                     result.success = true;
                     result.status = AgentConstants::STATUS_COMPLETED;
                 }
@@ -103,25 +206,41 @@ bool CommandExecutor::ExecuteCommand(const json& command) {
 
                 // If path is relative (no drive letter), prepend the log folder path
                 if (filePath.find(':') == std::string::npos) {
-                    std::string logFolder = GetLogFolderPath();
-                    filePath = logFolder + "\\" + filePath;
-                    data["FilePath"] = filePath;
+                    filePath = GetLogFolderPath() + "\\" + filePath;
                 }
 
-                // Call LogAnalyzer to read the file
-                std::string contentResult = LogAnalyzer::HandleGetLogFileContent(data.dump());
+                // The content goes straight from the mapped log into the request; only a
+                // failure is left to the outbox
+                LogContentBody body;
+                if (body.Open(filePath, commandId, result.errorMessage)) {
+                    if (SendStreamedResult(body)) {
+                        return true;
+                    }
+                    result.errorMessage = "Failed to send log file content: " + filePath;
+                }
+            }
+            catch (const std::exception& ex) {
+                result.success = false;
+                result.status = AgentConstants::STATUS_FAILED;
+                result.errorMessage = ex.what();
+            }
+        }
+    }
+
+    else if (commandType == AgentConstants::COMMAND_ANALYZE_LOG_FILE) {
+        if (command.contains("commandData")) {
+            try {
+                json data = json::parse(command["commandData"].get<std::string>());
+                std::string filePath = data.value("FilePath", "");
+
+                // Relative paths are under the log folder, as for GetLogFileContent
+                if (filePath.find(':') == std::string::npos) {
+                    filePath = GetLogFolderPath() + "\\" + filePath;
+                }
 
-                // Parse the analyzer result to check success
-                json contentJson = json::parse(contentResult);
-                if (contentJson.value("success", false)) {
+                if (LogAnalyzer::AnalyzeLogFile(filePath, result.resultData, result.errorMessage)) {
                     result.success = true;
                     result.status = AgentConstants::STATUS_COMPLETED;
-                    result.resultData = contentResult; // Send the JSON containing file content
-                }
-                else {
-                    result.success = false;
-                    result.status = AgentConstants::STATUS_FAILED;
-                    result.errorMessage = contentJson.value("error", "Unknown error reading log file");
                 }
             }
             catch (const std::exception& ex) {
@@ -131,7 +250,6 @@ bool CommandExecutor::ExecuteCommand(const json& command) {
             }
         }
     }
-
     else if (commandType == AgentConstants::COMMAND_UPDATE_AGENT_SETTINGS) {
         if (command.contains("commandData")) {
             try {
@@ -180,6 +298,47 @@ bool CommandExecutor::ExecuteCommand(const json& command) {
             }
         }
     }
+    else if (commandType == AgentConstants::COMMAND_SET_BANDWIDTH_LIMIT) {
+        if (command.contains("commandData")) {
+            try {
+                json data = json::parse(command["commandData"].get<std::string>());
+                int kbps = data.value("BandwidthLimitKbps", 0);
+                if (kbps < 0) {
+                    kbps = 0;
+                }
+
+                // Takes effect on transfers already in flight
+                httpClient_->SetBandwidthLimit(kbps);
+
+                // Persist so the cap survives a restart
+                std::ifstream inFile(AgentConstants::CONFIG_FILE_NAME);
+                json currentConfig;
+                if (inFile.is_open()) {
+                    inFile >> currentConfig;
+                    inFile.close();
+
+                    if (kbps > 0) {
+                        currentConfig["bandwidthLimitKbps"] = kbps;
+                    }
+                    else {
+                        currentConfig.erase("bandwidthLimitKbps");
+                    }
+
+                    std::ofstream outFile(AgentConstants::CONFIG_FILE_NAME);
+                    outFile << currentConfig.dump(4);
+                }
+
+                result.success = true;
+                result.status = AgentConstants::STATUS_COMPLETED;
+                result.resultData = kbps > 0 ?
+                    "Bandwidth limit set to " + std::to_string(kbps) + " kbps" : "Bandwidth limit removed";
+            }
+            catch (const std::exception& ex) {
+                result.success = false;
+                result.errorMessage = std::string("Error setting bandwidth limit: ") + ex.what();
+            }
+        }
+    }
     else if (commandType == AgentConstants::COMMAND_RESET_AGENT) {
         try {
             // 1. Delete the config file
@@ -220,10 +379,26 @@ void CommandExecutor::SendCommandResult(int commandId, const CommandResult& resu
     request["resultData"] = result.resultData;
     request["errorMessage"] = result.errorMessage;
 
+    // Written to disk first: a restart or an outage only delays the result. Keyed by command,
+    // so a command the server hands out twice leaves one result to deliver
+    if (outbox_->Enqueue(AgentConstants::ENDPOINT_COMMAND_RESULT, request, "commandresult:" + std::to_string(commandId))) {
+        outbox_->Flush();
+        return;
+    }
+
     json response;
     httpClient_->Post(AgentConstants::ENDPOINT_COMMAND_RESULT, request, response);
 }
 
+bool CommandExecutor::SendStreamedResult(LogContentBody& body) {
+    BodySource source = [&body](long long offset, const char*& data, size_t& length) {
+        return body.Read(offset, data, length);
+    };
+
+    json response;
+    return httpClient_->PostBody(AgentConstants::ENDPOINT_COMMAND_RESULT, source, body.GetLength(), response);
+}
+
 std::string CommandExecutor::GetLogFolderPath() {
     // TODO: Read from config or constants instead of hardcoding
     return "C:\\LAI\\LAI-WorkData\\Log";
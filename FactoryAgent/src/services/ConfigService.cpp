@@ -1,35 +1,167 @@
 #include "../include/services/ConfigService.h"
 #include "../include/network/HttpClient.h"
+#include "../include/monitoring/FileMonitor.h"
 #include "../include/utilities/FileUtils.h"
+#include "../include/utilities/LineDelta.h"
+#include "../include/utilities/Sha256.h"
 #include "../include/common/Constants.h"
 
 ConfigService::ConfigService(AgentSettings* settings, HttpClient* client, ConfigManager* configMgr) {
     settings_ = settings;
     httpClient_ = client;
     configManager_ = configMgr;
+    deltaEnabled_ = false;
+    configMonitor_ = new FileMonitor();
+    changedEvent_ = NULL;
 }
 
 ConfigService::~ConfigService() {
+    delete configMonitor_;
 }
 
-void ConfigService::SyncConfigToServer() {
-    std::string configContent;
-    if (!FileUtils::ReadFileContent(settings_->configFilePath, configContent)) {
-        return;
+bool ConfigService::StartWatching(HANDLE changedEvent) {
+    changedEvent_ = changedEvent;
+    return configMonitor_->StartMonitoring(settings_->configFilePath, OnConfigFileChanged, this);
+}
+
+void ConfigService::StopWatching() {
+    configMonitor_->StopMonitoring();
+}
+
+void ConfigService::OnConfigFileChanged(const std::string& content, void* userData) {
+    // The sync reads the file itself; this only says it is worth looking now
+    ConfigService* service = (ConfigService*)userData;
+    if (service->changedEvent_) {
+        SetEvent(service->changedEvent_);
     }
+}
+
+void ConfigService::SetDeltaSyncEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(configMutex_);
+    deltaEnabled_ = enabled;
+}
 
-    if (configContent.empty() || configContent == lastConfigContent_) {
+void ConfigService::SyncConfigToServer() {
+    json section;
+    if (!CollectSyncSection(section)) {
         return;
     }
 
-    lastConfigContent_ = configContent;
+    if (section.contains("ops")) {
+        bool needFull = false;
+        if (PostDelta(section, needFull)) {
+            AcknowledgeSyncSection(section);
+            return;
+        }
+
+        // A network failure just leaves the same delta for the next cycle
+        if (!needFull) {
+            return;
+        }
+        ResetSyncBase();
+        if (!CollectSyncSection(section)) {
+            return;
+        }
+    }
 
     json request;
     request["pcId"] = settings_->pcId;
-    request["configContent"] = configContent;
+    request["configContent"] = section["configContent"];
+
+    json response;
+    if (httpClient_->Post(AgentConstants::ENDPOINT_UPDATE_CONFIG, request, response)) {
+        AcknowledgeSyncSection(section);
+    }
+}
+
+bool ConfigService::PostDelta(const json& section, bool& needFull) {
+    json request = section;
+    request["pcId"] = settings_->pcId;
 
     json response;
-    httpClient_->Post(AgentConstants::ENDPOINT_UPDATE_CONFIG, request, response);
+    int statusCode = 0;
+    bool posted = httpClient_->Post(AgentConstants::ENDPOINT_UPDATE_CONFIG_DELTA, request, response, statusCode);
+
+    // Server rolled back to a build without deltas: full content from now on
+    if (statusCode == AgentConstants::HTTP_NOT_FOUND) {
+        SetDeltaSyncEnabled(false);
+        needFull = true;
+        return false;
+    }
+
+    if (!posted) {
+        return false;
+    }
+    if (response.value("success", false)) {
+        return true;
+    }
+
+    needFull = response.value("needFull", false);
+    return false;
+}
+
+bool ConfigService::CollectSyncSection(json& section) {
+    std::string configContent;
+    std::lock_guard<std::mutex> lock(configMutex_);
+
+    if (!FileUtils::ReadFileContent(settings_->configFilePath, configContent)) {
+        return false;
+    }
+
+    if (configContent.empty()) {
+        return false;
+    }
+
+    // Line hashes are enough to tell "unchanged"; SHA-256 only runs when something moved
+    std::vector<uint64_t> lineHashes = LineDelta::HashLines(configContent);
+    if (!lastConfigHash_.empty() && lineHashes == lastLineHashes_) {
+        return false;
+    }
+
+    std::string hash = Sha256::HashString(configContent);
+
+    section = json::object();
+    section["hash"] = hash;
+
+    if (deltaEnabled_ && !lastConfigHash_.empty()) {
+        json ops = LineDelta::Diff(lastLineHashes_, configContent);
+
+        // A mostly rewritten file is cheaper to send whole
+        if (ops.dump().length() < configContent.length()) {
+            section["baseHash"] = lastConfigHash_;
+            section["ops"] = ops;
+        }
+    }
+    if (!section.contains("ops")) {
+        section["configContent"] = configContent;
+    }
+
+    pendingConfigHash_ = hash;
+    pendingLineHashes_.swap(lineHashes);
+    return true;
+}
+
+void ConfigService::AcknowledgeSyncSection(const json& section) {
+    std::lock_guard<std::mutex> lock(configMutex_);
+
+    // An apply from the server may have moved the base while this section was in flight
+    if (section.value("hash", "") != pendingConfigHash_) {
+        return;
+    }
+    lastConfigHash_ = pendingConfigHash_;
+    lastLineHashes_ = pendingLineHashes_;
+}
+
+void ConfigService::ResetSyncBase() {
+    std::lock_guard<std::mutex> lock(configMutex_);
+    lastConfigHash_.clear();
+    lastLineHashes_.clear();
+}
+
+void ConfigService::SetBase(const std::string& content) {
+    lastConfigHash_ = Sha256::HashString(content);
+    lastLineHashes_ = LineDelta::HashLines(content);
+    pendingConfigHash_.clear();
 }
 
 bool ConfigService::ApplyConfigFromServer(const std::string& content) {
@@ -37,10 +169,47 @@ bool ConfigService::ApplyConfigFromServer(const std::string& content) {
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(configMutex_);
+
+    // The server records this content as its copy once the command completes
     if (configManager_->WriteConfigFile(settings_->configFilePath, content)) {
-        lastConfigContent_ = content;
+        SetBase(content);
         return true;
     }
 
     return false;
-}
\ No newline at end of file
+}
+
+bool ConfigService::ApplyConfigDeltaFromServer(const json& delta, bool& needFull) {
+    needFull = false;
+    if (!delta.is_object() || !delta.contains("ops")) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(configMutex_);
+
+    std::string current;
+    if (!FileUtils::ReadFileContent(settings_->configFilePath, current)) {
+        return false;
+    }
+
+    // Edited locally since the server's copy was taken: only the full content can be trusted
+    if (Sha256::HashString(current) != delta.value("baseHash", "")) {
+        needFull = true;
+        return false;
+    }
+
+    std::string updated;
+    if (!LineDelta::Apply(current, delta["ops"], updated) ||
+        Sha256::HashString(updated) != delta.value("hash", "")) {
+        needFull = true;
+        return false;
+    }
+
+    if (!configManager_->WriteConfigFile(settings_->configFilePath, updated)) {
+        return false;
+    }
+
+    SetBase(updated);
+    return true;
+}
@@ -1,7 +1,11 @@
 #include "../include/services/HeartbeatService.h"
 #include "../include/common/Constants.h"
+#include <chrono>
+#include <memory>
 
-HeartbeatService::HeartbeatService() {
+HeartbeatService::HeartbeatService(const CommandHandler& lateCommands) {
+    lastMetricsReport_ = std::chrono::steady_clock::now();
+    lateCommands_ = lateCommands;
 }
 
 HeartbeatService::~HeartbeatService() {
@@ -12,16 +16,69 @@ bool HeartbeatService::SendHeartbeat(int pcId, bool isAppRunning, HttpClient* cl
         return false;
     }
 
+    // One beat in flight at a time: a server that has not answered the last one gets no second
+    if (!CollectLate()) {
+        return false;
+    }
+
     json request = BuildHeartbeatRequest(pcId, isAppRunning);
-    json response;
+    if (commands == NULL) {
+        request["commandsOnChannel"] = true;
+    }
 
-    if (client->Post(AgentConstants::ENDPOINT_HEARTBEAT, request, response)) {
-        if (ParseHeartbeatResponse(response, commands)) {
-            return true;
-        }
+    // Request latency summary rides along about once a minute; a beat that fails leaves the
+    // interval open, so the next report still covers it
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    bool reportMetrics = now - lastMetricsReport_ >=
+        std::chrono::seconds(AgentConstants::METRICS_REPORT_INTERVAL_SECONDS);
+    if (reportMetrics) {
+        request["metrics"] = client->CollectMetricsSummary();
     }
 
-    return false;
+    std::shared_ptr<HeartbeatResponseReader> reader(new HeartbeatResponseReader());
+
+    // Bounded wait so a stalled server cannot stretch the heartbeat schedule; a late response
+    // counts as a failed beat, and the next one picks up any commands it carried
+    std::future<bool> pending = client->PostStreamingAsync(AgentConstants::ENDPOINT_HEARTBEAT, request,
+        reader, REQUEST_LANE_INTERACTIVE);
+    if (pending.wait_for(std::chrono::milliseconds(AgentConstants::HEARTBEAT_TIMEOUT_MS)) !=
+        std::future_status::ready) {
+        late_ = std::move(pending);
+        lateReader_ = reader;
+        return false;
+    }
+
+    if (!pending.get() || !reader->IsSuccess()) {
+        return false;
+    }
+
+    if (reportMetrics) {
+        client->AcknowledgeMetricsSummary();
+        lastMetricsReport_ = now;
+    }
+
+    if (commands != NULL && reader->HasPendingCommands() && !reader->GetCommands().is_null()) {
+        commands->swap(reader->GetCommands());
+    }
+    return true;
+}
+
+bool HeartbeatService::CollectLate() {
+    if (!late_.valid()) {
+        return true;
+    }
+    if (late_.wait_for(std::chrono::milliseconds(AgentConstants::HEARTBEAT_TIMEOUT_MS)) !=
+        std::future_status::ready) {
+        return false;
+    }
+
+    // Sent with or without a channel open, the commands in it are now this agent's to run
+    if (late_.get() && lateReader_->IsSuccess() && lateReader_->HasPendingCommands() &&
+        lateReader_->GetCommands().is_array() && !lateReader_->GetCommands().empty() && lateCommands_) {
+        lateCommands_(lateReader_->GetCommands());
+    }
+    lateReader_.reset();
+    return true;
 }
 
 json HeartbeatService::BuildHeartbeatRequest(int pcId, bool isAppRunning) {
@@ -31,15 +88,151 @@ json HeartbeatService::BuildHeartbeatRequest(int pcId, bool isAppRunning) {
     return request;
 }
 
-bool HeartbeatService::ParseHeartbeatResponse(const json& response, json* commands) {
-    if (response.contains("success") && response["success"].get<bool>()) {
-        if (commands != NULL && response.contains("hasPendingCommands") &&
-            response["hasPendingCommands"].get<bool>()) {
-            if (response.contains("commands")) {
-                *commands = response["commands"];
-            }
-        }
+HeartbeatResponseReader::HeartbeatResponseReader()
+    : success_(false), hasPendingCommands_(false), commandsBuilder_(commands_),
+    depth_(0), commandsDepth_(0), field_(FIELD_OTHER) {
+}
+
+bool HeartbeatResponseReader::IsSuccess() const {
+    return success_;
+}
+
+bool HeartbeatResponseReader::HasPendingCommands() const {
+    return hasPendingCommands_;
+}
+
+json& HeartbeatResponseReader::GetCommands() {
+    return commands_;
+}
+
+bool HeartbeatResponseReader::BeginContainer(bool isArray, std::size_t elements) {
+    if (commandsDepth_ == 0 && depth_ == 1 && field_ == FIELD_COMMANDS) {
+        commands_ = json();
+    }
+    else if (commandsDepth_ == 0) {
+        depth_++;
+        return true;
+    }
+
+    commandsDepth_++;
+    return isArray ? commandsBuilder_.start_array(elements) : commandsBuilder_.start_object(elements);
+}
+
+bool HeartbeatResponseReader::EndContainer(bool isArray) {
+    if (commandsDepth_ == 0) {
+        depth_--;
+        field_ = FIELD_OTHER;
         return true;
     }
+
+    commandsDepth_--;
+    if (commandsDepth_ == 0) {
+        field_ = FIELD_OTHER;
+    }
+    return isArray ? commandsBuilder_.end_array() : commandsBuilder_.end_object();
+}
+
+bool HeartbeatResponseReader::null() {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.null();
+    }
+    field_ = FIELD_OTHER;
+    return true;
+}
+
+bool HeartbeatResponseReader::boolean(bool val) {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.boolean(val);
+    }
+
+    if (depth_ == 1 && field_ == FIELD_SUCCESS) {
+        success_ = val;
+    }
+    else if (depth_ == 1 && field_ == FIELD_HAS_PENDING) {
+        hasPendingCommands_ = val;
+    }
+    field_ = FIELD_OTHER;
+    return true;
+}
+
+bool HeartbeatResponseReader::number_integer(number_integer_t val) {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.number_integer(val);
+    }
+    field_ = FIELD_OTHER;
+    return true;
+}
+
+bool HeartbeatResponseReader::number_unsigned(number_unsigned_t val) {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.number_unsigned(val);
+    }
+    field_ = FIELD_OTHER;
+    return true;
+}
+
+bool HeartbeatResponseReader::number_float(number_float_t val, const string_t& s) {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.number_float(val, s);
+    }
+    field_ = FIELD_OTHER;
+    return true;
+}
+
+bool HeartbeatResponseReader::string(string_t& val) {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.string(val);
+    }
+    field_ = FIELD_OTHER;
+    return true;
+}
+
+bool HeartbeatResponseReader::binary(binary_t& val) {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.binary(val);
+    }
+    field_ = FIELD_OTHER;
+    return true;
+}
+
+bool HeartbeatResponseReader::start_object(std::size_t elements) {
+    return BeginContainer(false, elements);
+}
+
+bool HeartbeatResponseReader::key(string_t& val) {
+    if (commandsDepth_ > 0) {
+        return commandsBuilder_.key(val);
+    }
+
+    if (depth_ == 1) {
+        if (val == "success") {
+            field_ = FIELD_SUCCESS;
+        }
+        else if (val == "hasPendingCommands") {
+            field_ = FIELD_HAS_PENDING;
+        }
+        else if (val == "commands") {
+            field_ = FIELD_COMMANDS;
+        }
+        else {
+            field_ = FIELD_OTHER;
+        }
+    }
+    return true;
+}
+
+bool HeartbeatResponseReader::end_object() {
+    return EndContainer(false);
+}
+
+bool HeartbeatResponseReader::start_array(std::size_t elements) {
+    return BeginContainer(true, elements);
+}
+
+bool HeartbeatResponseReader::end_array() {
+    return EndContainer(true);
+}
+
+bool HeartbeatResponseReader::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
     return false;
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 #include "../include/services/LogAnalyzerCommands.h"
 #include "../include/utilities/FileUtils.h"
+#include "../include/utilities/DirectoryScanner.h"
+#include "../include/services/BarrelLogAnalyzer.h"
 #include "../../third_party/json/json.hpp"
 #include <filesystem>
 #include <fstream>
@@ -36,123 +38,91 @@ namespace LogAnalyzer
         return wstrTo;
     }
 
-    // Build hierarchical file tree recursively
-    json BuildFileTree(const std::wstring& rootPath, const std::wstring& relativePath)
+    // Children of one scanned folder, names and paths in UTF-8
+    json BuildScannedTree(const std::vector<ScanEntry>& entries, const ScanEntry& folder, const std::wstring& relativePath)
     {
         json result = json::array();
 
-        try
+        for (int i = folder.firstChild; i < folder.firstChild + folder.childCount; i++)
         {
-            std::wstring fullPath = relativePath.empty() ? rootPath : rootPath + L"\\" + relativePath;
-
-            // Check if path exists and is a directory
-            if (!fs::exists(fullPath) || !fs::is_directory(fullPath))
+            const ScanEntry& entry = entries[i];
+            if (entry.isDirectory && entry.isLink)
             {
-                return result;
+                continue;
             }
 
-            // Iterate through directory entries
-            for (const auto& entry : fs::directory_iterator(fullPath))
+            json node;
+
+            std::wstring name = fs::path(entry.name).wstring();
+            std::wstring path = relativePath.empty() ? name : relativePath + L"\\" + name;
+
+            node["name"] = WStringToString(name);
+            node["path"] = WStringToString(path);
+            node["isDirectory"] = entry.isDirectory;
+
+            if (entry.isDirectory)
             {
-                try
-                {
-                    json node;
-
-                    std::wstring name = entry.path().filename().wstring();
-                    std::wstring path = relativePath.empty() ? name : relativePath + L"\\" + name;
-
-                    node["name"] = WStringToString(name);
-                    node["path"] = WStringToString(path);
-                    node["isDirectory"] = entry.is_directory();
-
-                    if (entry.is_regular_file())
-                    {
-                        // Get file size
-                        node["size"] = entry.file_size();
-
-                        // Get last modified time
-                        auto ftime = fs::last_write_time(entry);
-                        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
-                        );
-                        auto time = std::chrono::system_clock::to_time_t(sctp);
-
-                        char timeStr[100];
-                        struct tm timeinfo;
-                        localtime_s(&timeinfo, &time);
-                        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
-                        node["modifiedDate"] = timeStr;
-                    }
-                    else if (entry.is_directory())
-                    {
-                        // Recursively build children
-                        node["children"] = BuildFileTree(rootPath, path);
-                    }
-
-                    result.push_back(node);
-                }
-                catch (const std::exception& ex)
-                {
-                    // Skip files that can't be accessed
-                    continue;
-                }
+                node["children"] = BuildScannedTree(entries, entry, path);
             }
-        }
-        catch (const std::exception& ex)
-        {
-            // Return empty array on error
+            else
+            {
+                node["size"] = entry.size;
+
+                auto ftime = fs::file_time_type(fs::file_time_type::duration(entry.writeTime));
+                auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+                    ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
+                );
+                auto time = std::chrono::system_clock::to_time_t(sctp);
+
+                char timeStr[100];
+                struct tm timeinfo;
+                localtime_s(&timeinfo, &time);
+                strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+                node["modifiedDate"] = timeStr;
+            }
+
+            result.push_back(node);
         }
 
         return result;
     }
 
-    // Handle GetLogFileContent command
-    std::string HandleGetLogFileContent(const std::string& commandData)
+    // Build hierarchical file tree from one recursive scan
+    json BuildFileTree(const std::wstring& rootPath, const std::wstring& relativePath)
     {
-        try
-        {
-            json cmdJson = json::parse(commandData);
-            std::string filePath = cmdJson["FilePath"];
+        std::wstring fullPath = relativePath.empty() ? rootPath : rootPath + L"\\" + relativePath;
 
-            // Convert to wide string for Windows file operations
-            std::wstring wFilePath = StringToWString(filePath);
+        DirectoryScanner scanner;
+        std::vector<ScanEntry> entries;
+        if (!scanner.Scan(fs::path(fullPath).string(), true, entries))
+        {
+            return json::array();
+        }
 
-            // Open file
-            std::ifstream file(wFilePath, std::ios::binary);
-            if (!file.is_open())
-            {
-                json error;
-                error["success"] = false;
-                error["error"] = "Failed to open file: " + filePath;
-                return error.dump();
-            }
+        return BuildScannedTree(entries, entries[0], relativePath);
+    }
 
-            // Get file size
-            file.seekg(0, std::ios::end);
-            size_t fileSize = file.tellg();
-            file.seekg(0, std::ios::beg);
-
-            // Read content
-            std::string content;
-            content.resize(fileSize);
-            file.read(&content[0], fileSize);
-            file.close();
-
-            // Build result
-            json result;
-            result["success"] = true;
-            result["content"] = content;
-            result["size"] = fileSize;
-            result["encoding"] = "UTF-8";
-
-            return result.dump();
+    // Handle AnalyzeLogFile command: the barrel analysis alone, the log itself stays here.
+    // The result can run to tens of MB, so it is returned as text and never parsed back
+    bool AnalyzeLogFile(const std::string& filePath, std::string& resultJson, std::string& error)
+    {
+        // Shared for writing too: the line software keeps today's log open
+        std::ifstream file(StringToWString(filePath), std::ios::binary);
+        if (!file.is_open())
+        {
+            error = "Failed to open file: " + filePath;
+            return false;
         }
-        catch (const std::exception& ex)
+
+        BarrelLogAnalyzer analyzer;
+        if (!analyzer.FeedStream(file))
         {
-            json error;
-            error["success"] = false;
-            error["error"] = ex.what();
-            return error.dump();
+            error = "Failed to read file: " + filePath;
+            return false;
         }
+        analyzer.Finish();
+
+        analyzer.BuildResult(resultJson);
+        return true;
     }
 }
\ No newline at end of file
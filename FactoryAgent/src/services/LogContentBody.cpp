@@ -0,0 +1,109 @@
+#include "../include/services/LogContentBody.h"
+#include "../include/services/LogAnalyzerCommands.h"
+#include "../include/common/Constants.h"
+#include <algorithm>
+
+LogContentBody::LogContentBody() : escaper_(2) {
+    contentLength_ = 0;
+    position_ = 0;
+    fileOffset_ = 0;
+}
+
+LogContentBody::~LogContentBody() {
+}
+
+long long LogContentBody::GetLength() const {
+    return (long long)head_.size() + contentLength_ + (long long)tail_.size();
+}
+
+bool LogContentBody::Open(const std::string& filePath, int commandId, std::string& error) {
+    // Shared for writing too: the line software keeps today's log open
+    if (!file_.OpenShared(LogAnalyzer::StringToWString(filePath))) {
+        error = "Failed to open file: " + filePath;
+        return false;
+    }
+    long long size = file_.GetSize();
+
+    // Members in the order json::dump writes them, so the server sees the body it always did
+    std::string resultHead = "{\"content\":\"";
+    std::string resultTail = "\",\"encoding\":\"UTF-8\",\"size\":" + std::to_string(size) + ",\"success\":true}";
+    JsonEscaper literal(1);
+
+    head_ = "{\"commandId\":" + std::to_string(commandId) + ",\"errorMessage\":\"\",\"resultData\":\"";
+    literal.Escape(resultHead.data(), resultHead.size(), &head_);
+    tail_.clear();
+    literal.Escape(resultTail.data(), resultTail.size(), &tail_);
+    tail_ += "\",\"status\":\"" + std::string(AgentConstants::STATUS_COMPLETED) + "\"}";
+
+    // The length goes in the request headers, before any of the body
+    escaper_.Reset();
+    contentLength_ = 0;
+    for (long long offset = 0; offset < size; offset += AgentConstants::LOG_CONTENT_WINDOW_BYTES) {
+        size_t length = (size_t)std::min((long long)AgentConstants::LOG_CONTENT_WINDOW_BYTES, size - offset);
+        const char* data = file_.MapWindow(offset, length);
+        if (data == NULL) {
+            error = "Failed to read file: " + filePath;
+            return false;
+        }
+        contentLength_ += (long long)escaper_.Escape(data, length, NULL);
+    }
+    contentLength_ += (long long)escaper_.Finish(NULL);
+
+    position_ = 0;
+    fileOffset_ = 0;
+    return true;
+}
+
+bool LogContentBody::Read(long long offset, const char*& data, size_t& length) {
+    // A retried request starts the body again
+    if (offset == 0) {
+        position_ = 0;
+        fileOffset_ = 0;
+        escaper_.Reset();
+    }
+    if (offset != position_) {
+        return false;
+    }
+
+    long long headLength = (long long)head_.size();
+    long long contentEnd = headLength + contentLength_;
+    long long size = file_.GetSize();
+
+    if (position_ < headLength) {
+        data = head_.data() + position_;
+        length = (size_t)(headLength - position_);
+    }
+    else if (position_ < contentEnd) {
+        window_.clear();
+        if (fileOffset_ < size) {
+            size_t mapped = (size_t)std::min((long long)AgentConstants::LOG_CONTENT_WINDOW_BYTES, size - fileOffset_);
+            const char* bytes = file_.MapWindow(fileOffset_, mapped);
+            if (bytes == NULL) {
+                return false;
+            }
+            escaper_.Escape(bytes, mapped, &window_);
+            fileOffset_ += (long long)mapped;
+        }
+        if (fileOffset_ == size) {
+            escaper_.Finish(&window_);
+        }
+
+        // Bytes rewritten since Open would no longer fit the length already sent
+        if (window_.empty() || position_ + (long long)window_.size() > contentEnd) {
+            return false;
+        }
+        data = window_.data();
+        length = window_.size();
+    }
+    else {
+        long long within = position_ - contentEnd;
+        if (within >= (long long)tail_.size()) {
+            return false;
+        }
+        data = tail_.data() + within;
+        length = (size_t)((long long)tail_.size() - within);
+    }
+
+    position_ += (long long)length;
+    return true;
+}
@@ -0,0 +1,696 @@
+#include "../include/services/LogIndex.h"
+#include "../include/common/Constants.h"
+#include "../include/utilities/DirectoryScanner.h"
+#include "../include/utilities/StringUtils.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+namespace fs = std::filesystem;
+
+namespace {
+    long long Ticks(fs::file_time_type time) {
+        return (long long)time.time_since_epoch().count();
+    }
+
+    std::string FormatTicks(long long ticks) {
+        return StringUtils::FormatFileTime(fs::file_time_type(fs::file_time_type::duration(ticks)));
+    }
+
+    bool SameFiles(const std::vector<LogIndexFile>& a, const std::vector<LogIndexFile>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].name != b[i].name || a[i].size != b[i].size || a[i].writeTime != b[i].writeTime) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool NameLess(const LogIndexFile& a, const LogIndexFile& b) {
+        return a.name < b.name;
+    }
+
+    // FNV-1a 64 over the text and a terminating zero, so "ab","c" and "a","bc" differ.
+    // It tells a changed node from an unchanged one; it does not need to resist forgery
+    unsigned long long Mix(unsigned long long hash, const std::string& text) {
+        for (size_t i = 0; i <= text.size(); i++) {
+            hash ^= i < text.size() ? (unsigned char)text[i] : 0;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    unsigned long long FileFingerprint(const LogIndexFile& file) {
+        // The date as sent, not the raw write time: a change the server cannot see is no change
+        unsigned long long hash = Mix(14695981039346656037ULL, file.name);
+        hash = Mix(hash, std::to_string(file.size));
+        return Mix(hash, file.modifiedDate);
+    }
+}
+
+LogIndex::LogIndex(const std::string& snapshotPath) {
+    snapshotPath_ = snapshotPath;
+    cycle_ = 0;
+    snapshotDirty_ = false;
+    lastSnapshot_ = std::chrono::steady_clock::now();
+    walked_ = false;
+    eventDriven_ = false;
+    relistAll_ = false;
+    LoadSnapshot();
+}
+
+LogIndex::~LogIndex() {
+    SaveSnapshot();
+}
+
+const LogIndexStats& LogIndex::GetStats() const {
+    return stats_;
+}
+
+void LogIndex::SetEventDriven(bool enabled) {
+    std::lock_guard<std::mutex> lock(markMutex_);
+    eventDriven_ = enabled;
+    marked_.clear();
+    relistAll_ = false;
+}
+
+void LogIndex::MarkChanged(const std::vector<std::string>& relativePaths, bool overflowed) {
+    std::lock_guard<std::mutex> lock(markMutex_);
+    if (overflowed) {
+        relistAll_ = true;
+        marked_.clear();
+        return;
+    }
+    if (!relistAll_) {
+        marked_.insert(relativePaths.begin(), relativePaths.end());
+    }
+}
+
+bool LogIndex::Refresh(const std::string& rootPath) {
+    bool changed = false;
+    if (rootPath != rootPath_) {
+        directories_.clear();
+        rootPath_ = rootPath;
+        walked_ = false;
+        changed = true;
+    }
+
+    bool eventDriven = false;
+    bool relistAll = false;
+    std::set<std::string> marked;
+    {
+        std::lock_guard<std::mutex> lock(markMutex_);
+        eventDriven = eventDriven_;
+        relistAll = relistAll_;
+        marked.swap(marked_);
+        relistAll_ = false;
+    }
+
+    stats_.directoriesListed = 0;
+    stats_.filesChecked = 0;
+
+    long long hotSince = Ticks(fs::file_time_type::clock::now() - std::chrono::seconds(AgentConstants::LOG_INDEX_HOT_SECONDS));
+    if (eventDriven && walked_ && !relistAll) {
+        // The watcher named every folder that changed; nothing else is touched
+        if (RefreshMarked(marked, hotSince)) {
+            changed = true;
+        }
+    }
+    else {
+        if (RefreshDirectory("", hotSince, relistAll, true)) {
+            changed = true;
+        }
+        walked_ = true;
+    }
+    cycle_++;
+
+    stats_.directories = (int)directories_.size();
+    stats_.files = 0;
+    std::map<std::string, LogIndexDirectory>::const_iterator it;
+    for (it = directories_.begin(); it != directories_.end(); ++it) {
+        stats_.files += (int)it->second.files.size();
+    }
+
+    if (changed) {
+        snapshotDirty_ = true;
+    }
+
+    // Hot logs change the tree every cycle; the snapshot only has to be recent, not exact
+    if (snapshotDirty_ && std::chrono::steady_clock::now() - lastSnapshot_ >=
+        std::chrono::milliseconds(AgentConstants::LOG_INDEX_SNAPSHOT_INTERVAL_MS)) {
+        SaveSnapshot();
+    }
+
+    return changed;
+}
+
+bool LogIndex::RefreshDirectory(const std::string& relativePath, long long hotSince, bool forceList, bool walk) {
+    fs::path fullPath = FullPath(relativePath);
+    bool known = directories_.count(relativePath) > 0;
+
+    // One stat per folder is the whole cost of a folder nothing happened in
+    std::error_code error;
+    fs::file_time_type written = fs::last_write_time(fullPath, error);
+    if (error) {
+        RemoveSubtree(relativePath);
+        return known;
+    }
+
+    bool changed = false;
+    LogIndexDirectory& directory = directories_[relativePath];
+    std::vector<std::string> knownSubdirectories = directory.subdirectories;
+    if (forceList || !known || directory.writeTime != Ticks(written) || IsVerifyTurn(relativePath)) {
+        LogIndexDirectory listed;
+        listed.writeTime = Ticks(written);
+        if (!ListDirectory(fullPath, directory, listed)) {
+            RemoveSubtree(relativePath);
+            return known;
+        }
+        stats_.directoriesListed++;
+
+        changed = !known || !SameFiles(directory.files, listed.files) ||
+            directory.subdirectories != listed.subdirectories;
+
+        for (size_t i = 0; i < directory.subdirectories.size(); i++) {
+            if (!std::binary_search(listed.subdirectories.begin(), listed.subdirectories.end(),
+                directory.subdirectories[i])) {
+                RemoveSubtree((fs::path(relativePath) / directory.subdirectories[i]).string());
+            }
+        }
+
+        directory.writeTime = listed.writeTime;
+        directory.files.swap(listed.files);
+        directory.subdirectories.swap(listed.subdirectories);
+    }
+    else if (CheckHotFiles(fullPath, directory, hotSince)) {
+        changed = true;
+    }
+
+    std::vector<std::string> subdirectories = directory.subdirectories;
+    for (size_t i = 0; i < subdirectories.size(); i++) {
+        bool isNew = !std::binary_search(knownSubdirectories.begin(), knownSubdirectories.end(), subdirectories[i]);
+        if ((walk || isNew) &&
+            RefreshDirectory((fs::path(relativePath) / subdirectories[i]).string(), hotSince, forceList && walk, true)) {
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        directory.Invalidate();
+    }
+    return changed;
+}
+
+bool LogIndex::RefreshMarked(const std::set<std::string>& marked, long long hotSince) {
+    // A file that was only written is stat'ed on its own; anything else lists the folder that
+    // holds it, and a folder named itself is listed too
+    std::set<std::string> folders;
+    std::map<std::string, std::set<std::string> > writtenFiles;
+    std::set<std::string>::const_iterator it;
+    for (it = marked.begin(); it != marked.end(); ++it) {
+        fs::path path(*it);
+        std::string parent = path.parent_path().string();
+        std::string name = path.filename().string();
+
+        std::map<std::string, LogIndexDirectory>::const_iterator holder = directories_.find(parent);
+        if (holder == directories_.end()) {
+            continue;
+        }
+        LogIndexFile probe;
+        probe.name = name;
+        if (std::binary_search(holder->second.files.begin(), holder->second.files.end(), probe, NameLess)) {
+            writtenFiles[parent].insert(name);
+        }
+        else {
+            folders.insert(parent);
+        }
+        if (directories_.count(*it) > 0) {
+            folders.insert(*it);
+        }
+    }
+
+    // The backstop still applies: a missed event is caught within LOG_INDEX_VERIFY_CYCLES
+    std::map<std::string, LogIndexDirectory>::const_iterator directory;
+    for (directory = directories_.begin(); directory != directories_.end(); ++directory) {
+        if (IsVerifyTurn(directory->first)) {
+            folders.insert(directory->first);
+        }
+    }
+
+    // Parents sort first, so a removed folder is gone before its own marks come up
+    bool changed = false;
+    for (it = folders.begin(); it != folders.end(); ++it) {
+        if (directories_.count(*it) == 0) {
+            continue;
+        }
+        if (RefreshDirectory(*it, hotSince, true, false)) {
+            InvalidateAncestors(*it);
+            changed = true;
+        }
+    }
+
+    std::map<std::string, std::set<std::string> >::const_iterator written;
+    for (written = writtenFiles.begin(); written != writtenFiles.end(); ++written) {
+        std::map<std::string, LogIndexDirectory>::iterator holder = directories_.find(written->first);
+        if (folders.count(written->first) > 0 || holder == directories_.end()) {
+            continue;
+        }
+        bool missing = false;
+        if (CheckFiles(FullPath(written->first), holder->second, written->second, missing)) {
+            holder->second.Invalidate();
+            InvalidateAncestors(written->first);
+            changed = true;
+        }
+
+        // Removed or renamed away rather than written: the folder's listing says which
+        if (missing && RefreshDirectory(written->first, hotSince, true, false)) {
+            InvalidateAncestors(written->first);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void LogIndex::InvalidateAncestors(const std::string& relativePath) {
+    fs::path path(relativePath);
+    while (!path.empty()) {
+        path = path.parent_path();
+        std::map<std::string, LogIndexDirectory>::iterator it = directories_.find(path.string());
+        if (it != directories_.end()) {
+            it->second.Invalidate();
+        }
+    }
+}
+
+bool LogIndex::ListDirectory(const fs::path& fullPath, const LogIndexDirectory& previous, LogIndexDirectory& listed) {
+    // Size and write time come with the listing, so this is no stat per file on Windows
+    std::vector<ScanEntry> entries;
+    if (!DirectoryScanner::ListFolder(fullPath.string(), entries)) {
+        return false;
+    }
+
+    // Already sorted by name; linked folders are not followed, as in LogService::BuildDirectoryTree
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].isDirectory) {
+            if (!entries[i].isLink) {
+                listed.subdirectories.push_back(entries[i].name);
+            }
+        }
+        else {
+            LogIndexFile file;
+            file.name.swap(entries[i].name);
+            file.size = entries[i].size;
+            file.writeTime = entries[i].writeTime;
+            listed.files.push_back(file);
+        }
+    }
+
+    // Formatting a date is most of what a file costs once the stat is paid
+    size_t p = 0;
+    for (size_t i = 0; i < listed.files.size(); i++) {
+        LogIndexFile& file = listed.files[i];
+        while (p < previous.files.size() && previous.files[p].name < file.name) {
+            p++;
+        }
+        if (p < previous.files.size() && previous.files[p].name == file.name &&
+            previous.files[p].writeTime == file.writeTime) {
+            file.modifiedDate = previous.files[p].modifiedDate;
+        }
+        else {
+            file.modifiedDate = FormatTicks(file.writeTime);
+        }
+    }
+    return true;
+}
+
+bool LogIndex::CheckHotFiles(const fs::path& fullPath, LogIndexDirectory& directory, long long hotSince) {
+    // A removed file changed the folder's write time too; the next listing drops it
+    bool changed = false;
+    bool missing = false;
+    for (size_t i = 0; i < directory.files.size(); i++) {
+        if (directory.files[i].writeTime >= hotSince && CheckFile(fullPath, directory.files[i], missing)) {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool LogIndex::CheckFiles(const fs::path& fullPath, LogIndexDirectory& directory,
+    const std::set<std::string>& names, bool& missing) {
+    bool changed = false;
+    for (size_t i = 0; i < directory.files.size(); i++) {
+        if (names.count(directory.files[i].name) > 0 && CheckFile(fullPath, directory.files[i], missing)) {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool LogIndex::CheckFile(const fs::path& fullPath, LogIndexFile& file, bool& missing) {
+    std::error_code error;
+    fs::path filePath = fullPath / file.name;
+    unsigned long long size = (unsigned long long)fs::file_size(filePath, error);
+    if (error) {
+        missing = true;
+        return false;
+    }
+    long long writeTime = Ticks(fs::last_write_time(filePath, error));
+    if (error) {
+        missing = true;
+        return false;
+    }
+    stats_.filesChecked++;
+
+    if (size == file.size && writeTime == file.writeTime) {
+        return false;
+    }
+
+    file.size = size;
+    if (writeTime != file.writeTime) {
+        file.writeTime = writeTime;
+        file.modifiedDate = FormatTicks(writeTime);
+    }
+    return true;
+}
+
+void LogIndex::RemoveSubtree(const std::string& relativePath) {
+    std::map<std::string, LogIndexDirectory>::iterator it = directories_.find(relativePath);
+    if (it == directories_.end()) {
+        return;
+    }
+
+    std::vector<std::string> subdirectories = it->second.subdirectories;
+    directories_.erase(it);
+    for (size_t i = 0; i < subdirectories.size(); i++) {
+        RemoveSubtree((fs::path(relativePath) / subdirectories[i]).string());
+    }
+}
+
+const std::string& LogIndex::SerializeTree() {
+    return SerializeChildren("");
+}
+
+const std::string& LogIndex::SerializeChildren(const std::string& relativePath) {
+    static const std::string empty = "[]";
+
+    std::map<std::string, LogIndexDirectory>::iterator found = directories_.find(relativePath);
+    if (found == directories_.end()) {
+        return empty;
+    }
+
+    LogIndexDirectory& directory = found->second;
+    if (!directory.serialized.empty()) {
+        return directory.serialized;
+    }
+
+    // Written out by hand in the key order json::dump uses, so unchanged subtrees can be spliced in
+    std::string text = "[";
+    size_t f = 0;
+    size_t d = 0;
+    while (f < directory.files.size() || d < directory.subdirectories.size()) {
+        if (text.size() > 1) {
+            text += ",";
+        }
+
+        // Files and folders interleaved by name, the order a listing of the folder gives
+        bool takeFile = d >= directory.subdirectories.size() ||
+            (f < directory.files.size() && directory.files[f].name < directory.subdirectories[d]);
+        if (takeFile) {
+            text += SerializeFile(relativePath, directory.files[f++]);
+        }
+        else {
+            const std::string& name = directory.subdirectories[d++];
+            text += SerializeFolder((fs::path(relativePath) / name).string(), name);
+        }
+    }
+    text += "]";
+
+    directory.serialized.swap(text);
+    return directory.serialized;
+}
+
+std::string LogIndex::SerializeFile(const std::string& parentPath, const LogIndexFile& file) {
+    return "{\"isDirectory\":false,\"modifiedDate\":" + json(file.modifiedDate).dump() +
+        ",\"name\":" + json(file.name).dump() +
+        ",\"path\":" + json((fs::path(parentPath) / file.name).string()).dump() +
+        ",\"size\":" + std::to_string(file.size) + "}";
+}
+
+std::string LogIndex::SerializeFolder(const std::string& relativePath, const std::string& name) {
+    return "{\"children\":" + SerializeChildren(relativePath) +
+        ",\"isDirectory\":true,\"name\":" + json(name).dump() +
+        ",\"path\":" + json(relativePath).dump() + "}";
+}
+
+std::string LogIndex::GetVersion() {
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", Fingerprint(""));
+    return text;
+}
+
+unsigned long long LogIndex::Fingerprint(const std::string& relativePath) {
+    std::map<std::string, LogIndexDirectory>::iterator found = directories_.find(relativePath);
+    if (found != directories_.end() && found->second.fingerprinted) {
+        return found->second.fingerprint;
+    }
+
+    LogTreeFolder folder;
+    DescribeFolder(relativePath, folder);
+    return folder.fingerprint;
+}
+
+void LogIndex::DescribeFolder(const std::string& relativePath, LogTreeFolder& folder) {
+    folder = LogTreeFolder();
+    std::map<std::string, LogIndexDirectory>::iterator found = directories_.find(relativePath);
+    if (found == directories_.end()) {
+        folder.fingerprint = Mix(14695981039346656037ULL, "");
+        return;
+    }
+
+    LogIndexDirectory& directory = found->second;
+    size_t f = 0;
+    size_t d = 0;
+    folder.entries.reserve(directory.files.size() + directory.subdirectories.size());
+    unsigned long long hash = 14695981039346656037ULL;
+    while (f < directory.files.size() || d < directory.subdirectories.size()) {
+        LogTreeEntry entry;
+        const std::string* name;
+        if (d >= directory.subdirectories.size() ||
+            (f < directory.files.size() && directory.files[f].name < directory.subdirectories[d])) {
+            name = &directory.files[f].name;
+            entry.fingerprint = FileFingerprint(directory.files[f++]);
+        }
+        else {
+            name = &directory.subdirectories[d++];
+            entry.isDirectory = true;
+            entry.fingerprint = Fingerprint((fs::path(relativePath) / *name).string());
+        }
+
+        entry.nameOffset = (unsigned int)folder.names.size();
+        entry.nameLength = (unsigned int)name->size();
+        folder.names += *name;
+        folder.entries.push_back(entry);
+
+        hash = Mix(hash, *name);
+        hash = Mix(hash, entry.isDirectory ? "d" : "f");
+        hash = Mix(hash, std::to_string(entry.fingerprint));
+    }
+    folder.fingerprint = Mix(hash, "");
+    folder.names.shrink_to_fit();
+
+    directory.fingerprint = folder.fingerprint;
+    directory.fingerprinted = true;
+}
+
+void LogIndex::DescribeTree(LogTreeBase& tree) {
+    tree.clear();
+    DescribeSubtree("", tree);
+}
+
+void LogIndex::DescribeSubtree(const std::string& relativePath, LogTreeBase& tree) {
+    LogTreeFolder& folder = tree[relativePath];
+    DescribeFolder(relativePath, folder);
+    for (size_t i = 0; i < folder.entries.size(); i++) {
+        if (folder.entries[i].isDirectory) {
+            DescribeSubtree((fs::path(relativePath) / folder.Name(folder.entries[i])).string(), tree);
+        }
+    }
+}
+
+void LogIndex::Diff(const LogTreeBase& base, json& ops, LogTreeBase& changed, std::vector<std::string>& removed) {
+    ops = json::array();
+    changed.clear();
+    removed.clear();
+    DiffFolder("", base, ops, changed, removed);
+}
+
+void LogIndex::DiffFolder(const std::string& relativePath, const LogTreeBase& base, json& ops,
+    LogTreeBase& changed, std::vector<std::string>& removed) {
+    static const LogTreeFolder none;
+
+    // Equal fingerprints: nothing below this folder changed, so none of it is looked at
+    LogTreeBase::const_iterator held = base.find(relativePath);
+    if (held != base.end() && held->second.fingerprint == Fingerprint(relativePath)) {
+        return;
+    }
+    const LogTreeFolder& before = held != base.end() ? held->second : none;
+
+    LogTreeFolder& after = changed[relativePath];
+    DescribeFolder(relativePath, after);
+
+    size_t b = 0;
+    size_t a = 0;
+    while (b < before.entries.size() || a < after.entries.size()) {
+        const LogTreeEntry* old = b < before.entries.size() ? &before.entries[b] : NULL;
+        const LogTreeEntry* now = a < after.entries.size() ? &after.entries[a] : NULL;
+        std::string_view oldName = old ? before.Name(*old) : std::string_view();
+        std::string_view nowName = now ? after.Name(*now) : std::string_view();
+
+        if (!now || (old && oldName < nowName)) {
+            std::string path = (fs::path(relativePath) / std::string(oldName)).string();
+            ops.push_back({ { "op", "remove" }, { "path", path } });
+            if (old->isDirectory) {
+                removed.push_back(path);
+            }
+            b++;
+            continue;
+        }
+
+        std::string name(nowName);
+        std::string path = (fs::path(relativePath) / name).string();
+        bool sameName = old && oldName == nowName;
+        if (!sameName || now->isDirectory != old->isDirectory) {
+            // An add replaces a node of the same name, so a file that became a folder needs no remove
+            if (sameName && old->isDirectory) {
+                removed.push_back(path);
+            }
+            ops.push_back({ { "op", "add" }, { "node", json::parse(SerializeNode(relativePath, name, now->isDirectory)) } });
+            if (now->isDirectory) {
+                DescribeSubtree(path, changed);
+            }
+        }
+        else if (now->fingerprint != old->fingerprint) {
+            if (now->isDirectory) {
+                DiffFolder(path, base, ops, changed, removed);
+            }
+            else {
+                ops.push_back({ { "op", "modify" }, { "node", json::parse(SerializeNode(relativePath, name, false)) } });
+            }
+        }
+
+        if (sameName) {
+            b++;
+        }
+        a++;
+    }
+}
+
+std::string LogIndex::SerializeNode(const std::string& parentPath, const std::string& name, bool isDirectory) {
+    if (isDirectory) {
+        return SerializeFolder((fs::path(parentPath) / name).string(), name);
+    }
+
+    const LogIndexDirectory& directory = directories_[parentPath];
+    LogIndexFile probe;
+    probe.name = name;
+    std::vector<LogIndexFile>::const_iterator file =
+        std::lower_bound(directory.files.begin(), directory.files.end(), probe, NameLess);
+    return SerializeFile(parentPath, *file);
+}
+
+bool LogIndex::IsVerifyTurn(const std::string& relativePath) const {
+    // Spread over the cycles, so the backstop never lists the whole tree at once
+    size_t slot = std::hash<std::string>()(relativePath) % (size_t)AgentConstants::LOG_INDEX_VERIFY_CYCLES;
+    return slot == (size_t)(cycle_ % AgentConstants::LOG_INDEX_VERIFY_CYCLES);
+}
+
+fs::path LogIndex::FullPath(const std::string& relativePath) const {
+    return relativePath.empty() ? fs::path(rootPath_) : fs::path(rootPath_) / relativePath;
+}
+
+void LogIndex::LoadSnapshot() {
+    std::ifstream file(snapshotPath_);
+    if (!file.is_open()) {
+        return;
+    }
+
+    json snapshot = json::parse(file, nullptr, false);
+    if (!snapshot.is_object() || !snapshot.contains("root") || !snapshot.contains("directories") ||
+        !snapshot["directories"].is_object()) {
+        return;
+    }
+
+    // A field missing or of the wrong type discards the snapshot; the first Refresh rebuilds it
+    try {
+        std::map<std::string, LogIndexDirectory> directories;
+        for (json::const_iterator it = snapshot["directories"].begin(); it != snapshot["directories"].end(); ++it) {
+            const json& entry = it.value();
+            LogIndexDirectory directory;
+            directory.writeTime = entry.at("writeTime").get<long long>();
+            directory.subdirectories = entry.at("subdirectories").get<std::vector<std::string> >();
+
+            const json& files = entry.at("files");
+            for (size_t i = 0; i < files.size(); i++) {
+                LogIndexFile indexed;
+                indexed.name = files[i].at(0).get<std::string>();
+                indexed.size = files[i].at(1).get<unsigned long long>();
+                indexed.writeTime = files[i].at(2).get<long long>();
+                indexed.modifiedDate = files[i].at(3).get<std::string>();
+                directory.files.push_back(indexed);
+            }
+            directories[it.key()] = directory;
+        }
+
+        rootPath_ = snapshot["root"].get<std::string>();
+        directories_.swap(directories);
+    }
+    catch (const std::exception&) {
+        directories_.clear();
+    }
+}
+
+void LogIndex::SaveSnapshot() {
+    if (!snapshotDirty_) {
+        return;
+    }
+
+    json snapshot;
+    snapshot["root"] = rootPath_;
+    snapshot["directories"] = json::object();
+
+    std::map<std::string, LogIndexDirectory>::const_iterator it;
+    for (it = directories_.begin(); it != directories_.end(); ++it) {
+        json entry;
+        entry["writeTime"] = it->second.writeTime;
+        entry["subdirectories"] = it->second.subdirectories;
+        entry["files"] = json::array();
+        for (size_t i = 0; i < it->second.files.size(); i++) {
+            const LogIndexFile& indexed = it->second.files[i];
+            entry["files"].push_back(json::array({ indexed.name, indexed.size, indexed.writeTime, indexed.modifiedDate }));
+        }
+        snapshot["directories"][it->first] = entry;
+    }
+
+    // Written aside and renamed, so a crash mid-write leaves the previous snapshot
+    std::string tempPath = snapshotPath_ + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        file << snapshot.dump();
+        if (!file.good()) {
+            return;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempPath, snapshotPath_, error);
+    if (!error) {
+        snapshotDirty_ = false;
+        lastSnapshot_ = std::chrono::steady_clock::now();
+    }
+}
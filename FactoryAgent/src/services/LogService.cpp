@@ -1,6 +1,10 @@
 #include "../include/services/LogService.h"
+#include "../include/services/LogIndex.h"
+#include "../include/monitoring/DirectoryWatcher.h"
 #include "../include/network/HttpClient.h"
 #include "../include/utilities/FileUtils.h"
+#include "../include/utilities/StringUtils.h"
+#include "../include/utilities/DirectoryScanner.h"
 #include "../include/common/Constants.h"
 #include <windows.h>
 #include <filesystem>
@@ -10,92 +14,241 @@
 
 namespace fs = std::filesystem;
 
+namespace {
+    // Drops a folder and every folder below it
+    void EraseSubtree(LogTreeBase& tree, const std::string& relativePath) {
+        LogTreeBase::iterator it = tree.lower_bound(relativePath);
+        while (it != tree.end() && it->first.compare(0, relativePath.size(), relativePath) == 0) {
+            if (it->first.size() == relativePath.size() ||
+                it->first[relativePath.size()] == (char)fs::path::preferred_separator) {
+                it = tree.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    // Children of folder as BuildDirectoryTree lists them; linked folders are left out, a junction
+    // back up the tree would make it endless
+    json ScannedChildren(const std::vector<ScanEntry>& entries, const ScanEntry& folder, const std::string& folderPath) {
+        json children = json::array();
+        for (int i = folder.firstChild; i < folder.firstChild + folder.childCount; i++) {
+            const ScanEntry& entry = entries[i];
+            if (entry.isDirectory && entry.isLink) {
+                continue;
+            }
+
+            json node;
+            std::string path = DirectoryScanner::RelativePath(folderPath, entry);
+            node["name"] = entry.name;
+            node["path"] = path;
+            node["isDirectory"] = entry.isDirectory;
+            if (entry.isDirectory) {
+                node["children"] = ScannedChildren(entries, entry, path);
+            }
+            else {
+                node["size"] = entry.size;
+                node["modifiedDate"] = LogService::FormatTime(
+                    fs::file_time_type(fs::file_time_type::duration(entry.writeTime)));
+            }
+            children.push_back(node);
+        }
+        return children;
+    }
+}
+
 LogService::LogService(AgentSettings* settings, HttpClient* client) {
     settings_ = settings;
     httpClient_ = client;
-    lastSyncedStructure_ = "";
+    logIndex_ = new LogIndex(AgentConstants::LOG_INDEX_FILE_NAME);
+    logWatcher_ = new DirectoryWatcher();
+    deltaEnabled_ = false;
+    pendingFull_ = true;
 }
 
 LogService::~LogService() {
+    delete logWatcher_;
+    delete logIndex_;
+}
+
+bool LogService::StartWatching(HANDLE changedEvent) {
+    LogIndex* index = logIndex_;
+    bool started = logWatcher_->Start(settings_->logFolderPath, true, [index, changedEvent](const DirectoryChanges& changes) {
+        index->MarkChanged(changes.paths, changes.overflowed);
+        if (changes.entriesChanged || changes.overflowed) {
+            SetEvent(changedEvent);
+        }
+    });
+
+    // Without a watcher (folder missing, share that does not notify) the index keeps walking
+    logIndex_->SetEventDriven(started);
+    return started;
+}
+
+void LogService::StopWatching() {
+    logWatcher_->Stop();
+    logIndex_->SetEventDriven(false);
 }
 
 std::string LogService::FormatTime(fs::file_time_type ftime) {
-    try {
-        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-            ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now()
-        );
-        std::time_t cftime = std::chrono::system_clock::to_time_t(sctp);
+    return StringUtils::FormatFileTime(ftime);
+}
 
-        std::stringstream ss;
-        struct tm timeinfo;
-        localtime_s(&timeinfo, &cftime);
-        ss << std::put_time(&timeinfo, "%Y-%m-%d %H:%M:%S");
-        return ss.str();
+json LogService::BuildDirectoryTree(const fs::path& currentPath, const fs::path& rootPath) {
+    // One scan brings every name, size and write time; the JSON is built from it without touching the disk
+    DirectoryScanner scanner;
+    std::vector<ScanEntry> entries;
+    if (!scanner.Scan(currentPath.string(), true, entries)) {
+        return json::array();
     }
-    catch (...) {
-        return "2000-01-01 00:00:00";
+
+    fs::path relativePath = currentPath.lexically_relative(rootPath);
+    if (relativePath == ".") {
+        relativePath.clear();
     }
+    return ScannedChildren(entries, entries[0], relativePath.string());
 }
 
-json LogService::BuildDirectoryTree(const fs::path& currentPath, const fs::path& rootPath) {
-    json children = json::array();
+void LogService::SyncLogsToServer() {
+    json section;
+    if (!CollectSyncSection(section)) {
+        return;
+    }
 
-    // Safety check
-    if (!fs::exists(currentPath) || !fs::is_directory(currentPath)) {
-        return children;
+    if (section.contains("ops")) {
+        bool needFull = false;
+        if (PostDelta(section, needFull)) {
+            AcknowledgeSyncSection(section);
+            return;
+        }
+
+        // A network failure just leaves the same delta for the next cycle
+        if (!needFull) {
+            return;
+        }
+        ResetSyncBase();
+        if (!CollectSyncSection(section)) {
+            return;
+        }
     }
 
-    for (const auto& entry : fs::directory_iterator(currentPath)) {
-        try {
-            json node;
+    json request;
+    request["pcId"] = settings_->pcId;
+    request["logStructureJson"] = section["logStructureJson"];
+    request["version"] = section["version"];
 
-            node["name"] = entry.path().filename().string();
-            node["path"] = fs::relative(entry.path(), rootPath).string();
-            node["isDirectory"] = entry.is_directory();
+    json response;
+    if (httpClient_->Post(AgentConstants::ENDPOINT_SYNC_LOGS, request, response)) {
+        AcknowledgeSyncSection(section);
+    }
+}
 
-            if (entry.is_regular_file()) {
-                node["size"] = entry.file_size();
-                node["modifiedDate"] = FormatTime(fs::last_write_time(entry));
-            }
-            else if (entry.is_directory()) {
-                node["children"] = BuildDirectoryTree(entry.path(), rootPath);
-            }
+bool LogService::PostDelta(const json& section, bool& needFull) {
+    json request = section;
+    request["pcId"] = settings_->pcId;
 
-            children.push_back(node);
-        }
-        catch (const std::exception& ex) {
-            // Skip files/folders that cannot be accessed
-            continue;
-        }
+    json response;
+    int statusCode = 0;
+    bool posted = httpClient_->Post(AgentConstants::ENDPOINT_SYNC_LOGS_DELTA, request, response, statusCode);
+
+    // Server rolled back to a build without log deltas: whole trees from now on
+    if (statusCode == AgentConstants::HTTP_NOT_FOUND) {
+        SetDeltaSyncEnabled(false);
+        needFull = true;
+        return false;
+    }
+
+    if (!posted) {
+        return false;
+    }
+    if (response.value("success", false)) {
+        return true;
     }
-    return children;
+
+    needFull = response.value("needFull", false);
+    return false;
 }
 
-void LogService::SyncLogsToServer() {
+bool LogService::CollectSyncSection(json& section) {
     if (!FileUtils::FolderExists(settings_->logFolderPath)) {
-        return;
+        return false;
     }
 
     try {
-        fs::path rootPath(settings_->logFolderPath);
-        json fileTree = BuildDirectoryTree(rootPath, rootPath);
-
-        std::string currentStructureJson = fileTree.dump();
-        if (currentStructureJson == lastSyncedStructure_) {
-            return;  // No changes, skip sync
+        // Only folders that changed are listed again; an idle tree costs one stat per folder
+        logIndex_->Refresh(settings_->logFolderPath);
+        std::string version = logIndex_->GetVersion();
+        if (version == serverVersion_) {
+            return false;  // No changes, skip sync
         }
 
-        json request;
-        request["pcId"] = settings_->pcId;
-        request["logStructureJson"] = currentStructureJson;
+        section = json::object();
+        section["version"] = version;
+        pendingVersion_ = version;
+        pendingFull_ = true;
+        pendingFolders_.clear();
+        pendingRemoved_.clear();
+
+        if (deltaEnabled_ && !serverVersion_.empty()) {
+            json ops;
+            logIndex_->Diff(serverTree_, ops, pendingFolders_, pendingRemoved_);
+
+            // A tree mostly replaced is cheaper whole
+            if (ops.dump().length() < logIndex_->SerializeTree().length()) {
+                section["baseVersion"] = serverVersion_;
+                section["ops"] = ops;
+                pendingFull_ = false;
+                return true;
+            }
+        }
 
-        json response;
-        if (httpClient_->Post(AgentConstants::ENDPOINT_SYNC_LOGS, request, response)) {
-            lastSyncedStructure_ = currentStructureJson;
+        section["logStructureJson"] = logIndex_->SerializeTree();
+        if (deltaEnabled_) {
+            logIndex_->DescribeTree(pendingFolders_);
         }
+        return true;
     }
     catch (const std::exception& ex) {
         // Silently fail or log to local debug console if needed
         // std::cerr << "Log Sync Error: " << ex.what() << std::endl;
+        return false;
     }
-}
\ No newline at end of file
+}
+
+void LogService::AcknowledgeSyncSection(const json& section) {
+    std::string version = section.value("version", "");
+    if (version.empty() || version != pendingVersion_) {
+        return;
+    }
+
+    if (pendingFull_) {
+        serverTree_.swap(pendingFolders_);
+    }
+    else {
+        for (size_t i = 0; i < pendingRemoved_.size(); i++) {
+            EraseSubtree(serverTree_, pendingRemoved_[i]);
+        }
+        for (LogTreeBase::iterator it = pendingFolders_.begin(); it != pendingFolders_.end(); ++it) {
+            std::swap(serverTree_[it->first], it->second);
+        }
+    }
+
+    serverVersion_ = version;
+    pendingVersion_.clear();
+    pendingFolders_.clear();
+    pendingRemoved_.clear();
+}
+
+void LogService::SetDeltaSyncEnabled(bool enabled) {
+    deltaEnabled_ = enabled;
+    ResetSyncBase();
+}
+
+void LogService::ResetSyncBase() {
+    serverVersion_.clear();
+    serverTree_.clear();
+    pendingVersion_.clear();
+    pendingFolders_.clear();
+    pendingRemoved_.clear();
+}
@@ -0,0 +1,134 @@
+#include "../include/services/ModelCacheIndex.h"
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+ModelCacheIndex::ModelCacheIndex(const std::string& indexPath) {
+    indexPath_ = indexPath;
+    Load();
+}
+
+ModelCacheIndex::~ModelCacheIndex() {
+}
+
+bool ModelCacheIndex::Lookup(const std::string& modelName, const std::string& folderPath,
+    DownloadValidators& validators) {
+    std::string fingerprint = FingerprintFolder(folderPath);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fingerprint.empty() || !entries_.contains(modelName)) {
+        return false;
+    }
+
+    const json& entry = entries_[modelName];
+    if (entry.value("fingerprint", "") != fingerprint) {
+        return false;
+    }
+
+    validators.etag = entry.value("etag", "");
+    validators.lastModified = entry.value("lastModified", "");
+    validators.sha256 = entry.value("sha256", "");
+    return true;
+}
+
+void ModelCacheIndex::Record(const std::string& modelName, const std::string& folderPath,
+    const DownloadValidators& validators) {
+    std::string fingerprint = FingerprintFolder(folderPath);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fingerprint.empty() || (validators.IsEmpty() && validators.sha256.empty())) {
+        entries_.erase(modelName);
+    }
+    else {
+        json entry;
+        entry["etag"] = validators.etag;
+        entry["lastModified"] = validators.lastModified;
+        entry["sha256"] = validators.sha256;
+        entry["fingerprint"] = fingerprint;
+        entries_[modelName] = entry;
+    }
+    Save();
+}
+
+void ModelCacheIndex::Forget(const std::string& modelName) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.erase(modelName) > 0) {
+        Save();
+    }
+}
+
+std::string ModelCacheIndex::FingerprintFolder(const std::string& folderPath) {
+    std::error_code error;
+    fs::path root(folderPath);
+    if (!fs::is_directory(root, error)) {
+        return "";
+    }
+
+    std::vector<std::string> records;
+    for (fs::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error)) {
+            continue;
+        }
+
+        unsigned long long size = (unsigned long long)it->file_size(error);
+        long long written = (long long)it->last_write_time(error).time_since_epoch().count();
+        records.push_back(fs::relative(it->path(), root, error).generic_string() + "|" +
+            std::to_string(size) + "|" + std::to_string(written));
+    }
+    if (error) {
+        return "";
+    }
+
+    // Directory order is not guaranteed, the fingerprint has to be
+    std::sort(records.begin(), records.end());
+
+    // FNV-1a 64; this detects local edits, it does not need to resist forgery
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < records.size(); i++) {
+        const std::string& record = records[i];
+        for (size_t c = 0; c <= record.size(); c++) {
+            hash ^= (c < record.size()) ? (unsigned char)record[c] : (unsigned char)'\n';
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", hash);
+    return std::to_string(records.size()) + "-" + text;
+}
+
+void ModelCacheIndex::Load() {
+    entries_ = json::object();
+
+    std::ifstream file(indexPath_);
+    if (!file.is_open()) {
+        return;
+    }
+
+    json loaded = json::parse(file, nullptr, false);
+    if (loaded.is_object()) {
+        entries_ = loaded;
+    }
+}
+
+void ModelCacheIndex::Save() {
+    // Written aside and renamed, so a crash mid-write loses the update rather than the index
+    std::string tempPath = indexPath_ + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            return;
+        }
+        file << entries_.dump(2);
+        if (!file.good()) {
+            return;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(tempPath, indexPath_, error);
+}
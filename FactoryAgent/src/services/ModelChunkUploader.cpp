@@ -0,0 +1,194 @@
+#include "../include/services/ModelChunkUploader.h"
+#include "../include/utilities/ContentChunker.h"
+#include "../include/common/Constants.h"
+#include <filesystem>
+#include <algorithm>
+#include <set>
+
+namespace fs = std::filesystem;
+
+ModelChunkUploader::ModelChunkUploader(HttpClient* client) {
+    httpClient_ = client;
+}
+
+ModelChunkUploader::~ModelChunkUploader() {
+}
+
+const ChunkUploadStats& ModelChunkUploader::GetStats() const {
+    return stats_;
+}
+
+bool ModelChunkUploader::Upload(const std::string& folderPath, const std::string& modelName,
+    const std::wstring& commitEndpoint) {
+    stats_ = ChunkUploadStats();
+
+    json manifest;
+    std::vector<UploadChunk> unique;
+    if (!BuildManifest(folderPath, modelName, manifest, unique)) {
+        return false;
+    }
+
+    std::vector<UploadChunk> missing;
+    if (!QueryMissing(unique, missing) || !SendChunks(missing)) {
+        return false;
+    }
+
+    json response;
+    if (!httpClient_->Post(commitEndpoint, manifest, response)) {
+        return false;
+    }
+    if (response.value("success", false)) {
+        return true;
+    }
+
+    // The store may have dropped chunks since they were queried; send those and commit once more
+    if (!response.contains("missing") || !response["missing"].is_array()) {
+        return false;
+    }
+
+    std::set<std::string> dropped;
+    for (size_t i = 0; i < response["missing"].size(); i++) {
+        if (response["missing"][i].is_string()) {
+            dropped.insert(response["missing"][i].get<std::string>());
+        }
+    }
+
+    missing.clear();
+    for (size_t i = 0; i < unique.size(); i++) {
+        if (dropped.count(unique[i].hash) > 0) {
+            missing.push_back(unique[i]);
+        }
+    }
+    if (missing.empty() || !SendChunks(missing)) {
+        return false;
+    }
+
+    response = json();
+    return httpClient_->Post(commitEndpoint, manifest, response) && response.value("success", false);
+}
+
+bool ModelChunkUploader::BuildManifest(const std::string& folderPath, const std::string& modelName,
+    json& manifest, std::vector<UploadChunk>& unique) {
+    std::error_code error;
+    fs::path root(folderPath);
+    if (!fs::is_directory(root, error)) {
+        return false;
+    }
+
+    // Sorted, so the same folder always produces the same manifest
+    std::vector<fs::path> files;
+    for (fs::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_regular_file(error)) {
+            files.push_back(it->path());
+        }
+    }
+    if (error) {
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    manifest = json::object();
+    manifest["modelName"] = modelName;
+    manifest["files"] = json::array();
+
+    std::set<std::string> seen;
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string filePath = files[i].string();
+
+        std::vector<ContentChunk> chunks;
+        if (!ContentChunker::ChunkFile(filePath, chunks)) {
+            return false;
+        }
+
+        json entry;
+        entry["path"] = fs::relative(files[i], root, error).generic_string();
+        entry["chunks"] = json::array();
+
+        long long size = 0;
+        for (size_t c = 0; c < chunks.size(); c++) {
+            entry["chunks"].push_back(chunks[c].hash);
+            size += (long long)chunks[c].length;
+
+            // Identical chunks inside the model, e.g. padding or duplicated weights, go up once
+            if (seen.insert(chunks[c].hash).second) {
+                UploadChunk chunk;
+                chunk.filePath = filePath;
+                chunk.offset = chunks[c].offset;
+                chunk.length = chunks[c].length;
+                chunk.hash = chunks[c].hash;
+                unique.push_back(chunk);
+            }
+        }
+        entry["size"] = size;
+        manifest["files"].push_back(entry);
+
+        stats_.files++;
+        stats_.totalBytes += size;
+    }
+
+    stats_.chunks = (int)unique.size();
+    return true;
+}
+
+bool ModelChunkUploader::QueryMissing(const std::vector<UploadChunk>& unique, std::vector<UploadChunk>& missing) {
+    missing.clear();
+
+    for (size_t start = 0; start < unique.size(); start += AgentConstants::MODEL_CHUNK_QUERY_HASHES) {
+        size_t end = start + AgentConstants::MODEL_CHUNK_QUERY_HASHES;
+        if (end > unique.size()) {
+            end = unique.size();
+        }
+
+        json request;
+        request["hashes"] = json::array();
+        for (size_t i = start; i < end; i++) {
+            request["hashes"].push_back(unique[i].hash);
+        }
+
+        json response;
+        if (!httpClient_->Post(AgentConstants::ENDPOINT_MODEL_CHUNKS_MISSING, request, response) ||
+            !response.contains("missing") || !response["missing"].is_array()) {
+            return false;
+        }
+
+        std::set<std::string> absent;
+        for (size_t i = 0; i < response["missing"].size(); i++) {
+            if (response["missing"][i].is_string()) {
+                absent.insert(response["missing"][i].get<std::string>());
+            }
+        }
+        for (size_t i = start; i < end; i++) {
+            if (absent.count(unique[i].hash) > 0) {
+                missing.push_back(unique[i]);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ModelChunkUploader::SendChunks(const std::vector<UploadChunk>& chunks) {
+    // Batches of a few megabytes: few enough round trips, and a failure only repeats one batch
+    size_t start = 0;
+    while (start < chunks.size()) {
+        std::vector<UploadChunk> batch;
+        long long batchBytes = 0;
+        while (start < chunks.size() &&
+            (batch.empty() || batchBytes + (long long)chunks[start].length <= AgentConstants::MODEL_CHUNK_BATCH_BYTES)) {
+            batchBytes += (long long)chunks[start].length;
+            batch.push_back(chunks[start]);
+            start++;
+        }
+
+        json response;
+        if (!httpClient_->UploadChunks(AgentConstants::ENDPOINT_MODEL_CHUNKS, batch, response) ||
+            !response.value("success", false)) {
+            return false;
+        }
+
+        stats_.chunksSent += (int)batch.size();
+        stats_.bytesSent += batchBytes;
+    }
+
+    return true;
+}
@@ -1,7 +1,12 @@
 #include "../include/services/ModelService.h"
 #include "../include/network/HttpClient.h"
+#include "../include/services/ModelChunkUploader.h"
+#include "../include/services/ModelCacheIndex.h"
+#include "../include/monitoring/DirectoryWatcher.h"
 #include "../include/utilities/FileUtils.h"
 #include "../include/utilities/ZipUtils.h"
+#include "../include/utilities/StringUtils.h"
+#include "../include/utilities/DirectoryScanner.h"
 #include "../include/common/Constants.h"
 #include <windows.h>
 
@@ -9,9 +14,24 @@ ModelService::ModelService(AgentSettings* settings, HttpClient* client, ConfigMa
     settings_ = settings;
     httpClient_ = client;
     configManager_ = configMgr;
+    modelCache_ = new ModelCacheIndex(AgentConstants::MODEL_CACHE_FILE_NAME);
+    modelWatcher_ = new DirectoryWatcher();
 }
 
 ModelService::~ModelService() {
+    delete modelWatcher_;
+    delete modelCache_;
+}
+
+bool ModelService::StartWatching(HANDLE changedEvent) {
+    // Top level only: the model list is the folders, and writes inside one show up as it changing
+    return modelWatcher_->Start(settings_->modelFolderPath, false, [changedEvent](const DirectoryChanges& changes) {
+        SetEvent(changedEvent);
+    });
+}
+
+void ModelService::StopWatching() {
+    modelWatcher_->Stop();
 }
 
 std::vector<ModelInfo> ModelService::GetModelFolders() {
@@ -21,34 +41,24 @@ std::vector<ModelInfo> ModelService::GetModelFolders() {
         return models;
     }
 
-    std::string searchPath = settings_->modelFolderPath + "\\*.*";
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA(searchPath.c_str(), &findData);
-
-    if (hFind == INVALID_HANDLE_VALUE) {
-        return models;
-    }
-
-    do {
-        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
-            strcmp(findData.cFileName, ".") != 0 &&
-            strcmp(findData.cFileName, "..") != 0 &&
-            strcmp(findData.cFileName, AgentConstants::TEMP_FOLDER_NAME) != 0) {
+    std::vector<ScanEntry> entries;
+    DirectoryScanner::ListFolder(settings_->modelFolderPath, entries);
 
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].isDirectory && entries[i].name != AgentConstants::TEMP_FOLDER_NAME) {
             ModelInfo info;
-            info.modelName = findData.cFileName;
+            info.modelName = entries[i].name;
             info.modelPath = settings_->modelFolderPath + "\\" + info.modelName;
             info.isCurrent = false;
 
             models.push_back(info);
         }
-    } while (FindNextFileA(hFind, &findData));
+    }
 
-    FindClose(hFind);
     return models;
 }
 
-void ModelService::SyncModelsToServer() {
+json ModelService::BuildModelArray() {
     std::vector<ModelInfo> models = GetModelFolders();
 
     std::string configContent;
@@ -66,12 +76,43 @@ void ModelService::SyncModelsToServer() {
         modelArray.push_back(modelInfo);
     }
 
+    return modelArray;
+}
+
+void ModelService::SyncModelsToServer() {
     json request;
     request["pcId"] = settings_->pcId;
-    request["models"] = modelArray;
+    request["models"] = BuildModelArray();
 
     json response;
-    httpClient_->Post(AgentConstants::ENDPOINT_SYNC_MODELS, request, response);
+    if (httpClient_->Post(AgentConstants::ENDPOINT_SYNC_MODELS, request, response)) {
+        json section;
+        section["models"] = request["models"];
+        AcknowledgeSyncSection(section);
+    }
+}
+
+bool ModelService::CollectSyncSection(json& section) {
+    json modelArray = BuildModelArray();
+    std::string current = modelArray.dump();
+
+    // A periodic resend repairs the server copy if someone edited the Models table by hand
+    bool stale = std::chrono::steady_clock::now() - lastModelsAck_ >=
+        std::chrono::seconds(AgentConstants::MODEL_SYNC_REFRESH_SECONDS);
+    if (current == lastSyncedModels_ && !stale) {
+        return false;
+    }
+
+    section = json::object();
+    section["models"] = modelArray;
+    return true;
+}
+
+void ModelService::AcknowledgeSyncSection(const json& section) {
+    if (section.contains("models")) {
+        lastSyncedModels_ = section["models"].dump();
+        lastModelsAck_ = std::chrono::steady_clock::now();
+    }
 }
 
 bool ModelService::ChangeModel(const std::string& modelName) {
@@ -102,18 +143,39 @@ bool ModelService::UploadModelToServer(const json& data) {
 
     std::string downloadUrl = data["DownloadUrl"].get<std::string>();
     std::string modelName = data["ModelName"].get<std::string>();
+    std::string extractPath = settings_->modelFolderPath + "\\" + modelName;
+
+    // An interrupted download leaves <zip>.part behind, which the next attempt resumes
+    std::string expectedSha256 = StringUtils::ToLower(data.value("Sha256", ""));
+
+    DownloadValidators cached;
+    if (modelCache_->Lookup(modelName, extractPath, cached) &&
+        !expectedSha256.empty() && cached.sha256 == expectedSha256) {
+        // The command already names the zip this folder was extracted from
+        ApplyUploadedModel(data, modelName, extractPath);
+        return true;
+    }
 
     std::string tempDir = settings_->modelFolderPath + "\\" + AgentConstants::TEMP_FOLDER_NAME;
     FileUtils::CreateFolder(tempDir);
 
     std::string tempZipPath = tempDir + "\\" + modelName + AgentConstants::ZIP_EXTENSION;
 
-    if (httpClient_->DownloadFile(downloadUrl, tempZipPath)) {
-        std::string extractPath = settings_->modelFolderPath + "\\" + modelName;
+    // Bulk lane: the transfer runs off the interactive threads that carry heartbeats
+    DownloadValidators fresh;
+    DownloadOutcome outcome = httpClient_->DownloadFileIfChangedAsync(downloadUrl, tempZipPath,
+        cached, &fresh, expectedSha256).get();
+
+    if (outcome == DOWNLOAD_NOT_MODIFIED) {
+        ApplyUploadedModel(data, modelName, extractPath);
+        return true;
+    }
 
+    if (outcome == DOWNLOAD_COMPLETED) {
         if (FileUtils::FolderExists(extractPath)) {
             FileUtils::DeleteFolder(extractPath);
         }
+        modelCache_->Forget(modelName);
 
         // Create the folder where we will extract the zip
         FileUtils::CreateFolder(extractPath);
@@ -124,22 +186,12 @@ bool ModelService::UploadModelToServer(const json& data) {
             // REMOVED FLATTENING LOGIC AS REQUESTED
             // The zip content is extracted exactly as is.
 
-            std::string configContent;
-            if (configManager_->ParseConfigFile(settings_->configFilePath, configContent)) {
-
-                // Check if ApplyOnUpload is true
-                bool applyOnUpload = false;
-                if (data.contains("ApplyOnUpload")) {
-                    applyOnUpload = data["ApplyOnUpload"].get<bool>();
-                }
-
-                if (applyOnUpload) {
-                    if (configManager_->UpdateCurrentModel(configContent, modelName, extractPath)) {
-                        configManager_->WriteConfigFile(settings_->configFilePath, configContent);
-                    }
-                }
+            if (fresh.sha256.empty()) {
+                fresh.sha256 = expectedSha256;
             }
+            modelCache_->Record(modelName, extractPath, fresh);
 
+            ApplyUploadedModel(data, modelName, extractPath);
             return true;
         }
 
@@ -149,18 +201,48 @@ bool ModelService::UploadModelToServer(const json& data) {
     return false;
 }
 
+void ModelService::ApplyUploadedModel(const json& data, const std::string& modelName,
+    const std::string& extractPath) {
+    std::string configContent;
+    if (!configManager_->ParseConfigFile(settings_->configFilePath, configContent)) {
+        return;
+    }
+
+    // Check if ApplyOnUpload is true
+    bool applyOnUpload = false;
+    if (data.contains("ApplyOnUpload")) {
+        applyOnUpload = data["ApplyOnUpload"].get<bool>();
+    }
+
+    if (applyOnUpload) {
+        if (configManager_->UpdateCurrentModel(configContent, modelName, extractPath)) {
+            configManager_->WriteConfigFile(settings_->configFilePath, configContent);
+        }
+    }
+}
+
 bool ModelService::DeleteModel(const std::string& modelName) {
     std::string modelPath = settings_->modelFolderPath + "\\" + modelName;
+    modelCache_->Forget(modelName);
     return FileUtils::DeleteFolder(modelPath);
 }
 
-bool ModelService::UploadModelToLibrary(const std::string& modelName, const std::string& uploadUrl) {
+bool ModelService::UploadModelToLibrary(const std::string& modelName, const std::string& uploadUrl,
+    const std::string& chunkedUploadUrl) {
     std::string modelPath = settings_->modelFolderPath + "\\" + modelName;
 
     if (!FileUtils::FolderExists(modelPath)) {
         return false;
     }
 
+    if (!chunkedUploadUrl.empty()) {
+        ModelChunkUploader uploader(httpClient_);
+        std::wstring wChunkedUrl(chunkedUploadUrl.begin(), chunkedUploadUrl.end());
+        if (uploader.Upload(modelPath, modelName, wChunkedUrl)) {
+            return true;
+        }
+    }
+
     std::string tempDir = settings_->modelFolderPath + "\\" + AgentConstants::TEMP_FOLDER_NAME;
     FileUtils::CreateFolder(tempDir);
 
@@ -169,10 +251,9 @@ bool ModelService::UploadModelToLibrary(const std::string& modelName, const std:
     // Use existing ZipUtils
     if (ZipUtils::CreateZip(modelPath, tempZipPath)) {
         if (FileUtils::FileExists(tempZipPath)) {
-            json response;
             // Use the specific uploadUrl provided by server (converted to wstring)
             std::wstring wUploadUrl(uploadUrl.begin(), uploadUrl.end());
-            bool success = httpClient_->UploadFile(wUploadUrl, tempZipPath, "file", response);
+            bool success = httpClient_->UploadFileAsync(wUploadUrl, tempZipPath, "file").get().success;
 
             FileUtils::DeleteFile(tempZipPath);
 
@@ -0,0 +1,147 @@
+#include "../include/services/OutboxService.h"
+#include "../include/network/HttpClient.h"
+#include "../include/common/Constants.h"
+
+namespace {
+    // Endpoints are plain ASCII paths
+    std::string EndpointToString(const std::wstring& endpoint) {
+        return std::string(endpoint.begin(), endpoint.end());
+    }
+
+    std::wstring EndpointFromString(const std::string& endpoint) {
+        return std::wstring(endpoint.begin(), endpoint.end());
+    }
+}
+
+OutboxService::OutboxService(HttpClient* client) {
+    httpClient_ = client;
+    batchEndpointMissing_ = false;
+}
+
+OutboxService::~OutboxService() {
+}
+
+bool OutboxService::Open(const std::string& filePath) {
+    return log_.Open(filePath);
+}
+
+bool OutboxService::Enqueue(const std::wstring& endpoint, const json& body, const std::string& coalesceKey) {
+    long long sequence = 0;
+    return log_.Append(coalesceKey, EndpointToString(endpoint), body.dump(), sequence);
+}
+
+size_t OutboxService::GetPendingCount() const {
+    return log_.GetPendingCount();
+}
+
+bool OutboxService::Flush() {
+    // One replay at a time, or two threads would deliver the same message twice
+    std::lock_guard<std::mutex> lock(flushMutex_);
+
+    std::string resultEndpoint = EndpointToString(AgentConstants::ENDPOINT_COMMAND_RESULT);
+
+    while (true) {
+        // Only a window of the index is held; bodies are read from disk as each batch is built
+        std::vector<OutboxEntry> entries = log_.Peek(AgentConstants::OUTBOX_REPLAY_BATCH);
+        if (entries.empty()) {
+            return true;
+        }
+
+        size_t index = 0;
+        while (index < entries.size()) {
+            size_t delivered = 0;
+            bool unrecorded = false;
+            if (entries[index].endpoint == resultEndpoint && !batchEndpointMissing_) {
+                delivered = DeliverResults(entries, index, unrecorded);
+            }
+            else if (DeliverOne(entries[index], unrecorded)) {
+                delivered = 1;
+            }
+
+            // Stop at the first failure so messages still reach the server in the order they were written.
+            // A delivery the log could not record stops it too: the same batch would come back from Peek
+            // and go out again forever. It is sent once more on the next flush, which the server ignores
+            if (delivered == 0 || unrecorded) {
+                return false;
+            }
+            index += delivered;
+        }
+    }
+}
+
+size_t OutboxService::DeliverResults(const std::vector<OutboxEntry>& entries, size_t start, bool& unrecorded) {
+    json request;
+    request["results"] = json::array();
+
+    size_t batchBytes = 0;
+    size_t end = start;
+    while (end < entries.size() && entries[end].endpoint == entries[start].endpoint &&
+        (end == start || batchBytes + entries[end].bodyLength <= AgentConstants::OUTBOX_REPLAY_BATCH_BYTES)) {
+        std::string body;
+        json result;
+        if (!log_.ReadBody(entries[end], body) || (result = json::parse(body, nullptr, false)).is_discarded()) {
+            // Unreadable, so it can never be sent; drop it rather than block everything behind it
+            if (!log_.Acknowledge(entries[end].sequence)) {
+                unrecorded = true;
+                return 0;
+            }
+            if (end == start) {
+                return 1;
+            }
+            break;
+        }
+
+        request["results"].push_back(result);
+        batchBytes += entries[end].bodyLength;
+        end++;
+    }
+
+    json response;
+    int statusCode = 0;
+    bool sent = httpClient_->Post(AgentConstants::ENDPOINT_COMMAND_RESULTS, request, response, statusCode);
+
+    // A server without the batch endpoint still takes results one at a time
+    if (statusCode == AgentConstants::HTTP_NOT_FOUND) {
+        batchEndpointMissing_ = true;
+        return DeliverOne(entries[start], unrecorded) ? 1 : 0;
+    }
+    if (!IsDelivered(sent, statusCode)) {
+        return 0;
+    }
+
+    for (size_t i = start; i < end; i++) {
+        if (!log_.Acknowledge(entries[i].sequence)) {
+            unrecorded = true;
+            return i - start;
+        }
+    }
+    return end - start;
+}
+
+bool OutboxService::DeliverOne(const OutboxEntry& entry, bool& unrecorded) {
+    std::string body;
+    json request;
+    if (!log_.ReadBody(entry, body) || (request = json::parse(body, nullptr, false)).is_discarded()) {
+        unrecorded = !log_.Acknowledge(entry.sequence);
+        return !unrecorded;
+    }
+
+    json response;
+    int statusCode = 0;
+    bool sent = httpClient_->Post(EndpointFromString(entry.endpoint), request, response, statusCode);
+    if (!IsDelivered(sent, statusCode)) {
+        return false;
+    }
+
+    unrecorded = !log_.Acknowledge(entry.sequence);
+    return !unrecorded;
+}
+
+bool OutboxService::IsDelivered(bool sent, int statusCode) {
+    // A 4xx is an answer: the server read the message and will never take it, so sending it again is pointless.
+    // No answer, a 5xx or a 429 means the message may not have been processed and has to be kept
+    if (sent || (statusCode >= 200 && statusCode < 300)) {
+        return true;
+    }
+    return statusCode >= 400 && statusCode < 500 && statusCode != AgentConstants::HTTP_TOO_MANY_REQUESTS;
+}
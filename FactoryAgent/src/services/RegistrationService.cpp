@@ -26,6 +26,9 @@ bool RegistrationService::RegisterWithServer(AgentSettings* settings, HttpClient
     json request = BuildRegistrationRequest(settings);
     json response;
 
+    // Registration is always JSON: the server may have been replaced since the last negotiation
+    client->SetWireEncoding(WIRE_ENCODING_JSON);
+
     bool success = client->Post(AgentConstants::ENDPOINT_REGISTER, request, response);
     if (!success) {
         return false;
@@ -34,12 +37,34 @@ bool RegistrationService::RegisterWithServer(AgentSettings* settings, HttpClient
     int pcId = 0;
     if (ParseRegistrationResponse(response, &pcId)) {
         settings->pcId = pcId;
+
+        // Servers that predate negotiation leave wireEncoding out, which keeps JSON
+        WireEncoding encoding = WIRE_ENCODING_JSON;
+        if (response.contains("wireEncoding") && response["wireEncoding"].is_string() &&
+            WireCodec::FromName(response["wireEncoding"].get<std::string>(), encoding)) {
+            client->SetWireEncoding(encoding);
+        }
+
+        // Same for features: an older server simply gets none of them used
+        serverFeatures_.clear();
+        if (response.contains("features") && response["features"].is_array()) {
+            const json& features = response["features"];
+            for (size_t i = 0; i < features.size(); i++) {
+                if (features[i].is_string()) {
+                    serverFeatures_.insert(features[i].get<std::string>());
+                }
+            }
+        }
         return true;
     }
 
     return false;
 }
 
+bool RegistrationService::ServerSupports(const std::string& feature) const {
+    return serverFeatures_.count(feature) > 0;
+}
+
 json RegistrationService::BuildRegistrationRequest(AgentSettings* settings) {
     json request;
     request["lineNumber"] = settings->lineNumber;
@@ -61,6 +86,9 @@ json RegistrationService::BuildRegistrationRequest(AgentSettings* settings) {
 
     std::string exeName = NetworkUtils::ConvertWStringToString(settings->exeName);
     request["exeName"] = exeName;
+    request["supportedEncodings"] = WireCodec::SupportedNames();
+    request["features"] = json::array({ AgentConstants::FEATURE_CONFIG_DELTA, AgentConstants::FEATURE_COMMAND_CHANNEL,
+        AgentConstants::FEATURE_LOG_DELTA, AgentConstants::FEATURE_LOG_ANALYSIS });
 
     // Build and send log structure JSON if log folder exists
     if (!settings->logFolderPath.empty() && fs::exists(settings->logFolderPath)) {
@@ -0,0 +1,138 @@
+#include "../include/utilities/CompressionUtils.h"
+#include "../include/common/Constants.h"
+#include <zlib.h>
+#include <cstring>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "zlib.lib")
+#endif
+
+bool CompressionUtils::GzipCompress(const std::string& input, std::string& output) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    // windowBits 15 + 16 selects the gzip wrapper instead of raw zlib
+    if (deflateInit2(&stream, AgentConstants::COMPRESSION_LEVEL, Z_DEFLATED, 15 + 16, 8,
+        Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    output.resize(deflateBound(&stream, (uLong)input.size()));
+
+    stream.next_in = (Bytef*)input.data();
+    stream.avail_in = (uInt)input.size();
+    stream.next_out = (Bytef*)&output[0];
+    stream.avail_out = (uInt)output.size();
+
+    int status = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return status == Z_STREAM_END;
+}
+
+bool CompressionUtils::GzipDecompress(const std::string& input, std::string& output) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    // windowBits 15 + 32 auto-detects gzip or zlib headers
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return false;
+    }
+
+    stream.next_in = (Bytef*)input.data();
+    stream.avail_in = (uInt)input.size();
+
+    output.clear();
+    char buffer[16384];
+    int status = Z_OK;
+
+    while (status == Z_OK) {
+        stream.next_out = (Bytef*)buffer;
+        stream.avail_out = sizeof(buffer);
+
+        status = inflate(&stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END) {
+            break;
+        }
+        output.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+GzipStreamDecoder::GzipStreamDecoder()
+    : stream_(NULL), failed_(false), finished_(false), decodedBytes_(0), buffer_(16384) {
+    z_stream* stream = new z_stream;
+    memset(stream, 0, sizeof(z_stream));
+
+    if (inflateInit2(stream, 15 + 32) != Z_OK) {
+        delete stream;
+        failed_ = true;
+        return;
+    }
+    stream_ = stream;
+}
+
+GzipStreamDecoder::~GzipStreamDecoder() {
+    if (stream_) {
+        z_stream* stream = (z_stream*)stream_;
+        inflateEnd(stream);
+        delete stream;
+    }
+}
+
+bool GzipStreamDecoder::Feed(const char* data, size_t length,
+    const std::function<bool(const char*, size_t)>& sink) {
+    if (failed_) {
+        return false;
+    }
+    // Trailing bytes after the end of the stream are ignored, as GzipDecompress does
+    if (finished_) {
+        return true;
+    }
+
+    z_stream* stream = (z_stream*)stream_;
+    stream->next_in = (Bytef*)data;
+    stream->avail_in = (uInt)length;
+
+    for (;;) {
+        stream->next_out = (Bytef*)&buffer_[0];
+        stream->avail_out = (uInt)buffer_.size();
+
+        int status = inflate(stream, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            failed_ = true;
+            return false;
+        }
+
+        size_t produced = buffer_.size() - stream->avail_out;
+        if (produced > 0) {
+            decodedBytes_ += (long long)produced;
+            if (!sink(&buffer_[0], produced)) {
+                failed_ = true;
+                return false;
+            }
+        }
+
+        if (status == Z_STREAM_END) {
+            finished_ = true;
+            break;
+        }
+        // A full output buffer may hide more pending output; otherwise wait for more input
+        if (status == Z_BUF_ERROR || (stream->avail_out != 0 && stream->avail_in == 0)) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool GzipStreamDecoder::IsFinished() const {
+    return finished_;
+}
+
+long long GzipStreamDecoder::GetDecodedBytes() const {
+    return decodedBytes_;
+}
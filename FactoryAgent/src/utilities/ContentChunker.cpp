@@ -0,0 +1,117 @@
+#include "../include/utilities/ContentChunker.h"
+#include "../include/utilities/MappedFile.h"
+#include "../include/utilities/Sha256.h"
+#include "../include/common/Constants.h"
+
+namespace {
+    // Random per-byte values for the gear hash; generated with splitmix64 from a fixed seed,
+    // since every agent has to cut at the same places for chunks to deduplicate across PCs
+    struct GearTable {
+        uint64_t values[256];
+
+        GearTable() {
+            uint64_t state = 0x46414354434443ULL;
+            for (int i = 0; i < 256; i++) {
+                state += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                values[i] = z ^ (z >> 31);
+            }
+        }
+    };
+
+    const GearTable& Gear() {
+        static const GearTable table;
+        return table;
+    }
+
+    // The gear hash shifts left, so its high bits cover the most recent 64 bytes.
+    // Normalized chunking: a stricter mask before the average size, a looser one after,
+    // which keeps chunk sizes close to the average
+    uint64_t HighBitMask(int bits) {
+        return ((1ULL << bits) - 1) << (64 - bits);
+    }
+}
+
+size_t ContentChunker::FindBoundary(const unsigned char* data, size_t length) {
+    const size_t minBytes = AgentConstants::MODEL_CHUNK_MIN_BYTES;
+    const size_t averageBytes = (size_t)1 << AgentConstants::MODEL_CHUNK_AVERAGE_BITS;
+    const size_t maxBytes = AgentConstants::MODEL_CHUNK_MAX_BYTES;
+
+    if (length <= minBytes) {
+        return length;
+    }
+
+    const uint64_t* gear = Gear().values;
+    const uint64_t strictMask = HighBitMask(AgentConstants::MODEL_CHUNK_AVERAGE_BITS + 2);
+    const uint64_t looseMask = HighBitMask(AgentConstants::MODEL_CHUNK_AVERAGE_BITS - 2);
+
+    size_t normal = averageBytes < length ? averageBytes : length;
+    size_t end = maxBytes < length ? maxBytes : length;
+
+    // Nothing before the minimum size can be a cut point, so it is not hashed at all
+    uint64_t hash = 0;
+    size_t i = minBytes;
+    for (; i < normal; i++) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & strictMask) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < end; i++) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & looseMask) == 0) {
+            return i + 1;
+        }
+    }
+
+    return end;
+}
+
+bool ContentChunker::ChunkFile(const std::string& filePath, std::vector<ContentChunk>& chunks) {
+    chunks.clear();
+
+    MappedFile file;
+    if (!file.Open(filePath)) {
+        return false;
+    }
+
+    long long fileSize = file.GetSize();
+    long long windowStart = 0;
+    size_t windowLength = 0;
+    const char* window = NULL;
+    long long offset = 0;
+
+    while (offset < fileSize) {
+        // Remap once fewer than a maximum chunk's worth of bytes are left in the window,
+        // so a boundary search never runs short before the end of the file
+        long long windowEnd = windowStart + (long long)windowLength;
+        if (window == NULL || (windowEnd < fileSize && windowEnd - offset < AgentConstants::MODEL_CHUNK_MAX_BYTES)) {
+            long long remaining = fileSize - offset;
+            long long wanted = AgentConstants::UPLOAD_CHUNK_SIZE;
+            windowLength = (size_t)(remaining < wanted ? remaining : wanted);
+            windowStart = offset;
+            window = file.MapWindow(windowStart, windowLength);
+            if (window == NULL) {
+                return false;
+            }
+        }
+
+        const unsigned char* data = (const unsigned char*)window + (offset - windowStart);
+        size_t available = (size_t)(windowStart + (long long)windowLength - offset);
+
+        ContentChunk chunk;
+        chunk.offset = offset;
+        chunk.length = FindBoundary(data, available);
+
+        Sha256 hasher;
+        hasher.Update(data, chunk.length);
+        chunk.hash = hasher.FinalHex();
+
+        chunks.push_back(chunk);
+        offset += (long long)chunk.length;
+    }
+
+    return true;
+}
@@ -0,0 +1,395 @@
+#include "../include/utilities/DirectoryScanner.h"
+#include "../include/common/Constants.h"
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool NameLess(const ScanEntry& a, const ScanEntry& b) {
+        return a.name < b.name;
+    }
+
+    bool IsDots(const char* name) {
+        return name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0));
+    }
+
+#ifdef _WIN32
+    std::wstring Widen(const std::string& text) {
+        if (text.empty()) {
+            return std::wstring();
+        }
+        int length = MultiByteToWideChar(CP_ACP, 0, text.c_str(), (int)text.size(), NULL, 0);
+        std::wstring wide(length, 0);
+        MultiByteToWideChar(CP_ACP, 0, text.c_str(), (int)text.size(), &wide[0], length);
+        return wide;
+    }
+
+    std::string Narrow(const wchar_t* text) {
+        int length = WideCharToMultiByte(CP_ACP, 0, text, -1, NULL, 0, NULL, NULL);
+        if (length <= 1) {
+            return std::string();
+        }
+        std::string narrow(length - 1, 0);
+        WideCharToMultiByte(CP_ACP, 0, text, -1, &narrow[0], length, NULL, NULL);
+        return narrow;
+    }
+#else
+    struct LinuxDirent64 {
+        unsigned long long d_ino;
+        long long d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    // file_time_type's epoch is the library's choice; one path stat'ed both ways gives the offset
+    long long FileTimeOffset() {
+        static const long long offset = []() {
+            struct statx info;
+            std::error_code error;
+            fs::file_time_type written = fs::last_write_time("/", error);
+            if (error || statx(AT_FDCWD, "/", 0, STATX_MTIME, &info) != 0) {
+                return 0LL;
+            }
+            std::chrono::nanoseconds since = std::chrono::seconds(info.stx_mtime.tv_sec) +
+                std::chrono::nanoseconds(info.stx_mtime.tv_nsec);
+            return (long long)written.time_since_epoch().count() -
+                (long long)std::chrono::duration_cast<fs::file_time_type::duration>(since).count();
+        }();
+        return offset;
+    }
+
+    long long Ticks(const struct statx_timestamp& time) {
+        std::chrono::nanoseconds since = std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+        return (long long)std::chrono::duration_cast<fs::file_time_type::duration>(since).count() + FileTimeOffset();
+    }
+#endif
+}
+
+DirectoryScanner::DirectoryScanner() {
+    queues_ = NULL;
+    queueCount_ = 0;
+    outstanding_ = 0;
+    queued_ = 0;
+}
+
+DirectoryScanner::~DirectoryScanner() {
+}
+
+const ScanStats& DirectoryScanner::GetStats() const {
+    return stats_;
+}
+
+std::string DirectoryScanner::RelativePath(const std::string& parentPath, const ScanEntry& entry) {
+    return (fs::path(parentPath) / entry.name).string();
+}
+
+#ifdef _WIN32
+bool DirectoryScanner::ListFolder(const std::string& folderPath, std::vector<ScanEntry>& entries) {
+    entries.clear();
+
+    // Basic info skips the 8.3 name; large fetch asks for many entries per round trip to the file system
+    std::wstring pattern = Widen(folderPath) + L"\\*";
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL,
+        FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE) {
+        return GetLastError() == ERROR_FILE_NOT_FOUND;
+    }
+
+    do {
+        if (data.cFileName[0] == L'.' &&
+            (data.cFileName[1] == 0 || (data.cFileName[1] == L'.' && data.cFileName[2] == 0))) {
+            continue;
+        }
+
+        ScanEntry entry;
+        entry.name = Narrow(data.cFileName);
+        entry.isDirectory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        entry.isLink = entry.isDirectory && (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+        entry.writeTime = (long long)(((unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32) |
+            data.ftLastWriteTime.dwLowDateTime);
+        if (!entry.isDirectory) {
+            entry.size = ((unsigned long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        }
+        entries.push_back(entry);
+    } while (FindNextFileW(find, &data));
+
+    bool complete = GetLastError() == ERROR_NO_MORE_FILES;
+    FindClose(find);
+
+    std::sort(entries.begin(), entries.end(), NameLess);
+    return complete;
+}
+#else
+bool DirectoryScanner::ListFolder(const std::string& folderPath, std::vector<ScanEntry>& entries) {
+    entries.clear();
+
+    int fd = open(folderPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    // The listing brings the type; only files and links need a statx, for size and write time
+    std::vector<char> buffer(AgentConstants::DIRECTORY_SCAN_BUFFER_BYTES);
+    bool complete = true;
+    while (true) {
+        long bytes = syscall(SYS_getdents64, fd, &buffer[0], buffer.size());
+        if (bytes <= 0) {
+            complete = bytes == 0;
+            break;
+        }
+
+        for (long offset = 0; offset < bytes;) {
+            const LinuxDirent64* record = (const LinuxDirent64*)&buffer[offset];
+            offset += record->d_reclen;
+            if (IsDots(record->d_name)) {
+                continue;
+            }
+
+            ScanEntry entry;
+            entry.name = record->d_name;
+            if (record->d_type == DT_DIR) {
+                entry.isDirectory = true;
+                entries.push_back(entry);
+                continue;
+            }
+
+            // Follows links, as std::filesystem's is_directory and file_size do
+            struct statx info;
+            if (statx(fd, record->d_name, AT_NO_AUTOMOUNT, STATX_TYPE | STATX_SIZE | STATX_MTIME, &info) != 0) {
+                continue;
+            }
+            entry.isLink = record->d_type == DT_LNK;
+            entry.writeTime = Ticks(info.stx_mtime);
+            if (S_ISDIR(info.stx_mode)) {
+                entry.isDirectory = true;
+            }
+            else if (S_ISREG(info.stx_mode)) {
+                entry.size = info.stx_size;
+            }
+            else {
+                continue;
+            }
+            entries.push_back(entry);
+        }
+    }
+    close(fd);
+
+    std::sort(entries.begin(), entries.end(), NameLess);
+    return complete;
+}
+#endif
+
+bool DirectoryScanner::Scan(const std::string& rootPath, bool recursive, std::vector<ScanEntry>& entries) {
+    stats_ = ScanStats();
+    entries.clear();
+    blocks_.clear();
+
+    blocks_.push_back(Block());
+    if (!ListFolder(rootPath, blocks_[0].entries)) {
+        blocks_.clear();
+        return false;
+    }
+    blocks_[0].listed = true;
+    stats_.folders = 1;
+
+    std::vector<Job> jobs;
+    if (recursive) {
+        std::vector<ScanEntry>& children = blocks_[0].entries;
+        for (size_t i = 0; i < children.size(); i++) {
+            if (children[i].isDirectory && !children[i].isLink) {
+                Job job;
+                job.path = (fs::path(rootPath) / children[i].name).string();
+                job.block = (int)blocks_.size();
+                children[i].firstChild = job.block;
+                blocks_.push_back(Block());
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    if (!jobs.empty()) {
+        int threads = (int)std::thread::hardware_concurrency();
+        if (threads < 1) {
+            threads = 1;
+        }
+        if (threads > AgentConstants::DIRECTORY_SCAN_MAX_THREADS) {
+            threads = AgentConstants::DIRECTORY_SCAN_MAX_THREADS;
+        }
+        if (threads > (int)jobs.size() * 4) {
+            threads = (int)jobs.size() * 4;
+        }
+        stats_.threads = threads;
+
+        queueCount_ = threads;
+        queues_ = new WorkQueue[threads];
+        for (size_t i = 0; i < jobs.size(); i++) {
+            queues_[i % threads].jobs.push_back(jobs[i]);
+        }
+        outstanding_ = (int)jobs.size();
+        queued_ = (int)jobs.size();
+
+        // The calling thread is worker 0
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; i++) {
+            workers.push_back(std::thread(&DirectoryScanner::Worker, this, i));
+        }
+        Worker(0);
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+
+        delete[] queues_;
+        queues_ = NULL;
+        queueCount_ = 0;
+    }
+
+    Layout(entries);
+    blocks_.clear();
+    return true;
+}
+
+void DirectoryScanner::Worker(int index) {
+    Job job;
+    while (NextJob(index, job)) {
+        RunJob(index, job);
+        if (--outstanding_ == 0) {
+            std::lock_guard<std::mutex> lock(idleMutex_);
+            workAvailable_.notify_all();
+        }
+    }
+}
+
+bool DirectoryScanner::NextJob(int index, Job& job) {
+    while (true) {
+        // Own jobs newest first: the folder just listed is the one most likely still cached
+        {
+            WorkQueue& own = queues_[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                job = own.jobs.back();
+                own.jobs.pop_back();
+                queued_--;
+                return true;
+            }
+        }
+
+        // Stolen oldest first: the job queued earliest is usually the biggest subtree left
+        for (int i = 1; i < queueCount_; i++) {
+            WorkQueue& other = queues_[(index + i) % queueCount_];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (!other.jobs.empty()) {
+                job = other.jobs.front();
+                other.jobs.pop_front();
+                queued_--;
+                return true;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex_);
+        workAvailable_.wait(lock, [this]() { return queued_ > 0 || outstanding_ == 0; });
+        if (outstanding_ == 0) {
+            return false;
+        }
+    }
+}
+
+void DirectoryScanner::Push(int index, const Job& job) {
+    {
+        WorkQueue& own = queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.jobs.push_back(job);
+    }
+
+    std::lock_guard<std::mutex> lock(idleMutex_);
+    queued_++;
+    workAvailable_.notify_one();
+}
+
+void DirectoryScanner::RunJob(int index, const Job& job) {
+    std::vector<ScanEntry> listed;
+    bool complete = ListFolder(job.path, listed);
+
+    std::vector<Job> children;
+    {
+        std::lock_guard<std::mutex> lock(blockMutex_);
+        for (size_t i = 0; i < listed.size(); i++) {
+            if (listed[i].isDirectory && !listed[i].isLink) {
+                Job child;
+                child.path = (fs::path(job.path) / listed[i].name).string();
+                child.block = (int)blocks_.size();
+                listed[i].firstChild = child.block;
+                blocks_.push_back(Block());
+                children.push_back(child);
+            }
+        }
+
+        // A folder that failed part way keeps what it did list
+        Block& block = blocks_[job.block];
+        block.entries.swap(listed);
+        block.listed = complete;
+        if (complete) {
+            stats_.folders++;
+        }
+        else {
+            stats_.failedFolders++;
+        }
+    }
+
+    // Counted before this job finishes, so outstanding_ cannot touch zero in between
+    outstanding_ += (int)children.size();
+    for (size_t i = 0; i < children.size(); i++) {
+        Push(index, children[i]);
+    }
+}
+
+void DirectoryScanner::Layout(std::vector<ScanEntry>& entries) {
+    size_t total = 1;
+    for (size_t i = 0; i < blocks_.size(); i++) {
+        total += blocks_[i].entries.size();
+    }
+    entries.reserve(total);
+
+    ScanEntry root;
+    root.isDirectory = true;
+    entries.push_back(root);
+
+    // Breadth first: every folder's children land side by side, right after the previous folder's
+    std::deque<std::pair<int, int> > pending;
+    pending.push_back(std::make_pair(0, 0));
+    while (!pending.empty()) {
+        int at = pending.front().first;
+        Block& block = blocks_[pending.front().second];
+        pending.pop_front();
+
+        entries[at].firstChild = (int)entries.size();
+        entries[at].childCount = (int)block.entries.size();
+        for (size_t i = 0; i < block.entries.size(); i++) {
+            int childBlock = block.entries[i].firstChild;
+            entries.push_back(ScanEntry());
+            ScanEntry& placed = entries.back();
+            placed.name.swap(block.entries[i].name);
+            placed.isDirectory = block.entries[i].isDirectory;
+            placed.isLink = block.entries[i].isLink;
+            placed.size = block.entries[i].size;
+            placed.writeTime = block.entries[i].writeTime;
+            if (childBlock > 0) {
+                pending.push_back(std::make_pair((int)entries.size() - 1, childBlock));
+            }
+        }
+    }
+}
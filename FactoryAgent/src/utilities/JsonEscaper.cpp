@@ -0,0 +1,149 @@
+#include "../include/utilities/JsonEscaper.h"
+
+JsonEscaper::JsonEscaper(int depth) {
+    backslashes_ = 1 << (depth - 1);
+    literalBackslashes_ = (1 << depth) - 1;
+    Reset();
+}
+
+void JsonEscaper::Reset() {
+    partialLength_ = 0;
+    remaining_ = 0;
+    low_ = 0x80;
+    high_ = 0xBF;
+}
+
+size_t JsonEscaper::Put(const char* data, size_t length, std::string* out) {
+    if (out) {
+        out->append(data, length);
+    }
+    return length;
+}
+
+size_t JsonEscaper::PutEscape(char letter, std::string* out) {
+    if (out) {
+        out->append(backslashes_, '\\');
+        out->push_back(letter);
+    }
+    return backslashes_ + 1;
+}
+
+size_t JsonEscaper::PutReplacement(std::string* out) {
+    return Put("\xEF\xBF\xBD", 3, out);
+}
+
+size_t JsonEscaper::PutControl(unsigned char c, std::string* out) {
+    switch (c) {
+    case '\b': return PutEscape('b', out);
+    case '\t': return PutEscape('t', out);
+    case '\n': return PutEscape('n', out);
+    case '\f': return PutEscape('f', out);
+    case '\r': return PutEscape('r', out);
+    default:
+        break;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    char code[5] = { 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+    if (out) {
+        out->append(backslashes_, '\\');
+        out->append(code, sizeof(code));
+    }
+    return backslashes_ + sizeof(code);
+}
+
+size_t JsonEscaper::Escape(const char* data, size_t length, std::string* out) {
+    size_t produced = 0;
+    size_t i = 0;
+
+    while (i < length) {
+        unsigned char c = (unsigned char)data[i];
+
+        if (remaining_ > 0) {
+            if (c < low_ || c > high_) {
+                // The sequence breaks off; the byte is read again as the start of the next one
+                produced += PutReplacement(out);
+                Reset();
+                continue;
+            }
+            partial_[partialLength_++] = (char)c;
+            remaining_--;
+            low_ = 0x80;
+            high_ = 0xBF;
+            i++;
+            if (remaining_ == 0) {
+                produced += Put(partial_, partialLength_, out);
+                partialLength_ = 0;
+            }
+            continue;
+        }
+
+        // Most of a log is printable ASCII, copied a run at a time
+        size_t start = i;
+        while (i < length && (unsigned char)data[i] >= 0x20 && (unsigned char)data[i] < 0x80 &&
+            data[i] != '"' && data[i] != '\\') {
+            i++;
+        }
+        if (i > start) {
+            produced += Put(data + start, i - start, out);
+            continue;
+        }
+
+        i++;
+        if (c == '"' || c == '\\') {
+            if (out) {
+                out->append(literalBackslashes_, '\\');
+                out->push_back((char)c);
+            }
+            produced += literalBackslashes_ + 1;
+            continue;
+        }
+        if (c < 0x20) {
+            produced += PutControl(c, out);
+            continue;
+        }
+
+        // A lead byte; the first continuation's range rules out overlong forms and surrogates
+        if (c >= 0xC2 && c <= 0xDF) {
+            remaining_ = 1;
+        }
+        else if (c == 0xE0) {
+            remaining_ = 2;
+            low_ = 0xA0;
+        }
+        else if (c == 0xED) {
+            remaining_ = 2;
+            high_ = 0x9F;
+        }
+        else if (c >= 0xE1 && c <= 0xEF) {
+            remaining_ = 2;
+        }
+        else if (c == 0xF0) {
+            remaining_ = 3;
+            low_ = 0x90;
+        }
+        else if (c >= 0xF1 && c <= 0xF3) {
+            remaining_ = 3;
+        }
+        else if (c == 0xF4) {
+            remaining_ = 3;
+            high_ = 0x8F;
+        }
+        else {
+            produced += PutReplacement(out);
+            continue;
+        }
+        partial_[0] = (char)c;
+        partialLength_ = 1;
+    }
+
+    return produced;
+}
+
+size_t JsonEscaper::Finish(std::string* out) {
+    if (remaining_ == 0) {
+        return 0;
+    }
+    Reset();
+    return PutReplacement(out);
+}
@@ -0,0 +1,486 @@
+#include "../include/utilities/JsonStreamParser.h"
+#include <cerrno>
+#include <cstdlib>
+
+/*
+ * JsonStreamParser.cpp
+ * A small state machine over the JSON grammar. Only a token that straddles two
+ * chunks (a string, number or literal) is buffered; everything else is
+ * reported to the handler as soon as its closing character arrives.
+ */
+
+JsonStreamParser::JsonStreamParser(json::json_sax_t* handler)
+    : handler_(handler), expect_(EXPECT_VALUE), lexeme_(LEXEME_NONE), failed_(false),
+    tokenIsKey_(false), escaped_(false), unicodeDigits_(0), unicodeValue_(0), highSurrogate_(0) {
+}
+
+JsonStreamParser::~JsonStreamParser() {
+}
+
+bool JsonStreamParser::Fail() {
+    failed_ = true;
+    return false;
+}
+
+bool JsonStreamParser::ExpectsValue() const {
+    return expect_ == EXPECT_VALUE || expect_ == EXPECT_VALUE_OR_END;
+}
+
+bool JsonStreamParser::Feed(const char* data, size_t length) {
+    if (failed_) {
+        return false;
+    }
+
+    size_t pos = 0;
+    while (pos < length) {
+        if (lexeme_ == LEXEME_STRING) {
+            pos = ScanString(data, pos, length);
+            if (failed_) {
+                return false;
+            }
+            continue;
+        }
+
+        char c = data[pos];
+
+        if (lexeme_ == LEXEME_NUMBER) {
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                token_ += c;
+                pos++;
+                continue;
+            }
+            if (!EndNumber()) {
+                return Fail();
+            }
+        }
+        else if (lexeme_ == LEXEME_LITERAL) {
+            if (c >= 'a' && c <= 'z') {
+                token_ += c;
+                pos++;
+                continue;
+            }
+            if (!EndLiteral()) {
+                return Fail();
+            }
+        }
+
+        pos++;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            continue;
+        }
+        if (!Structural(c)) {
+            return Fail();
+        }
+    }
+
+    return true;
+}
+
+bool JsonStreamParser::Finish() {
+    if (failed_) {
+        return false;
+    }
+
+    // A bare top-level number has no terminator until the body ends
+    if (lexeme_ == LEXEME_NUMBER && !EndNumber()) {
+        return Fail();
+    }
+    if (lexeme_ == LEXEME_LITERAL && !EndLiteral()) {
+        return Fail();
+    }
+
+    return lexeme_ == LEXEME_NONE && expect_ == EXPECT_DONE;
+}
+
+bool JsonStreamParser::Structural(char c) {
+    switch (c) {
+    case '"':
+        if (!ExpectsValue() && expect_ != EXPECT_KEY && expect_ != EXPECT_KEY_OR_END) {
+            return false;
+        }
+        tokenIsKey_ = (expect_ == EXPECT_KEY || expect_ == EXPECT_KEY_OR_END);
+        token_.clear();
+        lexeme_ = LEXEME_STRING;
+        return true;
+
+    case '{':
+        if (!ExpectsValue() || !handler_->start_object(static_cast<std::size_t>(-1))) {
+            return false;
+        }
+        containers_.push_back('{');
+        expect_ = EXPECT_KEY_OR_END;
+        return true;
+
+    case '[':
+        if (!ExpectsValue() || !handler_->start_array(static_cast<std::size_t>(-1))) {
+            return false;
+        }
+        containers_.push_back('[');
+        expect_ = EXPECT_VALUE_OR_END;
+        return true;
+
+    case '}':
+        if ((expect_ != EXPECT_KEY_OR_END && expect_ != EXPECT_COMMA_OR_END) ||
+            containers_.empty() || containers_.back() != '{' || !handler_->end_object()) {
+            return false;
+        }
+        containers_.pop_back();
+        return AfterValue();
+
+    case ']':
+        if ((expect_ != EXPECT_VALUE_OR_END && expect_ != EXPECT_COMMA_OR_END) ||
+            containers_.empty() || containers_.back() != '[' || !handler_->end_array()) {
+            return false;
+        }
+        containers_.pop_back();
+        return AfterValue();
+
+    case ':':
+        if (expect_ != EXPECT_COLON) {
+            return false;
+        }
+        expect_ = EXPECT_VALUE;
+        return true;
+
+    case ',':
+        if (expect_ != EXPECT_COMMA_OR_END) {
+            return false;
+        }
+        expect_ = (containers_.back() == '{') ? EXPECT_KEY : EXPECT_VALUE;
+        return true;
+
+    case 't':
+    case 'f':
+    case 'n':
+        if (!ExpectsValue()) {
+            return false;
+        }
+        token_.assign(1, c);
+        lexeme_ = LEXEME_LITERAL;
+        return true;
+
+    default:
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            if (!ExpectsValue()) {
+                return false;
+            }
+            token_.assign(1, c);
+            lexeme_ = LEXEME_NUMBER;
+            return true;
+        }
+        return false;
+    }
+}
+
+size_t JsonStreamParser::ScanString(const char* data, size_t pos, size_t length) {
+    while (pos < length) {
+        if (unicodeDigits_ > 0) {
+            if (!ApplyUnicodeDigit(data[pos++])) {
+                Fail();
+                return pos;
+            }
+            continue;
+        }
+
+        if (escaped_) {
+            escaped_ = false;
+            if (!ApplyEscape(data[pos++])) {
+                Fail();
+                return pos;
+            }
+            continue;
+        }
+
+        // Copy the run of plain characters in one append
+        size_t start = pos;
+        while (pos < length && data[pos] != '"' && data[pos] != '\\' &&
+            (unsigned char)data[pos] >= 0x20) {
+            pos++;
+        }
+        if (pos > start) {
+            // A high surrogate must be followed directly by its \u low half
+            if (highSurrogate_ != 0) {
+                Fail();
+                return pos;
+            }
+            token_.append(data + start, pos - start);
+        }
+        if (pos == length) {
+            break;
+        }
+
+        char c = data[pos++];
+        if (c == '\\') {
+            escaped_ = true;
+        }
+        else if (c == '"' && highSurrogate_ == 0) {
+            lexeme_ = LEXEME_NONE;
+            if (!EndString()) {
+                Fail();
+            }
+            return pos;
+        }
+        else {
+            // Raw control characters and unpaired surrogates are invalid
+            Fail();
+            return pos;
+        }
+    }
+
+    return pos;
+}
+
+bool JsonStreamParser::ApplyEscape(char c) {
+    if (c == 'u') {
+        unicodeDigits_ = 4;
+        unicodeValue_ = 0;
+        return true;
+    }
+    if (highSurrogate_ != 0) {
+        return false;
+    }
+
+    switch (c) {
+    case '"': token_ += '"'; return true;
+    case '\\': token_ += '\\'; return true;
+    case '/': token_ += '/'; return true;
+    case 'b': token_ += '\b'; return true;
+    case 'f': token_ += '\f'; return true;
+    case 'n': token_ += '\n'; return true;
+    case 'r': token_ += '\r'; return true;
+    case 't': token_ += '\t'; return true;
+    default: return false;
+    }
+}
+
+bool JsonStreamParser::ApplyUnicodeDigit(char c) {
+    unsigned int digit;
+    if (c >= '0' && c <= '9') {
+        digit = (unsigned int)(c - '0');
+    }
+    else if (c >= 'a' && c <= 'f') {
+        digit = (unsigned int)(c - 'a' + 10);
+    }
+    else if (c >= 'A' && c <= 'F') {
+        digit = (unsigned int)(c - 'A' + 10);
+    }
+    else {
+        return false;
+    }
+
+    unicodeValue_ = (unicodeValue_ << 4) | digit;
+    if (--unicodeDigits_ > 0) {
+        return true;
+    }
+
+    if (unicodeValue_ >= 0xD800 && unicodeValue_ <= 0xDBFF) {
+        if (highSurrogate_ != 0) {
+            return false;
+        }
+        highSurrogate_ = unicodeValue_;
+        return true;
+    }
+
+    if (unicodeValue_ >= 0xDC00 && unicodeValue_ <= 0xDFFF) {
+        if (highSurrogate_ == 0) {
+            return false;
+        }
+        AppendCodePoint(0x10000 + ((highSurrogate_ - 0xD800) << 10) + (unicodeValue_ - 0xDC00));
+        highSurrogate_ = 0;
+        return true;
+    }
+
+    if (highSurrogate_ != 0) {
+        return false;
+    }
+    AppendCodePoint(unicodeValue_);
+    return true;
+}
+
+void JsonStreamParser::AppendCodePoint(unsigned int codePoint) {
+    if (codePoint < 0x80) {
+        token_ += (char)codePoint;
+    }
+    else if (codePoint < 0x800) {
+        token_ += (char)(0xC0 | (codePoint >> 6));
+        token_ += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000) {
+        token_ += (char)(0xE0 | (codePoint >> 12));
+        token_ += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        token_ += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else {
+        token_ += (char)(0xF0 | (codePoint >> 18));
+        token_ += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        token_ += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        token_ += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+bool JsonStreamParser::EndString() {
+    if (tokenIsKey_) {
+        if (!handler_->key(token_)) {
+            return false;
+        }
+        expect_ = EXPECT_COLON;
+        return true;
+    }
+
+    if (!handler_->string(token_)) {
+        return false;
+    }
+    return AfterValue();
+}
+
+bool JsonStreamParser::EndNumber() {
+    lexeme_ = LEXEME_NONE;
+
+    // JSON forbids leading zeros, a bare '-', and '+' outside the exponent
+    size_t digits = (token_[0] == '-') ? 1 : 0;
+    if (digits >= token_.size() || token_[digits] < '0' || token_[digits] > '9' ||
+        (token_[digits] == '0' && digits + 1 < token_.size() &&
+            token_[digits + 1] >= '0' && token_[digits + 1] <= '9')) {
+        return false;
+    }
+
+    bool isFloat = token_.find_first_of(".eE") != std::string::npos;
+    const char* text = token_.c_str();
+    char* end = NULL;
+    errno = 0;
+
+    if (!isFloat) {
+        // Integers that overflow fall through to double, as json::parse does
+        if (token_[0] == '-') {
+            long long value = strtoll(text, &end, 10);
+            if (*end == '\0' && errno != ERANGE) {
+                return handler_->number_integer(value) && AfterValue();
+            }
+        }
+        else {
+            unsigned long long value = strtoull(text, &end, 10);
+            if (*end == '\0' && errno != ERANGE) {
+                return handler_->number_unsigned(value) && AfterValue();
+            }
+        }
+        errno = 0;
+    }
+
+    double value = strtod(text, &end);
+    if (*end != '\0' || token_.back() == '.' || token_.find(".e") != std::string::npos ||
+        token_.find(".E") != std::string::npos) {
+        return false;
+    }
+
+    return handler_->number_float(value, token_) && AfterValue();
+}
+
+bool JsonStreamParser::EndLiteral() {
+    lexeme_ = LEXEME_NONE;
+
+    bool accepted;
+    if (token_ == "true") {
+        accepted = handler_->boolean(true);
+    }
+    else if (token_ == "false") {
+        accepted = handler_->boolean(false);
+    }
+    else if (token_ == "null") {
+        accepted = handler_->null();
+    }
+    else {
+        return false;
+    }
+
+    return accepted && AfterValue();
+}
+
+bool JsonStreamParser::AfterValue() {
+    expect_ = containers_.empty() ? EXPECT_DONE : EXPECT_COMMA_OR_END;
+    return true;
+}
+
+JsonDomBuilder::JsonDomBuilder(json& root) : root_(root) {
+}
+
+json* JsonDomBuilder::AddValue(json&& value) {
+    if (stack_.empty()) {
+        root_ = std::move(value);
+        return &root_;
+    }
+
+    json* parent = stack_.back();
+    if (parent->is_array()) {
+        parent->push_back(std::move(value));
+        return &parent->back();
+    }
+
+    // Object members live in a std::map, so the returned pointer stays valid
+    json& slot = (*parent)[key_];
+    slot = std::move(value);
+    return &slot;
+}
+
+bool JsonDomBuilder::null() {
+    AddValue(json(nullptr));
+    return true;
+}
+
+bool JsonDomBuilder::boolean(bool val) {
+    AddValue(json(val));
+    return true;
+}
+
+bool JsonDomBuilder::number_integer(number_integer_t val) {
+    AddValue(json(val));
+    return true;
+}
+
+bool JsonDomBuilder::number_unsigned(number_unsigned_t val) {
+    AddValue(json(val));
+    return true;
+}
+
+bool JsonDomBuilder::number_float(number_float_t val, const string_t&) {
+    AddValue(json(val));
+    return true;
+}
+
+bool JsonDomBuilder::string(string_t& val) {
+    AddValue(json(std::move(val)));
+    return true;
+}
+
+bool JsonDomBuilder::binary(binary_t& val) {
+    AddValue(json::binary(std::move(val)));
+    return true;
+}
+
+bool JsonDomBuilder::start_object(std::size_t) {
+    stack_.push_back(AddValue(json::object()));
+    return true;
+}
+
+bool JsonDomBuilder::key(string_t& val) {
+    key_.swap(val);
+    return true;
+}
+
+bool JsonDomBuilder::end_object() {
+    stack_.pop_back();
+    return true;
+}
+
+bool JsonDomBuilder::start_array(std::size_t) {
+    stack_.push_back(AddValue(json::array()));
+    return true;
+}
+
+bool JsonDomBuilder::end_array() {
+    stack_.pop_back();
+    return true;
+}
+
+bool JsonDomBuilder::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+    return false;
+}
@@ -0,0 +1,149 @@
+#include "../include/utilities/LineDelta.h"
+#include <map>
+#include <algorithm>
+
+void LineDelta::SplitLines(const std::string& content, std::vector<std::string>& lines) {
+    lines.clear();
+
+    size_t start = 0;
+    while (start < content.length()) {
+        size_t newline = content.find('\n', start);
+        size_t end = (newline == std::string::npos) ? content.length() : newline + 1;
+        lines.push_back(content.substr(start, end - start));
+        start = end;
+    }
+}
+
+uint64_t LineDelta::HashLine(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::vector<uint64_t> LineDelta::HashLines(const std::string& content) {
+    std::vector<uint64_t> hashes;
+
+    size_t start = 0;
+    while (start < content.length()) {
+        size_t newline = content.find('\n', start);
+        size_t end = (newline == std::string::npos) ? content.length() : newline + 1;
+        hashes.push_back(HashLine(content.data() + start, end - start));
+        start = end;
+    }
+
+    return hashes;
+}
+
+json LineDelta::Diff(const std::vector<uint64_t>& baseLineHashes, const std::string& content) {
+    // Every base position per hash, ascending, so a moved or duplicated line can still be copied
+    std::map<uint64_t, std::vector<int> > positions;
+    for (size_t i = 0; i < baseLineHashes.size(); i++) {
+        positions[baseLineHashes[i]].push_back((int)i);
+    }
+
+    std::vector<std::string> lines;
+    SplitLines(content, lines);
+
+    json ops = json::array();
+    int copyStart = -1;
+    int copyCount = 0;
+    json inserted = json::array();
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        uint64_t hash = HashLine(lines[i].data(), lines[i].length());
+
+        // Extending the current run is the common case: unchanged stretches between edits
+        int next = copyStart + copyCount;
+        if (copyStart >= 0 && next < (int)baseLineHashes.size() && baseLineHashes[next] == hash) {
+            copyCount++;
+            continue;
+        }
+
+        std::map<uint64_t, std::vector<int> >::const_iterator found = positions.find(hash);
+        if (found == positions.end()) {
+            if (copyStart >= 0) {
+                ops.push_back({ { "copy", { copyStart, copyCount } } });
+                copyStart = -1;
+                copyCount = 0;
+            }
+            inserted.push_back(lines[i]);
+            continue;
+        }
+
+        if (copyStart >= 0) {
+            ops.push_back({ { "copy", { copyStart, copyCount } } });
+        }
+        if (!inserted.empty()) {
+            ops.push_back({ { "insert", inserted } });
+            inserted = json::array();
+        }
+
+        // Prefer the first match after the previous run so the following lines can extend it
+        const std::vector<int>& candidates = found->second;
+        std::vector<int>::const_iterator after = std::lower_bound(candidates.begin(), candidates.end(), next);
+        copyStart = (after != candidates.end()) ? *after : candidates.front();
+        copyCount = 1;
+    }
+
+    if (copyStart >= 0) {
+        ops.push_back({ { "copy", { copyStart, copyCount } } });
+    }
+    if (!inserted.empty()) {
+        ops.push_back({ { "insert", inserted } });
+    }
+
+    return ops;
+}
+
+bool LineDelta::Apply(const std::string& base, const json& ops, std::string& result) {
+    if (!ops.is_array()) {
+        return false;
+    }
+
+    std::vector<std::string> lines;
+    SplitLines(base, lines);
+
+    result.clear();
+    for (size_t i = 0; i < ops.size(); i++) {
+        const json& op = ops[i];
+        if (!op.is_object()) {
+            return false;
+        }
+
+        if (op.contains("copy")) {
+            const json& range = op["copy"];
+            if (!range.is_array() || range.size() != 2 ||
+                !range[0].is_number_integer() || !range[1].is_number_integer()) {
+                return false;
+            }
+
+            long long start = range[0].get<long long>();
+            long long count = range[1].get<long long>();
+            if (start < 0 || count < 0 || start + count > (long long)lines.size()) {
+                return false;
+            }
+            for (long long line = start; line < start + count; line++) {
+                result += lines[(size_t)line];
+            }
+        }
+        else if (op.contains("insert")) {
+            const json& inserted = op["insert"];
+            if (!inserted.is_array()) {
+                return false;
+            }
+            for (size_t line = 0; line < inserted.size(); line++) {
+                if (!inserted[line].is_string()) {
+                    return false;
+                }
+                result += inserted[line].get_ref<const std::string&>();
+            }
+        }
+        else {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,414 @@
+#include "../include/utilities/LogTokenizer.h"
+#include <atomic>
+#include <charconv>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LOG_TOKENIZER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/*
+ * LogTokenizer.cpp
+ * A vector of bytes is compared against '\n' and '\t' at once and the two masks
+ * walked bit by bit, so a line costs one pass whatever its field count. Once
+ * enough fields are found only newlines are looked for
+ */
+
+// MSVC compiles any intrinsic anywhere; GCC and Clang want the function marked for it
+#ifdef _MSC_VER
+#define LOG_TOKENIZER_TARGET(isa)
+#else
+#define LOG_TOKENIZER_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+    std::atomic<int> g_level(-1);
+
+    int DetectLevel() {
+#ifdef LOG_TOKENIZER_X86
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int leaves = info[0];
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        // AVX2 also needs the OS to save the upper register halves
+        bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (avx && leaves >= 7) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        bool sse2 = __builtin_cpu_supports("sse2") != 0;
+        bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+        if (avx2) {
+            return LogTokenizer::LEVEL_AVX2;
+        }
+        if (sse2) {
+            return LogTokenizer::LEVEL_SSE2;
+        }
+#endif
+        return LogTokenizer::LEVEL_SCALAR;
+    }
+
+    const char* SplitScalar(const char* p, const char* end, const char** fields, int maxFields, int& count) {
+        for (; p < end && count < maxFields; p++) {
+            if (*p == '\n') {
+                return p;
+            }
+            if (*p == '\t') {
+                fields[count++] = p + 1;
+            }
+        }
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        return newline ? newline : end;
+    }
+
+#ifdef LOG_TOKENIZER_X86
+    int LowestBit(unsigned mask) {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward(&index, mask);
+        return (int)index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    LOG_TOKENIZER_TARGET("sse2")
+    const char* SplitSse2(const char* p, const char* end, const char** fields, int maxFields, int& count) {
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i tab = _mm_set1_epi8('\t');
+        for (; end - p >= 16; p += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)p);
+            unsigned newlines = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+            unsigned hits = newlines;
+            if (count < maxFields) {
+                hits |= (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, tab));
+            }
+            while (hits != 0) {
+                int bit = LowestBit(hits);
+                if (newlines & (1u << bit)) {
+                    return p + bit;
+                }
+                fields[count++] = p + bit + 1;
+                hits &= hits - 1;
+                if (count == maxFields) {
+                    hits &= newlines;
+                }
+            }
+        }
+        return SplitScalar(p, end, fields, maxFields, count);
+    }
+
+    LOG_TOKENIZER_TARGET("avx2")
+    const char* SplitAvx2(const char* p, const char* end, const char** fields, int maxFields, int& count) {
+        const __m256i newline = _mm256_set1_epi8('\n');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        for (; end - p >= 32; p += 32) {
+            __m256i block = _mm256_loadu_si256((const __m256i*)p);
+            unsigned newlines = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+            unsigned hits = newlines;
+            if (count < maxFields) {
+                hits |= (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, tab));
+            }
+            while (hits != 0) {
+                int bit = LowestBit(hits);
+                if (newlines & (1u << bit)) {
+                    return p + bit;
+                }
+                fields[count++] = p + bit + 1;
+                hits &= hits - 1;
+                if (count == maxFields) {
+                    hits &= newlines;
+                }
+            }
+        }
+        return SplitScalar(p, end, fields, maxFields, count);
+    }
+#endif
+
+    // One flat object; the checks follow the JSON grammar, so a line JSON.parse rejects is rejected here
+    class FlatObjectReader {
+    public:
+        FlatObjectReader(const char* begin, const char* end) {
+            p_ = begin;
+            end_ = end;
+        }
+
+        bool Read(const char* const* keys, int keyCount, JsonToken* values) {
+            for (int i = 0; i < keyCount; i++) {
+                values[i] = JsonToken();
+            }
+
+            SkipSpace();
+            if (!Consume('{')) {
+                return false;
+            }
+            SkipSpace();
+            if (!Consume('}')) {
+                while (true) {
+                    JsonToken key;
+                    if (!ReadString(key)) {
+                        return false;
+                    }
+                    SkipSpace();
+                    if (!Consume(':')) {
+                        return false;
+                    }
+                    SkipSpace();
+                    JsonToken value;
+                    if (!ReadValue(value)) {
+                        return false;
+                    }
+                    // A key with escapes is taken as none of the wanted ones
+                    int index = key.escaped ? -1 : FindKey(key, keys, keyCount);
+                    if (index >= 0) {
+                        values[index] = value;
+                    }
+                    SkipSpace();
+                    if (Consume('}')) {
+                        break;
+                    }
+                    if (!Consume(',')) {
+                        return false;
+                    }
+                    SkipSpace();
+                }
+            }
+            SkipSpace();
+            return p_ == end_;
+        }
+
+    private:
+        const char* p_;
+        const char* end_;
+
+        static int FindKey(const JsonToken& key, const char* const* keys, int keyCount) {
+            size_t length = key.end - key.begin;
+            for (int i = 0; i < keyCount; i++) {
+                // Keys hold no control characters, so strncmp stops at the wanted key's end
+                if (strncmp(keys[i], key.begin, length) == 0 && keys[i][length] == '\0') {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        void SkipSpace() {
+            while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) {
+                p_++;
+            }
+        }
+
+        bool Consume(char c) {
+            if (p_ < end_ && *p_ == c) {
+                p_++;
+                return true;
+            }
+            return false;
+        }
+
+        bool ConsumeDigits() {
+            if (p_ == end_ || *p_ < '0' || *p_ > '9') {
+                return false;
+            }
+            while (p_ < end_ && *p_ >= '0' && *p_ <= '9') {
+                p_++;
+            }
+            return true;
+        }
+
+        bool ReadString(JsonToken& token) {
+            if (!Consume('"')) {
+                return false;
+            }
+            token.type = JsonToken::STRING;
+            token.begin = p_;
+            token.escaped = false;
+            while (p_ < end_ && *p_ != '"') {
+                if ((unsigned char)*p_ < 0x20) {
+                    return false;
+                }
+                if (*p_ == '\\') {
+                    token.escaped = true;
+                    p_++;
+                    if (p_ == end_) {
+                        return false;
+                    }
+                }
+                p_++;
+            }
+            if (p_ == end_) {
+                return false;
+            }
+            token.end = p_;
+            p_++;
+            return true;
+        }
+
+        bool ReadNumber(JsonToken& token) {
+            token.type = JsonToken::NUMBER;
+            token.begin = p_;
+            Consume('-');
+            if (Consume('0')) {
+                // no leading zeros
+            }
+            else if (!ConsumeDigits()) {
+                return false;
+            }
+            if (Consume('.') && !ConsumeDigits()) {
+                return false;
+            }
+            if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+                p_++;
+                if (!Consume('+')) {
+                    Consume('-');
+                }
+                if (!ConsumeDigits()) {
+                    return false;
+                }
+            }
+            token.end = p_;
+            return true;
+        }
+
+        // Arrays and objects are not read into; only their nesting and strings matter
+        bool SkipNested(JsonToken& token) {
+            token.type = JsonToken::NESTED;
+            token.begin = p_;
+            int depth = 0;
+            do {
+                if (p_ == end_) {
+                    return false;
+                }
+                if (*p_ == '"') {
+                    JsonToken text;
+                    if (!ReadString(text)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (*p_ == '{' || *p_ == '[') {
+                    depth++;
+                }
+                else if (*p_ == '}' || *p_ == ']') {
+                    depth--;
+                }
+                p_++;
+            } while (depth > 0);
+            token.end = p_;
+            return true;
+        }
+
+        bool ReadValue(JsonToken& token) {
+            if (p_ == end_) {
+                return false;
+            }
+            if (*p_ == '"') {
+                return ReadString(token);
+            }
+            if (*p_ == '{' || *p_ == '[') {
+                return SkipNested(token);
+            }
+            if (*p_ == 't' || *p_ == 'f' || *p_ == 'n') {
+                const char* word = *p_ == 't' ? "true" : (*p_ == 'f' ? "false" : "null");
+                size_t length = strlen(word);
+                if ((size_t)(end_ - p_) < length || memcmp(p_, word, length) != 0) {
+                    return false;
+                }
+                token.type = JsonToken::LITERAL;
+                token.begin = p_;
+                p_ += length;
+                token.end = p_;
+                return true;
+            }
+            return ReadNumber(token);
+        }
+    };
+}
+
+const char* LogTokenizer::SplitLine(const char* begin, const char* end, const char** fields, int maxFields, int& fieldCount) {
+    fieldCount = 0;
+    if (maxFields > 0) {
+        fields[0] = begin;
+        fieldCount = 1;
+    }
+
+    switch (GetLevel()) {
+#ifdef LOG_TOKENIZER_X86
+    case LEVEL_AVX2:
+        return SplitAvx2(begin, end, fields, maxFields, fieldCount);
+    case LEVEL_SSE2:
+        return SplitSse2(begin, end, fields, maxFields, fieldCount);
+#endif
+    default:
+        return SplitScalar(begin, end, fields, maxFields, fieldCount);
+    }
+}
+
+LogTokenizer::Level LogTokenizer::GetLevel() {
+    int level = g_level.load(std::memory_order_relaxed);
+    if (level < 0) {
+        level = DetectLevel();
+        g_level.store(level, std::memory_order_relaxed);
+    }
+    return (Level)level;
+}
+
+LogTokenizer::Level LogTokenizer::SetLevel(Level level) {
+    int supported = DetectLevel();
+    int capped = (int)level < supported ? (int)level : supported;
+    g_level.store(capped, std::memory_order_relaxed);
+    return (Level)capped;
+}
+
+bool LogTokenizer::ReadFlatObject(const char* begin, const char* end, const char* const* keys, int keyCount, JsonToken* values) {
+    FlatObjectReader reader(begin, end);
+    return reader.Read(keys, keyCount, values);
+}
+
+// Timestamps are short decimals: up to 15 digits with no exponent convert exactly as
+// digits / 10^scale, both sides exact doubles, so from_chars is only needed for the rest
+bool LogTokenizer::ParseNumber(const char* begin, const char* end, double& value) {
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15 };
+    const char* p = begin;
+    bool negative = p < end && *p == '-';
+    if (negative) {
+        p++;
+    }
+    long long digits = 0;
+    int count = 0;
+    int scale = -1;
+    for (; p < end; p++) {
+        if (*p >= '0' && *p <= '9') {
+            digits = digits * 10 + (*p - '0');
+            count++;
+            if (scale >= 0) {
+                scale++;
+            }
+        }
+        else if (*p == '.' && scale < 0) {
+            scale = 0;
+        }
+        else {
+            break;
+        }
+    }
+    if (p == end && count <= 15) {
+        value = (double)digits / powers[scale < 0 ? 0 : scale];
+        if (negative) {
+            value = -value;
+        }
+        return true;
+    }
+    return std::from_chars(begin, end, value).ec == std::errc();
+}
@@ -0,0 +1,203 @@
+#include "../include/utilities/MappedFile.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <filesystem>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() {
+    hFile_ = INVALID_HANDLE_VALUE;
+    hMapping_ = NULL;
+    view_ = NULL;
+    size_ = 0;
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    granularity_ = info.dwAllocationGranularity;
+}
+
+bool MappedFile::Open(const std::string& filePath) {
+    Close();
+
+    hFile_ = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    return MapOpenedFile();
+}
+
+bool MappedFile::OpenShared(const std::wstring& filePath) {
+    Close();
+
+    // The writer keeps appending, and may rename or delete the file, while the view is up
+    hFile_ = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    return MapOpenedFile();
+}
+
+bool MappedFile::MapOpenedFile() {
+    if (hFile_ == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile_, &fileSize)) {
+        Close();
+        return false;
+    }
+    size_ = fileSize.QuadPart;
+
+    // Zero-length files cannot be mapped; they are still valid to open
+    if (size_ == 0) {
+        return true;
+    }
+
+    hMapping_ = CreateFileMappingA(hFile_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!hMapping_) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::UnmapView() {
+    if (view_) {
+        UnmapViewOfFile(view_);
+        view_ = NULL;
+    }
+}
+
+void MappedFile::Close() {
+    UnmapView();
+
+    if (hMapping_) {
+        CloseHandle(hMapping_);
+        hMapping_ = NULL;
+    }
+
+    if (hFile_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(hFile_);
+        hFile_ = INVALID_HANDLE_VALUE;
+    }
+
+    size_ = 0;
+}
+
+bool MappedFile::IsOpen() const {
+    return hFile_ != INVALID_HANDLE_VALUE;
+}
+
+const char* MappedFile::MapWindow(long long offset, size_t length) {
+    UnmapView();
+
+    if (!hMapping_ || offset < 0 || length == 0 || offset + (long long)length > size_) {
+        return NULL;
+    }
+
+    // View offsets must sit on the allocation granularity, so map from the boundary below
+    long long alignedOffset = offset - (offset % granularity_);
+    size_t delta = (size_t)(offset - alignedOffset);
+
+    view_ = MapViewOfFile(hMapping_, FILE_MAP_READ,
+        (DWORD)(alignedOffset >> 32), (DWORD)(alignedOffset & 0xFFFFFFFF),
+        length + delta);
+    if (!view_) {
+        return NULL;
+    }
+
+    return (const char*)view_ + delta;
+}
+
+#else
+
+MappedFile::MappedFile() {
+    fd_ = -1;
+    view_ = NULL;
+    viewLength_ = 0;
+    size_ = 0;
+    granularity_ = sysconf(_SC_PAGESIZE);
+}
+
+bool MappedFile::Open(const std::string& filePath) {
+    Close();
+
+    fd_ = open(filePath.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd_, &info) != 0) {
+        Close();
+        return false;
+    }
+    size_ = (long long)info.st_size;
+
+    return true;
+}
+
+bool MappedFile::OpenShared(const std::wstring& filePath) {
+    // No share modes here; a writer never stands in the way
+    return Open(std::filesystem::path(filePath).string());
+}
+
+void MappedFile::UnmapView() {
+    if (view_) {
+        munmap(view_, viewLength_);
+        view_ = NULL;
+        viewLength_ = 0;
+    }
+}
+
+void MappedFile::Close() {
+    UnmapView();
+
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+
+    size_ = 0;
+}
+
+bool MappedFile::IsOpen() const {
+    return fd_ >= 0;
+}
+
+const char* MappedFile::MapWindow(long long offset, size_t length) {
+    UnmapView();
+
+    if (fd_ < 0 || offset < 0 || length == 0 || offset + (long long)length > size_) {
+        return NULL;
+    }
+
+    // mmap offsets must be page aligned, so map from the boundary below
+    long long alignedOffset = offset - (offset % granularity_);
+    size_t delta = (size_t)(offset - alignedOffset);
+
+    void* view = mmap(NULL, length + delta, PROT_READ, MAP_PRIVATE, fd_, (off_t)alignedOffset);
+    if (view == MAP_FAILED) {
+        return NULL;
+    }
+    view_ = view;
+    viewLength_ = length + delta;
+
+    // Windows are consumed front to back exactly once
+    madvise(view_, viewLength_, MADV_SEQUENTIAL);
+
+    return (const char*)view_ + delta;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+long long MappedFile::GetSize() const {
+    return size_;
+}
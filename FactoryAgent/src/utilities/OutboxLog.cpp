@@ -0,0 +1,345 @@
+#include "../include/utilities/OutboxLog.h"
+#include "../include/common/Constants.h"
+#include <zlib.h>
+#include <fstream>
+#include <filesystem>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const size_t RECORD_HEADER_BYTES = 8;       // payload length, CRC-32 of the payload
+    const size_t MAX_RECORD_BYTES = 256 * 1024 * 1024;
+
+    void PutUInt32(std::string& out, unsigned int value) {
+        for (int i = 0; i < 4; i++) {
+            out.push_back((char)((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    unsigned int GetUInt32(const char* data) {
+        unsigned int value = 0;
+        for (int i = 3; i >= 0; i--) {
+            value = (value << 8) | (unsigned char)data[i];
+        }
+        return value;
+    }
+
+    unsigned int Checksum(const std::string& data) {
+        return (unsigned int)crc32(crc32(0L, Z_NULL, 0), (const Bytef*)data.data(), (uInt)data.size());
+    }
+}
+
+OutboxLog::OutboxLog() {
+    fileSize_ = 0;
+    deadBytes_ = 0;
+    nextSequence_ = 1;
+}
+
+OutboxLog::~OutboxLog() {
+    Close();
+}
+
+bool OutboxLog::Open(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    filePath_ = filePath;
+    pending_.clear();
+    pendingByKey_.clear();
+    recordBytes_.clear();
+    fileSize_ = 0;
+    deadBytes_ = 0;
+    nextSequence_ = 1;
+
+    if (!Replay() || !file_.Open(filePath_)) {
+        return false;
+    }
+
+    // Whatever follows the last whole record is a write the crash interrupted
+    return file_.Resize(fileSize_);
+}
+
+void OutboxLog::Close() {
+    file_.Close();
+}
+
+bool OutboxLog::Replay() {
+    std::ifstream in(filePath_, std::ios::binary);
+    if (!in.is_open()) {
+        return true;
+    }
+
+    std::string payload;
+    char header[RECORD_HEADER_BYTES];
+    while (in.read(header, RECORD_HEADER_BYTES)) {
+        size_t length = GetUInt32(header);
+        unsigned int crc = GetUInt32(header + 4);
+        if (length == 0 || length > MAX_RECORD_BYTES) {
+            break;
+        }
+
+        payload.resize(length);
+        if (!in.read(&payload[0], (std::streamsize)length) || Checksum(payload) != crc) {
+            break;
+        }
+
+        long long payloadOffset = fileSize_ + (long long)RECORD_HEADER_BYTES;
+        long long recordSize = (long long)(RECORD_HEADER_BYTES + length);
+
+        // "P <seq> <key>\n<endpoint>\n<body>", "A <seq>" or "S <next seq>"
+        char type = payload[0];
+        long long sequence = strtoll(payload.c_str() + 2, NULL, 10);
+        if (type == 'P') {
+            size_t keyStart = payload.find(' ', 2);
+            size_t keyEnd = payload.find('\n');
+            size_t endpointEnd = (keyEnd == std::string::npos) ? std::string::npos : payload.find('\n', keyEnd + 1);
+            if (keyStart == std::string::npos || endpointEnd == std::string::npos || keyStart > keyEnd) {
+                break;
+            }
+
+            OutboxEntry entry;
+            entry.sequence = sequence;
+            entry.key = payload.substr(keyStart + 1, keyEnd - keyStart - 1);
+            entry.endpoint = payload.substr(keyEnd + 1, endpointEnd - keyEnd - 1);
+            entry.bodyOffset = payloadOffset + (long long)endpointEnd + 1;
+            entry.bodyLength = length - (endpointEnd + 1);
+            ApplyPut(entry, recordSize);
+        }
+        else if (type == 'A') {
+            deadBytes_ += recordSize;
+            ApplyAck(sequence);
+        }
+        else if (type == 'S') {
+            deadBytes_ += recordSize;
+        }
+        else {
+            break;
+        }
+
+        if (sequence >= nextSequence_) {
+            nextSequence_ = (type == 'S') ? sequence : sequence + 1;
+        }
+        fileSize_ += recordSize;
+    }
+
+    return true;
+}
+
+bool OutboxLog::Append(const std::string& key, const std::string& endpoint, const std::string& body,
+    long long& sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.IsOpen() || key.find_first_of(" \n") != std::string::npos || endpoint.find('\n') != std::string::npos) {
+        return false;
+    }
+
+    OutboxEntry entry;
+    entry.sequence = nextSequence_;
+    entry.key = key;
+    entry.endpoint = endpoint;
+    entry.bodyLength = body.size();
+
+    size_t bodyStart = 0;
+    std::string payload = BuildPut(entry.sequence, key, endpoint, body, bodyStart);
+
+    long long payloadOffset = 0;
+    if (!WriteRecord(payload, payloadOffset)) {
+        return false;
+    }
+
+    entry.bodyOffset = payloadOffset + (long long)bodyStart;
+    ApplyPut(entry, (long long)(RECORD_HEADER_BYTES + payload.size()));
+    nextSequence_++;
+    sequence = entry.sequence;
+    return true;
+}
+
+bool OutboxLog::Acknowledge(long long sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.count(sequence) == 0) {
+        return true;
+    }
+
+    long long payloadOffset = 0;
+    std::string payload = "A " + std::to_string(sequence);
+    if (!WriteRecord(payload, payloadOffset)) {
+        return false;
+    }
+    deadBytes_ += (long long)(RECORD_HEADER_BYTES + payload.size());
+    ApplyAck(sequence);
+
+    CompactIfWorthwhile();
+    return true;
+}
+
+std::vector<OutboxEntry> OutboxLog::Peek(size_t maxEntries) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<OutboxEntry> entries;
+    std::map<long long, OutboxEntry>::const_iterator it;
+    for (it = pending_.begin(); it != pending_.end() && entries.size() < maxEntries; ++it) {
+        entries.push_back(it->second);
+    }
+    return entries;
+}
+
+bool OutboxLog::ReadBody(const OutboxEntry& entry, std::string& body) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // A compaction since the Peek moved the record; find it by sequence
+    std::map<long long, OutboxEntry>::const_iterator it = pending_.find(entry.sequence);
+    if (it == pending_.end()) {
+        return false;
+    }
+
+    std::ifstream in(filePath_, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    body.resize(it->second.bodyLength);
+    in.seekg(it->second.bodyOffset);
+    return it->second.bodyLength == 0 || (bool)in.read(&body[0], (std::streamsize)it->second.bodyLength);
+}
+
+size_t OutboxLog::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+long long OutboxLog::GetFileSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fileSize_;
+}
+
+bool OutboxLog::WriteRecord(const std::string& payload, long long& payloadOffset) {
+    std::string record;
+    record.reserve(RECORD_HEADER_BYTES + payload.size());
+    PutUInt32(record, (unsigned int)payload.size());
+    PutUInt32(record, Checksum(payload));
+    record += payload;
+
+    // Flushed to the disk, not just the OS, so a power cut cannot take an acknowledged write
+    if (!file_.WriteAt(fileSize_, record.data(), record.size()) || !file_.Flush()) {
+        // Leave no half record for the next append to land behind
+        file_.Resize(fileSize_);
+        return false;
+    }
+
+    payloadOffset = fileSize_ + (long long)RECORD_HEADER_BYTES;
+    fileSize_ += (long long)record.size();
+    return true;
+}
+
+void OutboxLog::ApplyPut(const OutboxEntry& entry, long long recordSize) {
+    std::map<std::string, long long>::iterator previous = pendingByKey_.find(entry.key);
+    if (previous != pendingByKey_.end()) {
+        deadBytes_ += recordBytes_[previous->second];
+        recordBytes_.erase(previous->second);
+        pending_.erase(previous->second);
+    }
+
+    pending_[entry.sequence] = entry;
+    pendingByKey_[entry.key] = entry.sequence;
+    recordBytes_[entry.sequence] = recordSize;
+}
+
+void OutboxLog::ApplyAck(long long sequence) {
+    std::map<long long, OutboxEntry>::iterator it = pending_.find(sequence);
+    if (it == pending_.end()) {
+        return;
+    }
+
+    deadBytes_ += recordBytes_[sequence];
+    pendingByKey_.erase(it->second.key);
+    recordBytes_.erase(sequence);
+    pending_.erase(it);
+}
+
+bool OutboxLog::CompactIfWorthwhile() {
+    if (fileSize_ < AgentConstants::OUTBOX_COMPACT_BYTES || deadBytes_ * 2 < fileSize_) {
+        return true;
+    }
+
+    // Pending entries are copied, in order and under their own sequence numbers, into a
+    // new file that replaces the old one in a single rename
+    std::string tempPath = filePath_ + ".tmp";
+    std::ifstream in(filePath_, std::ios::binary);
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!in.is_open() || !out.is_open()) {
+        return false;
+    }
+
+    std::map<long long, OutboxEntry> moved;
+    std::map<long long, long long> movedBytes;
+    long long size = 0;
+
+    std::string marker = "S " + std::to_string(nextSequence_);
+    std::string record;
+    PutUInt32(record, (unsigned int)marker.size());
+    PutUInt32(record, Checksum(marker));
+    record += marker;
+    out.write(record.data(), (std::streamsize)record.size());
+    size += (long long)record.size();
+
+    std::map<long long, OutboxEntry>::const_iterator it;
+    for (it = pending_.begin(); it != pending_.end(); ++it) {
+        std::string body(it->second.bodyLength, '\0');
+        in.seekg(it->second.bodyOffset);
+        if (it->second.bodyLength > 0 && !in.read(&body[0], (std::streamsize)body.size())) {
+            return false;
+        }
+
+        size_t bodyStart = 0;
+        std::string payload = BuildPut(it->first, it->second.key, it->second.endpoint, body, bodyStart);
+        record.clear();
+        PutUInt32(record, (unsigned int)payload.size());
+        PutUInt32(record, Checksum(payload));
+        record += payload;
+        out.write(record.data(), (std::streamsize)record.size());
+
+        OutboxEntry entry = it->second;
+        entry.bodyOffset = size + (long long)RECORD_HEADER_BYTES + (long long)bodyStart;
+        moved[it->first] = entry;
+        movedBytes[it->first] = (long long)record.size();
+        size += (long long)record.size();
+    }
+
+    out.flush();
+    bool written = out.good();
+    out.close();
+    in.close();
+    if (!written) {
+        return false;
+    }
+
+    // The rename only happens once the copy is complete on disk
+    RandomAccessFile copy;
+    if (!copy.Open(tempPath) || !copy.Flush()) {
+        return false;
+    }
+    copy.Close();
+
+    file_.Close();
+    std::error_code error;
+    fs::rename(tempPath, filePath_, error);
+    if (!file_.Open(filePath_)) {
+        return false;
+    }
+    if (error) {
+        return true;
+    }
+
+    pending_.swap(moved);
+    recordBytes_.swap(movedBytes);
+    fileSize_ = size;
+    deadBytes_ = (long long)(RECORD_HEADER_BYTES + marker.size());
+    return true;
+}
+
+std::string OutboxLog::BuildPut(long long sequence, const std::string& key, const std::string& endpoint,
+    const std::string& body, size_t& bodyStart) {
+    std::string payload = "P " + std::to_string(sequence) + " " + key + "\n" + endpoint + "\n";
+    bodyStart = payload.size();
+    payload += body;
+    return payload;
+}
@@ -0,0 +1,114 @@
+#include "../include/utilities/RandomAccessFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifdef _WIN32
+
+RandomAccessFile::RandomAccessFile() {
+    hFile_ = INVALID_HANDLE_VALUE;
+}
+
+bool RandomAccessFile::Open(const std::string& filePath) {
+    Close();
+    hFile_ = CreateFileA(filePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    return hFile_ != INVALID_HANDLE_VALUE;
+}
+
+void RandomAccessFile::Close() {
+    if (hFile_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(hFile_);
+        hFile_ = INVALID_HANDLE_VALUE;
+    }
+}
+
+bool RandomAccessFile::IsOpen() const {
+    return hFile_ != INVALID_HANDLE_VALUE;
+}
+
+bool RandomAccessFile::Resize(long long size) {
+    LARGE_INTEGER position;
+    position.QuadPart = size;
+    return SetFilePointerEx(hFile_, position, NULL, FILE_BEGIN) && SetEndOfFile(hFile_);
+}
+
+bool RandomAccessFile::WriteAt(long long offset, const char* data, size_t length) {
+    while (length > 0) {
+        // The OVERLAPPED offset makes this a positioned write even on a synchronous handle
+        OVERLAPPED overlapped;
+        ZeroMemory(&overlapped, sizeof(overlapped));
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        DWORD chunk = (DWORD)(length < MAXDWORD ? length : MAXDWORD);
+        DWORD written = 0;
+        if (!WriteFile(hFile_, data, chunk, &written, &overlapped) || written == 0) {
+            return false;
+        }
+        offset += written;
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+bool RandomAccessFile::Flush() {
+    return FlushFileBuffers(hFile_) != FALSE;
+}
+
+#else
+
+RandomAccessFile::RandomAccessFile() {
+    fd_ = -1;
+}
+
+bool RandomAccessFile::Open(const std::string& filePath) {
+    Close();
+    fd_ = open(filePath.c_str(), O_WRONLY | O_CREAT, 0644);
+    return fd_ >= 0;
+}
+
+void RandomAccessFile::Close() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool RandomAccessFile::IsOpen() const {
+    return fd_ >= 0;
+}
+
+bool RandomAccessFile::Resize(long long size) {
+    return ftruncate(fd_, (off_t)size) == 0;
+}
+
+bool RandomAccessFile::WriteAt(long long offset, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd_, data, length, (off_t)offset);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        offset += written;
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+bool RandomAccessFile::Flush() {
+    return fsync(fd_) == 0;
+}
+
+#endif
+
+RandomAccessFile::~RandomAccessFile() {
+    Close();
+}
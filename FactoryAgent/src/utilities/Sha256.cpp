@@ -0,0 +1,177 @@
+#include "../include/utilities/Sha256.h"
+#include <fstream>
+#include <vector>
+#include <cstring>
+
+namespace {
+    const uint32_t ROUND_CONSTANTS[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    inline uint32_t RotateRight(uint32_t value, int bits) {
+        return (value >> bits) | (value << (32 - bits));
+    }
+}
+
+Sha256::Sha256() {
+    Reset();
+}
+
+void Sha256::Reset() {
+    state_[0] = 0x6a09e667;
+    state_[1] = 0xbb67ae85;
+    state_[2] = 0x3c6ef372;
+    state_[3] = 0xa54ff53a;
+    state_[4] = 0x510e527f;
+    state_[5] = 0x9b05688c;
+    state_[6] = 0x1f83d9ab;
+    state_[7] = 0x5be0cd19;
+    totalLength_ = 0;
+    bufferLength_ = 0;
+}
+
+void Sha256::Transform(const unsigned char* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+            ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t temp1 = h + s1 + ch + ROUND_CONSTANTS[i] + w[i];
+        uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t temp2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+void Sha256::Update(const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    totalLength_ += length;
+
+    if (bufferLength_ > 0) {
+        size_t take = 64 - bufferLength_;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(buffer_ + bufferLength_, bytes, take);
+        bufferLength_ += take;
+        bytes += take;
+        length -= take;
+
+        if (bufferLength_ < 64) {
+            return;
+        }
+        Transform(buffer_);
+        bufferLength_ = 0;
+    }
+
+    while (length >= 64) {
+        Transform(bytes);
+        bytes += 64;
+        length -= 64;
+    }
+
+    if (length > 0) {
+        memcpy(buffer_, bytes, length);
+        bufferLength_ = length;
+    }
+}
+
+std::string Sha256::FinalHex() {
+    uint64_t bitLength = totalLength_ * 8;
+
+    unsigned char padding[72];
+    size_t padLength = (bufferLength_ < 56) ? (56 - bufferLength_) : (120 - bufferLength_);
+    memset(padding, 0, sizeof(padding));
+    padding[0] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        padding[padLength + i] = (unsigned char)(bitLength >> (56 - i * 8));
+    }
+    Update(padding, padLength + 8);
+
+    static const char* hexDigits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(64);
+    for (int i = 0; i < 8; i++) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            hex += hexDigits[(state_[i] >> shift) & 0xF];
+        }
+    }
+    return hex;
+}
+
+std::string Sha256::HashString(const std::string& data) {
+    Sha256 hasher;
+    hasher.Update(data.data(), data.size());
+    return hasher.FinalHex();
+}
+
+bool Sha256::HashFile(const std::string& filePath, std::string& hexDigest, long long prefixLength) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    Sha256 hasher;
+    std::vector<char> buffer(1024 * 1024);
+    long long remaining = prefixLength;
+
+    while (prefixLength < 0 || remaining > 0) {
+        std::streamsize want = (std::streamsize)buffer.size();
+        if (prefixLength >= 0 && remaining < want) {
+            want = (std::streamsize)remaining;
+        }
+
+        file.read(buffer.data(), want);
+        std::streamsize got = file.gcount();
+        if (got <= 0) {
+            break;
+        }
+
+        hasher.Update(buffer.data(), (size_t)got);
+        remaining -= got;
+    }
+
+    if (prefixLength >= 0 && remaining > 0) {
+        return false;
+    }
+
+    hexDigest = hasher.FinalHex();
+    return true;
+}
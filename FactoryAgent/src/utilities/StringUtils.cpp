@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <cctype>
 #include <sstream>
+#include <iomanip>
+#include <ctime>
 
 std::string StringUtils::Trim(const std::string& str) {
     return TrimLeft(TrimRight(str));
@@ -71,4 +73,26 @@ std::string StringUtils::Replace(const std::string& str, const std::string& from
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+std::string StringUtils::FormatFileTime(std::filesystem::file_time_type ftime) {
+    try {
+        auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+            ftime - std::filesystem::file_time_type::clock::now() + std::chrono::system_clock::now()
+        );
+        std::time_t cftime = std::chrono::system_clock::to_time_t(sctp);
+
+        std::stringstream ss;
+        struct tm timeinfo;
+#ifdef _WIN32
+        localtime_s(&timeinfo, &cftime);
+#else
+        localtime_r(&cftime, &timeinfo);
+#endif
+        ss << std::put_time(&timeinfo, "%Y-%m-%d %H:%M:%S");
+        return ss.str();
+    }
+    catch (...) {
+        return "2000-01-01 00:00:00";
+    }
+}
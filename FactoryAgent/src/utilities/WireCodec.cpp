@@ -0,0 +1,96 @@
+#include "../include/utilities/WireCodec.h"
+#include "../include/common/Constants.h"
+#include "../include/utilities/StringUtils.h"
+#include <vector>
+#include <cstdint>
+
+bool WireCodec::Encode(const json& value, WireEncoding encoding, std::string& output) {
+    try {
+        if (encoding == WIRE_ENCODING_JSON) {
+            output = value.dump();
+            return true;
+        }
+
+        std::vector<std::uint8_t> bytes;
+        if (encoding == WIRE_ENCODING_CBOR) {
+            json::to_cbor(value, bytes);
+        }
+        else {
+            json::to_msgpack(value, bytes);
+        }
+        output.assign(bytes.begin(), bytes.end());
+        return true;
+    }
+    catch (...) {
+        // Invalid UTF-8 in a string value is the usual culprit
+        return false;
+    }
+}
+
+bool WireCodec::Decode(const std::string& input, const std::string& contentType, json& value) {
+    std::string type = StringUtils::ToLower(contentType);
+
+    try {
+        if (type.find(AgentConstants::CONTENT_TYPE_CBOR) != std::string::npos) {
+            value = json::from_cbor(input);
+        }
+        else if (type.find(AgentConstants::CONTENT_TYPE_MSGPACK) != std::string::npos) {
+            value = json::from_msgpack(input);
+        }
+        else {
+            value = json::parse(input);
+        }
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
+
+const char* WireCodec::ContentType(WireEncoding encoding) {
+    switch (encoding) {
+    case WIRE_ENCODING_CBOR:
+        return AgentConstants::CONTENT_TYPE_CBOR;
+    case WIRE_ENCODING_MSGPACK:
+        return AgentConstants::CONTENT_TYPE_MSGPACK;
+    default:
+        return AgentConstants::CONTENT_TYPE_JSON;
+    }
+}
+
+const char* WireCodec::Name(WireEncoding encoding) {
+    switch (encoding) {
+    case WIRE_ENCODING_CBOR:
+        return "cbor";
+    case WIRE_ENCODING_MSGPACK:
+        return "msgpack";
+    default:
+        return "json";
+    }
+}
+
+bool WireCodec::FromName(const std::string& name, WireEncoding& encoding) {
+    std::string lower = StringUtils::ToLower(name);
+
+    if (lower == "cbor") {
+        encoding = WIRE_ENCODING_CBOR;
+    }
+    else if (lower == "msgpack") {
+        encoding = WIRE_ENCODING_MSGPACK;
+    }
+    else if (lower == "json") {
+        encoding = WIRE_ENCODING_JSON;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+json WireCodec::SupportedNames() {
+    json names = json::array();
+    names.push_back(Name(WIRE_ENCODING_CBOR));
+    names.push_back(Name(WIRE_ENCODING_MSGPACK));
+    names.push_back(Name(WIRE_ENCODING_JSON));
+    return names;
+}
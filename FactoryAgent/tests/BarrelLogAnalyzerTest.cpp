@@ -0,0 +1,171 @@
+/*
+ * BarrelLogAnalyzerTest.cpp
+ * A small log with known timelines gives the execution times, operation order,
+ * barrel order and summary logParser.ts would; the result does not depend on
+ * how the log is cut into pieces; a line too long to be an event is dropped
+ * without breaking the lines after it
+ */
+
+#include "../include/services/BarrelLogAnalyzer.h"
+#include "../include/common/Constants.h"
+#include "../third_party/json/json.hpp"
+#include "TestSupport.h"
+#include <sstream>
+#include <random>
+#include <cctype>
+
+using json = nlohmann::json;
+
+namespace {
+    std::string EventLine(const char* sequence, const char* event, const std::string& data) {
+        return std::string("2026-10-17 08:00:00.000\tINFO\tL1\tPC3\tSeq\tT1\tSeqRunner\t0\t") + sequence + "\t" +
+            event + "\t" + data + "\n";
+    }
+
+    std::string SampleLog() {
+        std::string log = "SEM_LOG_VERSION\t2\n";
+        // Barrel 10: a gap of 50 between Load and Drill, Wash overlapping Drill
+        log += EventLine("Load", "START", "{\"barrelId\":10,\"startTs\":0}");
+        log += EventLine("Load", "END", "{\"barrelId\":10,\"endTs\":100,\"idealMs\":90}");
+        log += EventLine("Drill", "START", "{\"barrelId\":10,\"startTs\":150}");
+        log += EventLine("Drill", "END", "{\"barrelId\":10,\"endTs\":250}");
+        log += EventLine("Wash", "START", "{\"barrelId\":10,\"startTs\":200}");
+        std::string crlf = EventLine("Wash", "END", "{\"barrelId\":10,\"endTs\":260,\"idealMs\":50}");
+        log += crlf.insert(crlf.size() - 1, "\r");
+        // Barrel 2: an END with no START takes a sequence number but no place on the timeline
+        log += EventLine("Load", "START", "{\"barrelId\":2,\"startTs\":1000}");
+        log += EventLine("Load", "END", "{\"barrelId\":2,\"endTs\":1040.5}");
+        log += EventLine("Clamp", "END", "{\"barrelId\":2,\"endTs\":5}");
+        log += EventLine("Drill", "START", "{\"barrelId\":2,\"note\":{\"a\":[1,\"}\"]},\"startTs\":1100}");
+        log += EventLine("Drill", "END", "{\"barrelId\":2,\"endTs\":1200}");
+        // The string "2" is a barrel of its own, as in the dashboard
+        log += EventLine("Load", "START", "{\"barrelId\":\"2\",\"startTs\":0}");
+        log += EventLine("Load", "START", "{\"barrelId\":3,\"startTs\":5");
+        log += "2026-10-17\tnoise line without fields\n";
+        log += EventLine("Load", "PAUSE", "{\"barrelId\":3}");
+        std::string last = EventLine("Mark", "START", "{\"barrelId\":10,\"startTs\":300}");
+        log += last.substr(0, last.size() - 1);
+        return log;
+    }
+
+    std::string Analyze(const std::string& log, size_t pieceBytes) {
+        BarrelLogAnalyzer analyzer;
+        for (size_t offset = 0; offset < log.size(); offset += pieceBytes) {
+            analyzer.Feed(log.data() + offset, std::min(pieceBytes, log.size() - offset));
+        }
+        analyzer.Finish();
+        std::string result;
+        analyzer.BuildResult(result);
+        return result;
+    }
+
+    void KnownTimelines() {
+        json result = json::parse(Analyze(SampleLog(), SampleLog().size()), nullptr, false);
+        CHECK(result.is_object());
+        if (!result.is_object()) {
+            return;
+        }
+
+        CHECK(result["sequences"] == json::parse("[\"Load\",\"Drill\",\"Wash\",\"Clamp\",\"Mark\"]"));
+
+        // parseInt order, ties in order of first appearance
+        json& barrels = result["barrels"];
+        CHECK(barrels.size() == 4);
+        if (barrels.size() != 4) {
+            return;
+        }
+        CHECK(barrels[0]["barrelId"] == "2");
+        CHECK(barrels[0]["totalExecutionTime"] == 140.5);
+        CHECK(barrels[0]["operations"] == json::parse("[[0,1,1000,1040.5,40.5,1000],[1,3,1100,1200,100,1000]]"));
+        CHECK(barrels[1]["barrelId"] == "2");
+        CHECK(barrels[1]["totalExecutionTime"] == 0);
+        CHECK(barrels[1]["operations"].empty());
+        CHECK(barrels[2]["barrelId"] == "3");
+        CHECK(barrels[2]["operations"].empty());
+        CHECK(barrels[3]["barrelId"] == "10");
+        CHECK(barrels[3]["totalExecutionTime"] == 210);
+        CHECK(barrels[3]["operations"] ==
+            json::parse("[[0,1,0,100,100,90],[1,2,150,250,100,1000],[2,3,200,260,60,50]]"));
+
+        json& summary = result["summary"];
+        CHECK(summary["totalBarrels"] == 4);
+        CHECK(summary["averageExecutionTime"] == 87.625);
+        CHECK(summary["minExecutionTime"] == 0);
+        CHECK(summary["maxExecutionTime"] == 210);
+        CHECK(summary["lines"] == 17);
+        CHECK(summary["events"] == 14);
+    }
+
+    void AnyPiecesGiveTheSameResult() {
+        std::string log;
+        for (int copy = 0; copy < 50; copy++) {
+            std::string sample = SampleLog();
+            // Fresh numeric barrel ids per copy, so the result grows with the log
+            std::string prefix = std::to_string(copy + 1);
+            const std::string key = "\"barrelId\":";
+            for (size_t at = sample.find(key); at != std::string::npos; at = sample.find(key, at + 1)) {
+                if (isdigit((unsigned char)sample[at + key.size()])) {
+                    sample.insert(at + key.size(), prefix);
+                }
+            }
+            log += sample + "\n";
+        }
+
+        std::string whole = Analyze(log, log.size());
+        json parsed = json::parse(whole, nullptr, false);
+        // The string id "2" is the same barrel in every copy
+        CHECK(parsed.is_object() && parsed["barrels"].size() == 50 * 3 + 1);
+        CHECK(Analyze(log, 1) == whole);
+        CHECK(Analyze(log, 7) == whole);
+        CHECK(Analyze(log, 4096) == whole);
+
+        BarrelLogAnalyzer analyzer;
+        std::mt19937 random(11);
+        for (size_t offset = 0; offset < log.size();) {
+            size_t length = std::min<size_t>(log.size() - offset, 1 + random() % 300);
+            analyzer.Feed(log.data() + offset, length);
+            offset += length;
+        }
+        analyzer.Finish();
+        std::string pieces;
+        analyzer.BuildResult(pieces);
+        CHECK(pieces == whole);
+
+        BarrelLogAnalyzer streamed;
+        std::istringstream stream(log);
+        CHECK(streamed.FeedStream(stream));
+        streamed.Finish();
+        std::string fromStream;
+        streamed.BuildResult(fromStream);
+        CHECK(fromStream == whole);
+    }
+
+    void OverlongLineIsDropped() {
+        std::string longLine(AgentConstants::LOG_ANALYSIS_MAX_LINE_BYTES + 10, 'x');
+        longLine += "\n";
+        std::string event = EventLine("Load", "START", "{\"barrelId\":1,\"startTs\":0}");
+        event += EventLine("Load", "END", "{\"barrelId\":1,\"endTs\":5}");
+
+        BarrelLogAnalyzer analyzer;
+        size_t third = longLine.size() / 3;
+        analyzer.Feed(longLine.data(), third);
+        analyzer.Feed(longLine.data() + third, third);
+        analyzer.Feed(longLine.data() + 2 * third, longLine.size() - 2 * third);
+        analyzer.Feed(event.data(), event.size());
+        analyzer.Finish();
+        CHECK(analyzer.GetLineCount() == 3);
+        CHECK(analyzer.GetEventCount() == 2);
+
+        std::string text;
+        analyzer.BuildResult(text);
+        json result = json::parse(text, nullptr, false);
+        CHECK(result.is_object() && result["summary"]["maxExecutionTime"] == 5);
+    }
+}
+
+int main() {
+    KnownTimelines();
+    AnyPiecesGiveTheSameResult();
+    OverlongLineIsDropped();
+    return TestSupport::Result();
+}
@@ -0,0 +1,101 @@
+/*
+ * CompressionTest.cpp
+ * A request body from COMPRESSION_MIN_BYTES up goes out gzipped and a
+ * heartbeat-sized one goes out as it is, as StandInServer counts the bytes it
+ * read. What was compressed shows up in GetCompressionStats and in the
+ * heartbeat metrics summary for the interval, and not again once acknowledged
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/common/Constants.h"
+#include "TestSupport.h"
+#include <cwchar>
+
+namespace {
+    std::string Narrow(const wchar_t* text) {
+        return std::string(text, text + wcslen(text));
+    }
+
+    long long BytesIn(const StandInServer& server, const wchar_t* endpoint) {
+        std::map<std::string, StandInEndpointStats> stats = server.GetStats();
+        std::string path = Narrow(endpoint);
+        return stats.count(path) ? stats[path].bytesIn : 0;
+    }
+
+    json SummaryEntry(const json& summary, const wchar_t* endpoint) {
+        for (size_t i = 0; i < summary["endpoints"].size(); i++) {
+            if (summary["endpoints"][i].value("endpoint", "") == Narrow(endpoint)) {
+                return summary["endpoints"][i];
+            }
+        }
+        return json();
+    }
+
+    // As ModelService::SyncModelsToServer; 50 models are several KB of repetitive JSON
+    json ModelSync() {
+        json request;
+        request["pcId"] = 1;
+        request["models"] = json::array();
+        for (int i = 0; i < 50; i++) {
+            json model;
+            model["ModelName"] = "MODEL_" + std::to_string(1000 + i);
+            model["ModelPath"] = "D:\\LEADER_TEST\\INSPECTION\\MODEL_" + std::to_string(1000 + i);
+            model["IsCurrent"] = i == 0;
+            request["models"].push_back(model);
+        }
+        return request;
+    }
+
+    void LargeBodiesOnlyAreGzipped() {
+        StandInServer server;
+        CHECK(server.Start(0));
+        HttpClient client(server.GetBaseUrl());
+
+        json heartbeat;
+        heartbeat["pcId"] = 1;
+        heartbeat["isApplicationRunning"] = true;
+        std::string heartbeatBody = heartbeat.dump();
+        CHECK((int)heartbeatBody.size() < AgentConstants::COMPRESSION_MIN_BYTES);
+        json response;
+        CHECK(client.Post(AgentConstants::ENDPOINT_HEARTBEAT, heartbeat, response));
+        CHECK(BytesIn(server, AgentConstants::ENDPOINT_HEARTBEAT) == (long long)heartbeatBody.size());
+
+        json models = ModelSync();
+        std::string modelsBody = models.dump();
+        CHECK((int)modelsBody.size() >= AgentConstants::COMPRESSION_MIN_BYTES);
+        CHECK(client.Post(AgentConstants::ENDPOINT_SYNC_MODELS, models, response));
+        long long modelsWire = BytesIn(server, AgentConstants::ENDPOINT_SYNC_MODELS);
+        CHECK(modelsWire > 0 && modelsWire < (long long)modelsBody.size() / 2);
+
+        std::map<std::wstring, CompressionStats> stats = client.GetCompressionStats();
+        CHECK(stats.count(AgentConstants::ENDPOINT_HEARTBEAT) == 0);
+        CHECK(stats.count(AgentConstants::ENDPOINT_SYNC_MODELS) == 1);
+        if (stats.count(AgentConstants::ENDPOINT_SYNC_MODELS)) {
+            const CompressionStats& sync = stats[AgentConstants::ENDPOINT_SYNC_MODELS];
+            CHECK(sync.requestsCompressed == 1);
+            CHECK(sync.requestRawBytes == (long long)modelsBody.size());
+            CHECK(sync.requestWireBytes == modelsWire);
+        }
+
+        // The summary the next heartbeat carries says how well the sync compressed
+        json summary = client.CollectMetricsSummary();
+        json sync = SummaryEntry(summary, AgentConstants::ENDPOINT_SYNC_MODELS);
+        CHECK(sync.value("gzipRequests", 0) == 1);
+        CHECK(sync.value("gzipRequestRatio", 0.0) > 2.0);
+        json beat = SummaryEntry(summary, AgentConstants::ENDPOINT_HEARTBEAT);
+        CHECK(beat.value("count", 0) == 1 && !beat.contains("gzipRequests"));
+
+        // Once the server has taken it, the next interval starts from nothing
+        client.AcknowledgeMetricsSummary();
+        CHECK(client.Post(AgentConstants::ENDPOINT_HEARTBEAT, heartbeat, response));
+        summary = client.CollectMetricsSummary();
+        CHECK(SummaryEntry(summary, AgentConstants::ENDPOINT_SYNC_MODELS).is_null());
+        server.Stop();
+    }
+}
+
+int main() {
+    LargeBodiesOnlyAreGzipped();
+    return TestSupport::Result();
+}
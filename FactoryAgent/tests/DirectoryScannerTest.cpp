@@ -0,0 +1,158 @@
+/*
+ * DirectoryScannerTest.cpp
+ * A recursive scan reports the same files, folders, sizes and write times as
+ * std::filesystem, lays each folder's children out side by side in name order,
+ * lists folders too large for one getdents64 batch in full, and does not
+ * descend into linked folders
+ */
+
+#include "../include/utilities/DirectoryScanner.h"
+#include "TestSupport.h"
+#include <map>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const int WIDE_FOLDER_FILES = 3000;     // several 64 KB getdents64 batches
+
+    struct Expected {
+        bool isDirectory;
+        unsigned long long size;
+        long long writeTime;
+    };
+
+    void WriteFile(const fs::path& path, size_t size) {
+        std::ofstream file(path.string().c_str(), std::ios::binary);
+        file << std::string(size, 'x');
+    }
+
+    void BuildTree(const fs::path& root) {
+        fs::create_directories(root / "a" / "deep" / "d1" / "d2");
+        fs::create_directories(root / "empty");
+        fs::create_directories(root / "wide");
+        WriteFile(root / "b.log", 5);
+        WriteFile(root / "a" / "x.txt", 3);
+        WriteFile(root / "a" / "y.txt", 0);
+        WriteFile(root / "a" / "deep" / "d1" / "d2" / "z.log", 7);
+        for (int i = 0; i < WIDE_FOLDER_FILES; i++) {
+            WriteFile(root / "wide" / ("camera_" + std::to_string(i) + "_production_line_log.txt"), i % 17);
+        }
+        fs::create_symlink(root / "b.log", root / "link.log");
+        fs::create_directory_symlink(root / "a", root / "loop");
+    }
+
+    // What std::filesystem sees, without following linked folders
+    std::map<std::string, Expected> Reference(const fs::path& root) {
+        std::map<std::string, Expected> expected;
+        for (fs::recursive_directory_iterator it(root); it != fs::recursive_directory_iterator(); ++it) {
+            Expected entry;
+            entry.isDirectory = it->is_directory();
+            entry.size = entry.isDirectory ? 0 : it->file_size();
+            entry.writeTime = entry.isDirectory ? 0 : (long long)it->last_write_time().time_since_epoch().count();
+            expected[it->path().lexically_relative(root).string()] = entry;
+        }
+        return expected;
+    }
+
+    // Walks the flat layout from entries[index], checking order and collecting every node by path
+    void Collect(const std::vector<ScanEntry>& entries, int index, const std::string& path,
+        std::map<std::string, const ScanEntry*>& found) {
+        const ScanEntry& folder = entries[index];
+        CHECK(folder.firstChild + folder.childCount <= (int)entries.size());
+        for (int i = folder.firstChild; i < folder.firstChild + folder.childCount; i++) {
+            if (i > folder.firstChild) {
+                CHECK(entries[i - 1].name < entries[i].name);
+            }
+            std::string childPath = DirectoryScanner::RelativePath(path, entries[i]);
+            found[childPath] = &entries[i];
+            if (entries[i].isDirectory) {
+                Collect(entries, i, childPath, found);
+            }
+        }
+    }
+
+    void RecursiveScanMatchesFilesystem() {
+        TestSupport::ScratchDir scratch("scannertest");
+        fs::path root = scratch.File("Log");
+        BuildTree(root);
+
+        DirectoryScanner scanner;
+        std::vector<ScanEntry> entries;
+        CHECK(scanner.Scan(root.string(), true, entries));
+        CHECK(!entries.empty());
+        if (entries.empty()) {
+            return;
+        }
+        // root, a, deep, d1, d2, empty, wide
+        CHECK(scanner.GetStats().folders == 7);
+        CHECK(scanner.GetStats().failedFolders == 0);
+
+        std::map<std::string, const ScanEntry*> found;
+        Collect(entries, 0, "", found);
+        std::map<std::string, Expected> expected = Reference(root);
+        CHECK(found.size() == expected.size());
+        CHECK(found.size() + 1 == entries.size());
+
+        for (std::map<std::string, Expected>::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+            std::map<std::string, const ScanEntry*>::const_iterator match = found.find(it->first);
+            CHECK(match != found.end());
+            if (match == found.end()) {
+                continue;
+            }
+            CHECK(match->second->isDirectory == it->second.isDirectory);
+            if (!it->second.isDirectory) {
+                CHECK(match->second->size == it->second.size);
+                CHECK(match->second->writeTime == it->second.writeTime);
+            }
+        }
+
+        // A link to a file is still a file; a linked folder is listed but not entered
+        CHECK(found.count("link.log") == 1 && found["link.log"]->isLink && found["link.log"]->size == 5);
+        CHECK(found.count("loop") == 1 && found["loop"]->isDirectory && found["loop"]->isLink);
+        CHECK(found.count("loop") == 1 && found["loop"]->childCount == 0);
+        CHECK(found.count("wide") == 1 && found["wide"]->childCount == WIDE_FOLDER_FILES);
+    }
+
+    void ShallowScanAndListFolder() {
+        TestSupport::ScratchDir scratch("scannertest");
+        fs::path root = scratch.File("Log");
+        BuildTree(root);
+
+        DirectoryScanner scanner;
+        std::vector<ScanEntry> entries;
+        CHECK(scanner.Scan(root.string(), false, entries));
+        // root, then a, b.log, empty, link.log, loop, wide
+        CHECK(entries.size() == 7);
+        CHECK(scanner.GetStats().folders == 1);
+        for (size_t i = 1; i < entries.size(); i++) {
+            CHECK(entries[i].childCount == 0);
+        }
+
+        std::vector<ScanEntry> listed;
+        CHECK(DirectoryScanner::ListFolder((root / "a").string(), listed));
+        CHECK(listed.size() == 3);
+        if (listed.size() == 3) {
+            CHECK(listed[0].name == "deep" && listed[0].isDirectory);
+            CHECK(listed[1].name == "x.txt" && listed[1].size == 3);
+            CHECK(listed[2].name == "y.txt" && listed[2].size == 0);
+        }
+        CHECK(DirectoryScanner::ListFolder((root / "empty").string(), listed));
+        CHECK(listed.empty());
+    }
+
+    void MissingRootFails() {
+        TestSupport::ScratchDir scratch("scannertest");
+        DirectoryScanner scanner;
+        std::vector<ScanEntry> entries;
+        CHECK(!scanner.Scan(scratch.File("missing"), true, entries));
+        CHECK(entries.empty());
+    }
+}
+
+int main() {
+    RecursiveScanMatchesFilesystem();
+    ShallowScanAndListFolder();
+    MissingRootFails();
+    return TestSupport::Result();
+}
@@ -0,0 +1,221 @@
+/*
+ * DirectoryWatcherTest.cpp
+ * The inotify backend of DirectoryWatcher: a burst of writes to one file is
+ * handed over as one batch naming it once; a folder created after Start is
+ * watched too; a burst past DIRECTORY_WATCH_MAX_PATHS is reported as a rescan;
+ * the root deleted and created again is reported as a rescan and watched
+ * again; and Stop returns at once, also while the watcher waits for the root
+ */
+
+#include "../include/monitoring/DirectoryWatcher.h"
+#include "../include/common/Constants.h"
+#include "TestSupport.h"
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <thread>
+#include <future>
+
+namespace fs = std::filesystem;
+
+namespace {
+    const int BATCH_WAIT_MS = AgentConstants::DIRECTORY_WATCH_MAX_DELAY_MS + 1000;
+    const double STOP_LIMIT_MS = 100.0;
+
+    // Collects the batches the watcher hands over on its thread
+    class BatchLog {
+    public:
+        DirectoryWatcher::ChangeHandler Handler() {
+            return [this](const DirectoryChanges& changes) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                batches_.push_back(changes);
+                arrived_.notify_all();
+            };
+        }
+
+        // Waits until at least count batches have arrived in all
+        bool WaitFor(size_t count, int timeoutMs) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return arrived_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                [this, count]() { return batches_.size() >= count; });
+        }
+
+        std::vector<DirectoryChanges> Batches() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return batches_;
+        }
+
+        size_t Count() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return batches_.size();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable arrived_;
+        std::vector<DirectoryChanges> batches_;
+    };
+
+    bool Names(const DirectoryChanges& changes, const std::string& path) {
+        return std::find(changes.paths.begin(), changes.paths.end(), path) != changes.paths.end();
+    }
+
+    void Write(const std::string& path, const std::string& text) {
+        std::ofstream file(path.c_str(), std::ios::app);
+        file << text;
+    }
+
+    double StopMillis(DirectoryWatcher& watcher) {
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        watcher.Stop();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    void BurstIsOneBatch() {
+        TestSupport::ScratchDir scratch("watchertest");
+        BatchLog log;
+        DirectoryWatcher watcher;
+        CHECK(watcher.Start(scratch.Path(), true, log.Handler()));
+        CHECK(watcher.IsWatching());
+
+        for (int i = 0; i < 500; i++) {
+            Write(scratch.File("live.log"), "line\n");
+        }
+        CHECK(log.WaitFor(1, BATCH_WAIT_MS));
+        // Nothing else arrives once the burst has been handed over
+        std::this_thread::sleep_for(std::chrono::milliseconds(AgentConstants::DIRECTORY_WATCH_DEBOUNCE_MS * 2));
+
+        std::vector<DirectoryChanges> batches = log.Batches();
+        CHECK(batches.size() == 1);
+        if (!batches.empty()) {
+            CHECK(batches[0].paths.size() == 1 && Names(batches[0], "live.log"));
+            CHECK(batches[0].entriesChanged && !batches[0].overflowed);
+        }
+
+        // Writing without a pause is still reported every DIRECTORY_WATCH_MAX_DELAY_MS
+        std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(AgentConstants::DIRECTORY_WATCH_MAX_DELAY_MS * 2 + 500);
+        while (std::chrono::steady_clock::now() < until) {
+            Write(scratch.File("live.log"), "line\n");
+            std::this_thread::sleep_for(std::chrono::milliseconds(AgentConstants::DIRECTORY_WATCH_DEBOUNCE_MS / 4));
+        }
+        CHECK(log.Count() >= 3);
+        batches = log.Batches();
+        CHECK(!batches.back().entriesChanged);
+
+        double stopMs = StopMillis(watcher);
+        printf("burst: %zu batches, stop %.1f ms\n", batches.size(), stopMs);
+        CHECK(stopMs < STOP_LIMIT_MS);
+        CHECK(!watcher.IsWatching());
+    }
+
+    void NewFolderIsWatched() {
+        TestSupport::ScratchDir scratch("watchertest");
+        BatchLog log;
+        DirectoryWatcher watcher;
+        CHECK(watcher.Start(scratch.Path(), true, log.Handler()));
+
+        fs::create_directories(scratch.File("2026-10-17/cam1"));
+        CHECK(log.WaitFor(1, BATCH_WAIT_MS));
+        std::vector<DirectoryChanges> batches = log.Batches();
+        CHECK(!batches.empty() && Names(batches[0], "2026-10-17") && batches[0].entriesChanged);
+
+        Write(scratch.File("2026-10-17/cam1/shot.log"), "x");
+        CHECK(log.WaitFor(2, BATCH_WAIT_MS));
+        batches = log.Batches();
+        CHECK(batches.size() >= 2 && Names(batches.back(), "2026-10-17/cam1/shot.log"));
+
+        // A non-recursive watch sees the folder appear but nothing inside it
+        TestSupport::ScratchDir flatRoot("watchertest");
+        BatchLog flat;
+        DirectoryWatcher flatWatcher;
+        CHECK(flatWatcher.Start(flatRoot.Path(), false, flat.Handler()));
+        fs::create_directories(flatRoot.File("sub"));
+        CHECK(flat.WaitFor(1, BATCH_WAIT_MS));
+        Write(flatRoot.File("sub/inner.log"), "x");
+        CHECK(!flat.WaitFor(2, BATCH_WAIT_MS));
+        flatWatcher.Stop();
+        watcher.Stop();
+    }
+
+    void FloodIsARescan() {
+        TestSupport::ScratchDir scratch("watchertest");
+        fs::create_directories(scratch.File("flood"));
+        BatchLog log;
+        DirectoryWatcher::ChangeHandler record = log.Handler();
+
+        // The receiver is busy with the first batch while the flood arrives, so the whole flood
+        // is read in one go however slowly the disk creates the files
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        DirectoryWatcher::ChangeHandler handler = [record, released](const DirectoryChanges& changes) {
+            record(changes);
+            released.wait();
+        };
+        DirectoryWatcher watcher;
+        CHECK(watcher.Start(scratch.Path(), true, handler));
+
+        Write(scratch.File("first.log"), "x");
+        CHECK(log.WaitFor(1, BATCH_WAIT_MS));
+        const size_t files = AgentConstants::DIRECTORY_WATCH_MAX_PATHS + 500;
+        for (size_t i = 0; i < files; i++) {
+            std::ofstream(scratch.File("flood/f" + std::to_string(i)).c_str());
+        }
+        release.set_value();
+
+        CHECK(log.WaitFor(2, BATCH_WAIT_MS));
+        std::vector<DirectoryChanges> batches = log.Batches();
+        if (batches.size() >= 2) {
+            CHECK(batches[1].overflowed && batches[1].paths.empty() && batches[1].entriesChanged);
+        }
+        watcher.Stop();
+    }
+
+    void RootComesBack() {
+        TestSupport::ScratchDir scratch("watchertest");
+        std::string root = scratch.File("logs");
+        fs::create_directories(root + "/day1");
+        BatchLog log;
+        DirectoryWatcher watcher;
+        CHECK(watcher.Start(root, true, log.Handler()));
+
+        fs::remove_all(root);
+        CHECK(log.WaitFor(1, BATCH_WAIT_MS));
+        std::vector<DirectoryChanges> batches = log.Batches();
+        CHECK(!batches.empty() && batches.back().overflowed);
+
+        // Retried every DIRECTORY_WATCH_RETRY_MS; the rescan says whatever happened meanwhile is unknown
+        fs::create_directories(root + "/day2");
+        size_t before = log.Count();
+        CHECK(log.WaitFor(before + 1, AgentConstants::DIRECTORY_WATCH_RETRY_MS + BATCH_WAIT_MS));
+        batches = log.Batches();
+        CHECK(batches.back().overflowed);
+
+        Write(root + "/day2/after.log", "x");
+        CHECK(log.WaitFor(batches.size() + 1, BATCH_WAIT_MS));
+        batches = log.Batches();
+        CHECK(Names(batches.back(), "day2/after.log") && !batches.back().overflowed);
+
+        // Stopped while waiting for the root to come back, it does not wait out the retry
+        fs::remove_all(root);
+        CHECK(log.WaitFor(batches.size() + 1, BATCH_WAIT_MS));
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        double stopMs = StopMillis(watcher);
+        printf("stop while the root is gone: %.1f ms\n", stopMs);
+        CHECK(stopMs < STOP_LIMIT_MS);
+
+        // A folder that is not there cannot be watched at all
+        DirectoryWatcher missing;
+        CHECK(!missing.Start(scratch.File("missing"), true, log.Handler()));
+        CHECK(!missing.IsWatching());
+    }
+}
+
+int main() {
+    BurstIsOneBatch();
+    NewFolderIsWatched();
+    FloodIsARescan();
+    RootComesBack();
+    return TestSupport::Result();
+}
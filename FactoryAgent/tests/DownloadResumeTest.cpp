@@ -0,0 +1,227 @@
+/*
+ * DownloadResumeTest.cpp
+ * A model download cut off partway, on one stream and as parallel segments,
+ * resumes from what the part file and its sidecar hold: the second attempt
+ * fetches only the bytes that are not on disk yet and the file it finishes
+ * matches the server's SHA-256. A part file left from an entity the server
+ * has since replaced is started over, never mixed with the new one. A download
+ * ended by CancelTransfers returns at once and resumes the same way. A range
+ * that does not start where it was asked to is never written: a resume on one
+ * stream starts over, and segments fail without touching what is on disk
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/common/Constants.h"
+#include "../include/utilities/Sha256.h"
+#include "TestSupport.h"
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <chrono>
+
+namespace {
+    const char* const MODEL_URL = "/api/agent/downloadmodel/1";
+    const std::string DOWNLOAD_ENDPOINT = "/api/agent/downloadmodel";
+
+    std::string MakePayload(size_t size, unsigned seed) {
+        std::string data(size, '\0');
+        unsigned state = seed * 2654435761u + 1;
+        for (size_t i = 0; i < size; i++) {
+            state = state * 1103515245u + 12345u;
+            data[i] = (char)(state >> 16);
+        }
+        return data;
+    }
+
+    std::string ReadFile(const std::string& path) {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    long long BytesServed(const StandInServer& server) {
+        std::map<std::string, StandInEndpointStats> stats = server.GetStats();
+        return stats.count(DOWNLOAD_ENDPOINT) ? stats[DOWNLOAD_ENDPOINT].bytesOut : 0;
+    }
+
+    // Bytes the sidecar says are on disk: the offset on one stream, the completed ranges in segments
+    long long BytesRecorded(const std::string& metaPath) {
+        json meta = json::parse(ReadFile(metaPath), nullptr, false);
+        if (!meta.is_object()) {
+            return -1;
+        }
+        if (!meta.contains("completed")) {
+            return meta.value("offset", 0LL);
+        }
+        long long recorded = 0;
+        for (size_t i = 0; i < meta["completed"].size(); i++) {
+            recorded += meta["completed"][i][1].get<long long>() - meta["completed"][i][0].get<long long>();
+        }
+        return recorded;
+    }
+
+    // Cuts the first attempt off after cutoff bytes, then lets a second one finish
+    void ResumesWithoutRefetching(long long segmentedThreshold, size_t size, long long cutoff) {
+        TestSupport::ScratchDir scratch("downloadresume");
+        std::string outputPath = scratch.File("model.zip");
+        std::string partPath = outputPath + AgentConstants::PART_EXTENSION;
+        std::string metaPath = partPath + AgentConstants::META_EXTENSION;
+
+        StandInServer server;
+        CHECK(server.Start(0));
+        std::string payload = MakePayload(size, (unsigned)size);
+        std::string digest = Sha256::HashString(payload);
+        server.SetModelPayload(payload);
+
+        HttpClient client(server.GetBaseUrl());
+        client.SetSegmentedDownloadThreshold(segmentedThreshold);
+
+        server.SetDownloadCutoff(cutoff);
+        CHECK(!client.DownloadFile(MODEL_URL, outputPath, digest));
+        CHECK(!std::filesystem::exists(outputPath));
+        long long recorded = BytesRecorded(metaPath);
+        CHECK(recorded > 0 && recorded < (long long)size);
+        if (segmentedThreshold == 0) {
+            // One stream keeps every byte that arrived before the hang-up
+            CHECK(recorded == cutoff);
+        }
+
+        server.SetDownloadCutoff(-1);
+        long long servedBefore = BytesServed(server);
+        CHECK(client.DownloadFile(MODEL_URL, outputPath, digest));
+        long long refetched = BytesServed(server) - servedBefore;
+        // A segmented resume probes one byte first to learn the entity is unchanged
+        long long probe = segmentedThreshold > 0 ? 1 : 0;
+        if (refetched != (long long)size - recorded + probe) {
+            fprintf(stderr, "threshold %lld: %lld bytes on disk, %lld of %zu fetched again\n",
+                segmentedThreshold, recorded, refetched, size);
+            TestSupport::failures++;
+        }
+
+        CHECK(ReadFile(outputPath) == payload);
+        CHECK(!std::filesystem::exists(partPath) && !std::filesystem::exists(metaPath));
+        server.Stop();
+    }
+
+    void ChangedEntityStartsOver() {
+        TestSupport::ScratchDir scratch("downloadresume");
+        std::string outputPath = scratch.File("model.zip");
+        const size_t size = 3 * 1024 * 1024;
+
+        StandInServer server;
+        CHECK(server.Start(0));
+        server.SetModelPayload(MakePayload(size, 1));
+        HttpClient client(server.GetBaseUrl());
+        client.SetSegmentedDownloadThreshold(0);
+
+        server.SetDownloadCutoff(size / 2);
+        CHECK(!client.DownloadFile(MODEL_URL, outputPath));
+        server.SetDownloadCutoff(-1);
+
+        // If-Range no longer matches, so the whole new entity comes back in a 200
+        std::string replaced = MakePayload(size, 2);
+        server.SetModelPayload(replaced);
+        long long servedBefore = BytesServed(server);
+        CHECK(client.DownloadFile(MODEL_URL, outputPath, Sha256::HashString(replaced)));
+        CHECK(BytesServed(server) - servedBefore == (long long)size);
+        CHECK(ReadFile(outputPath) == replaced);
+        server.Stop();
+    }
+
+    // A proxy that rounds ranges down to 1000-byte blocks: every resume offset here is off the grid
+    void MisplacedRangeIsNotWritten(long long segmentedThreshold, size_t size, long long cutoff) {
+        TestSupport::ScratchDir scratch("downloadresume");
+        std::string outputPath = scratch.File("model.zip");
+        std::string metaPath = outputPath + AgentConstants::PART_EXTENSION + AgentConstants::META_EXTENSION;
+
+        StandInServer server;
+        CHECK(server.Start(0));
+        std::string payload = MakePayload(size, 4);
+        std::string digest = Sha256::HashString(payload);
+        server.SetModelPayload(payload);
+        HttpClient client(server.GetBaseUrl());
+        client.SetSegmentedDownloadThreshold(segmentedThreshold);
+
+        server.SetDownloadCutoff(cutoff);
+        CHECK(!client.DownloadFile(MODEL_URL, outputPath, digest));
+        server.SetDownloadCutoff(-1);
+        server.SetRangeAlignment(1000);
+
+        if (segmentedThreshold == 0) {
+            // One stream drops the part file and fetches the whole entity again without a Range
+            long long servedBefore = BytesServed(server);
+            CHECK(client.DownloadFile(MODEL_URL, outputPath, digest));
+            CHECK(BytesServed(server) - servedBefore >= (long long)size);
+            CHECK(ReadFile(outputPath) == payload);
+            server.Stop();
+            return;
+        }
+
+        // Segments off the grid fail; the ranges already on disk stay recorded and intact
+        long long before = BytesRecorded(metaPath);
+        CHECK(!client.DownloadFile(MODEL_URL, outputPath, digest));
+        long long recorded = BytesRecorded(metaPath);
+        CHECK(recorded >= before && recorded < (long long)size);
+
+        server.SetRangeAlignment(0);
+        long long servedBefore = BytesServed(server);
+        CHECK(client.DownloadFile(MODEL_URL, outputPath, digest));
+        CHECK(BytesServed(server) - servedBefore == (long long)size - recorded + 1);
+        CHECK(ReadFile(outputPath) == payload);
+        server.Stop();
+    }
+
+    // As CommandExecutor::Stop: cancel, join the thread that was downloading, resume
+    void CancelledDownloadResumes(long long segmentedThreshold) {
+        TestSupport::ScratchDir scratch("downloadresume");
+        std::string outputPath = scratch.File("model.zip");
+        const size_t size = 8 * 1024 * 1024;
+
+        StandInServer server;
+        CHECK(server.Start(0));
+        std::string payload = MakePayload(size, 3);
+        std::string digest = Sha256::HashString(payload);
+        server.SetModelPayload(payload);
+        // 32 windows of 20 ms: well over half a second on one stream
+        server.SetDownloadRoundTrip(20);
+        HttpClient client(server.GetBaseUrl());
+        client.SetSegmentedDownloadThreshold(segmentedThreshold);
+
+        bool downloaded = true;
+        std::thread downloader([&]() { downloaded = client.DownloadFile(MODEL_URL, outputPath, digest); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        std::chrono::steady_clock::time_point cancelled = std::chrono::steady_clock::now();
+        client.CancelTransfers();
+        downloader.join();
+        double joinMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cancelled).count();
+        printf("threshold %lld: joined %.1f ms after CancelTransfers\n", segmentedThreshold, joinMs);
+        CHECK(!downloaded);
+        // Idle segment workers and the checkpoint loop notice at their next poll
+        CHECK(joinMs < AgentConstants::SEGMENT_IDLE_WAIT_MS * 4);
+
+        // Nothing new starts until transfers are resumed
+        json heartbeat;
+        heartbeat["pcId"] = 1;
+        json response;
+        CHECK(!client.Post(AgentConstants::ENDPOINT_HEARTBEAT, heartbeat, response));
+        client.ResumeTransfers();
+
+        server.SetDownloadRoundTrip(0);
+        CHECK(client.DownloadFile(MODEL_URL, outputPath, digest));
+        CHECK(ReadFile(outputPath) == payload);
+        server.Stop();
+    }
+}
+
+int main() {
+    // One stream, cut mid-window
+    ResumesWithoutRefetching(0, 4 * 1024 * 1024, 1536 * 1024 + 100);
+    // Parallel segments, cut once several of them are in flight
+    ResumesWithoutRefetching(1, 12 * 1024 * 1024, 5 * 1024 * 1024 + 7);
+    ChangedEntityStartsOver();
+    MisplacedRangeIsNotWritten(0, 4 * 1024 * 1024, 1536 * 1024 + 100);
+    MisplacedRangeIsNotWritten(1, 12 * 1024 * 1024, 5 * 1024 * 1024 + 7);
+    CancelledDownloadResumes(0);
+    CancelledDownloadResumes(1);
+    return TestSupport::Result();
+}
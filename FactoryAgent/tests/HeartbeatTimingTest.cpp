@@ -0,0 +1,99 @@
+/*
+ * HeartbeatTimingTest.cpp
+ * Heartbeats keep their schedule, within a second, while a bandwidth-capped
+ * model upload holds the bulk lane for several seconds. A heartbeat whose reply
+ * outlives HEARTBEAT_TIMEOUT_MS fails, and the commands the server handed it
+ * are still delivered by the beat after
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/services/HeartbeatService.h"
+#include "../include/common/Constants.h"
+#include "TestSupport.h"
+#include <fstream>
+#include <thread>
+#include <chrono>
+
+namespace {
+    const int BEAT_INTERVAL_MS = 1000;
+    const int BEATS = 5;
+    const long long UPLOAD_BYTES = 48LL * 1024 * 1024;
+    const int UPLOAD_KBPS = 64 * 1024;      // 8 MB/s: about six seconds for the upload
+
+    double MillisSince(const std::chrono::steady_clock::time_point& start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void BeatsKeepScheduleDuringUpload() {
+        TestSupport::ScratchDir scratch("heartbeattest");
+        std::string modelPath = scratch.File("model.zip");
+        {
+            std::ofstream file(modelPath.c_str(), std::ios::binary);
+            std::string window(1024 * 1024, 'm');
+            for (long long written = 0; written < UPLOAD_BYTES; written += (long long)window.size()) {
+                file.write(window.data(), (std::streamsize)window.size());
+            }
+        }
+
+        StandInServer server;
+        CHECK(server.Start(0));
+        HttpClient client(server.GetBaseUrl());
+        client.SetBandwidthLimit(UPLOAD_KBPS);
+        HeartbeatService heartbeat((HeartbeatService::CommandHandler()));
+
+        std::future<HttpResult> upload = client.UploadFileAsync(AgentConstants::ENDPOINT_UPLOAD_MODEL,
+            modelPath, "timing");
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int beat = 0; beat < BEATS; beat++) {
+            std::chrono::steady_clock::time_point due = start + std::chrono::milliseconds(beat * BEAT_INTERVAL_MS);
+            std::this_thread::sleep_until(due);
+
+            json commands;
+            CHECK(heartbeat.SendHeartbeat(1, true, &client, &commands));
+            double late = MillisSince(due);
+            printf("beat %d done %.1f ms after it was due\n", beat, late);
+            CHECK(late < 1000.0);
+        }
+
+        // Otherwise the beats above never had to share the client with it
+        CHECK(upload.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+        HttpResult result = upload.get();
+        CHECK(result.success);
+        printf("upload finished %.1f s after the first beat\n", MillisSince(start) / 1000.0);
+        server.Stop();
+    }
+
+    void LateReplyCommandsAreKept() {
+        StandInServer server;
+        CHECK(server.Start(0));
+        HttpClient client(server.GetBaseUrl());
+
+        std::vector<json> late;
+        HeartbeatService heartbeat([&late](const json& commands) { late.push_back(commands); });
+
+        json command;
+        command["commandId"] = 7;
+        command["commandType"] = "UpdateConfig";
+        server.QueueCommand(command);
+        server.SetReplyDelay(AgentConstants::HEARTBEAT_TIMEOUT_MS + 1000);
+
+        json commands;
+        CHECK(!heartbeat.SendHeartbeat(1, true, &client, &commands));
+        CHECK(commands.empty());
+        CHECK(late.empty());
+
+        server.SetReplyDelay(0);
+        CHECK(heartbeat.SendHeartbeat(1, true, &client, &commands));
+        CHECK(late.size() == 1);
+        CHECK(late.size() == 1 && late[0].size() == 1 && late[0][0]["commandId"] == 7);
+        server.Stop();
+    }
+}
+
+int main() {
+    BeatsKeepScheduleDuringUpload();
+    LateReplyCommandsAreKept();
+    return TestSupport::Result();
+}
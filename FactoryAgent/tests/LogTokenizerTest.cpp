@@ -0,0 +1,164 @@
+/*
+ * LogTokenizerTest.cpp
+ * Every SIMD level splits lines and fields exactly as the scalar loop does,
+ * whatever the alignment and wherever the delimiters fall against the 16 and
+ * 32 byte blocks; ReadFlatObject picks out the requested members and rejects
+ * what JSON.parse would; ParseNumber agrees with strtod
+ */
+
+#include "../include/utilities/LogTokenizer.h"
+#include "TestSupport.h"
+#include <random>
+#include <cstring>
+
+namespace {
+    const int MAX_FIELDS = 14;
+
+    struct Split {
+        long long lineEnd;
+        int fieldCount;
+        long long fields[MAX_FIELDS];
+    };
+
+    // Splits every line of text at the current level; offsets, so levels can be compared
+    std::vector<Split> SplitAll(const char* begin, const char* end, int maxFields) {
+        std::vector<Split> splits;
+        const char* fields[MAX_FIELDS];
+        for (const char* p = begin; p < end;) {
+            Split split;
+            const char* lineEnd = LogTokenizer::SplitLine(p, end, fields, maxFields, split.fieldCount);
+            split.lineEnd = lineEnd - begin;
+            for (int i = 0; i < MAX_FIELDS; i++) {
+                split.fields[i] = i < split.fieldCount ? fields[i] - begin : -1;
+            }
+            splits.push_back(split);
+            p = lineEnd < end ? lineEnd + 1 : end;
+        }
+        return splits;
+    }
+
+    bool SameSplits(const std::vector<Split>& a, const std::vector<Split>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i].lineEnd != b[i].lineEnd || a[i].fieldCount != b[i].fieldCount ||
+                memcmp(a[i].fields, b[i].fields, sizeof(a[i].fields)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void LevelsAgreeWithScalar() {
+        LogTokenizer::Level widest = LogTokenizer::GetLevel();
+        printf("widest level on this CPU: %d\n", (int)widest);
+
+        // Mostly plain bytes, with delimiters dense enough to land on every block position
+        std::mt19937 random(3);
+        const char alphabet[] = "abcdefgh{}\":,0123456789\t\t\t\n";
+        std::string text(64 * 1024, ' ');
+        for (size_t i = 0; i < text.size(); i++) {
+            text[i] = alphabet[random() % (sizeof(alphabet) - 1)];
+        }
+        // and some long runs, so whole blocks go by without a delimiter
+        for (int run = 0; run < 20; run++) {
+            size_t at = random() % (text.size() - 300);
+            memset(&text[at], 'x', 33 + random() % 250);
+        }
+
+        int compared = 0;
+        for (int offset = 0; offset < 33; offset++) {
+            for (int maxFields = 0; maxFields <= MAX_FIELDS; maxFields += 1 + offset % 4) {
+                const char* begin = text.data() + offset;
+                const char* end = text.data() + text.size() - (offset % 7);
+
+                LogTokenizer::SetLevel(LogTokenizer::LEVEL_SCALAR);
+                std::vector<Split> expected = SplitAll(begin, end, maxFields);
+                for (int level = LogTokenizer::LEVEL_SSE2; level <= widest; level++) {
+                    LogTokenizer::SetLevel((LogTokenizer::Level)level);
+                    CHECK(SameSplits(SplitAll(begin, end, maxFields), expected));
+                    compared++;
+                }
+            }
+        }
+        LogTokenizer::SetLevel(widest);
+
+        // A line with no newline ends at end, and every field is counted up to maxFields
+        const char* line = "a\tb\t\tc";
+        const char* fields[MAX_FIELDS];
+        int fieldCount = 0;
+        CHECK(LogTokenizer::SplitLine(line, line + 6, fields, MAX_FIELDS, fieldCount) == line + 6);
+        CHECK(fieldCount == 4 && fields[2] == line + 4 && fields[3] == line + 5);
+        CHECK(LogTokenizer::SplitLine(line, line + 6, fields, 2, fieldCount) == line + 6);
+        CHECK(fieldCount == 2);
+        printf("%d level comparisons\n", compared);
+    }
+
+    std::string Text(const JsonToken& token) {
+        return token.begin ? std::string(token.begin, token.end) : std::string();
+    }
+
+    // Tokens point into object, so it has to outlive them
+    bool Read(const char* object, JsonToken* values) {
+        static const char* const keys[] = { "barrelId", "startTs", "endTs", "idealMs" };
+        return LogTokenizer::ReadFlatObject(object, object + strlen(object), keys, 4, values);
+    }
+
+    void ReadsOnlyTheRequestedMembers() {
+        JsonToken values[4];
+        CHECK(Read("{\"barrelId\":7,\"startTs\":12.5}", values));
+        CHECK(values[0].type == JsonToken::NUMBER && Text(values[0]) == "7");
+        CHECK(values[1].type == JsonToken::NUMBER && Text(values[1]) == "12.5");
+        CHECK(values[2].type == JsonToken::NONE && values[3].type == JsonToken::NONE);
+
+        JsonToken spaced[4];
+        CHECK(Read("{ \"barrelId\" : \"A\\\"1\" ,\r\n \"endTs\" : 3 }", spaced));
+        CHECK(spaced[0].type == JsonToken::STRING && spaced[0].escaped && Text(spaced[0]) == "A\\\"1");
+        CHECK(spaced[2].type == JsonToken::NUMBER && Text(spaced[2]) == "3");
+
+        // The last of a repeated member wins; members inside nested values are not the object's
+        JsonToken nested[4];
+        CHECK(Read("{\"startTs\":1,\"x\":{\"startTs\":99,\"y\":[1,\"]}\"]},\"startTs\":5,\"idealMs\":{\"a\":1}}",
+            nested));
+        CHECK(nested[1].type == JsonToken::NUMBER && Text(nested[1]) == "5");
+        CHECK(nested[3].type == JsonToken::NESTED);
+
+        JsonToken literals[4];
+        CHECK(Read("{\"barrelId\":null,\"endTs\":true}", literals));
+        CHECK(literals[0].type == JsonToken::LITERAL && Text(literals[0]) == "null");
+        CHECK(literals[2].type == JsonToken::LITERAL && Text(literals[2]) == "true");
+
+        JsonToken rejected[4];
+        CHECK(!Read("{\"barrelId\":1,}", rejected));
+        CHECK(!Read("{\"barrelId\":1", rejected));
+        CHECK(!Read("{barrelId:1}", rejected));
+        CHECK(!Read("[1]", rejected));
+        CHECK(!Read("{\"barrelId\":01}", rejected));
+        CHECK(!Read("{\"barrelId\":1.}", rejected));
+        CHECK(!Read("{\"barrelId\":1} x", rejected));
+        CHECK(!Read("{\"x\":[1,2}", rejected));
+        CHECK(!Read("", rejected));
+    }
+
+    void NumbersMatchStrtod() {
+        const char* const numbers[] = { "0", "-0", "7", "749.0", "1040.5", "-12.25", "0.1", "0.30000000000000004",
+            "123456789012345", "1234567890123456789", "1e3", "-2.5E-3", "1.7976931348623157e308", "5e-324" };
+        for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+            double value = 0;
+            const char* text = numbers[i];
+            CHECK(LogTokenizer::ParseNumber(text, text + strlen(text), value));
+            if (value != strtod(text, NULL)) {
+                fprintf(stderr, "ParseNumber(%s) gave %.17g\n", text, value);
+                TestSupport::failures++;
+            }
+        }
+    }
+}
+
+int main() {
+    LevelsAgreeWithScalar();
+    ReadsOnlyTheRequestedMembers();
+    NumbersMatchStrtod();
+    return TestSupport::Result();
+}
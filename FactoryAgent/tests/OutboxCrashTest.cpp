@@ -0,0 +1,237 @@
+/*
+ * OutboxCrashTest.cpp
+ * An agent process queues command results in its outbox while the server is
+ * down and is killed with SIGKILL partway through. After a torn write is left
+ * at the end of the log, a fresh process reopens it and replays to a
+ * restarted StandInServer: every result the first process was told was
+ * durable arrives exactly once, superseded results arrive in their newer form,
+ * and a second restart sends nothing. A flush whose acks cannot be written
+ * gives up instead of resending the same batch forever
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/services/OutboxService.h"
+#include "../include/common/Constants.h"
+#include "TestSupport.h"
+#include <map>
+#include <set>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+namespace {
+    json MakeResult(int commandId, const std::string& status) {
+        json result;
+        result["commandId"] = commandId;
+        result["status"] = status;
+        result["resultData"] = std::string(200 + commandId % 700, 'x');
+        result["errorMessage"] = "";
+        return result;
+    }
+
+    std::string ResultKey(int commandId) {
+        return "commandresult:" + std::to_string(commandId);
+    }
+
+    std::wstring LoopbackUrl(int port) {
+        return L"http://127.0.0.1:" + std::to_wstring(port);
+    }
+
+    // A port nothing listens on until the test starts a server there
+    int ReservePort() {
+        StandInServer probe;
+        if (!probe.Start(0)) {
+            return 0;
+        }
+        int port = probe.GetPort();
+        probe.Stop();
+        return port;
+    }
+
+    // Runs in the child: queues results until it is killed, writing each id to the
+    // pipe once Enqueue has returned. Every tenth result is superseded by a failure
+    void QueueUntilKilled(const std::string& logPath, int port, int reportFd) {
+        HttpClient client(LoopbackUrl(port));
+        OutboxService outbox(&client);
+        if (!outbox.Open(logPath)) {
+            _exit(2);
+        }
+        for (int commandId = 1; ; commandId++) {
+            if (!outbox.Enqueue(AgentConstants::ENDPOINT_COMMAND_RESULT, MakeResult(commandId, "Completed"),
+                ResultKey(commandId))) {
+                _exit(3);
+            }
+            if (commandId % 10 == 0 && !outbox.Enqueue(AgentConstants::ENDPOINT_COMMAND_RESULT,
+                MakeResult(commandId, "Failed"), ResultKey(commandId))) {
+                _exit(3);
+            }
+            if (write(reportFd, &commandId, sizeof(commandId)) != (ssize_t)sizeof(commandId)) {
+                _exit(4);
+            }
+            // The server is down, so these only prove a failed replay keeps everything
+            if (commandId % 50 == 0) {
+                outbox.Flush();
+            }
+        }
+    }
+
+    void KilledMidOutage() {
+        TestSupport::ScratchDir scratch("outboxtest");
+        std::string logPath = scratch.File("agent_outbox.log");
+        int port = ReservePort();
+        CHECK(port != 0);
+
+        int fds[2];
+        CHECK(pipe(fds) == 0);
+        pid_t child = fork();
+        if (child == 0) {
+            close(fds[0]);
+            QueueUntilKilled(logPath, port, fds[1]);
+        }
+        close(fds[1]);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        kill(child, SIGKILL);
+        int status = 0;
+        waitpid(child, &status, 0);
+        CHECK(WIFSIGNALED(status));
+
+        std::set<int> durable;
+        int commandId = 0;
+        while (read(fds[0], &commandId, sizeof(commandId)) == (ssize_t)sizeof(commandId)) {
+            durable.insert(commandId);
+        }
+        close(fds[0]);
+        printf("%zu results durable when the agent was killed\n", durable.size());
+        CHECK(durable.size() > 100);
+
+        // What a power cut in the middle of a write leaves behind
+        {
+            std::ofstream log(logPath.c_str(), std::ios::binary | std::ios::app);
+            log.write("\x40\x00\x00\x00\x12\x34\x56\x78P 99", 12);
+        }
+
+        StandInServer server;
+        CHECK(server.Start(port));
+        HttpClient client(LoopbackUrl(port));
+        {
+            OutboxService outbox(&client);
+            CHECK(outbox.Open(logPath));
+            CHECK(outbox.GetPendingCount() >= durable.size());
+            CHECK(outbox.Flush());
+            CHECK(outbox.GetPendingCount() == 0);
+        }
+
+        std::map<int, int> deliveries;
+        std::map<int, std::string> statuses;
+        std::vector<json> results = server.GetCommandResults();
+        for (size_t i = 0; i < results.size(); i++) {
+            int id = results[i]["commandId"];
+            deliveries[id]++;
+            statuses[id] = results[i]["status"];
+        }
+
+        int lost = 0;
+        int duplicated = 0;
+        int stale = 0;
+        for (std::set<int>::const_iterator it = durable.begin(); it != durable.end(); ++it) {
+            if (deliveries.count(*it) == 0) {
+                lost++;
+            }
+            else if (*it % 10 == 0 && statuses[*it] != "Failed") {
+                stale++;
+            }
+        }
+        int inFlight = 0;
+        for (std::map<int, int>::const_iterator it = deliveries.begin(); it != deliveries.end(); ++it) {
+            if (it->second > 1) {
+                duplicated++;
+            }
+            if (durable.count(it->first) == 0) {
+                inFlight++;
+            }
+        }
+        printf("delivered %zu: lost %d, duplicated %d, superseded sent stale %d, in flight at the kill %d\n",
+            deliveries.size(), lost, duplicated, stale, inFlight);
+        CHECK(lost == 0);
+        CHECK(duplicated == 0);
+        CHECK(stale == 0);
+        // Only the result being written when the signal landed can be on disk without having been reported
+        CHECK(inFlight <= 1);
+
+        size_t delivered = results.size();
+        {
+            OutboxService outbox(&client);
+            CHECK(outbox.Open(logPath));
+            CHECK(outbox.GetPendingCount() == 0);
+            CHECK(outbox.Flush());
+        }
+        CHECK(server.GetCommandResults().size() == delivered);
+        server.Stop();
+    }
+
+    // Runs in the child, so the file size limit stays out of the test process
+    int FlushWithUnwritableAcks(const std::string& logPath) {
+        signal(SIGXFSZ, SIG_IGN);
+
+        StandInServer server;
+        CHECK(server.Start(0));
+        HttpClient client(server.GetBaseUrl());
+        OutboxService outbox(&client);
+        CHECK(outbox.Open(logPath));
+        for (int commandId = 1; commandId <= 20; commandId++) {
+            CHECK(outbox.Enqueue(AgentConstants::ENDPOINT_COMMAND_RESULT, MakeResult(commandId, "Completed"),
+                ResultKey(commandId)));
+        }
+
+        struct rlimit limit;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        struct rlimit full = limit;
+        full.rlim_cur = (rlim_t)std::filesystem::file_size(logPath);
+        CHECK(setrlimit(RLIMIT_FSIZE, &full) == 0);
+
+        CHECK(!outbox.Flush());
+        CHECK(outbox.GetPendingCount() == 20);
+        size_t sent = server.GetCommandResults().size();
+        CHECK(sent == 20);
+
+        // Once the disk takes writes again the batch goes out once more and is recorded
+        CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+        CHECK(outbox.Flush());
+        CHECK(outbox.GetPendingCount() == 0);
+        CHECK(server.GetCommandResults().size() == sent + 20);
+        server.Stop();
+        return TestSupport::Result();
+    }
+
+    void AckFailureEndsFlush() {
+        TestSupport::ScratchDir scratch("outboxtest");
+        pid_t child = fork();
+        if (child == 0) {
+            _exit(FlushWithUnwritableAcks(scratch.File("agent_outbox.log")));
+        }
+
+        // A flush that spins on the same batch never returns; give it ten seconds
+        int status = 0;
+        pid_t done = 0;
+        for (int waited = 0; waited < 10000 && done == 0; waited += 50) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            done = waitpid(child, &status, WNOHANG);
+        }
+        if (done == 0) {
+            kill(child, SIGKILL);
+            waitpid(child, &status, 0);
+        }
+        CHECK(done == child);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+}
+
+int main() {
+    KilledMidOutage();
+    AckFailureEndsFlush();
+    return TestSupport::Result();
+}
@@ -0,0 +1,135 @@
+/*
+ * RequestMetricsTest.cpp
+ * LatencyHistogram percentiles against the exact ones from the sorted samples:
+ * never below the true value and at most 1/16 above it, exact below 16, and an
+ * interval taken with Since sees only what came after. RequestMetrics keeps
+ * its own entry for the first 31 endpoints; the 32nd and every one after it
+ * fold into "(other)", in the snapshots and in the heartbeat summary
+ */
+
+#include "../include/network/RequestMetrics.h"
+#include "TestSupport.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const double PERCENTILES[] = { 0, 1, 25, 50, 75, 90, 95, 99, 99.9, 100 };
+
+    // The sample ValueAtPercentile reports the bucket of: 1-based rank, rounded up
+    long long ExactPercentile(const std::vector<long long>& sorted, double percentile) {
+        long long rank = (long long)(percentile / 100.0 * (double)sorted.size() + 0.999999);
+        if (rank < 1) {
+            rank = 1;
+        }
+        return sorted[(size_t)(rank - 1)];
+    }
+
+    bool WithinBucket(long long reported, long long exact) {
+        return reported >= exact && reported <= exact + exact / LatencyHistogram::SUB_BUCKET_COUNT;
+    }
+
+    void PercentilesAreWithinABucket() {
+        // Spread evenly on a log scale from 1 us to about 30 s, as latencies are
+        std::vector<long long> samples;
+        LatencyHistogram histogram;
+        unsigned state = 12345;
+        for (int i = 0; i < 100000; i++) {
+            state = state * 1103515245u + 12345u;
+            double exponent = (double)(state >> 8) / (double)(1u << 24) * 7.5;
+            long long value = (long long)std::pow(10.0, exponent);
+            samples.push_back(value);
+            histogram.Record(value);
+        }
+        std::sort(samples.begin(), samples.end());
+
+        HistogramSnapshot snapshot = histogram.Snapshot();
+        CHECK(snapshot.count == (long long)samples.size());
+        CHECK(snapshot.max == samples.back());
+        for (size_t i = 0; i < sizeof(PERCENTILES) / sizeof(PERCENTILES[0]); i++) {
+            long long exact = ExactPercentile(samples, PERCENTILES[i]);
+            long long reported = snapshot.ValueAtPercentile(PERCENTILES[i]);
+            if (!WithinBucket(reported, exact)) {
+                fprintf(stderr, "p%g: reported %lld, exact %lld\n", PERCENTILES[i], reported, exact);
+                TestSupport::failures++;
+            }
+        }
+        CHECK(snapshot.ValueAtPercentile(100) == samples.back());
+
+        // Every value below SUB_BUCKET_COUNT has a bucket to itself
+        LatencyHistogram small;
+        for (long long value = 0; value < LatencyHistogram::SUB_BUCKET_COUNT; value++) {
+            small.Record(value);
+        }
+        CHECK(small.Snapshot().ValueAtPercentile(50) == 7);
+        CHECK(small.Snapshot().ValueAtPercentile(100) == 15);
+
+        // Bucket edges line up: each bucket starts right after the previous one ends
+        for (int index = 1; index < LatencyHistogram::BUCKET_COUNT; index++) {
+            CHECK(LatencyHistogram::BucketLowest(index) == LatencyHistogram::BucketHighest(index - 1) + 1);
+            CHECK(LatencyHistogram::BucketIndex(LatencyHistogram::BucketLowest(index)) == index);
+        }
+        CHECK(HistogramSnapshot().ValueAtPercentile(50) == 0);
+    }
+
+    void IntervalSeesOnlyNewValues() {
+        LatencyHistogram histogram;
+        for (int i = 0; i < 1000; i++) {
+            histogram.Record(100);
+        }
+        HistogramSnapshot before = histogram.Snapshot();
+        for (int i = 0; i < 10; i++) {
+            histogram.Record(50000);
+        }
+        HistogramSnapshot interval = histogram.Snapshot().Since(before);
+        CHECK(interval.count == 10);
+        CHECK(WithinBucket(interval.ValueAtPercentile(50), 50000));
+        CHECK(WithinBucket(interval.max, 50000));
+    }
+
+    std::wstring EndpointName(int i) {
+        return L"/api/agent/endpoint" + std::to_wstring(i);
+    }
+
+    void LateEndpointsFoldIntoOther() {
+        const int endpoints = RequestMetrics::MAX_ENDPOINTS + 8;
+        RequestMetrics metrics;
+        TransportTimings timings;
+        timings.totalMicros = 1000;
+        for (int i = 0; i < endpoints; i++) {
+            metrics.Record(EndpointName(i), timings, false);
+        }
+
+        std::vector<EndpointMetricsSnapshot> snapshots = metrics.GetSnapshots();
+        CHECK(snapshots.size() == (size_t)RequestMetrics::MAX_ENDPOINTS);
+        for (int i = 0; i < RequestMetrics::MAX_ENDPOINTS - 1 && i < (int)snapshots.size(); i++) {
+            CHECK(snapshots[i].endpoint == EndpointName(i) && snapshots[i].total.count == 1);
+        }
+        if (snapshots.size() == (size_t)RequestMetrics::MAX_ENDPOINTS) {
+            const EndpointMetricsSnapshot& other = snapshots.back();
+            CHECK(other.endpoint == L"(other)");
+            CHECK(other.total.count == endpoints - (RequestMetrics::MAX_ENDPOINTS - 1));
+        }
+
+        // Folded endpoints have no entry of their own, and later calls to them keep folding
+        EndpointMetricsSnapshot snapshot;
+        CHECK(metrics.GetSnapshot(EndpointName(0), snapshot));
+        CHECK(!metrics.GetSnapshot(EndpointName(RequestMetrics::MAX_ENDPOINTS - 1), snapshot));
+        CHECK(!metrics.GetSnapshot(EndpointName(endpoints - 1), snapshot));
+        metrics.Record(EndpointName(RequestMetrics::MAX_ENDPOINTS), timings, true);
+        CHECK(metrics.GetSnapshot(L"(other)", snapshot) && snapshot.total.count == 10 && snapshot.failures == 1);
+
+        json summary = metrics.CollectSummary();
+        CHECK(summary["endpoints"].size() == (size_t)RequestMetrics::MAX_ENDPOINTS);
+        if (summary["endpoints"].size() == (size_t)RequestMetrics::MAX_ENDPOINTS) {
+            const json& other = summary["endpoints"].back();
+            CHECK(other.value("endpoint", "") == "(other)" && other.value("count", 0) == 10);
+        }
+    }
+}
+
+int main() {
+    PercentilesAreWithinABucket();
+    IntervalSeesOnlyNewValues();
+    LateEndpointsFoldIntoOther();
+    return TestSupport::Result();
+}
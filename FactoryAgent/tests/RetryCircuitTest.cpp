@@ -0,0 +1,88 @@
+/*
+ * RetryCircuitTest.cpp
+ * RetryPolicy delays stay inside the decorrelated-jitter bounds and differ
+ * between agents; CircuitBreaker opens after its threshold, lets exactly one
+ * probe through once the open interval ends, and closes or reopens on its outcome
+ */
+
+#include "../include/network/RetryPolicy.h"
+#include "../include/network/CircuitBreaker.h"
+#include "TestSupport.h"
+#include <set>
+#include <thread>
+#include <chrono>
+
+namespace {
+    void DelaysStayInBounds() {
+        const int base = 100;
+        const int cap = 5000;
+        RetryPolicy policy(base, cap);
+
+        long long previous = base;
+        for (int i = 0; i < 200; i++) {
+            int delay = policy.NextDelayMs();
+            CHECK(delay >= base);
+            CHECK(delay <= cap);
+            CHECK(delay <= previous * 3);
+            previous = delay;
+        }
+        CHECK(policy.GetAttempts() == 200);
+
+        policy.Reset();
+        CHECK(policy.GetAttempts() == 0);
+        CHECK(policy.NextDelayMs() <= base * 3);
+    }
+
+    void AgentsDoNotMoveInStep() {
+        // The same failure sequence on many agents must not produce the same delays
+        std::set<int> thirdDelays;
+        for (int agent = 0; agent < 50; agent++) {
+            RetryPolicy policy(1000, 60000);
+            policy.NextDelayMs();
+            policy.NextDelayMs();
+            thirdDelays.insert(policy.NextDelayMs());
+        }
+        CHECK(thirdDelays.size() > 25);
+    }
+
+    void BreakerOpensProbesAndCloses() {
+        const std::wstring sync = L"/api/agent/syncbatch";
+        CircuitBreaker breaker(3, 50, 400);
+
+        CHECK(breaker.AllowRequest(sync));
+        breaker.RecordFailure(sync);
+        breaker.RecordFailure(sync);
+        CHECK(breaker.GetState(sync) == CIRCUIT_CLOSED);
+        breaker.RecordFailure(sync);
+        CHECK(breaker.GetState(sync) == CIRCUIT_OPEN);
+        CHECK(!breaker.AllowRequest(sync));
+
+        // Other endpoints keep their own circuit
+        CHECK(breaker.AllowRequest(L"/api/agent/commandresults"));
+
+        // The open interval is drawn from [50, 150] ms the first time
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        CHECK(breaker.AllowRequest(sync));
+        CHECK(breaker.GetState(sync) == CIRCUIT_HALF_OPEN);
+        CHECK(!breaker.AllowRequest(sync));
+
+        // A failed probe reopens it
+        breaker.RecordFailure(sync);
+        CHECK(breaker.GetState(sync) == CIRCUIT_OPEN);
+        CHECK(!breaker.AllowRequest(sync));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        CHECK(breaker.AllowRequest(sync));
+        breaker.RecordSuccess(sync);
+        CHECK(breaker.GetState(sync) == CIRCUIT_CLOSED);
+        CHECK(breaker.AllowRequest(sync));
+        CHECK(breaker.AllowRequest(sync));
+    }
+}
+
+int main() {
+    DelaysStayInBounds();
+    AgentsDoNotMoveInStep();
+    BreakerOpensProbesAndCloses();
+    return TestSupport::Result();
+}
@@ -0,0 +1,73 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+/*
+ * TestSupport.h
+ * CHECK for the test drivers and a scratch directory that cleans up after
+ * itself. A driver returns TestSupport::Result() from main, so ctest sees any
+ * failed CHECK as a failed test
+ */
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <unistd.h>
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            TestSupport::failures++; \
+        } \
+    } while (0)
+
+namespace TestSupport {
+
+    inline int failures = 0;
+
+    inline int Result() {
+        if (failures > 0) {
+            fprintf(stderr, "%d check(s) failed\n", failures);
+            return 1;
+        }
+        return 0;
+    }
+
+    class ScratchDir {
+    public:
+        explicit ScratchDir(const char* tag) {
+            const char* base = getenv("TMPDIR");
+            std::string pattern = std::string(base ? base : "/tmp") + "/" + tag + "XXXXXX";
+            std::vector<char> path(pattern.begin(), pattern.end());
+            path.push_back('\0');
+            if (mkdtemp(path.data())) {
+                path_ = path.data();
+            }
+        }
+
+        ~ScratchDir() {
+            if (!path_.empty()) {
+                std::error_code ignored;
+                std::filesystem::remove_all(path_, ignored);
+            }
+        }
+
+        const std::string& Path() const {
+            return path_;
+        }
+
+        std::string File(const std::string& name) const {
+            return path_ + "/" + name;
+        }
+
+    private:
+        std::string path_;
+
+        ScratchDir(const ScratchDir&);
+        ScratchDir& operator=(const ScratchDir&);
+    };
+}
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * WireCodecTest.cpp
+ * Every encoding gives back the value it was given, whatever the types, and
+ * the decoder follows the Content-Type. Against StandInServer the encoding is
+ * negotiated at registration and used both ways, and when the server is rolled
+ * back to a JSON-only build the 415 it answers makes the client resend as JSON
+ * and stay on JSON
+ */
+
+#include "../include/network/HttpClient.h"
+#include "../include/network/StandInServer.h"
+#include "../include/utilities/WireCodec.h"
+#include "../include/common/Constants.h"
+#include "TestSupport.h"
+#include <cctype>
+#include <cwchar>
+
+namespace {
+    const WireEncoding ENCODINGS[] = { WIRE_ENCODING_JSON, WIRE_ENCODING_CBOR, WIRE_ENCODING_MSGPACK };
+
+    json SampleValue() {
+        json value;
+        value["pcId"] = 12;
+        value["negative"] = -40000;
+        value["big"] = 9007199254740993LL;
+        value["unsigned"] = 18446744073709551615ULL;
+        value["ratio"] = 0.1;
+        value["tiny"] = 5e-324;
+        value["flag"] = true;
+        value["nothing"] = nullptr;
+        value["text"] = "Linie 3 \xc3\xbc\xe2\x82\xac \xf0\x9f\x94\xa7 \"quoted\"\t\n";
+        value["empty"] = "";
+        value["path"] = "D:\\LEADER_TEST\\INSPECTION\\MODEL_1";
+        value["list"] = json::array({ 1, "two", 3.5, json::array(), json::object() });
+        value["nested"]["deeper"]["deepest"] = json::array({ false, nullptr });
+        value["long"] = std::string(70000, 'x');
+        return value;
+    }
+
+    void EveryEncodingRoundTrips() {
+        json value = SampleValue();
+        for (size_t e = 0; e < sizeof(ENCODINGS) / sizeof(ENCODINGS[0]); e++) {
+            std::string body;
+            CHECK(WireCodec::Encode(value, ENCODINGS[e], body));
+            json decoded;
+            CHECK(WireCodec::Decode(body, WireCodec::ContentType(ENCODINGS[e]), decoded));
+            if (decoded != value) {
+                fprintf(stderr, "%s does not round-trip\n", WireCodec::Name(ENCODINGS[e]));
+                TestSupport::failures++;
+            }
+
+            // Parameters and case in the Content-Type do not change the decoder
+            std::string contentType = std::string(WireCodec::ContentType(ENCODINGS[e])) + "; charset=utf-8";
+            for (size_t i = 0; i < contentType.size(); i++) {
+                contentType[i] = (char)toupper((unsigned char)contentType[i]);
+            }
+            json again;
+            CHECK(WireCodec::Decode(body, contentType, again) && again == value);
+
+            WireEncoding named;
+            CHECK(WireCodec::FromName(WireCodec::Name(ENCODINGS[e]), named) && named == ENCODINGS[e]);
+        }
+
+        // A binary body is not JSON, and anything unrecognised is parsed as JSON
+        std::string cbor;
+        WireCodec::Encode(value, WIRE_ENCODING_CBOR, cbor);
+        json decoded;
+        CHECK(!WireCodec::Decode(cbor, AgentConstants::CONTENT_TYPE_JSON, decoded));
+        CHECK(WireCodec::Decode("{\"a\":1}", "text/html", decoded) && decoded["a"] == 1);
+        // A two-element array that ends after one
+        CHECK(!WireCodec::Decode("\x92\x01", AgentConstants::CONTENT_TYPE_MSGPACK, decoded));
+
+        // Invalid UTF-8 cannot be written as JSON; Encode reports it instead of throwing
+        json invalid;
+        invalid["text"] = "\xc3\x28";
+        std::string body;
+        CHECK(!WireCodec::Encode(invalid, WIRE_ENCODING_JSON, body));
+
+        WireEncoding unknown;
+        CHECK(!WireCodec::FromName("protobuf", unknown));
+        CHECK(WireCodec::SupportedNames().size() == 3 && WireCodec::SupportedNames()[0] != "json");
+    }
+
+    int HeartbeatRequests(const StandInServer& server) {
+        std::map<std::string, StandInEndpointStats> stats = server.GetStats();
+        std::string heartbeat(AgentConstants::ENDPOINT_HEARTBEAT,
+            AgentConstants::ENDPOINT_HEARTBEAT + wcslen(AgentConstants::ENDPOINT_HEARTBEAT));
+        return stats.count(heartbeat) ? (int)stats[heartbeat].requests : 0;
+    }
+
+    // As RegistrationService: offer every encoding, use the one the server picked
+    bool Register(HttpClient& client) {
+        client.SetWireEncoding(WIRE_ENCODING_JSON);
+        json request;
+        request["lineNumber"] = 3;
+        request["pcNumber"] = 12;
+        request["supportedEncodings"] = WireCodec::SupportedNames();
+        json response;
+        if (!client.Post(AgentConstants::ENDPOINT_REGISTER, request, response)) {
+            return false;
+        }
+        WireEncoding encoding = WIRE_ENCODING_JSON;
+        if (response.contains("wireEncoding") && response["wireEncoding"].is_string()) {
+            WireCodec::FromName(response["wireEncoding"].get<std::string>(), encoding);
+        }
+        client.SetWireEncoding(encoding);
+        return true;
+    }
+
+    void NegotiatesAndFallsBackOn415() {
+        StandInServer server;
+        CHECK(server.Start(0));
+        HttpClient client(server.GetBaseUrl());
+
+        CHECK(Register(client));
+        CHECK(client.GetWireEncoding() == WIRE_ENCODING_CBOR);
+
+        json heartbeat;
+        heartbeat["pcId"] = 1;
+        heartbeat["isApplicationRunning"] = true;
+        heartbeat["note"] = "\xc3\xbc";
+        json response;
+        CHECK(client.Post(AgentConstants::ENDPOINT_HEARTBEAT, heartbeat, response));
+        CHECK(response.value("success", false));
+        CHECK(HeartbeatRequests(server) == 1);
+
+        // Rolled back: the CBOR heartbeat is refused, resent as JSON, and JSON sticks
+        server.SetBinaryEncodingsEnabled(false);
+        json fallback;
+        int statusCode = 0;
+        CHECK(client.Post(AgentConstants::ENDPOINT_HEARTBEAT, heartbeat, fallback, statusCode));
+        CHECK(statusCode == AgentConstants::HTTP_OK && fallback.value("success", false));
+        CHECK(client.GetWireEncoding() == WIRE_ENCODING_JSON);
+        CHECK(HeartbeatRequests(server) == 3);
+
+        CHECK(client.Post(AgentConstants::ENDPOINT_HEARTBEAT, heartbeat, fallback));
+        CHECK(HeartbeatRequests(server) == 4);
+
+        // Registering again with the JSON-only build negotiates nothing
+        CHECK(Register(client));
+        CHECK(client.GetWireEncoding() == WIRE_ENCODING_JSON);
+        server.Stop();
+    }
+}
+
+int main() {
+    EveryEncodingRoundTrips();
+    NegotiatesAndFallsBackOn415();
+    return TestSupport::Result();
+}
@@ -1,8 +1,10 @@
 using FactoryMonitoringWeb.Data;
 using FactoryMonitoringWeb.Models;
 using FactoryMonitoringWeb.Models.DTOs;
+using FactoryMonitoringWeb.Services;
 using Microsoft.AspNetCore.Mvc;
 using Microsoft.EntityFrameworkCore;
+using Microsoft.Net.Http.Headers;
 using Newtonsoft.Json;
 
 namespace FactoryMonitoringWeb.Controllers
@@ -11,13 +13,32 @@ namespace FactoryMonitoringWeb.Controllers
     [ApiController]
     public class AgentApiController : ControllerBase
     {
+        // Binary encodings this server has formatters for (see Formatters/)
+        private static readonly string[] ServerWireEncodings = { "cbor" };
+        // Optional protocol features this server implements
+        private static readonly string[] ServerFeatures = { "configdelta", "commandchannel", "logdelta", "loganalysis" };
+
+        // Command channel: held open up to MaxChannelHold, a newline every ChannelKeepAlive
+        // keeps proxies and the agent's socket timeout from closing it, and the table is
+        // re-read every ChannelRecheck in case a command was queued by another instance
+        private static readonly TimeSpan MaxChannelHold = TimeSpan.FromMinutes(5);
+        private static readonly TimeSpan ChannelKeepAlive = TimeSpan.FromSeconds(3);
+        private static readonly TimeSpan ChannelRecheck = TimeSpan.FromSeconds(30);
+        private static readonly JsonSerializerSettings ChannelSerializerSettings = new JsonSerializerSettings
+        {
+            ContractResolver = new Newtonsoft.Json.Serialization.CamelCasePropertyNamesContractResolver(),
+            NullValueHandling = NullValueHandling.Ignore
+        };
+
         private readonly FactoryDbContext _context;
         private readonly ILogger<AgentApiController> _logger;
+        private readonly CommandNotifier _notifier;
 
-        public AgentApiController(FactoryDbContext context, ILogger<AgentApiController> logger)
+        public AgentApiController(FactoryDbContext context, ILogger<AgentApiController> logger, CommandNotifier notifier)
         {
             _context = context;
             _logger = logger;
+            _notifier = notifier;
         }
 
         [HttpPost("register")]
@@ -32,6 +53,8 @@ namespace FactoryMonitoringWeb.Controllers
                                             && p.ModelVersion == request.ModelVersion);
 
                 int pcId;
+                var features = NegotiateFeatures(request.Features);
+                var agentFeatures = string.Join(",", features);
 
                 if (existingPC == null)
                 {
@@ -46,7 +69,8 @@ namespace FactoryMonitoringWeb.Controllers
                         ModelVersion = string.IsNullOrWhiteSpace(request.ModelVersion) ? "3.5" : request.ModelVersion,
                         IsOnline = true,
                         LastHeartbeat = DateTime.Now,
-                        LogStructureJson = request.LogStructureJson
+                        LogStructureJson = request.LogStructureJson,
+                        AgentFeatures = agentFeatures
                     };
 
                     _context.FactoryPCs.Add(newPC);
@@ -67,10 +91,13 @@ namespace FactoryMonitoringWeb.Controllers
                     existingPC.IsOnline = true;
                     existingPC.LastHeartbeat = DateTime.Now;
                     existingPC.LastUpdated = DateTime.Now;
+                    existingPC.AgentFeatures = agentFeatures;
 
                     if (!string.IsNullOrEmpty(request.LogStructureJson))
                     {
                         existingPC.LogStructureJson = request.LogStructureJson;
+                        // Built without a fingerprint; the agent's first log sync after this is a full one
+                        existingPC.LogStructureVersion = null;
                     }
 
                     await _context.SaveChangesAsync();
@@ -83,7 +110,9 @@ namespace FactoryMonitoringWeb.Controllers
                 {
                     Success = true,
                     PCId = pcId,
-                    Message = "Registration successful"
+                    Message = "Registration successful",
+                    WireEncoding = NegotiateWireEncoding(request.SupportedEncodings),
+                    Features = features.Count > 0 ? features : null
                 });
             }
             catch (Exception ex)
@@ -97,6 +126,24 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
+        private static string? NegotiateWireEncoding(List<string>? supportedEncodings)
+        {
+            // Agent's preference order wins; JSON needs no announcement
+            return supportedEncodings?
+                .Select(e => e.ToLowerInvariant())
+                .FirstOrDefault(e => ServerWireEncodings.Contains(e));
+        }
+
+        private static List<string> NegotiateFeatures(List<string>? agentFeatures)
+        {
+            // Older agents send nothing and keep the full-content protocol
+            return agentFeatures?
+                .Select(f => f.ToLowerInvariant())
+                .Where(f => ServerFeatures.Contains(f))
+                .Distinct()
+                .ToList() ?? new List<string>();
+        }
+
         [HttpPost("heartbeat")]
         public async Task<ActionResult<HeartbeatResponse>> Heartbeat([FromBody] HeartbeatRequest request)
         {
@@ -113,24 +160,17 @@ namespace FactoryMonitoringWeb.Controllers
                 pc.IsApplicationRunning = request.IsApplicationRunning;
                 pc.LastUpdated = DateTime.Now;
 
-                var pendingCommands = await _context.AgentCommands
-                    .Where(c => c.PCId == request.PCId && c.Status == "Pending")
-                    .OrderBy(c => c.CreatedDate)
-                    .ToListAsync();
-
-                var commands = pendingCommands.Select(c => new CommandInfo
-                {
-                    CommandId = c.CommandId,
-                    CommandType = c.CommandType,
-                    CommandData = c.CommandData
-                }).ToList();
-
-                foreach (var cmd in pendingCommands)
+                if (request.Metrics != null)
                 {
-                    cmd.Status = "InProgress";
-                    cmd.ExecutedDate = DateTime.Now;
+                    pc.AgentMetricsJson = request.Metrics.ToString(Formatting.None);
+                    pc.AgentMetricsUpdated = DateTime.Now;
                 }
 
+                // With a channel open the commands go out there, and only there
+                var commands = request.CommandsOnChannel
+                    ? new List<CommandInfo>()
+                    : await ClaimPendingCommands(request.PCId);
+
                 await _context.SaveChangesAsync();
 
                 return Ok(new HeartbeatResponse
@@ -147,36 +187,128 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
-        [HttpPost("updateconfig")]
-        public async Task<ActionResult<ApiResponse>> UpdateConfig([FromBody] ConfigUpdateRequest request)
+        /// <summary>
+        /// Long-lived response that pushes commands to the agent the moment they are queued,
+        /// one JSON object per line ({"commands":[...]}), with bare newlines as keep-alives.
+        /// Results still come back through commandresult. Agents that lose the channel fall
+        /// back to receiving commands with their heartbeat
+        /// </summary>
+        [HttpPost("commandchannel")]
+        public async Task CommandChannel([FromBody] CommandChannelRequest request)
         {
+            var aborted = HttpContext.RequestAborted;
+            if (!await _context.FactoryPCs.AnyAsync(p => p.PCId == request.PCId, aborted))
+            {
+                Response.StatusCode = StatusCodes.Status404NotFound;
+                return;
+            }
+
+            var hold = request.HoldSeconds > 0 ? TimeSpan.FromSeconds(request.HoldSeconds) : MaxChannelHold;
+            if (hold > MaxChannelHold)
+            {
+                hold = MaxChannelHold;
+            }
+
+            Response.ContentType = "application/x-ndjson";
+            Response.Headers.CacheControl = "no-store";
+            HttpContext.Features.Get<Microsoft.AspNetCore.Http.Features.IHttpResponseBodyFeature>()?.DisableBuffering();
+
+            var keepAlive = new byte[] { (byte)'\n' };
+            var deadline = DateTime.UtcNow + hold;
+            var nextCheck = DateTime.MinValue;
+            bool signalled = false;
+            var unsent = new List<int>();
+
             try
             {
-                var existingConfig = await _context.ConfigFiles
-                    .FirstOrDefaultAsync(c => c.PCId == request.PCId);
+                // Headers and a first newline right away tell the agent the channel is up
+                await Response.Body.WriteAsync(keepAlive, aborted);
+                await Response.Body.FlushAsync(aborted);
 
-                if (existingConfig == null)
+                while (!aborted.IsCancellationRequested && DateTime.UtcNow < deadline)
                 {
-                    var newConfig = new ConfigFile
+                    var queued = _notifier.QueuedSignal(request.PCId);
+
+                    if (signalled || DateTime.UtcNow >= nextCheck)
                     {
-                        PCId = request.PCId,
-                        ConfigContent = request.ConfigContent,
-                        LastModified = DateTime.Now
-                    };
-                    _context.ConfigFiles.Add(newConfig);
-                }
-                else
-                {
-                    existingConfig.ConfigContent = request.ConfigContent;
-                    existingConfig.LastModified = DateTime.Now;
+                        var commands = await ClaimPendingCommands(request.PCId);
+                        await _context.SaveChangesAsync(aborted);
+                        _context.ChangeTracker.Clear();
+                        nextCheck = DateTime.UtcNow + ChannelRecheck;
+
+                        if (commands.Count > 0)
+                        {
+                            unsent = commands.Select(c => c.CommandId).ToList();
+                            var line = JsonConvert.SerializeObject(new { commands }, ChannelSerializerSettings) + "\n";
+                            await Response.Body.WriteAsync(System.Text.Encoding.UTF8.GetBytes(line), aborted);
+                            await Response.Body.FlushAsync(aborted);
+                            unsent.Clear();
+                        }
+                    }
 
-                    if (existingConfig.PendingUpdate)
+                    var wait = deadline - DateTime.UtcNow;
+                    if (wait > ChannelKeepAlive)
+                    {
+                        wait = ChannelKeepAlive;
+                    }
+                    if (wait < TimeSpan.Zero)
                     {
-                        existingConfig.UpdateApplied = true;
-                        existingConfig.PendingUpdate = false;
+                        wait = TimeSpan.Zero;
+                    }
+
+                    signalled = await Task.WhenAny(queued, Task.Delay(wait, aborted)) == queued;
+                    if (!signalled && !aborted.IsCancellationRequested)
+                    {
+                        await Response.Body.WriteAsync(keepAlive, aborted);
+                        await Response.Body.FlushAsync(aborted);
                     }
                 }
+            }
+            catch (OperationCanceledException)
+            {
+                // The agent went away; anything not yet claimed is still Pending
+            }
+            catch (IOException)
+            {
+            }
+
+            // Claimed but never written: hand them back to the heartbeat
+            if (unsent.Count > 0)
+            {
+                await _context.AgentCommands
+                    .Where(c => unsent.Contains(c.CommandId) && c.Status == "InProgress")
+                    .ExecuteUpdateAsync(u => u.SetProperty(c => c.Status, "Pending"));
+            }
+        }
+
+        // Marks the PC's pending commands InProgress and returns them oldest first; the caller saves
+        private async Task<List<CommandInfo>> ClaimPendingCommands(int pcId)
+        {
+            var pendingCommands = await _context.AgentCommands
+                .Where(c => c.PCId == pcId && c.Status == "Pending")
+                .OrderBy(c => c.CreatedDate)
+                .ToListAsync();
+
+            foreach (var cmd in pendingCommands)
+            {
+                cmd.Status = "InProgress";
+                cmd.ExecutedDate = DateTime.Now;
+            }
+
+            return pendingCommands.Select(c => new CommandInfo
+            {
+                CommandId = c.CommandId,
+                CommandType = c.CommandType,
+                CommandData = c.CommandData
+            }).ToList();
+        }
 
+        [HttpPost("updateconfig")]
+        public async Task<ActionResult<ApiResponse>> UpdateConfig([FromBody] ConfigUpdateRequest request)
+        {
+            try
+            {
+                await ApplyConfigContent(request.PCId, request.ConfigContent);
                 await _context.SaveChangesAsync();
 
                 return Ok(new ApiResponse
@@ -196,6 +328,40 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
+        [HttpPost("updateconfigdelta")]
+        public async Task<ActionResult<ConfigDeltaResponse>> UpdateConfigDelta([FromBody] ConfigDeltaRequest request)
+        {
+            try
+            {
+                if (!await TryApplyConfigDelta(request.PCId, request.BaseHash, request.Ops, request.Hash))
+                {
+                    return Ok(new ConfigDeltaResponse
+                    {
+                        Success = false,
+                        NeedFull = true,
+                        Message = "Config base does not match"
+                    });
+                }
+
+                await _context.SaveChangesAsync();
+
+                return Ok(new ConfigDeltaResponse
+                {
+                    Success = true,
+                    Message = "Config updated successfully"
+                });
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error applying config delta");
+                return StatusCode(500, new ConfigDeltaResponse
+                {
+                    Success = false,
+                    Message = $"Config delta failed: {ex.Message}"
+                });
+            }
+        }
+
         [HttpPost("synclogs")]
         public async Task<ActionResult<ApiResponse>> SyncLogStructure([FromBody] LogStructureSyncRequest request)
         {
@@ -204,9 +370,7 @@ namespace FactoryMonitoringWeb.Controllers
                 var pc = await _context.FactoryPCs.FindAsync(request.PCId);
                 if (pc == null) return NotFound(new ApiResponse { Success = false, Message = "PC not found" });
 
-                pc.LogStructureJson = request.LogStructureJson;
-                pc.LastUpdated = DateTime.Now;
-
+                ApplyLogStructure(pc, request.LogStructureJson, request.Version);
                 await _context.SaveChangesAsync();
                 return Ok(new ApiResponse { Success = true, Message = "Log structure synced" });
             }
@@ -217,53 +381,41 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
-
-        [HttpPost("syncmodels")]
-        public async Task<ActionResult<ApiResponse>> SyncModels([FromBody] ModelSyncRequest request)
+        [HttpPost("synclogsdelta")]
+        public async Task<ActionResult<LogTreeDeltaResponse>> SyncLogStructureDelta([FromBody] LogTreeDeltaRequest request)
         {
             try
             {
-                var existingModels = await _context.Models
-                    .Where(m => m.PCId == request.PCId)
-                    .ToListAsync();
+                var pc = await _context.FactoryPCs.FindAsync(request.PCId);
+                if (pc == null) return NotFound(new LogTreeDeltaResponse { Success = false, Message = "PC not found" });
 
-                foreach (var modelInfo in request.Models)
+                if (!TryApplyLogDelta(pc, request.BaseVersion, request.Ops, request.Version))
                 {
-                    var existingModel = existingModels
-                        .FirstOrDefault(m => m.ModelName == modelInfo.ModelName);
-
-                    if (existingModel == null)
+                    return Ok(new LogTreeDeltaResponse
                     {
-                        var newModel = new Model
-                        {
-                            PCId = request.PCId,
-                            ModelName = modelInfo.ModelName,
-                            ModelPath = modelInfo.ModelPath,
-                            IsCurrentModel = modelInfo.IsCurrent,
-                            LastUsed = modelInfo.IsCurrent ? DateTime.Now : null
-                        };
-                        _context.Models.Add(newModel);
-                    }
-                    else
-                    {
-                        bool wasCurrent = existingModel.IsCurrentModel;
-
-                        existingModel.ModelPath = modelInfo.ModelPath;
-                        existingModel.IsCurrentModel = modelInfo.IsCurrent;
-
-                        if (modelInfo.IsCurrent && !wasCurrent)
-                        {
-                            existingModel.LastUsed = DateTime.Now;
-                        }
-                    }
+                        Success = false,
+                        NeedFull = true,
+                        Message = "Log tree base does not match"
+                    });
                 }
 
-                var modelNamesFromRequest = request.Models.Select(m => m.ModelName).ToList();
-                var modelsToRemove = existingModels
-                    .Where(m => !modelNamesFromRequest.Contains(m.ModelName))
-                    .ToList();
+                await _context.SaveChangesAsync();
+                return Ok(new LogTreeDeltaResponse { Success = true, Message = "Log structure synced" });
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error applying log structure delta");
+                return StatusCode(500, new LogTreeDeltaResponse { Success = false, Message = ex.Message });
+            }
+        }
 
-                _context.Models.RemoveRange(modelsToRemove);
+
+        [HttpPost("syncmodels")]
+        public async Task<ActionResult<ApiResponse>> SyncModels([FromBody] ModelSyncRequest request)
+        {
+            try
+            {
+                await ApplyModelList(request.PCId, request.Models);
 
                 await _context.SaveChangesAsync();
 
@@ -284,34 +436,206 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
-        [HttpPost("commandresult")]
-        public async Task<ActionResult<ApiResponse>> CommandResult([FromBody] CommandResultRequest request)
+        [HttpPost("syncbatch")]
+        public async Task<ActionResult<SyncBatchResponse>> SyncBatch([FromBody] SyncBatchRequest request)
         {
             try
             {
-                var command = await _context.AgentCommands.FindAsync(request.CommandId);
-                if (command == null)
+                // An unknown PC gets a normal reply with no acks, so the agent keeps every section
+                // pending instead of mistaking it for a server without batch support
+                var pc = await _context.FactoryPCs.FindAsync(request.PCId);
+                if (pc == null)
                 {
-                    return NotFound(new ApiResponse { Success = false, Message = "Command not found" });
+                    return Ok(new SyncBatchResponse { Success = false, Message = "PC not found" });
                 }
 
-                command.Status = request.Status;
-                command.ResultData = request.ResultData;
-                command.ErrorMessage = request.ErrorMessage;
-                command.ExecutedDate = DateTime.Now;
+                var result = new SyncBatchResponse { Success = true, Message = "Batch synced" };
 
-                if (command.CommandType == "ResetAgent" && request.Status == "Completed")
+                if (request.Config != null)
                 {
-                    var pc = await _context.FactoryPCs
-                        .Include(p => p.ConfigFile)
-                        .Include(p => p.Models)
-                        .FirstOrDefaultAsync(p => p.PCId == command.PCId);
+                    if (request.Config.ConfigContent != null)
+                    {
+                        await ApplyConfigContent(request.PCId, request.Config.ConfigContent);
+                        result.Acks["config"] = true;
+                    }
+                    else if (await TryApplyConfigDelta(request.PCId, request.Config.BaseHash ?? string.Empty,
+                        request.Config.Ops, request.Config.Hash ?? string.Empty))
+                    {
+                        result.Acks["config"] = true;
+                    }
+                    else
+                    {
+                        result.Acks["config"] = false;
+                        result.NeedFull = new List<string> { "config" };
+                    }
+                }
 
-                    if (pc != null)
+                if (request.Logs != null)
+                {
+                    if (request.Logs.LogStructureJson != null)
                     {
-                        _context.FactoryPCs.Remove(pc);
-                        _logger.LogInformation($"PC {pc.PCId} permanently deleted after Agent confirmation.");
+                        ApplyLogStructure(pc, request.Logs.LogStructureJson, request.Logs.Version);
+                        result.Acks["logs"] = true;
                     }
+                    else if (TryApplyLogDelta(pc, request.Logs.BaseVersion ?? string.Empty,
+                        request.Logs.Ops, request.Logs.Version ?? string.Empty))
+                    {
+                        result.Acks["logs"] = true;
+                    }
+                    else
+                    {
+                        result.Acks["logs"] = false;
+                        result.NeedFull ??= new List<string>();
+                        result.NeedFull.Add("logs");
+                    }
+                }
+
+                if (request.Models != null)
+                {
+                    await ApplyModelList(request.PCId, request.Models.Models);
+                    result.Acks["models"] = true;
+                }
+
+                // One transaction for every section instead of one per endpoint call
+                await _context.SaveChangesAsync();
+
+                return Ok(result);
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error syncing batch");
+                return StatusCode(500, new SyncBatchResponse
+                {
+                    Success = false,
+                    Message = $"Batch sync failed: {ex.Message}"
+                });
+            }
+        }
+
+        private async Task ApplyConfigContent(int pcId, string configContent)
+        {
+            var existingConfig = await _context.ConfigFiles
+                .FirstOrDefaultAsync(c => c.PCId == pcId);
+
+            if (existingConfig == null)
+            {
+                var newConfig = new ConfigFile
+                {
+                    PCId = pcId,
+                    ConfigContent = configContent,
+                    LastModified = DateTime.Now
+                };
+                _context.ConfigFiles.Add(newConfig);
+            }
+            else
+            {
+                existingConfig.ConfigContent = configContent;
+                existingConfig.LastModified = DateTime.Now;
+
+                if (existingConfig.PendingUpdate)
+                {
+                    existingConfig.UpdateApplied = true;
+                    existingConfig.PendingUpdate = false;
+                }
+            }
+        }
+
+        private async Task<bool> TryApplyConfigDelta(int pcId, string baseHash, List<ConfigDeltaOp>? ops, string hash)
+        {
+            var existingConfig = await _context.ConfigFiles
+                .FirstOrDefaultAsync(c => c.PCId == pcId);
+            if (existingConfig == null)
+            {
+                return false;
+            }
+
+            var updated = ConfigDelta.TryApply(existingConfig.ConfigContent, baseHash, ops, hash);
+            if (updated == null)
+            {
+                return false;
+            }
+
+            await ApplyConfigContent(pcId, updated);
+            return true;
+        }
+
+        private static void ApplyLogStructure(FactoryPC pc, string logStructureJson, string? version)
+        {
+            pc.LogStructureJson = logStructureJson;
+            pc.LogStructureVersion = version;
+            pc.LastUpdated = DateTime.Now;
+        }
+
+        private static bool TryApplyLogDelta(FactoryPC pc, string baseVersion, List<LogTreeOp>? ops, string version)
+        {
+            if (string.IsNullOrEmpty(version))
+            {
+                return false;
+            }
+
+            var updated = LogTreeDelta.TryApply(pc.LogStructureJson, pc.LogStructureVersion, baseVersion, ops);
+            if (updated == null)
+            {
+                return false;
+            }
+
+            ApplyLogStructure(pc, updated, version);
+            return true;
+        }
+
+        private async Task ApplyModelList(int pcId, List<ModelInfo> models)
+        {
+            var existingModels = await _context.Models
+                .Where(m => m.PCId == pcId)
+                .ToListAsync();
+
+            foreach (var modelInfo in models)
+            {
+                var existingModel = existingModels
+                    .FirstOrDefault(m => m.ModelName == modelInfo.ModelName);
+
+                if (existingModel == null)
+                {
+                    var newModel = new Model
+                    {
+                        PCId = pcId,
+                        ModelName = modelInfo.ModelName,
+                        ModelPath = modelInfo.ModelPath,
+                        IsCurrentModel = modelInfo.IsCurrent,
+                        LastUsed = modelInfo.IsCurrent ? DateTime.Now : null
+                    };
+                    _context.Models.Add(newModel);
+                }
+                else
+                {
+                    bool wasCurrent = existingModel.IsCurrentModel;
+
+                    existingModel.ModelPath = modelInfo.ModelPath;
+                    existingModel.IsCurrentModel = modelInfo.IsCurrent;
+
+                    if (modelInfo.IsCurrent && !wasCurrent)
+                    {
+                        existingModel.LastUsed = DateTime.Now;
+                    }
+                }
+            }
+
+            var modelNamesFromRequest = models.Select(m => m.ModelName).ToList();
+            var modelsToRemove = existingModels
+                .Where(m => !modelNamesFromRequest.Contains(m.ModelName))
+                .ToList();
+
+            _context.Models.RemoveRange(modelsToRemove);
+        }
+
+        [HttpPost("commandresult")]
+        public async Task<ActionResult<ApiResponse>> CommandResult([FromBody] CommandResultRequest request)
+        {
+            try
+            {
+                if (!await RecordCommandResult(request))
+                {
+                    return NotFound(new ApiResponse { Success = false, Message = "Command not found" });
                 }
 
                 await _context.SaveChangesAsync();
@@ -333,6 +657,115 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
+        /// <summary>
+        /// Results an agent kept on disk while the server was out of reach, replayed in one
+        /// request. Saved together: either every result is recorded or the agent sends them again
+        /// </summary>
+        [HttpPost("commandresults")]
+        public async Task<ActionResult<ApiResponse>> CommandResults([FromBody] CommandResultBatchRequest request)
+        {
+            try
+            {
+                int unknown = 0;
+                foreach (var result in request.Results)
+                {
+                    if (!await RecordCommandResult(result))
+                    {
+                        unknown++;
+                    }
+                }
+
+                await _context.SaveChangesAsync();
+
+                return Ok(new ApiResponse
+                {
+                    Success = true,
+                    Message = $"{request.Results.Count - unknown} command results recorded, {unknown} unknown"
+                });
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error recording command results");
+                return StatusCode(500, new ApiResponse
+                {
+                    Success = false,
+                    Message = $"Command results failed: {ex.Message}"
+                });
+            }
+        }
+
+        /// <summary>
+        /// Applies one result to the tracked context. A result for a command that already has one
+        /// is a replay of a delivery whose answer the agent never saw, and changes nothing.
+        /// Returns false for an unknown command
+        /// </summary>
+        private async Task<bool> RecordCommandResult(CommandResultRequest request)
+        {
+            var command = await _context.AgentCommands.FindAsync(request.CommandId);
+            if (command == null)
+            {
+                return false;
+            }
+
+            if (command.Status == "Completed" || command.Status == "Failed")
+            {
+                return true;
+            }
+
+            command.Status = request.Status;
+            command.ResultData = request.ResultData;
+            command.ErrorMessage = request.ErrorMessage;
+            command.ExecutedDate = DateTime.Now;
+
+            // Agents no longer resend a config the server pushed, so our copy follows the command
+            if ((command.CommandType == "UpdateConfig" || command.CommandType == "UpdateConfigDelta") &&
+                request.Status == "Completed")
+            {
+                var config = await _context.ConfigFiles.FirstOrDefaultAsync(c => c.PCId == command.PCId);
+                if (config != null && config.UpdatedContent != null)
+                {
+                    config.ConfigContent = config.UpdatedContent;
+                    config.LastModified = DateTime.Now;
+                    config.PendingUpdate = false;
+                    config.UpdateApplied = true;
+                }
+            }
+
+            // The agent's file was not the delta's base: fall back to sending all of it
+            if (command.CommandType == "UpdateConfigDelta" && request.Status == "Failed" &&
+                request.ResultData == "NeedFullConfig")
+            {
+                var config = await _context.ConfigFiles.FirstOrDefaultAsync(c => c.PCId == command.PCId);
+                if (config != null && config.UpdatedContent != null)
+                {
+                    _context.AgentCommands.Add(new AgentCommand
+                    {
+                        PCId = command.PCId,
+                        CommandType = "UpdateConfig",
+                        CommandData = config.UpdatedContent,
+                        Status = "Pending",
+                        CreatedDate = DateTime.Now
+                    });
+                }
+            }
+
+            if (command.CommandType == "ResetAgent" && request.Status == "Completed")
+            {
+                var pc = await _context.FactoryPCs
+                    .Include(p => p.ConfigFile)
+                    .Include(p => p.Models)
+                    .FirstOrDefaultAsync(p => p.PCId == command.PCId);
+
+                if (pc != null)
+                {
+                    _context.FactoryPCs.Remove(pc);
+                    _logger.LogInformation($"PC {pc.PCId} permanently deleted after Agent confirmation.");
+                }
+            }
+
+            return true;
+        }
+
         [HttpGet("getconfigupdate/{pcId}")]
         public async Task<ActionResult<ApiResponse>> GetConfigUpdate(int pcId)
         {
@@ -402,13 +835,15 @@ namespace FactoryMonitoringWeb.Controllers
 
                 using var memoryStream = new MemoryStream();
                 await file.CopyToAsync(memoryStream);
+                var fileData = memoryStream.ToArray();
 
                 var modelFile = new ModelFile
                 {
                     ModelName = modelName,
                     FileName = file.FileName,
-                    FileData = memoryStream.ToArray(),
+                    FileData = fileData,
                     FileSize = file.Length,
+                    ContentSha256 = ModelFileDigest.Compute(fileData),
                     UploadedDate = DateTime.Now,
                     IsActive = true
                 };
@@ -455,13 +890,15 @@ namespace FactoryMonitoringWeb.Controllers
 
                 using var memoryStream = new MemoryStream();
                 await file.CopyToAsync(memoryStream);
+                var fileData = memoryStream.ToArray();
 
                 var modelFile = new ModelFile
                 {
                     ModelName = modelName,
                     FileName = file.FileName,
-                    FileData = memoryStream.ToArray(),
+                    FileData = fileData,
                     FileSize = file.Length,
+                    ContentSha256 = ModelFileDigest.Compute(fileData),
                     UploadedDate = DateTime.Now
                 };
 
@@ -517,13 +954,47 @@ namespace FactoryMonitoringWeb.Controllers
         {
             try
             {
-                var modelFile = await _context.ModelFiles.FindAsync(modelFileId);
-                if (modelFile == null)
+                // Metadata only: neither a revalidation nor a range request loads the blob
+                var meta = await _context.ModelFiles
+                    .Where(m => m.ModelFileId == modelFileId)
+                    .Select(m => new { m.FileName, m.UploadedDate, m.ContentSha256, Length = EF.Functions.DataLength(m.FileData) })
+                    .FirstOrDefaultAsync();
+                if (meta == null)
                 {
                     return NotFound();
                 }
 
-                return File(modelFile.FileData, "application/octet-stream", modelFile.FileName);
+                // HTTP dates carry whole seconds
+                var lastModified = new DateTimeOffset(meta.UploadedDate.AddTicks(-(meta.UploadedDate.Ticks % TimeSpan.TicksPerSecond)));
+
+                // Stored model files never change, so the digest doubles as a strong ETag. Files
+                // stored before it was recorded on upload are hashed once here, streaming, and the
+                // digest kept, so every later range of a segmented download finds it in meta
+                var digest = meta.ContentSha256;
+                if (string.IsNullOrEmpty(digest))
+                {
+                    digest = await ModelFileBlobStream.HashAsync(_context, modelFileId);
+                    await _context.ModelFiles
+                        .Where(m => m.ModelFileId == modelFileId)
+                        .ExecuteUpdateAsync(u => u.SetProperty(m => m.ContentSha256, digest));
+                }
+
+                var etag = new EntityTagHeaderValue($"\"{digest}\"");
+                if (IsNotModified(etag, lastModified))
+                {
+                    var headers = Response.GetTypedHeaders();
+                    headers.ETag = etag;
+                    headers.LastModified = lastModified;
+                    return StatusCode(StatusCodes.Status304NotModified);
+                }
+
+                Response.Headers["X-Content-SHA256"] = digest;
+
+                // Range processing lets agents resume interrupted downloads and fetch segments in
+                // parallel; the blob stream reads just the requested bytes
+                var blob = await ModelFileBlobStream.OpenAsync(_context, modelFileId, meta.Length ?? 0);
+                return File(blob, "application/octet-stream", meta.FileName,
+                    lastModified: lastModified, entityTag: etag, enableRangeProcessing: true);
             }
             catch (Exception ex)
             {
@@ -531,5 +1002,17 @@ namespace FactoryMonitoringWeb.Controllers
                 return StatusCode(500);
             }
         }
+
+        // If-None-Match decides when present; If-Modified-Since only without it (RFC 9110 13.2.2)
+        private bool IsNotModified(EntityTagHeaderValue etag, DateTimeOffset lastModified)
+        {
+            var headers = Request.GetTypedHeaders();
+            if (headers.IfNoneMatch != null && headers.IfNoneMatch.Count > 0)
+            {
+                return headers.IfNoneMatch.Any(t => t.Equals(EntityTagHeaderValue.Any) || t.Compare(etag, useStrongComparison: false));
+            }
+
+            return headers.IfModifiedSince.HasValue && lastModified <= headers.IfModifiedSince.Value;
+        }
     }
-}
\ No newline at end of file
+}
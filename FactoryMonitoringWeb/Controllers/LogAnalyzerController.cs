@@ -1,5 +1,6 @@
 ﻿using FactoryMonitoringWeb.Data;
 using FactoryMonitoringWeb.Models;
+using FactoryMonitoringWeb.Services;
 using Microsoft.AspNetCore.Mvc;
 using Microsoft.EntityFrameworkCore;
 using Newtonsoft.Json;
@@ -15,11 +16,17 @@ namespace FactoryMonitoringWeb.Controllers
     {
         private readonly FactoryDbContext _context;
         private readonly ILogger<LogAnalyzerController> _logger;
+        private readonly CommandNotifier _notifier;
 
-        public LogAnalyzerController(FactoryDbContext context, ILogger<LogAnalyzerController> logger)
+        // Results normally arrive through CommandNotifier; the table is re-read this often regardless
+        private static readonly TimeSpan ResultRecheck = TimeSpan.FromSeconds(5);
+        private static readonly TimeSpan ResultTimeout = TimeSpan.FromSeconds(60);
+
+        public LogAnalyzerController(FactoryDbContext context, ILogger<LogAnalyzerController> logger, CommandNotifier notifier)
         {
             _context = context;
             _logger = logger;
+            _notifier = notifier;
         }
 
         [HttpGet("structure/{pcId}")]
@@ -35,6 +42,7 @@ namespace FactoryMonitoringWeb.Controllers
             string responseJson = $@"{{
                 ""pcId"": {pcId},
                 ""rootPath"": {JsonConvert.ToString(pc.LogFolderPath)}, 
+                ""agentAnalysis"": {(SupportsAgentAnalysis(pc) ? "true" : "false")},
                 ""files"": {rawJson}
             }}";
 
@@ -62,33 +70,24 @@ namespace FactoryMonitoringWeb.Controllers
                 _context.AgentCommands.Add(command);
                 await _context.SaveChangesAsync();
 
-                var timeout = DateTime.UtcNow.AddSeconds(60);
+                var cmd = await WaitForResultAsync(command.CommandId);
 
-                while (DateTime.UtcNow < timeout)
+                if (cmd?.Status == "Completed" && !string.IsNullOrEmpty(cmd.ResultData))
                 {
-                    await Task.Delay(1000);
-
-                    var cmd = await _context.AgentCommands
-                        .AsNoTracking()
-                        .FirstOrDefaultAsync(c => c.CommandId == command.CommandId);
-
-                    if (cmd?.Status == "Completed" && !string.IsNullOrEmpty(cmd.ResultData))
+                    var result = JsonConvert.DeserializeObject<Dictionary<string, object>>(cmd.ResultData);
+                    return Ok(new
                     {
-                        var result = JsonConvert.DeserializeObject<Dictionary<string, object>>(cmd.ResultData);
-                        return Ok(new
-                        {
-                            fileName = Path.GetFileName(request.FilePath),
-                            filePath = request.FilePath,
-                            content = result?["content"],
-                            size = result?["size"],
-                            encoding = result?["encoding"] ?? "UTF-8"
-                        });
-                    }
-
-                    if (cmd?.Status == "Failed")
-                        return StatusCode(500, new { error = cmd.ErrorMessage });
+                        fileName = Path.GetFileName(request.FilePath),
+                        filePath = request.FilePath,
+                        content = result?["content"],
+                        size = result?["size"],
+                        encoding = result?["encoding"] ?? "UTF-8"
+                    });
                 }
 
+                if (cmd?.Status == "Failed")
+                    return StatusCode(500, new { error = cmd.ErrorMessage });
+
                 return StatusCode(408, new { error = "Request timeout - agent did not respond" });
             }
             catch (Exception ex)
@@ -108,10 +107,13 @@ namespace FactoryMonitoringWeb.Controllers
                 if (pc == null)
                     return NotFound(new { error = "PC not found" });
 
+                // Agents with the analysis engine parse the log where it lies and send back only the result
+                bool agentAnalysis = SupportsAgentAnalysis(pc);
+
                 var command = new AgentCommand
                 {
                     PCId = pcId,
-                    CommandType = "GetLogFileContent",
+                    CommandType = agentAnalysis ? "AnalyzeLogFile" : "GetLogFileContent",
                     CommandData = JsonConvert.SerializeObject(new { FilePath = request.FilePath }),
                     Status = "Pending",
                     CreatedDate = DateTime.UtcNow
@@ -120,28 +122,35 @@ namespace FactoryMonitoringWeb.Controllers
                 _context.AgentCommands.Add(command);
                 await _context.SaveChangesAsync();
 
-                var timeout = DateTime.UtcNow.AddSeconds(60);
-                string? fileContent = null;
-
-                while (DateTime.UtcNow < timeout)
+                if (agentAnalysis)
                 {
-                    await Task.Delay(1000);
-
-                    var cmd = await _context.AgentCommands
-                        .AsNoTracking()
-                        .FirstOrDefaultAsync(c => c.CommandId == command.CommandId);
+                    var analyzed = await WaitForResultAsync(command.CommandId);
 
-                    if (cmd?.Status == "Completed" && !string.IsNullOrEmpty(cmd.ResultData))
+                    // Passed through as text: one operation per pair of log lines makes it large
+                    if (analyzed?.Status == "Completed" && analyzed.ResultData?.StartsWith("{") == true)
                     {
-                        var result = JsonConvert.DeserializeObject<Dictionary<string, object>>(cmd.ResultData);
-                        fileContent = result?["content"]?.ToString();
-                        break;
+                        var fileName = JsonConvert.ToString(Path.GetFileName(request.FilePath));
+                        return Content($"{{\"fileName\":{fileName},{analyzed.ResultData.Substring(1)}", "application/json");
                     }
 
-                    if (cmd?.Status == "Failed")
-                        return StatusCode(500, new { error = "Failed to read file" });
+                    if (analyzed?.Status == "Failed")
+                        return StatusCode(500, new { error = analyzed.ErrorMessage ?? "Failed to analyze file" });
+
+                    return StatusCode(408, new { error = "Timeout analyzing file" });
+                }
+
+                string? fileContent = null;
+                var cmd = await WaitForResultAsync(command.CommandId);
+
+                if (cmd?.Status == "Completed" && !string.IsNullOrEmpty(cmd.ResultData))
+                {
+                    var result = JsonConvert.DeserializeObject<Dictionary<string, object>>(cmd.ResultData);
+                    fileContent = result?["content"]?.ToString();
                 }
 
+                if (cmd?.Status == "Failed")
+                    return StatusCode(500, new { error = "Failed to read file" });
+
                 if (fileContent == null)
                     return StatusCode(408, new { error = "Timeout reading file" });
 
@@ -176,33 +185,62 @@ namespace FactoryMonitoringWeb.Controllers
                 _context.AgentCommands.Add(command);
                 await _context.SaveChangesAsync();
 
-                var timeout = DateTime.UtcNow.AddSeconds(60);
+                var cmd = await WaitForResultAsync(command.CommandId);
+
+                if (cmd?.Status == "Completed" && !string.IsNullOrEmpty(cmd.ResultData))
+                {
+                    var result = JsonConvert.DeserializeObject<Dictionary<string, object>>(cmd.ResultData);
+                    var bytes = Encoding.UTF8.GetBytes(result?["content"]?.ToString() ?? "");
+                    return File(bytes, "text/plain", Path.GetFileName(request.FilePath));
+                }
+
+                if (cmd?.Status == "Failed")
+                    return StatusCode(500);
+
+                return StatusCode(408);
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "DownloadLogFile failed for PC {pcId}", pcId);
+                return StatusCode(500);
+            }
+        }
 
-                while (DateTime.UtcNow < timeout)
+        private static bool SupportsAgentAnalysis(FactoryPC pc)
+        {
+            return pc.AgentFeatures?.Split(',').Contains("loganalysis") == true;
+        }
+
+        // Returns the command once the agent reports it Completed or Failed, or as it stands
+        // when ResultTimeout runs out. Wakes as soon as the result is saved rather than polling
+        private async Task<AgentCommand?> WaitForResultAsync(int commandId)
+        {
+            var deadline = DateTime.UtcNow + ResultTimeout;
+            var aborted = HttpContext.RequestAborted;
+
+            try
+            {
+                while (true)
                 {
-                    await Task.Delay(1000);
+                    var finished = _notifier.ResultSignal(commandId);
 
                     var cmd = await _context.AgentCommands
                         .AsNoTracking()
-                        .FirstOrDefaultAsync(c => c.CommandId == command.CommandId);
+                        .FirstOrDefaultAsync(c => c.CommandId == commandId);
 
-                    if (cmd?.Status == "Completed" && !string.IsNullOrEmpty(cmd.ResultData))
+                    var remaining = deadline - DateTime.UtcNow;
+                    if (cmd == null || cmd.Status == "Completed" || cmd.Status == "Failed" ||
+                        remaining <= TimeSpan.Zero || aborted.IsCancellationRequested)
                     {
-                        var result = JsonConvert.DeserializeObject<Dictionary<string, object>>(cmd.ResultData);
-                        var bytes = Encoding.UTF8.GetBytes(result?["content"]?.ToString() ?? "");
-                        return File(bytes, "text/plain", Path.GetFileName(request.FilePath));
+                        return cmd;
                     }
 
-                    if (cmd?.Status == "Failed")
-                        return StatusCode(500);
+                    await Task.WhenAny(finished, Task.Delay(remaining < ResultRecheck ? remaining : ResultRecheck, aborted));
                 }
-
-                return StatusCode(408);
             }
-            catch (Exception ex)
+            finally
             {
-                _logger.LogError(ex, "DownloadLogFile failed for PC {pcId}", pcId);
-                return StatusCode(500);
+                _notifier.ForgetResult(commandId);
             }
         }
 
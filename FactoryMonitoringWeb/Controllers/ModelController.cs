@@ -1,5 +1,6 @@
 using FactoryMonitoringWeb.Data;
 using FactoryMonitoringWeb.Models;
+using FactoryMonitoringWeb.Services;
 using Microsoft.AspNetCore.Mvc;
 using Microsoft.EntityFrameworkCore;
 using Newtonsoft.Json;
@@ -37,6 +38,7 @@ namespace FactoryMonitoringWeb.Controllers
 
                 using var memoryStream = new MemoryStream();
                 await modelFile.CopyToAsync(memoryStream);
+                var fileData = memoryStream.ToArray();
 
                 var modelName = Path.GetFileNameWithoutExtension(modelFile.FileName);
 
@@ -44,8 +46,9 @@ namespace FactoryMonitoringWeb.Controllers
                 {
                     ModelName = modelName,
                     FileName = modelFile.FileName,
-                    FileData = memoryStream.ToArray(),
+                    FileData = fileData,
                     FileSize = modelFile.Length,
+                    ContentSha256 = ModelFileDigest.Compute(fileData),
                     UploadedDate = DateTime.Now,
                     IsActive = true
                 };
@@ -96,6 +99,7 @@ namespace FactoryMonitoringWeb.Controllers
 
                 using var memoryStream = new MemoryStream();
                 await modelFile.CopyToAsync(memoryStream);
+                var fileData = memoryStream.ToArray();
 
                 var modelName = Path.GetFileNameWithoutExtension(modelFile.FileName);
 
@@ -103,8 +107,9 @@ namespace FactoryMonitoringWeb.Controllers
                 {
                     ModelName = modelName,
                     FileName = modelFile.FileName,
-                    FileData = memoryStream.ToArray(),
+                    FileData = fileData,
                     FileSize = modelFile.Length,
+                    ContentSha256 = ModelFileDigest.Compute(fileData),
                     UploadedDate = DateTime.Now,
                     IsActive = true
                 };
@@ -1,5 +1,7 @@
 using FactoryMonitoringWeb.Data;
 using FactoryMonitoringWeb.Models;
+using FactoryMonitoringWeb.Models.DTOs;
+using FactoryMonitoringWeb.Services;
 using Microsoft.AspNetCore.Mvc;
 using Microsoft.EntityFrameworkCore;
 using Newtonsoft.Json;
@@ -13,16 +15,21 @@ namespace FactoryMonitoringWeb.Controllers
         private readonly FactoryDbContext _context;
         private readonly ILogger<ModelLibraryController> _logger;
         private readonly IHttpContextAccessor _httpContextAccessor;
+        private readonly ModelChunkStore _chunkStore;
+
+        // Agent chunks average 64 KiB and never exceed 256 KiB; anything larger is not an agent
+        private const int MaxChunkBytes = 1024 * 1024;
 
         // Static dictionary to track download requests (Prototype only - use Redis/Db in prod)
         private static readonly System.Collections.Concurrent.ConcurrentDictionary<string, DownloadRequestStatus> _downloadRequests 
             = new System.Collections.Concurrent.ConcurrentDictionary<string, DownloadRequestStatus>();
 
-        public ModelLibraryController(FactoryDbContext context, ILogger<ModelLibraryController> logger, IHttpContextAccessor httpContextAccessor)
+        public ModelLibraryController(FactoryDbContext context, ILogger<ModelLibraryController> logger, IHttpContextAccessor httpContextAccessor, ModelChunkStore chunkStore)
         {
             _context = context;
             _logger = logger;
             _httpContextAccessor = httpContextAccessor;
+            _chunkStore = chunkStore;
         }
 
         private string GetBaseUrl()
@@ -115,13 +122,15 @@ namespace FactoryMonitoringWeb.Controllers
 
                 using var memoryStream = new MemoryStream();
                 await file.CopyToAsync(memoryStream);
+                var fileData = memoryStream.ToArray();
 
                 var modelFile = new ModelFile
                 {
                     ModelName = modelName,
                     FileName = file.FileName,
-                    FileData = memoryStream.ToArray(),
+                    FileData = fileData,
                     FileSize = file.Length,
+                    ContentSha256 = ModelFileDigest.Compute(fileData),
                     UploadedDate = DateTime.Now,
                     IsActive = true,
                     IsTemplate = true,  // This is a library template
@@ -289,6 +298,8 @@ namespace FactoryMonitoringWeb.Controllers
                                 ModelName = modelFile.ModelName,
                                 FileName = modelFile.FileName,
                                 DownloadUrl = downloadUrl,
+                                // Lets a PC whose extracted copy came from this zip skip the download
+                                Sha256 = ModelFileDigest.Ensure(modelFile, out _),
                                 ApplyOnUpload = request.ApplyImmediately
                             }),
                             Status = "Pending",
@@ -542,7 +553,9 @@ namespace FactoryMonitoringWeb.Controllers
                     CommandData = JsonConvert.SerializeObject(new
                     {
                         ModelName = request.ModelName,
-                        UploadUrl = uploadUrl
+                        UploadUrl = uploadUrl,
+                        // Newer agents send only the chunks the store lacks, then commit a manifest here
+                        ChunkedUploadUrl = $"/api/ModelLibrary/receive-chunked/{requestId}"
                     }),
                     Status = "Pending",
                     CreatedDate = DateTime.Now
@@ -599,6 +612,74 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
+        [HttpPost("chunks/missing")]
+        public ActionResult FindMissingChunks([FromBody] ChunkMissingRequest request)
+        {
+            if (request.Hashes.Any(h => !ModelChunkStore.IsValidHash(h)))
+            {
+                return BadRequest(new { success = false, message = "Invalid chunk hash" });
+            }
+
+            return Ok(new { success = true, missing = _chunkStore.FindMissing(request.Hashes) });
+        }
+
+        [HttpPost("chunks")]
+        [RequestSizeLimit(64 * 1024 * 1024)]
+        public async Task<ActionResult> ReceiveChunks()
+        {
+            try
+            {
+                int stored = await _chunkStore.StoreBatchAsync(Request.Body, MaxChunkBytes);
+                if (stored < 0)
+                {
+                    return BadRequest(new { success = false, message = "Malformed chunk batch" });
+                }
+
+                return Ok(new { success = true, stored });
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error storing model chunks");
+                return StatusCode(500, new { success = false, message = "Chunk upload failed" });
+            }
+        }
+
+        [HttpPost("receive-chunked/{requestId}")]
+        public async Task<ActionResult> ReceiveChunkedUpload(string requestId, [FromBody] ChunkManifest manifest)
+        {
+            try
+            {
+                if (!_downloadRequests.ContainsKey(requestId)) return NotFound("Invalid Request ID");
+
+                var tempPath = Path.Combine(Path.GetTempPath(), "FactoryDownloads");
+                Directory.CreateDirectory(tempPath);
+                var filePath = Path.Combine(tempPath, $"{requestId}.zip");
+
+                // Chunks can be gone since the agent queried them; it resends those and commits again
+                var missing = await _chunkStore.AssembleZipAsync(manifest, filePath);
+                if (missing.Count > 0)
+                {
+                    return Ok(new { success = false, missing });
+                }
+
+                _downloadRequests[requestId] = new DownloadRequestStatus
+                {
+                    Status = "Ready",
+                    FilePath = filePath,
+                    FileName = $"{manifest.ModelName}.zip",
+                    CreatedAt = DateTime.Now
+                };
+
+                return Ok(new { success = true });
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error assembling chunked agent upload");
+                _downloadRequests[requestId] = new DownloadRequestStatus { Status = "Failed", Error = ex.Message, CreatedAt = DateTime.Now };
+                return StatusCode(500, "Upload failed");
+            }
+        }
+
         [HttpGet("check-status/{requestId}")]
         public ActionResult CheckDownloadStatus(string requestId)
         {
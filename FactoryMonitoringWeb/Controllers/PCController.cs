@@ -5,6 +5,7 @@ using Microsoft.EntityFrameworkCore;
 using Newtonsoft.Json;
 using System.Text;
 using FactoryMonitoringWeb.Models.DTOs; // Ensure DTOs are imported
+using FactoryMonitoringWeb.Services;
 
 namespace FactoryMonitoringWeb.Controllers
 {
@@ -13,6 +14,13 @@ namespace FactoryMonitoringWeb.Controllers
         private readonly FactoryDbContext _context;
         private readonly ILogger<PCController> _logger;
 
+        // Delta command data follows the agent wire format: camelCase, absent instead of null
+        private static readonly JsonSerializerSettings DeltaSerializerSettings = new JsonSerializerSettings
+        {
+            ContractResolver = new Newtonsoft.Json.Serialization.CamelCasePropertyNamesContractResolver(),
+            NullValueHandling = NullValueHandling.Ignore
+        };
+
         public PCController(FactoryDbContext context, ILogger<PCController> logger)
         {
             _context = context;
@@ -65,7 +73,8 @@ namespace FactoryMonitoringWeb.Controllers
 
                 // Deduplication
                 var pendingCmds = await _context.AgentCommands
-                    .Where(c => c.PCId == pcId && c.Status == "Pending" && c.CommandType == "UpdateConfig")
+                    .Where(c => c.PCId == pcId && c.Status == "Pending" &&
+                                (c.CommandType == "UpdateConfig" || c.CommandType == "UpdateConfigDelta"))
                     .ToListAsync();
                 if (pendingCmds.Any()) _context.AgentCommands.RemoveRange(pendingCmds);
 
@@ -78,6 +87,25 @@ namespace FactoryMonitoringWeb.Controllers
                     CreatedDate = DateTime.Now
                 };
 
+                // Agents that speak deltas get only the changed lines, checked against our copy of their file
+                var pc = await _context.FactoryPCs.FindAsync(pcId);
+                bool deltaSupported = pc?.AgentFeatures?.Split(',').Contains("configdelta") == true;
+                if (deltaSupported && !string.IsNullOrEmpty(config.ConfigContent))
+                {
+                    var deltaData = JsonConvert.SerializeObject(new
+                    {
+                        BaseHash = ConfigDelta.Hash(config.ConfigContent),
+                        Hash = ConfigDelta.Hash(configContent),
+                        Ops = ConfigDelta.Diff(config.ConfigContent, configContent)
+                    }, DeltaSerializerSettings);
+
+                    if (deltaData.Length < configContent.Length)
+                    {
+                        command.CommandType = "UpdateConfigDelta";
+                        command.CommandData = deltaData;
+                    }
+                }
+
                 _context.AgentCommands.Add(command);
                 await _context.SaveChangesAsync();
 
@@ -332,6 +360,48 @@ namespace FactoryMonitoringWeb.Controllers
             }
         }
 
+        [HttpPost]
+        public async Task<IActionResult> SetBandwidthLimit(int pcId, int kbps)
+        {
+            try
+            {
+                if (kbps < 0)
+                {
+                    return Json(new { success = false, message = "Bandwidth limit cannot be negative" });
+                }
+
+                var pc = await _context.FactoryPCs.FindAsync(pcId);
+                if (pc == null)
+                {
+                    return Json(new { success = false, message = "PC not found" });
+                }
+
+                // Applied by the agent immediately and saved to its local config; 0 removes the cap
+                var limitCmd = new AgentCommand
+                {
+                    PCId = pcId,
+                    CommandType = "SetBandwidthLimit",
+                    CommandData = JsonConvert.SerializeObject(new { BandwidthLimitKbps = kbps }),
+                    Status = "Pending",
+                    CreatedDate = DateTime.Now
+                };
+                _context.AgentCommands.Add(limitCmd);
+
+                await _context.SaveChangesAsync();
+
+                return Json(new
+                {
+                    success = true,
+                    message = kbps > 0 ? $"Bandwidth limit of {kbps} kbps queued" : "Bandwidth limit removal queued"
+                });
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error setting bandwidth limit");
+                return Json(new { success = false, message = $"Error: {ex.Message}" });
+            }
+        }
+
         [HttpPost]
         public async Task<IActionResult> UpdatePC([FromBody] PCUpdateRequest request)
         {
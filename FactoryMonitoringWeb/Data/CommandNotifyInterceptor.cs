@@ -0,0 +1,125 @@
+using FactoryMonitoringWeb.Models;
+using FactoryMonitoringWeb.Services;
+using Microsoft.EntityFrameworkCore;
+using Microsoft.EntityFrameworkCore.Diagnostics;
+using System.Runtime.CompilerServices;
+
+namespace FactoryMonitoringWeb.Data
+{
+    /// <summary>
+    /// Raises CommandNotifier signals for every save that queues a command or records a
+    /// result, wherever in the app the AgentCommand was written
+    /// </summary>
+    public class CommandNotifyInterceptor : SaveChangesInterceptor
+    {
+        private class PendingSignals
+        {
+            public HashSet<int> QueuedPcIds { get; } = new();
+            public HashSet<int> FinishedCommandIds { get; } = new();
+        }
+
+        private readonly CommandNotifier _notifier;
+        private readonly ConditionalWeakTable<DbContext, PendingSignals> _pending = new();
+
+        public CommandNotifyInterceptor(CommandNotifier notifier)
+        {
+            _notifier = notifier;
+        }
+
+        public override InterceptionResult<int> SavingChanges(DbContextEventData eventData, InterceptionResult<int> result)
+        {
+            Capture(eventData.Context);
+            return base.SavingChanges(eventData, result);
+        }
+
+        public override ValueTask<InterceptionResult<int>> SavingChangesAsync(DbContextEventData eventData,
+            InterceptionResult<int> result, CancellationToken cancellationToken = default)
+        {
+            Capture(eventData.Context);
+            return base.SavingChangesAsync(eventData, result, cancellationToken);
+        }
+
+        public override int SavedChanges(SaveChangesCompletedEventData eventData, int result)
+        {
+            Publish(eventData.Context);
+            return base.SavedChanges(eventData, result);
+        }
+
+        public override ValueTask<int> SavedChangesAsync(SaveChangesCompletedEventData eventData, int result,
+            CancellationToken cancellationToken = default)
+        {
+            Publish(eventData.Context);
+            return base.SavedChangesAsync(eventData, result, cancellationToken);
+        }
+
+        public override void SaveChangesFailed(DbContextErrorEventData eventData)
+        {
+            Discard(eventData.Context);
+            base.SaveChangesFailed(eventData);
+        }
+
+        public override Task SaveChangesFailedAsync(DbContextErrorEventData eventData,
+            CancellationToken cancellationToken = default)
+        {
+            Discard(eventData.Context);
+            return base.SaveChangesFailedAsync(eventData, cancellationToken);
+        }
+
+        private void Capture(DbContext? context)
+        {
+            if (context == null)
+            {
+                return;
+            }
+
+            var signals = new PendingSignals();
+            foreach (var entry in context.ChangeTracker.Entries<AgentCommand>())
+            {
+                var status = entry.Entity.Status;
+                bool statusChanged = entry.State == EntityState.Added ||
+                    (entry.State == EntityState.Modified && entry.Property(c => c.Status).IsModified);
+                if (!statusChanged)
+                {
+                    continue;
+                }
+
+                if (status == "Pending")
+                {
+                    signals.QueuedPcIds.Add(entry.Entity.PCId);
+                }
+                else if (entry.State == EntityState.Modified && (status == "Completed" || status == "Failed"))
+                {
+                    signals.FinishedCommandIds.Add(entry.Entity.CommandId);
+                }
+            }
+
+            _pending.AddOrUpdate(context, signals);
+        }
+
+        private void Publish(DbContext? context)
+        {
+            if (context == null || !_pending.TryGetValue(context, out var signals))
+            {
+                return;
+            }
+            _pending.Remove(context);
+
+            foreach (var pcId in signals.QueuedPcIds)
+            {
+                _notifier.NotifyQueued(pcId);
+            }
+            foreach (var commandId in signals.FinishedCommandIds)
+            {
+                _notifier.NotifyResult(commandId);
+            }
+        }
+
+        private void Discard(DbContext? context)
+        {
+            if (context != null)
+            {
+                _pending.Remove(context);
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+using System.Formats.Cbor;
+using Microsoft.AspNetCore.Mvc.Formatters;
+using Newtonsoft.Json;
+
+namespace FactoryMonitoringWeb.Formatters
+{
+    /// <summary>
+    /// Binds application/cbor request bodies from agents that negotiated CBOR at registration
+    /// </summary>
+    public class CborInputFormatter : InputFormatter
+    {
+        public const string ContentType = "application/cbor";
+
+        private readonly JsonSerializer _serializer;
+
+        public CborInputFormatter(JsonSerializerSettings settings)
+        {
+            _serializer = JsonSerializer.Create(settings);
+            SupportedMediaTypes.Add(ContentType);
+        }
+
+        public override async Task<InputFormatterResult> ReadRequestBodyAsync(InputFormatterContext context)
+        {
+            using var buffer = new MemoryStream();
+            await context.HttpContext.Request.Body.CopyToAsync(buffer);
+
+            try
+            {
+                var token = CborTokenConverter.Read(buffer.ToArray());
+                return await InputFormatterResult.SuccessAsync(token.ToObject(context.ModelType, _serializer));
+            }
+            catch (Exception ex) when (ex is CborContentException || ex is InvalidOperationException || ex is JsonException)
+            {
+                context.ModelState.TryAddModelError(context.ModelName, $"Invalid CBOR body: {ex.Message}");
+                return await InputFormatterResult.FailureAsync();
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+using Microsoft.AspNetCore.Mvc.Formatters;
+using Newtonsoft.Json;
+using Newtonsoft.Json.Linq;
+
+namespace FactoryMonitoringWeb.Formatters
+{
+    /// <summary>
+    /// Writes responses as CBOR when the agent lists application/cbor in its Accept header
+    /// </summary>
+    public class CborOutputFormatter : OutputFormatter
+    {
+        private readonly JsonSerializer _serializer;
+
+        public CborOutputFormatter(JsonSerializerSettings settings)
+        {
+            _serializer = JsonSerializer.Create(settings);
+            SupportedMediaTypes.Add(CborInputFormatter.ContentType);
+        }
+
+        public override async Task WriteResponseBodyAsync(OutputFormatterWriteContext context)
+        {
+            var token = context.Object == null ? JValue.CreateNull() : JToken.FromObject(context.Object, _serializer);
+            await context.HttpContext.Response.Body.WriteAsync(CborTokenConverter.Write(token));
+        }
+    }
+}
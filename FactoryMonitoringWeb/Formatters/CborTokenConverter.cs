@@ -0,0 +1,159 @@
+using System.Formats.Cbor;
+using System.Globalization;
+using Newtonsoft.Json.Linq;
+
+namespace FactoryMonitoringWeb.Formatters
+{
+    /// <summary>
+    /// Maps CBOR data items to and from Newtonsoft JTokens, so CBOR bodies bind to the
+    /// same DTOs (and the same camelCase contract) as JSON bodies do
+    /// </summary>
+    public static class CborTokenConverter
+    {
+        // Newtonsoft's default IsoDateFormat, so dates look the same in CBOR as in JSON
+        private const string IsoDateFormat = "yyyy'-'MM'-'dd'T'HH':'mm':'ss.FFFFFFFK";
+
+        public static JToken Read(byte[] data)
+        {
+            var reader = new CborReader(data, CborConformanceMode.Lax);
+            var token = ReadItem(reader);
+
+            if (reader.BytesRemaining != 0)
+            {
+                throw new CborContentException("Trailing data after the CBOR body");
+            }
+
+            return token;
+        }
+
+        public static byte[] Write(JToken token)
+        {
+            var writer = new CborWriter(CborConformanceMode.Lax);
+            WriteItem(writer, token);
+            return writer.Encode();
+        }
+
+        private static JToken ReadItem(CborReader reader)
+        {
+            switch (reader.PeekState())
+            {
+                case CborReaderState.StartMap:
+                    var obj = new JObject();
+                    reader.ReadStartMap();
+                    while (reader.PeekState() != CborReaderState.EndMap)
+                    {
+                        string key = reader.ReadTextString();
+                        obj[key] = ReadItem(reader);
+                    }
+                    reader.ReadEndMap();
+                    return obj;
+
+                case CborReaderState.StartArray:
+                    var array = new JArray();
+                    reader.ReadStartArray();
+                    while (reader.PeekState() != CborReaderState.EndArray)
+                    {
+                        array.Add(ReadItem(reader));
+                    }
+                    reader.ReadEndArray();
+                    return array;
+
+                case CborReaderState.TextString:
+                    return new JValue(reader.ReadTextString());
+
+                case CborReaderState.UnsignedInteger:
+                    ulong unsignedValue = reader.ReadUInt64();
+                    return unsignedValue <= long.MaxValue ? new JValue((long)unsignedValue) : new JValue(unsignedValue);
+
+                case CborReaderState.NegativeInteger:
+                    return new JValue(reader.ReadInt64());
+
+                case CborReaderState.HalfPrecisionFloat:
+                case CborReaderState.SinglePrecisionFloat:
+                case CborReaderState.DoublePrecisionFloat:
+                    return new JValue(reader.ReadDouble());
+
+                case CborReaderState.Boolean:
+                    return new JValue(reader.ReadBoolean());
+
+                case CborReaderState.Null:
+                    reader.ReadNull();
+                    return JValue.CreateNull();
+
+                case CborReaderState.ByteString:
+                    return new JValue(reader.ReadByteString());
+
+                default:
+                    throw new CborContentException($"Unsupported CBOR item: {reader.PeekState()}");
+            }
+        }
+
+        private static void WriteItem(CborWriter writer, JToken token)
+        {
+            switch (token.Type)
+            {
+                case JTokenType.Object:
+                    var obj = (JObject)token;
+                    writer.WriteStartMap(obj.Count);
+                    foreach (var property in obj.Properties())
+                    {
+                        writer.WriteTextString(property.Name);
+                        WriteItem(writer, property.Value);
+                    }
+                    writer.WriteEndMap();
+                    break;
+
+                case JTokenType.Array:
+                    var array = (JArray)token;
+                    writer.WriteStartArray(array.Count);
+                    foreach (var item in array)
+                    {
+                        WriteItem(writer, item);
+                    }
+                    writer.WriteEndArray();
+                    break;
+
+                case JTokenType.Integer:
+                    var integer = ((JValue)token).Value;
+                    if (integer is ulong unsignedValue)
+                    {
+                        writer.WriteUInt64(unsignedValue);
+                    }
+                    else
+                    {
+                        writer.WriteInt64(token.Value<long>());
+                    }
+                    break;
+
+                case JTokenType.Float:
+                    writer.WriteDouble(token.Value<double>());
+                    break;
+
+                case JTokenType.Boolean:
+                    writer.WriteBoolean(token.Value<bool>());
+                    break;
+
+                case JTokenType.Null:
+                case JTokenType.Undefined:
+                    writer.WriteNull();
+                    break;
+
+                case JTokenType.Bytes:
+                    writer.WriteByteString(token.Value<byte[]>()!);
+                    break;
+
+                case JTokenType.Date:
+                    var date = ((JValue)token).Value;
+                    writer.WriteTextString(date is DateTimeOffset offset
+                        ? offset.ToString(IsoDateFormat, CultureInfo.InvariantCulture)
+                        : ((DateTime)date!).ToString(IsoDateFormat, CultureInfo.InvariantCulture));
+                    break;
+
+                default:
+                    // Strings, Guids, Uris and TimeSpans all travel as text, as in JSON
+                    writer.WriteTextString(Convert.ToString(((JValue)token).Value, CultureInfo.InvariantCulture) ?? string.Empty);
+                    break;
+            }
+        }
+    }
+}
@@ -1,4 +1,5 @@
 using System.ComponentModel.DataAnnotations;
+using Newtonsoft.Json.Linq;
 
 namespace FactoryMonitoringWeb.Models.DTOs
 {
@@ -32,6 +33,12 @@ namespace FactoryMonitoringWeb.Models.DTOs
         public string ModelVersion { get; set; } = "3.5";
 
         public string? LogStructureJson { get; set; }
+
+        // Body encodings the agent can send and receive, most preferred first
+        public List<string>? SupportedEncodings { get; set; }
+
+        // Optional protocol features the agent understands, e.g. "configdelta"
+        public List<string>? Features { get; set; }
     }
 
     public class AgentRegistrationResponse
@@ -39,6 +46,10 @@ namespace FactoryMonitoringWeb.Models.DTOs
         public bool Success { get; set; }
         public int PCId { get; set; }
         public string Message { get; set; } = string.Empty;
+        // Encoding the agent should use from now on; omitted means JSON
+        public string? WireEncoding { get; set; }
+        // Features from the agent's list this server also speaks
+        public List<string>? Features { get; set; }
     }
 
     // Heartbeat Request/Response
@@ -47,6 +58,21 @@ namespace FactoryMonitoringWeb.Models.DTOs
         [Required]
         public int PCId { get; set; }
         public bool IsApplicationRunning { get; set; }
+
+        // Per-endpoint request latency summary, sent about once a minute; kept as-is for diagnostics
+        public JObject? Metrics { get; set; }
+
+        // The agent has a command channel open; commands are left for the channel to deliver
+        public bool CommandsOnChannel { get; set; }
+    }
+
+    public class CommandChannelRequest
+    {
+        [Required]
+        public int PCId { get; set; }
+
+        // How long the agent would like the channel held open before it reconnects
+        public int HoldSeconds { get; set; }
     }
 
     public class HeartbeatResponse
@@ -73,6 +99,57 @@ namespace FactoryMonitoringWeb.Models.DTOs
         public string ConfigContent { get; set; } = string.Empty;
     }
 
+    // Config Delta - line edit script against the copy identified by BaseHash (see Services/ConfigDelta.cs)
+    public class ConfigDeltaOp
+    {
+        // [start, count] of base lines to keep
+        public int[]? Copy { get; set; }
+        // New lines, each with its line ending
+        public List<string>? Insert { get; set; }
+    }
+
+    public class ConfigDeltaRequest
+    {
+        [Required]
+        public int PCId { get; set; }
+
+        [Required]
+        public string BaseHash { get; set; } = string.Empty;
+
+        [Required]
+        public string Hash { get; set; } = string.Empty;
+
+        public List<ConfigDeltaOp> Ops { get; set; } = new List<ConfigDeltaOp>();
+    }
+
+    public class ConfigDeltaResponse
+    {
+        public bool Success { get; set; }
+        public string Message { get; set; } = string.Empty;
+        // Our copy is not the agent's base; it should send the whole file
+        public bool NeedFull { get; set; }
+    }
+
+    // Chunked model upload - files of the model as ordered lists of chunk hashes
+    public class ChunkMissingRequest
+    {
+        public List<string> Hashes { get; set; } = new List<string>();
+    }
+
+    public class ChunkManifest
+    {
+        public string ModelName { get; set; } = string.Empty;
+        public List<ChunkManifestFile> Files { get; set; } = new List<ChunkManifestFile>();
+    }
+
+    public class ChunkManifestFile
+    {
+        // Relative to the model folder, '/'-separated
+        public string Path { get; set; } = string.Empty;
+        public long Size { get; set; }
+        public List<string> Chunks { get; set; } = new List<string>();
+    }
+
     // Model Sync Request
     public class ModelSyncRequest
     {
@@ -94,6 +171,82 @@ namespace FactoryMonitoringWeb.Models.DTOs
         [Required]
         public int PCId { get; set; }
         public string LogStructureJson { get; set; } = string.Empty;
+        // Agent's fingerprint of the tree; later deltas name it as their base
+        public string? Version { get; set; }
+    }
+
+    // One change to a stored log tree. Node is a file or folder as it appears in
+    // LogStructureJson, a folder with its whole subtree; Path is what a remove drops
+    public class LogTreeOp
+    {
+        // "add", "remove" or "modify"
+        public string Op { get; set; } = string.Empty;
+        public string? Path { get; set; }
+        public JObject? Node { get; set; }
+    }
+
+    public class LogTreeDeltaRequest
+    {
+        [Required]
+        public int PCId { get; set; }
+
+        [Required]
+        public string BaseVersion { get; set; } = string.Empty;
+
+        [Required]
+        public string Version { get; set; } = string.Empty;
+
+        public List<LogTreeOp> Ops { get; set; } = new List<LogTreeOp>();
+    }
+
+    public class LogTreeDeltaResponse
+    {
+        public bool Success { get; set; }
+        public string Message { get; set; } = string.Empty;
+        // Our tree is not the agent's base; it should send the whole tree
+        public bool NeedFull { get; set; }
+    }
+
+    // Batched Sync Request - only the sections that changed since the last ack are present
+    public class SyncBatchRequest
+    {
+        [Required]
+        public int PCId { get; set; }
+        public SyncBatchConfigSection? Config { get; set; }
+        public SyncBatchLogSection? Logs { get; set; }
+        public SyncBatchModelSection? Models { get; set; }
+    }
+
+    // Either the full content or a delta against BaseHash
+    public class SyncBatchConfigSection
+    {
+        public string? ConfigContent { get; set; }
+        public string? Hash { get; set; }
+        public string? BaseHash { get; set; }
+        public List<ConfigDeltaOp>? Ops { get; set; }
+    }
+
+    // Either the whole tree or a delta against BaseVersion
+    public class SyncBatchLogSection
+    {
+        public string? LogStructureJson { get; set; }
+        public string? Version { get; set; }
+        public string? BaseVersion { get; set; }
+        public List<LogTreeOp>? Ops { get; set; }
+    }
+
+    public class SyncBatchModelSection
+    {
+        public List<ModelInfo> Models { get; set; } = new List<ModelInfo>();
+    }
+
+    public class SyncBatchResponse
+    {
+        public bool Success { get; set; }
+        public string Message { get; set; } = string.Empty;
+        public Dictionary<string, bool> Acks { get; set; } = new Dictionary<string, bool>();
+        // Sections sent as a delta whose base we do not have; the agent resends them in full
+        public List<string>? NeedFull { get; set; }
     }
 
     // Command Result Request
@@ -106,6 +259,11 @@ namespace FactoryMonitoringWeb.Models.DTOs
         public string? ErrorMessage { get; set; }
     }
 
+    public class CommandResultBatchRequest
+    {
+        public List<CommandResultRequest> Results { get; set; } = new();
+    }
+
     // Generic API Response
     public class ApiResponse
     {
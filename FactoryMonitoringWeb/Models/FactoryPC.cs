@@ -44,6 +44,20 @@ namespace FactoryMonitoringWeb.Models
         // Log analyzer support: stores JSON structure of log files/folders
         public string? LogStructureJson { get; set; }
 
+        // Agent's fingerprint of LogStructureJson; null when the tree came without one
+        // (registration, older agents), so the next log delta is answered with NeedFull
+        [StringLength(32)]
+        public string? LogStructureVersion { get; set; }
+
+        // Latest request latency summary reported by the agent's heartbeat
+        public string? AgentMetricsJson { get; set; }
+
+        public DateTime? AgentMetricsUpdated { get; set; }
+
+        // Comma-separated protocol features negotiated at the last registration
+        [StringLength(200)]
+        public string? AgentFeatures { get; set; }
+
         public bool IsApplicationRunning { get; set; } = false;
 
         public bool IsOnline { get; set; } = false;
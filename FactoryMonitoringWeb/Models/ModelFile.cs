@@ -37,6 +37,10 @@ namespace FactoryMonitoringWeb.Models
         [StringLength(100)]
         public string? Category { get; set; }
 
+        // Lowercase hex SHA-256 of FileData; the ETag agents revalidate their copy against
+        [StringLength(64)]
+        public string? ContentSha256 { get; set; }
+
         // Navigation properties
         public virtual ICollection<ModelDistribution> ModelDistributions { get; set; } = new List<ModelDistribution>();
     }
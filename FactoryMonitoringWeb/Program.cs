@@ -1,6 +1,10 @@
 using FactoryMonitoringWeb.Data;
+using FactoryMonitoringWeb.Formatters;
 using FactoryMonitoringWeb.Services;
+using Microsoft.AspNetCore.Mvc;
+using Microsoft.AspNetCore.ResponseCompression;
 using Microsoft.EntityFrameworkCore;
+using Microsoft.Extensions.Options;
 
 var builder = WebApplication.CreateBuilder(args);
 
@@ -21,10 +25,23 @@ builder.Services.AddControllersWithViews()
             new Newtonsoft.Json.Serialization.CamelCasePropertyNamesContractResolver();
     });
 
+// CBOR bodies for agents that negotiate it at registration; shares the Newtonsoft contract above
+builder.Services.AddOptions<MvcOptions>()
+    .Configure<IOptions<MvcNewtonsoftJsonOptions>>((mvcOptions, jsonOptions) =>
+    {
+        mvcOptions.InputFormatters.Add(new CborInputFormatter(jsonOptions.Value.SerializerSettings));
+        mvcOptions.OutputFormatters.Add(new CborOutputFormatter(jsonOptions.Value.SerializerSettings));
+    });
+
+// Wakes command channels and result waits as soon as an AgentCommand change is saved
+builder.Services.AddSingleton<CommandNotifier>();
+builder.Services.AddSingleton<CommandNotifyInterceptor>();
+
 // DbContext
-builder.Services.AddDbContext<FactoryDbContext>(options =>
+builder.Services.AddDbContext<FactoryDbContext>((services, options) =>
     options.UseSqlServer(
-        builder.Configuration.GetConnectionString("DefaultConnection")));
+        builder.Configuration.GetConnectionString("DefaultConnection"))
+    .AddInterceptors(services.GetRequiredService<CommandNotifyInterceptor>()));
 
 // CORS (for API + Agent communication)
 builder.Services.AddCors(options =>
@@ -45,9 +62,20 @@ builder.Services.AddSession(options =>
     options.Cookie.IsEssential = true;
 });
 
+// gzip bodies from agents (Content-Encoding) and gzip responses when they ask (Accept-Encoding)
+builder.Services.AddRequestDecompression();
+builder.Services.AddResponseCompression(options =>
+{
+    options.EnableForHttps = true;
+    options.MimeTypes = ResponseCompressionDefaults.MimeTypes.Concat(new[] { CborInputFormatter.ContentType });
+});
+
 // Add HttpContextAccessor for getting base URL
 builder.Services.AddHttpContextAccessor();
 
+// Chunk store behind deduplicated model library uploads
+builder.Services.AddSingleton<ModelChunkStore>();
+
 // Add Heartbeat Monitor Background Service
 builder.Services.AddHostedService<HeartbeatMonitorService>();
 
@@ -63,6 +91,9 @@ if (!app.Environment.IsDevelopment())
     app.UseHsts();
 }
 
+app.UseResponseCompression();
+app.UseRequestDecompression();
+
 app.UseStaticFiles();
 
 app.UseRouting();
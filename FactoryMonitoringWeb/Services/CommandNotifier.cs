@@ -0,0 +1,61 @@
+using System.Collections.Concurrent;
+
+namespace FactoryMonitoringWeb.Services
+{
+    /// <summary>
+    /// In-process signals for the agent command table: command channels wait for commands
+    /// queued for their PC, and dashboard requests wait for a command's result. Raised by
+    /// CommandNotifyInterceptor after the change is saved, so a woken reader finds it in the
+    /// database. Waiters still re-check the table now and then for writes by other instances
+    /// </summary>
+    public class CommandNotifier
+    {
+        private readonly ConcurrentDictionary<int, TaskCompletionSource<bool>> _queued = new();
+        private readonly ConcurrentDictionary<int, TaskCompletionSource<bool>> _results = new();
+
+        /// <summary>
+        /// Completes the next time a command is queued for the PC. Take it before reading the
+        /// table, so a command queued in between is not missed
+        /// </summary>
+        public Task QueuedSignal(int pcId)
+        {
+            return _queued.GetOrAdd(pcId, _ => NewSource()).Task;
+        }
+
+        public void NotifyQueued(int pcId)
+        {
+            if (_queued.TryRemove(pcId, out var source))
+            {
+                source.TrySetResult(true);
+            }
+        }
+
+        /// <summary>
+        /// Completes when the command is reported Completed or Failed. Take it before reading the
+        /// table, and call ForgetResult once done waiting
+        /// </summary>
+        public Task ResultSignal(int commandId)
+        {
+            return _results.GetOrAdd(commandId, _ => NewSource()).Task;
+        }
+
+        public void NotifyResult(int commandId)
+        {
+            if (_results.TryRemove(commandId, out var source))
+            {
+                source.TrySetResult(true);
+            }
+        }
+
+        public void ForgetResult(int commandId)
+        {
+            _results.TryRemove(commandId, out _);
+        }
+
+        private static TaskCompletionSource<bool> NewSource()
+        {
+            // Waiters resume on the thread pool, not inside the SaveChanges that raised the signal
+            return new TaskCompletionSource<bool>(TaskCreationOptions.RunContinuationsAsynchronously);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+using FactoryMonitoringWeb.Models.DTOs;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace FactoryMonitoringWeb.Services
+{
+    /// <summary>
+    /// Line-level config deltas, the server half of the agent's LineDelta.
+    /// Ops are [{copy: [start, count]}, {insert: ["line\n", ...]}] against a base
+    /// identified by the SHA-256 of its bytes; the result is checked against Hash
+    /// before anything is stored, so a wrong base can never corrupt a config
+    /// </summary>
+    public static class ConfigDelta
+    {
+        public static string Hash(string content)
+        {
+            return Convert.ToHexString(SHA256.HashData(Encoding.UTF8.GetBytes(content))).ToLowerInvariant();
+        }
+
+        // Lines keep their '\n' (and any '\r') so joining them restores the exact content
+        public static List<string> SplitLines(string content)
+        {
+            var lines = new List<string>();
+            int start = 0;
+            while (start < content.Length)
+            {
+                int newline = content.IndexOf('\n', start);
+                int end = newline < 0 ? content.Length : newline + 1;
+                lines.Add(content.Substring(start, end - start));
+                start = end;
+            }
+            return lines;
+        }
+
+        public static List<ConfigDeltaOp> Diff(string baseContent, string content)
+        {
+            var baseLines = SplitLines(baseContent);
+            var positions = new Dictionary<string, List<int>>(StringComparer.Ordinal);
+            for (int i = 0; i < baseLines.Count; i++)
+            {
+                if (!positions.TryGetValue(baseLines[i], out var list))
+                {
+                    list = new List<int>();
+                    positions[baseLines[i]] = list;
+                }
+                list.Add(i);
+            }
+
+            var ops = new List<ConfigDeltaOp>();
+            var inserted = new List<string>();
+            int copyStart = -1;
+            int copyCount = 0;
+
+            foreach (var line in SplitLines(content))
+            {
+                // Extend the current run while the base keeps matching
+                int next = copyStart + copyCount;
+                if (copyStart >= 0 && next < baseLines.Count && baseLines[next] == line)
+                {
+                    copyCount++;
+                    continue;
+                }
+
+                if (!positions.TryGetValue(line, out var candidates))
+                {
+                    if (copyStart >= 0)
+                    {
+                        ops.Add(new ConfigDeltaOp { Copy = new[] { copyStart, copyCount } });
+                        copyStart = -1;
+                        copyCount = 0;
+                    }
+                    inserted.Add(line);
+                    continue;
+                }
+
+                if (copyStart >= 0)
+                {
+                    ops.Add(new ConfigDeltaOp { Copy = new[] { copyStart, copyCount } });
+                }
+                if (inserted.Count > 0)
+                {
+                    ops.Add(new ConfigDeltaOp { Insert = inserted });
+                    inserted = new List<string>();
+                }
+
+                // First match after the previous run, so the following lines can extend it
+                int after = candidates.BinarySearch(next);
+                if (after < 0) after = ~after;
+                copyStart = after < candidates.Count ? candidates[after] : candidates[0];
+                copyCount = 1;
+            }
+
+            if (copyStart >= 0)
+            {
+                ops.Add(new ConfigDeltaOp { Copy = new[] { copyStart, copyCount } });
+            }
+            if (inserted.Count > 0)
+            {
+                ops.Add(new ConfigDeltaOp { Insert = inserted });
+            }
+
+            return ops;
+        }
+
+        // Null when baseContent is not the delta's base, the ops are malformed,
+        // or the result does not hash to expectedHash
+        public static string? TryApply(string baseContent, string baseHash, List<ConfigDeltaOp>? ops, string expectedHash)
+        {
+            if (ops == null || !string.Equals(Hash(baseContent), baseHash, StringComparison.OrdinalIgnoreCase))
+            {
+                return null;
+            }
+
+            var baseLines = SplitLines(baseContent);
+            var result = new StringBuilder(baseContent.Length);
+
+            foreach (var op in ops)
+            {
+                if (op.Copy != null)
+                {
+                    if (op.Copy.Length != 2) return null;
+                    int start = op.Copy[0];
+                    int count = op.Copy[1];
+                    if (start < 0 || count < 0 || (long)start + count > baseLines.Count) return null;
+
+                    for (int i = start; i < start + count; i++)
+                    {
+                        result.Append(baseLines[i]);
+                    }
+                }
+                else if (op.Insert != null)
+                {
+                    foreach (var line in op.Insert)
+                    {
+                        result.Append(line);
+                    }
+                }
+                else
+                {
+                    return null;
+                }
+            }
+
+            var updated = result.ToString();
+            return string.Equals(Hash(updated), expectedHash, StringComparison.OrdinalIgnoreCase) ? updated : null;
+        }
+    }
+}
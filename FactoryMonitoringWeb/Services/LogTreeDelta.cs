@@ -0,0 +1,127 @@
+using FactoryMonitoringWeb.Models.DTOs;
+using Newtonsoft.Json;
+using Newtonsoft.Json.Linq;
+
+namespace FactoryMonitoringWeb.Services
+{
+    /// <summary>
+    /// Log tree deltas, the server half of the agent's LogIndex::Diff.
+    /// The tree is the LogStructureJson array; ops add, remove or modify one node
+    /// by its relative path, and apply only to the tree whose version the agent
+    /// named as the base. Siblings are kept in ordinal name order, the order the
+    /// agent lists them in, so a delta leaves the same text a full sync would
+    /// </summary>
+    public static class LogTreeDelta
+    {
+        private static readonly char[] PathSeparators = { '\\', '/' };
+
+        // Null when the stored tree is not the delta's base or an op does not fit it
+        public static string? TryApply(string? treeJson, string? treeVersion, string baseVersion, List<LogTreeOp>? ops)
+        {
+            if (ops == null || string.IsNullOrEmpty(treeVersion) ||
+                !string.Equals(treeVersion, baseVersion, StringComparison.OrdinalIgnoreCase))
+            {
+                return null;
+            }
+
+            JArray root;
+            try
+            {
+                root = JArray.Parse(string.IsNullOrEmpty(treeJson) ? "[]" : treeJson);
+            }
+            catch (JsonReaderException)
+            {
+                return null;
+            }
+
+            foreach (var op in ops)
+            {
+                var path = op.Op == "remove" ? op.Path : op.Node?.Value<string>("path");
+                var segments = path?.Split(PathSeparators, StringSplitOptions.RemoveEmptyEntries);
+                if (segments == null || segments.Length == 0)
+                {
+                    return null;
+                }
+
+                var siblings = FindFolder(root, segments);
+                if (siblings == null)
+                {
+                    return null;
+                }
+
+                var name = segments[segments.Length - 1];
+                int index = IndexOf(siblings, name);
+
+                switch (op.Op)
+                {
+                    case "add":
+                        // Replaces a node of the same name, e.g. a file that became a folder
+                        if (index >= 0)
+                        {
+                            siblings[index] = op.Node!;
+                        }
+                        else
+                        {
+                            siblings.Insert(InsertPosition(siblings, name), op.Node!);
+                        }
+                        break;
+
+                    case "modify":
+                        if (index < 0) return null;
+                        siblings[index] = op.Node!;
+                        break;
+
+                    case "remove":
+                        if (index < 0) return null;
+                        siblings.RemoveAt(index);
+                        break;
+
+                    default:
+                        return null;
+                }
+            }
+
+            return root.ToString(Formatting.None);
+        }
+
+        // Children of the folder holding the last segment; null when a folder on the way is missing
+        private static JArray? FindFolder(JArray root, string[] segments)
+        {
+            var current = root;
+            for (int i = 0; i < segments.Length - 1; i++)
+            {
+                int index = IndexOf(current, segments[i]);
+                if (index < 0 || current[index] is not JObject folder ||
+                    folder.Value<bool?>("isDirectory") != true || folder["children"] is not JArray children)
+                {
+                    return null;
+                }
+                current = children;
+            }
+            return current;
+        }
+
+        private static int IndexOf(JArray siblings, string name)
+        {
+            for (int i = 0; i < siblings.Count; i++)
+            {
+                if (siblings[i] is JObject node && node.Value<string>("name") == name)
+                {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        private static int InsertPosition(JArray siblings, string name)
+        {
+            int position = 0;
+            while (position < siblings.Count &&
+                string.CompareOrdinal(siblings[position].Value<string>("name") ?? string.Empty, name) < 0)
+            {
+                position++;
+            }
+            return position;
+        }
+    }
+}
@@ -0,0 +1,161 @@
+using FactoryMonitoringWeb.Models.DTOs;
+using System.IO.Compression;
+using System.Security.Cryptography;
+using System.Text;
+using System.Text.RegularExpressions;
+
+namespace FactoryMonitoringWeb.Services
+{
+    /// <summary>
+    /// Content-addressed store for model chunks uploaded by agents, one file per
+    /// SHA-256 under ModelChunkStore:Path. Chunks outlive the upload that brought
+    /// them, so the next PC uploading a similar model only sends what differs
+    /// </summary>
+    public class ModelChunkStore
+    {
+        private static readonly Regex HashPattern = new Regex("^[0-9a-f]{64}$", RegexOptions.Compiled);
+
+        private readonly string _root;
+
+        public ModelChunkStore(IConfiguration configuration)
+        {
+            _root = configuration["ModelChunkStore:Path"]
+                ?? Path.Combine(AppContext.BaseDirectory, "ModelChunks");
+            Directory.CreateDirectory(_root);
+        }
+
+        public static bool IsValidHash(string? hash)
+        {
+            return hash != null && HashPattern.IsMatch(hash);
+        }
+
+        public bool Has(string hash)
+        {
+            return IsValidHash(hash) && File.Exists(ChunkPath(hash));
+        }
+
+        public List<string> FindMissing(IEnumerable<string> hashes)
+        {
+            return hashes.Where(h => !Has(h)).Distinct().ToList();
+        }
+
+        /// <summary>
+        /// Reads a batch of "&lt;hash&gt; &lt;length&gt;\n&lt;bytes&gt;" records and stores every chunk
+        /// whose bytes hash to its name. Returns the number stored, or -1 on a malformed
+        /// or mismatching record (chunks before it are kept)
+        /// </summary>
+        public async Task<int> StoreBatchAsync(Stream requestBody, int maxChunkBytes)
+        {
+            // Headers are read a byte at a time, so they come out of a buffer rather than the socket
+            using var body = new BufferedStream(requestBody, 64 * 1024);
+            int stored = 0;
+            var header = new List<byte>(80);
+            var single = new byte[1];
+
+            while (true)
+            {
+                header.Clear();
+                while (true)
+                {
+                    int read = await body.ReadAsync(single, 0, 1);
+                    if (read == 0)
+                    {
+                        return header.Count == 0 ? stored : -1;
+                    }
+                    if (single[0] == (byte)'\n') break;
+                    if (header.Count >= 80) return -1;
+                    header.Add(single[0]);
+                }
+
+                var parts = Encoding.ASCII.GetString(header.ToArray()).Split(' ');
+                if (parts.Length != 2 || !IsValidHash(parts[0]) ||
+                    !int.TryParse(parts[1], out int length) || length < 0 || length > maxChunkBytes)
+                {
+                    return -1;
+                }
+
+                var data = new byte[length];
+                int filled = 0;
+                while (filled < length)
+                {
+                    int read = await body.ReadAsync(data, filled, length - filled);
+                    if (read == 0) return -1;
+                    filled += read;
+                }
+
+                if (Convert.ToHexString(SHA256.HashData(data)).ToLowerInvariant() != parts[0])
+                {
+                    return -1;
+                }
+
+                await PutAsync(parts[0], data);
+                stored++;
+            }
+        }
+
+        /// <summary>
+        /// Writes the files of a manifest into a zip, the format the rest of the library uses.
+        /// Returns the hashes the store does not have; nothing is written unless that is empty
+        /// </summary>
+        public async Task<List<string>> AssembleZipAsync(ChunkManifest manifest, string zipPath)
+        {
+            var missing = FindMissing(manifest.Files.SelectMany(f => f.Chunks));
+            if (missing.Count > 0)
+            {
+                return missing;
+            }
+
+            using (var zipStream = new FileStream(zipPath, FileMode.Create))
+            using (var archive = new ZipArchive(zipStream, ZipArchiveMode.Create))
+            {
+                foreach (var file in manifest.Files)
+                {
+                    var entryName = file.Path.Replace('\\', '/').TrimStart('/');
+                    if (entryName.Length == 0 || entryName.Split('/').Contains(".."))
+                    {
+                        throw new InvalidDataException($"Invalid path in manifest: {file.Path}");
+                    }
+
+                    var entry = archive.CreateEntry(entryName, CompressionLevel.Fastest);
+                    using var entryStream = entry.Open();
+                    foreach (var hash in file.Chunks)
+                    {
+                        using var chunk = File.OpenRead(ChunkPath(hash));
+                        await chunk.CopyToAsync(entryStream);
+                    }
+                }
+            }
+
+            return missing;
+        }
+
+        private async Task PutAsync(string hash, byte[] data)
+        {
+            var path = ChunkPath(hash);
+            if (File.Exists(path))
+            {
+                return;
+            }
+
+            Directory.CreateDirectory(Path.GetDirectoryName(path)!);
+
+            // Written aside and moved in, so a reader never sees a partial chunk
+            var tempPath = path + "." + Guid.NewGuid().ToString("N") + ".tmp";
+            await File.WriteAllBytesAsync(tempPath, data);
+            try
+            {
+                File.Move(tempPath, path);
+            }
+            catch (IOException)
+            {
+                // Another upload stored the same chunk first
+                File.Delete(tempPath);
+            }
+        }
+
+        private string ChunkPath(string hash)
+        {
+            return Path.Combine(_root, hash.Substring(0, 2), hash);
+        }
+    }
+}
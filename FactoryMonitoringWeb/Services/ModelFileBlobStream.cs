@@ -0,0 +1,194 @@
+using FactoryMonitoringWeb.Data;
+using FactoryMonitoringWeb.Models;
+using Microsoft.EntityFrameworkCore;
+using System.Data;
+using System.Data.Common;
+
+namespace FactoryMonitoringWeb.Services
+{
+    /// <summary>
+    /// Read-only, seekable view of ModelFile.FileData that fetches a window at a time with
+    /// SUBSTRING, so serving a byte range reads that range from the database and not the
+    /// whole blob. Lets File() do range processing on a model of any size
+    /// </summary>
+    public class ModelFileBlobStream : Stream
+    {
+        // Range copies ask for small buffers; each query fetches this much ahead of them
+        private const int WindowBytes = 1024 * 1024;
+
+        private readonly DbConnection _connection;
+        private readonly string _table;
+        private readonly int _modelFileId;
+        private readonly long _length;
+        private readonly bool _closeConnection;
+        private long _position;
+        private byte[] _window = Array.Empty<byte>();
+        private long _windowStart;
+
+        private ModelFileBlobStream(DbConnection connection, string table, int modelFileId, long length, bool closeConnection)
+        {
+            _connection = connection;
+            _table = table;
+            _modelFileId = modelFileId;
+            _length = length;
+            _closeConnection = closeConnection;
+        }
+
+        /// <summary>
+        /// Opens the blob of a model file whose stored length is already known
+        /// </summary>
+        public static async Task<ModelFileBlobStream> OpenAsync(FactoryDbContext context, int modelFileId, long length)
+        {
+            var connection = context.Database.GetDbConnection();
+            bool opened = false;
+            if (connection.State != ConnectionState.Open)
+            {
+                await connection.OpenAsync();
+                opened = true;
+            }
+            return new ModelFileBlobStream(connection, TableName(context), modelFileId, length, opened);
+        }
+
+        /// <summary>
+        /// Lowercase hex SHA-256 of a stored blob, read through a sequential stream rather than
+        /// loaded whole
+        /// </summary>
+        public static async Task<string> HashAsync(FactoryDbContext context, int modelFileId)
+        {
+            var connection = context.Database.GetDbConnection();
+            bool opened = false;
+            if (connection.State != ConnectionState.Open)
+            {
+                await connection.OpenAsync();
+                opened = true;
+            }
+
+            try
+            {
+                using var command = connection.CreateCommand();
+                command.CommandText = $"SELECT FileData FROM {TableName(context)} WHERE ModelFileId = @id";
+                AddParameter(command, "@id", modelFileId);
+
+                using var reader = await command.ExecuteReaderAsync(CommandBehavior.SequentialAccess);
+                if (!await reader.ReadAsync())
+                {
+                    throw new InvalidOperationException($"Model file {modelFileId} not found");
+                }
+                using var blob = reader.GetStream(0);
+                return await ModelFileDigest.ComputeAsync(blob);
+            }
+            finally
+            {
+                if (opened)
+                {
+                    await connection.CloseAsync();
+                }
+            }
+        }
+
+        public override bool CanRead => true;
+        public override bool CanSeek => true;
+        public override bool CanWrite => false;
+        public override long Length => _length;
+
+        public override long Position
+        {
+            get => _position;
+            set => Seek(value, SeekOrigin.Begin);
+        }
+
+        public override long Seek(long offset, SeekOrigin origin)
+        {
+            long target = origin switch
+            {
+                SeekOrigin.Begin => offset,
+                SeekOrigin.Current => _position + offset,
+                _ => _length + offset
+            };
+            if (target < 0)
+            {
+                throw new IOException("Seek before the start of the model file");
+            }
+            _position = target;
+            return _position;
+        }
+
+        public override int Read(byte[] buffer, int offset, int count)
+        {
+            return ReadAsync(buffer.AsMemory(offset, count)).AsTask().GetAwaiter().GetResult();
+        }
+
+        public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken)
+        {
+            return ReadAsync(buffer.AsMemory(offset, count), cancellationToken).AsTask();
+        }
+
+        public override async ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default)
+        {
+            if (_position >= _length || buffer.Length == 0)
+            {
+                return 0;
+            }
+
+            if (_position < _windowStart || _position >= _windowStart + _window.Length)
+            {
+                await FetchWindowAsync(_position, cancellationToken);
+                if (_window.Length == 0)
+                {
+                    return 0;
+                }
+            }
+
+            int within = (int)(_position - _windowStart);
+            int count = Math.Min(buffer.Length, _window.Length - within);
+            _window.AsMemory(within, count).CopyTo(buffer);
+            _position += count;
+            return count;
+        }
+
+        private async Task FetchWindowAsync(long start, CancellationToken cancellationToken)
+        {
+            using var command = _connection.CreateCommand();
+            // SUBSTRING is 1-based
+            command.CommandText = $"SELECT SUBSTRING(FileData, @start, @count) FROM {_table} WHERE ModelFileId = @id";
+            AddParameter(command, "@start", start + 1);
+            AddParameter(command, "@count", (long)Math.Min(WindowBytes, _length - start));
+            AddParameter(command, "@id", _modelFileId);
+
+            var result = await command.ExecuteScalarAsync(cancellationToken);
+            _window = result as byte[] ?? Array.Empty<byte>();
+            _windowStart = start;
+        }
+
+        private static string TableName(FactoryDbContext context)
+        {
+            var entity = context.Model.FindEntityType(typeof(ModelFile))!;
+            var schema = entity.GetSchema();
+            return schema == null ? $"[{entity.GetTableName()}]" : $"[{schema}].[{entity.GetTableName()}]";
+        }
+
+        private static void AddParameter(DbCommand command, string name, object value)
+        {
+            var parameter = command.CreateParameter();
+            parameter.ParameterName = name;
+            parameter.Value = value;
+            command.Parameters.Add(parameter);
+        }
+
+        public override void Flush()
+        {
+        }
+
+        public override void SetLength(long value) => throw new NotSupportedException();
+        public override void Write(byte[] buffer, int offset, int count) => throw new NotSupportedException();
+
+        protected override void Dispose(bool disposing)
+        {
+            if (disposing && _closeConnection)
+            {
+                _connection.Close();
+            }
+            base.Dispose(disposing);
+        }
+    }
+}
@@ -0,0 +1,40 @@
+using FactoryMonitoringWeb.Models;
+using System.Security.Cryptography;
+
+namespace FactoryMonitoringWeb.Services
+{
+    /// <summary>
+    /// Content digest of a stored model file. Files are never modified in place, so the
+    /// digest is computed once, kept in ModelFile.ContentSha256 and serves as a strong ETag
+    /// </summary>
+    public static class ModelFileDigest
+    {
+        /// <summary>
+        /// Returns the digest, computing it into the entity when missing. The caller saves
+        /// the entity when this returns true in computed
+        /// </summary>
+        public static string Ensure(ModelFile modelFile, out bool computed)
+        {
+            computed = false;
+            if (string.IsNullOrEmpty(modelFile.ContentSha256))
+            {
+                modelFile.ContentSha256 = Compute(modelFile.FileData);
+                computed = true;
+            }
+            return modelFile.ContentSha256;
+        }
+
+        /// <summary>
+        /// Set when a model file is stored, so downloads never hash it on the way out
+        /// </summary>
+        public static string Compute(byte[] data)
+        {
+            return Convert.ToHexString(SHA256.HashData(data)).ToLowerInvariant();
+        }
+
+        public static async Task<string> ComputeAsync(Stream data)
+        {
+            return Convert.ToHexString(await SHA256.HashDataAsync(data)).ToLowerInvariant();
+        }
+    }
+}
@@ -21,6 +21,10 @@ CREATE TABLE FactoryPCs (
     RegisteredDate DATETIME DEFAULT GETDATE(),
     LastUpdated DATETIME DEFAULT GETDATE(),
     LogStructureJson NVARCHAR(MAX) NULL, -- Added for Log Analyzer
+    LogStructureVersion NVARCHAR(32) NULL, -- Agent's fingerprint of the tree in LogStructureJson; log deltas apply only on top of it
+    AgentMetricsJson NVARCHAR(MAX) NULL, -- Latest request latency summary from the agent heartbeat
+    AgentMetricsUpdated DATETIME NULL,
+    AgentFeatures NVARCHAR(200) NULL, -- Protocol features negotiated at registration (e.g. configdelta)
     CONSTRAINT UC_LinePC_Version UNIQUE(LineNumber, PCNumber, ModelVersion)
 );
 GO
@@ -74,7 +78,8 @@ CREATE TABLE ModelFiles (
     IsActive BIT DEFAULT 1,
     IsTemplate BIT NOT NULL DEFAULT 0,
     Description NVARCHAR(500) NULL,
-    Category NVARCHAR(100) NULL
+    Category NVARCHAR(100) NULL,
+    ContentSha256 NVARCHAR(64) NULL -- ETag for conditional downloads, filled on first download
 );
 GO
 
@@ -26,6 +26,7 @@ export default function LogAnalyzer() {
     // State: Data
     const [pcs, setPCs] = useState<PCWithVersion[]>([]);
     const [logFiles, setLogFiles] = useState<LogFileNode[]>([]);
+    const [agentAnalysis, setAgentAnalysis] = useState(false);
     const [analysisResult, setAnalysisResult] = useState<AnalysisResult | null>(null);
 
     // ... (rest of the component logic remains exactly the same)
@@ -66,6 +67,7 @@ export default function LogAnalyzer() {
     const handlePCClick = async (pc: PCWithVersion) => {
         setSelectedPC(pc);
         setLogFiles([]);
+        setAgentAnalysis(false);
         setSelectedFile(null);
         setAnalysisResult(null);
         setSelectedBarrel(null);
@@ -74,6 +76,7 @@ export default function LogAnalyzer() {
         try {
             const structure = await logAnalyzerApi.getLogStructure(pc.pcId);
             setLogFiles(structure.files);
+            setAgentAnalysis(structure.agentAnalysis === true);
         } catch (error: any) {
             alert(`Failed to load log files: ${error.message}`);
         } finally {
@@ -89,12 +92,18 @@ export default function LogAnalyzer() {
         setAnalyzing(true);
 
         try {
-            // 1. Fetch Content
-            const contentData = await logAnalyzerApi.getLogFileContent(selectedPC.pcId, filePath);
-
-            // 2. Parse Immediately
-            // We pass the fileName to the parser to store it in the result
-            const result = parseLogContent(contentData.content, contentData.fileName);
+            let result: AnalysisResult;
+            if (agentAnalysis) {
+                // The agent parses the log itself and sends only the barrel timelines
+                result = await logAnalyzerApi.analyzeLogFile(selectedPC.pcId, filePath);
+            } else {
+                // 1. Fetch Content
+                const contentData = await logAnalyzerApi.getLogFileContent(selectedPC.pcId, filePath);
+
+                // 2. Parse Immediately
+                // We pass the fileName to the parser to store it in the result
+                result = parseLogContent(contentData.content, contentData.fileName);
+            }
 
             // 3. Open Analysis Modal Directly
             setAnalysisResult(result);
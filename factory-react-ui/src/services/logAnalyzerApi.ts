@@ -1,4 +1,4 @@
-﻿import type { LogFileStructure, LogFileContent } from '../types/logTypes';
+﻿import type { LogFileStructure, LogFileContent, AnalysisResult, CompactAnalysisResult } from '../types/logTypes';
 
 const API_BASE = '/api';
 
@@ -25,6 +25,44 @@ export const logAnalyzerApi = {
         return response.json();
     },
 
+    // Barrel analysis done on the agent; only for PCs whose structure reports agentAnalysis
+    async analyzeLogFile(pcId: number, filePath: string): Promise<AnalysisResult> {
+        const response = await fetch(`${API_BASE}/LogAnalyzer/analyze/${pcId}`, {
+            method: 'POST',
+            headers: { 'Content-Type': 'application/json' },
+            body: JSON.stringify({ filePath })
+        });
+        if (!response.ok) {
+            const error = await response.json().catch(() => ({ error: response.statusText }));
+            throw new Error(error.error || `Failed to analyze log file: ${response.statusText}`);
+        }
+
+        // Expanded to what parseLogContent returns; times relative to the barrel's first operation
+        const compact: CompactAnalysisResult = await response.json();
+        return {
+            barrels: compact.barrels.map(barrel => {
+                const firstStart = barrel.operations.length > 0 ? barrel.operations[0][2] : 0;
+                return {
+                    barrelId: barrel.barrelId,
+                    totalExecutionTime: barrel.totalExecutionTime,
+                    operations: barrel.operations.map(([name, sequence, start, end, actual, ideal]) => ({
+                        operationName: compact.sequences[name],
+                        sequence,
+                        barrelId: barrel.barrelId,
+                        startTime: start - firstStart,
+                        endTime: end - firstStart,
+                        globalStartTime: start,
+                        globalEndTime: end,
+                        actualDuration: actual,
+                        idealDuration: ideal
+                    }))
+                };
+            }),
+            summary: compact.summary,
+            fileName: compact.fileName
+        };
+    },
+
     async downloadLogFile(pcId: number, filePath: string): Promise<Blob> {
         const response = await fetch(`${API_BASE}/LogAnalyzer/download/${pcId}`, {
             method: 'POST',
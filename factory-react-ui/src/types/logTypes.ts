@@ -47,6 +47,19 @@ export interface AnalysisResult {
     fileName?: string;
 }
 
+// AnalyzeLogFile as the agent sends it: each sequence name once, each operation as
+// [name index, sequence, globalStartTime, globalEndTime, actualDuration, idealDuration]
+export interface CompactAnalysisResult {
+    sequences: string[];
+    barrels: {
+        barrelId: string;
+        totalExecutionTime: number;
+        operations: [number, number, number, number, number, number][];
+    }[];
+    summary: AnalysisResult['summary'];
+    fileName?: string;
+}
+
 export interface FactoryPC {
     pcId: number;
     pcNumber: number;
@@ -59,4 +72,5 @@ export interface FactoryPC {
 
 export interface LogFileStructure {
     files: LogFileNode[];
+    agentAnalysis?: boolean;    // the PC's agent can analyze a log itself (AnalyzeLogFile)
 }